@@ -0,0 +1,87 @@
+/*
+ * RAM emulation of a NOR flash, shared by the tests of the flash based stores.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-31
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_TESTS_RAMFLASHSTORAGE_H
+#define UBIRCH_MBED_CRYPTO_TESTS_RAMFLASHSTORAGE_H
+
+#include <cstring>
+#include <FlashStorage.h>
+
+#define RAM_FLASH_PROGRAM_SIZE 8
+
+// counts the erase cycles per sector and can be cut off after a number of program operations
+class RAMFlashStorage : public FlashStorage {
+public:
+    unsigned char *memory;
+    unsigned int *erases;
+    // program operations left before the flash fails, -1 for no limit
+    int programs;
+
+    RAMFlashStorage(size_t length, size_t sector) : programs(-1), length(length), sector(sector) {
+        memory = new unsigned char[length];
+        erases = new unsigned int[length / sector];
+        memset(memory, 0xFF, length);
+        memset(erases, 0, length / sector * sizeof(unsigned int));
+    }
+
+    ~RAMFlashStorage() {
+        delete[] memory;
+        delete[] erases;
+    }
+
+    const unsigned char *address() { return memory; }
+
+    size_t size() { return length; }
+
+    size_t sectorSize() { return sector; }
+
+    size_t programSize() { return RAM_FLASH_PROGRAM_SIZE; }
+
+    bool erase(size_t offset, size_t length) {
+        if (offset % sector || length % sector || offset + length > this->length) return false;
+        memset(memory + offset, 0xFF, length);
+        for (size_t s = offset / sector; s < (offset + length) / sector; s++) erases[s]++;
+        return true;
+    }
+
+    bool program(size_t offset, const void *data, size_t length) {
+        if (offset % RAM_FLASH_PROGRAM_SIZE || length % RAM_FLASH_PROGRAM_SIZE || offset + length > this->length) {
+            return false;
+        }
+        if (programs == 0) return false;
+        if (programs > 0) programs--;
+        for (size_t i = 0; i < length; i++) if (memory[offset + i] != 0xFF) return false;
+        memcpy(memory + offset, data, length);
+        return true;
+    }
+
+private:
+    size_t length;
+    size_t sector;
+
+    RAMFlashStorage(const RAMFlashStorage &);
+
+    RAMFlashStorage &operator=(const RAMFlashStorage &);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_TESTS_RAMFLASHSTORAGE_H
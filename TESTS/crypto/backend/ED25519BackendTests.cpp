@@ -0,0 +1,178 @@
+/*
+ * Tests and benchmark of the ED25519 backend of the target. The comparison
+ * with other implementations runs on the host, see tools/BackendComparison.cpp.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-29
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <ED25519Backend.h>
+#include <KeyPair.h>
+#include <SHA512.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define BENCHMARK_ROUNDS 10
+#define MESSAGE_SIZE 256
+
+// RFC 8032, 7.1 TEST 1
+static const unsigned char rfcSecretKey[crypto_sign_SECRETKEYBYTES] = {
+        0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+        0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60,
+        0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+        0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a
+};
+static const unsigned char rfcSignature[crypto_sign_BYTES] = {
+        0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+        0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+        0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+        0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b
+};
+
+static unsigned char message[MESSAGE_SIZE];
+
+static uint32_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<uint32_t>(__rdtsc());
+#elif defined(DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    return DWT->CYCCNT;
+#else
+    return us_ticker_read();
+#endif
+}
+
+void TestBackendTestVector() {
+    ED25519ExpandedKey expanded;
+    ed25519Expand(&expanded, rfcSecretKey);
+    const ED25519Segment empty = {NULL, 0};
+    unsigned char publicKey[crypto_sign_PUBLICKEYBYTES];
+    unsigned char signature[crypto_sign_BYTES];
+
+    ED25519DefaultBackend::derivePublicKey(publicKey, &expanded);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rfcSecretKey + ED25519_SEED_BYTES, publicKey, sizeof(publicKey));
+    ED25519DefaultBackend::sign(signature, &expanded, publicKey, &empty, 1);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rfcSignature, signature, sizeof(signature));
+    TEST_ASSERT_TRUE(ED25519DefaultBackend::verify(signature, publicKey, &empty, 1));
+    signature[7] ^= 0x80;
+    TEST_ASSERT_FALSE(ED25519DefaultBackend::verify(signature, publicKey, &empty, 1));
+
+    // y = 2 is not on the curve
+    const unsigned char invalid[crypto_sign_PUBLICKEYBYTES] = {2};
+    TEST_ASSERT_FALSE(ED25519DefaultBackend::verify(rfcSignature, invalid, &empty, 1));
+}
+
+void TestBackendKeyPair() {
+    unsigned char signedMessage[crypto_sign_BYTES + MESSAGE_SIZE];
+    unsigned char openedMessage[crypto_sign_BYTES + MESSAGE_SIZE];
+    crypto_uint16 signedLength, openedLength;
+
+    // a generated key pair signs what crypto_sign_open() accepts
+    ED25519KeyPair generated;
+    generated.generate();
+    ED25519Signature *signature = generated.sign(message, MESSAGE_SIZE);
+    memcpy(signedMessage, signature->signature, crypto_sign_BYTES);
+    memcpy(signedMessage + crypto_sign_BYTES, message, MESSAGE_SIZE);
+    TEST_ASSERT_EQUAL_INT(0, crypto_sign_open(openedMessage, &openedLength, signedMessage,
+                                              crypto_sign_BYTES + MESSAGE_SIZE, generated.getPublicKey()->key));
+    delete signature;
+
+    // the signatures are the ones of crypto_sign()
+    ED25519PublicKey publicKey;
+    ED25519PrivateKey privateKey;
+    crypto_sign_keypair(publicKey.key, privateKey.key);
+    ED25519KeyPair linked;
+    linked.link(&publicKey, &privateKey);
+    crypto_sign(signedMessage, &signedLength, message, MESSAGE_SIZE, privateKey.key);
+    signature = linked.sign(message, MESSAGE_SIZE);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signedMessage, signature->signature, crypto_sign_BYTES);
+    TEST_ASSERT_TRUE(linked.verify(message, MESSAGE_SIZE, signature));
+    signature->signature[7] ^= 0x80;
+    TEST_ASSERT_FALSE(linked.verify(message, MESSAGE_SIZE, signature));
+    delete signature;
+
+    // a seed derives the public key of the NaCl secret key
+    ED25519KeyPair seeded;
+    TEST_ASSERT_TRUE(seeded.importSeed(privateKey.key, ED25519_SEED_BYTES));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(publicKey.key, seeded.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+}
+
+void TestBackendBenchmark() {
+    unsigned char seed[ED25519_SEED_BYTES];
+    unsigned char publicKey[crypto_sign_PUBLICKEYBYTES];
+    unsigned char signature[crypto_sign_BYTES];
+    ED25519ExpandedKey expanded;
+    const ED25519Segment segment = {message, 64};
+    randombytes(seed, sizeof(seed));
+    ed25519Expand(&expanded, seed);
+
+    uint32_t start = cycles();
+    for (int n = 0; n < BENCHMARK_ROUNDS; n++) ED25519DefaultBackend::derivePublicKey(publicKey, &expanded);
+    const uint32_t generateCycles = cycles() - start;
+
+    start = cycles();
+    for (int n = 0; n < BENCHMARK_ROUNDS; n++) {
+        ED25519DefaultBackend::sign(signature, &expanded, publicKey, &segment, 1);
+    }
+    const uint32_t signCycles = cycles() - start;
+
+    bool valid = true;
+    start = cycles();
+    for (int n = 0; n < BENCHMARK_ROUNDS; n++) {
+        valid &= ED25519DefaultBackend::verify(signature, publicKey, &segment, 1);
+    }
+    const uint32_t verifyCycles = cycles() - start;
+    TEST_ASSERT_TRUE(valid);
+
+    printf("64 byte message, cycles per operation\r\n");
+    printf("%-10s generate %10lu, sign %10lu, verify %10lu\r\n", ED25519DefaultBackend::name(),
+           (unsigned long) (generateCycles / BENCHMARK_ROUNDS), (unsigned long) (signCycles / BENCHMARK_ROUNDS),
+           (unsigned long) (verifyCycles / BENCHMARK_ROUNDS));
+    ed25519Wipe(&expanded, sizeof(expanded));
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(300, "default_auto");
+    randombytes(message, sizeof(message));
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Backend RFC 8032 test vector", TestBackendTestVector, greentea_case_failure_abort_handler),
+            Case("Backend key pair", TestBackendKeyPair, greentea_case_failure_abort_handler),
+            Case("Backend benchmark", TestBackendBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -104,6 +104,74 @@ control_t TestBase64PowerOfTwoPlusOne(const size_t n) {
     return (n < 4) ? CaseRepeatAll : CaseNext;
 }
 
+void TestBase64Encoder() {
+    Base64 base64;
+    Base64Encoder encoder;
+
+    const size_t size = 1000;
+    unsigned char *orig = new unsigned char[size];
+    randombytes(orig, size);
+
+    // chunks of every size from 1 to 7 must give the same result as the one-shot encoder
+    for (size_t chunk = 1; chunk <= 7; chunk++) {
+        for (size_t length = size - 3; length <= size; length++) {
+            size_t expectedLength;
+            char *expected = base64.Encode(reinterpret_cast<const char *>(orig), length, &expectedLength);
+
+            char *encoded = new char[expectedLength + Base64Encoder::MaxOutput(chunk)];
+            size_t encodedLength = 0;
+            for (size_t i = 0; i < length; i += chunk) {
+                const size_t n = length - i < chunk ? length - i : chunk;
+                encodedLength += encoder.Update(orig + i, n, encoded + encodedLength);
+            }
+            encodedLength += encoder.Finish(encoded + encodedLength);
+
+            TEST_ASSERT_EQUAL_INT(expectedLength, encodedLength);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, encoded, expectedLength);
+
+            delete[] expected;
+            delete[] encoded;
+        }
+    }
+
+    delete[] orig;
+}
+
+void TestBase64DecodeInPlace() {
+    Base64 base64;
+
+    const char *vectors[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char *encoded[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    unsigned char decoded[6];
+    size_t o;
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        TEST_ASSERT_TRUE(base64.Decode(encoded[i], strlen(encoded[i]), decoded, strlen(vectors[i]), &o));
+        TEST_ASSERT_EQUAL_INT(strlen(vectors[i]), o);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(vectors[i], decoded, o);
+    }
+
+    // broken input and too small buffers are rejected
+    TEST_ASSERT_FALSE(base64.Decode("Zm9vYmFy", 8, decoded, 5, &o));
+    TEST_ASSERT_FALSE(base64.Decode("Zm9vYmF", 7, decoded, sizeof(decoded), &o));
+    TEST_ASSERT_FALSE(base64.Decode("Zm9v*mFy", 8, decoded, sizeof(decoded), &o));
+    TEST_ASSERT_FALSE(base64.Decode("Zg=v", 4, decoded, sizeof(decoded), &o));
+    TEST_ASSERT_FALSE(base64.Decode("Z===", 4, decoded, sizeof(decoded), &o));
+    TEST_ASSERT_FALSE(base64.Decode("Zg==Zg==", 8, decoded, sizeof(decoded), &o));
+
+    // the decoded bytes can overwrite the encoded characters
+    const size_t size = 1001;
+    unsigned char *orig = new unsigned char[size];
+    randombytes(orig, size);
+    size_t encodedLength;
+    char *buffer = base64.Encode(reinterpret_cast<const char *>(orig), size, &encodedLength);
+    unsigned char *inPlace = reinterpret_cast<unsigned char *>(buffer);
+    TEST_ASSERT_TRUE(base64.Decode(buffer, encodedLength, inPlace, encodedLength, &o));
+    TEST_ASSERT_EQUAL_INT(size, o);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(orig, inPlace, size);
+
+    delete[] orig;
+    delete[] buffer;
+}
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
     GREENTEA_SETUP(200, "default_auto");
@@ -116,6 +184,8 @@ int main() {
             Case("Base64 RFC 4648 test vectors", TestBase64RFC4648, greentea_case_failure_abort_handler),
             Case("Base64 size power of 2 test", TestBase64PowerOfTwo, greentea_case_failure_abort_handler),
             Case("Base64 size power of 2+1 test", TestBase64PowerOfTwoPlusOne, greentea_case_failure_abort_handler),
+            Case("Base64 streaming encoder", TestBase64Encoder, greentea_case_failure_abort_handler),
+            Case("Base64 decode in place", TestBase64DecodeInPlace, greentea_case_failure_abort_handler),
 
     };
 
@@ -0,0 +1,161 @@
+/*
+ * Tests for the verified signature cache.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-13
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <VerificationCache.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define PACKET_SIZE 36
+#define PACKETS 16
+
+// retransmit trace: packet index per received copy, about 30% of the packets arrive more than once
+static const int trace[] = {
+        0, 1, 1, 2, 3, 4, 4, 4, 5, 6, 7, 7, 8, 9, 10, 11, 11, 12, 13, 13, 14, 15
+};
+
+#define TRACE_LENGTH (int) (sizeof(trace) / sizeof(trace[0]))
+
+static ED25519KeyPair sender;
+static unsigned char packets[PACKETS][PACKET_SIZE];
+static ED25519Signature signatureStore[PACKETS];
+static const ED25519Signature *signatures[PACKETS];
+
+static void createPackets() {
+    sender.generate();
+    for (int i = 0; i < PACKETS; i++) {
+        randombytes(packets[i], PACKET_SIZE);
+        ED25519Signature *signature = sender.sign(packets[i], PACKET_SIZE);
+        signatureStore[i] = *signature;
+        signatures[i] = &signatureStore[i];
+        delete signature;
+    }
+}
+
+void TestCacheHit() {
+    VerificationCache cache;
+
+    TEST_ASSERT_TRUE(cache.verify(sender, packets[0], PACKET_SIZE, signatures[0]));
+    TEST_ASSERT_EQUAL_UINT32(0, cache.hits());
+    TEST_ASSERT_EQUAL_UINT32(1, cache.misses());
+
+    TEST_ASSERT_TRUE_MESSAGE(cache.verify(sender, packets[0], PACKET_SIZE, signatures[0]), "cached packet rejected");
+    TEST_ASSERT_EQUAL_UINT32(1, cache.hits());
+    TEST_ASSERT_EQUAL_UINT32(1, cache.misses());
+
+    cache.clear();
+    TEST_ASSERT_TRUE(cache.verify(sender, packets[0], PACKET_SIZE, signatures[0]));
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, cache.misses(), "cleared entry still cached");
+
+    cache.resetCounters();
+    TEST_ASSERT_EQUAL_UINT32(0, cache.hits());
+    TEST_ASSERT_EQUAL_UINT32(0, cache.misses());
+}
+
+void TestCacheForgery() {
+    VerificationCache cache;
+
+    TEST_ASSERT_TRUE(cache.verify(sender, packets[0], PACKET_SIZE, signatures[0]));
+
+    // a modified copy of a cached packet must be verified and fail
+    unsigned char forged[PACKET_SIZE];
+    memcpy(forged, packets[0], PACKET_SIZE);
+    forged[PACKET_SIZE - 1] ^= 1;
+    TEST_ASSERT_FALSE_MESSAGE(cache.verify(sender, forged, PACKET_SIZE, signatures[0]), "forged message accepted");
+    TEST_ASSERT_FALSE_MESSAGE(cache.verify(sender, forged, PACKET_SIZE, signatures[0]), "failure was cached");
+    TEST_ASSERT_FALSE_MESSAGE(cache.verify(sender, packets[0], PACKET_SIZE, signatures[1]), "wrong signature accepted");
+    TEST_ASSERT_EQUAL_UINT32(0, cache.hits());
+    TEST_ASSERT_EQUAL_UINT32(4, cache.misses());
+
+    // the same packet from another key is a different entry
+    ED25519KeyPair other;
+    other.generate();
+    TEST_ASSERT_FALSE_MESSAGE(cache.verify(other, packets[0], PACKET_SIZE, signatures[0]), "wrong key accepted");
+}
+
+void TestCacheEviction() {
+    VerificationCache cache(1);
+
+    for (int i = 0; i < VERIFICATION_CACHE_WAYS + 1; i++) {
+        TEST_ASSERT_TRUE(cache.verify(sender, packets[i], PACKET_SIZE, signatures[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, cache.evictions());
+
+    // the least recently used entry (packet 0) was replaced
+    TEST_ASSERT_TRUE(cache.verify(sender, packets[VERIFICATION_CACHE_WAYS], PACKET_SIZE,
+                                  signatures[VERIFICATION_CACHE_WAYS]));
+    TEST_ASSERT_EQUAL_UINT32(1, cache.hits());
+    TEST_ASSERT_TRUE(cache.verify(sender, packets[0], PACKET_SIZE, signatures[0]));
+    TEST_ASSERT_EQUAL_UINT32(1, cache.hits());
+    TEST_ASSERT_EQUAL_UINT32(2, cache.evictions());
+}
+
+void TestCacheRetransmitTrace() {
+    // retransmits arrive shortly after the original, so they are still cached
+    VerificationCache cache;
+    Timer timer;
+
+    timer.start();
+    for (int i = 0; i < TRACE_LENGTH; i++) {
+        TEST_ASSERT_TRUE(sender.verify(packets[trace[i]], PACKET_SIZE, signatures[trace[i]]));
+    }
+    const int uncachedTime = timer.read_us();
+
+    timer.reset();
+    for (int i = 0; i < TRACE_LENGTH; i++) {
+        TEST_ASSERT_TRUE(cache.verify(sender, packets[trace[i]], PACKET_SIZE, signatures[trace[i]]));
+    }
+    const int cachedTime = timer.read_us();
+    timer.stop();
+
+    TEST_ASSERT_EQUAL_UINT32(PACKETS, cache.misses());
+    TEST_ASSERT_EQUAL_UINT32(TRACE_LENGTH - PACKETS, cache.hits());
+
+    printf("%d packets (%d retransmits): uncached %dus, cached %dus, %u evictions\r\n",
+           TRACE_LENGTH, TRACE_LENGTH - PACKETS, uncachedTime, cachedTime, (unsigned int) cache.evictions());
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(120, "default_auto");
+    createPackets();
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Verification cache hit", TestCacheHit, greentea_case_failure_abort_handler),
+            Case("Verification cache forgery", TestCacheForgery, greentea_case_failure_abort_handler),
+            Case("Verification cache eviction", TestCacheEviction, greentea_case_failure_abort_handler),
+            Case("Verification cache retransmit trace", TestCacheRetransmitTrace, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
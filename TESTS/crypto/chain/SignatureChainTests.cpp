@@ -0,0 +1,200 @@
+/*
+ * Tests for the hash chained message stream.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-15
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <SignatureChain.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define PAYLOAD_SIZE 48
+#define MESSAGES (CHAIN_REORDER_WINDOW + 2)
+
+static ED25519KeyPair sender;
+static unsigned char payloads[MESSAGES][PAYLOAD_SIZE];
+static ED25519Signature previous[MESSAGES];
+static ED25519Signature signatures[MESSAGES];
+
+static void createChain() {
+    sender.generate();
+    randombytes(&payloads[0][0], sizeof(payloads));
+
+    ChainedSigner signer(sender);
+    for (int i = 0; i < MESSAGES; i++) {
+        previous[i] = signer.last();
+        TEST_ASSERT_TRUE(signer.sign(payloads[i], PAYLOAD_SIZE, &signatures[i]));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[i].signature, signer.last().signature, crypto_sign_BYTES);
+    }
+}
+
+void TestChainStandardSignature() {
+    // a chained signature is a plain signature over previous || payload
+    unsigned char message[crypto_sign_BYTES + PAYLOAD_SIZE];
+    for (int i = 0; i < MESSAGES; i++) {
+        memcpy(message, previous[i].signature, crypto_sign_BYTES);
+        memcpy(message + crypto_sign_BYTES, payloads[i], PAYLOAD_SIZE);
+        TEST_ASSERT_TRUE_MESSAGE(sender.verify(message, sizeof(message), &signatures[i]), "not a plain signature");
+        if (i > 0) {
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[i - 1].signature, previous[i].signature, crypto_sign_BYTES);
+        }
+    }
+
+    const unsigned char zero[crypto_sign_BYTES] = {0};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(zero, previous[0].signature, crypto_sign_BYTES, "chain does not start at 0");
+
+    ED25519KeyPair publicOnly;
+    publicOnly.link(sender.getPublicKey());
+    ChainedSigner signer(publicOnly);
+    ED25519Signature signature;
+    TEST_ASSERT_FALSE_MESSAGE(signer.sign(payloads[0], PAYLOAD_SIZE, &signature), "signed without private key");
+}
+
+void TestChainInOrder() {
+    ChainedVerifier verifier(sender);
+
+    for (int i = 0; i < MESSAGES; i++) {
+        TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[i], payloads[i], PAYLOAD_SIZE, &signatures[i]));
+        TEST_ASSERT_EQUAL_INT(CHAIN_DUPLICATE,
+                              verifier.verify(&previous[i], payloads[i], PAYLOAD_SIZE, &signatures[i]));
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[MESSAGES - 1].signature, verifier.last().signature, crypto_sign_BYTES);
+    TEST_ASSERT_EQUAL_UINT32(0, verifier.pending());
+}
+
+void TestChainInvalid() {
+    ChainedVerifier verifier(sender);
+
+    payloads[0][0] ^= 1;
+    TEST_ASSERT_EQUAL_INT(CHAIN_INVALID, verifier.verify(&previous[0], payloads[0], PAYLOAD_SIZE, &signatures[0]));
+    payloads[0][0] ^= 1;
+
+    // claiming a different predecessor breaks the signature
+    TEST_ASSERT_EQUAL_INT(CHAIN_INVALID, verifier.verify(&previous[2], payloads[1], PAYLOAD_SIZE, &signatures[1]));
+
+    ED25519KeyPair other;
+    other.generate();
+    ChainedVerifier otherVerifier(other);
+    TEST_ASSERT_EQUAL_INT(CHAIN_INVALID,
+                          otherVerifier.verify(&previous[0], payloads[0], PAYLOAD_SIZE, &signatures[0]));
+    TEST_ASSERT_EQUAL_UINT32(0, verifier.pending());
+}
+
+void TestChainReorder() {
+    ChainedVerifier verifier(sender);
+
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[0], payloads[0], PAYLOAD_SIZE, &signatures[0]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_PENDING, verifier.verify(&previous[2], payloads[2], PAYLOAD_SIZE, &signatures[2]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_PENDING, verifier.verify(&previous[3], payloads[3], PAYLOAD_SIZE, &signatures[3]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_DUPLICATE,
+                          verifier.verify(&previous[3], payloads[3], PAYLOAD_SIZE, &signatures[3]));
+    TEST_ASSERT_EQUAL_UINT32(2, verifier.pending());
+
+    // the missing message links the waiting ones
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[1], payloads[1], PAYLOAD_SIZE, &signatures[1]));
+    TEST_ASSERT_EQUAL_UINT32(0, verifier.pending());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[3].signature, verifier.last().signature, crypto_sign_BYTES);
+
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[4], payloads[4], PAYLOAD_SIZE, &signatures[4]));
+    TEST_ASSERT_EQUAL_UINT32(0, verifier.dropped());
+}
+
+void TestChainWindowOverflow() {
+    ChainedVerifier verifier(sender);
+
+    // message 0 never arrives, one more message than the window holds waits for it
+    for (int i = 1; i < MESSAGES; i++) {
+        TEST_ASSERT_EQUAL_INT(CHAIN_PENDING,
+                              verifier.verify(&previous[i], payloads[i], PAYLOAD_SIZE, &signatures[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(CHAIN_REORDER_WINDOW, verifier.pending());
+    TEST_ASSERT_EQUAL_UINT32(MESSAGES - 1 - CHAIN_REORDER_WINDOW, verifier.dropped());
+
+    // message 1 was dropped, so the chain only moves by one
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[0], payloads[0], PAYLOAD_SIZE, &signatures[0]));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[0].signature, verifier.last().signature, crypto_sign_BYTES);
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[1], payloads[1], PAYLOAD_SIZE, &signatures[1]));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[MESSAGES - 1].signature, verifier.last().signature, crypto_sign_BYTES);
+}
+
+void TestChainRetransmitWhilePending() {
+    ChainedVerifier verifier(sender);
+
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[0], payloads[0], PAYLOAD_SIZE, &signatures[0]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[1], payloads[1], PAYLOAD_SIZE, &signatures[1]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_PENDING, verifier.verify(&previous[3], payloads[3], PAYLOAD_SIZE, &signatures[3]));
+
+    // retransmitted links must not push the waiting message out of the window
+    for (int i = 0; i < 2 * CHAIN_REORDER_WINDOW; i++) {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(CHAIN_DUPLICATE,
+                                      verifier.verify(&previous[0], payloads[0], PAYLOAD_SIZE, &signatures[0]),
+                                      "linked message verified again");
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, verifier.pending());
+    TEST_ASSERT_EQUAL_UINT32(0, verifier.dropped());
+
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[2], payloads[2], PAYLOAD_SIZE, &signatures[2]));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[3].signature, verifier.last().signature, crypto_sign_BYTES);
+    TEST_ASSERT_EQUAL_INT(CHAIN_DUPLICATE, verifier.verify(&previous[1], payloads[1], PAYLOAD_SIZE, &signatures[1]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_DUPLICATE, verifier.verify(&previous[2], payloads[2], PAYLOAD_SIZE, &signatures[2]));
+    TEST_ASSERT_EQUAL_UINT32(0, verifier.pending());
+}
+
+void TestChainContinue() {
+    // a chain continued from a stored signature matches the original chain
+    ChainedSigner signer(sender, &signatures[1]);
+    ED25519Signature signature;
+    TEST_ASSERT_TRUE(signer.sign(payloads[2], PAYLOAD_SIZE, &signature));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signatures[2].signature, signature.signature, crypto_sign_BYTES);
+
+    ChainedVerifier verifier(sender, &signatures[2]);
+    TEST_ASSERT_EQUAL_INT(CHAIN_DUPLICATE, verifier.verify(&previous[2], payloads[2], PAYLOAD_SIZE, &signatures[2]));
+    TEST_ASSERT_EQUAL_INT(CHAIN_LINKED, verifier.verify(&previous[3], payloads[3], PAYLOAD_SIZE, &signatures[3]));
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    createChain();
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Chain standard signature", TestChainStandardSignature, greentea_case_failure_abort_handler),
+            Case("Chain in order", TestChainInOrder, greentea_case_failure_abort_handler),
+            Case("Chain invalid", TestChainInvalid, greentea_case_failure_abort_handler),
+            Case("Chain reorder", TestChainReorder, greentea_case_failure_abort_handler),
+            Case("Chain window overflow", TestChainWindowOverflow, greentea_case_failure_abort_handler),
+            Case("Chain retransmit while pending", TestChainRetransmitWhilePending,
+                 greentea_case_failure_abort_handler),
+            Case("Chain continue", TestChainContinue, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -0,0 +1,209 @@
+/*
+ * Tests for the precomputed signing context.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-28
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <new>
+#include <nacl/armnacl.h>
+#include <SigningContext.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define MESSAGE_SIZE 256
+#define BENCHMARK_ROUNDS 20
+
+static ED25519KeyPair keyPair;
+static unsigned char message[MESSAGE_SIZE];
+
+static bool contains(const unsigned char *data, size_t length, const unsigned char *needle, size_t needleLength) {
+    for (size_t i = 0; i + needleLength <= length; i++) {
+        if (memcmp(data + i, needle, needleLength) == 0) return true;
+    }
+    return false;
+}
+
+void TestSigningContextSign() {
+    ED25519SigningContext context(keyPair);
+    TEST_ASSERT_TRUE(context.valid());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(keyPair.getPublicKey()->key, context.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+
+    // the signatures are the same as the ones of the key pair, and of crypto_sign()
+    const size_t lengths[] = {0, 1, 63, 64, 96, 127, 128, MESSAGE_SIZE};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        ED25519Signature signature;
+        TEST_ASSERT_TRUE(context.sign(message, lengths[i], signature));
+        ED25519Signature *expected = keyPair.sign(message, lengths[i]);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected->signature, signature.signature, crypto_sign_BYTES);
+        delete expected;
+
+        ED25519Signature *allocated = context.sign(message, lengths[i]);
+        TEST_ASSERT_NOT_NULL(allocated);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(signature.signature, allocated->signature, crypto_sign_BYTES);
+        delete allocated;
+    }
+
+    // crypto_sign() prepends the signature to the message
+    ED25519PublicKey publicKey;
+    ED25519PrivateKey privateKey;
+    crypto_sign_keypair(publicKey.key, privateKey.key);
+    ED25519KeyPair linked;
+    linked.link(&publicKey, &privateKey);
+    TEST_ASSERT_TRUE(context.load(linked));
+
+    unsigned char signedMessage[crypto_sign_BYTES + MESSAGE_SIZE];
+    crypto_uint16 signedLength;
+    ED25519Signature signature;
+    crypto_sign(signedMessage, &signedLength, message, MESSAGE_SIZE, privateKey.key);
+    TEST_ASSERT_TRUE(context.sign(message, MESSAGE_SIZE, signature));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signedMessage, signature.signature, crypto_sign_BYTES);
+}
+
+void TestSigningContextSegments() {
+    ED25519SigningContext context(keyPair);
+    const ED25519Segment segments[] = {{message, 10}, {NULL, 0}, {message + 10, 118}, {message + 128, 128}};
+    ED25519Signature signature, expected;
+
+    TEST_ASSERT_TRUE(context.sign(segments, 4, signature));
+    TEST_ASSERT_TRUE(context.sign(message, MESSAGE_SIZE, expected));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.signature, signature.signature, crypto_sign_BYTES);
+
+    const ED25519Segment broken[] = {{message, 10}, {NULL, 5}};
+    TEST_ASSERT_FALSE(context.sign(broken, 2, signature));
+    TEST_ASSERT_FALSE(context.sign(segments, 0, signature));
+    TEST_ASSERT_FALSE(context.sign(static_cast<const ED25519Segment *>(NULL), 1, signature));
+    TEST_ASSERT_FALSE(context.sign(static_cast<const unsigned char *>(NULL), 1, signature));
+    TEST_ASSERT_NULL(context.sign(NULL, 1));
+}
+
+void TestSigningContextKeys() {
+    ED25519Signature signature;
+
+    ED25519SigningContext empty;
+    TEST_ASSERT_FALSE(empty.valid());
+    TEST_ASSERT_NULL(empty.getPublicKey());
+    TEST_ASSERT_FALSE(empty.sign(message, MESSAGE_SIZE, signature));
+
+    // a public key alone can not sign
+    ED25519KeyPair publicOnly;
+    publicOnly.link(keyPair.getPublicKey());
+    TEST_ASSERT_FALSE(empty.load(publicOnly));
+    TEST_ASSERT_FALSE(empty.valid());
+
+    // a seed only key pair derives its public key
+    unsigned char seed[ED25519_SEED_BYTES];
+    randombytes(seed, sizeof(seed));
+    ED25519KeyPair *seedPair = new ED25519KeyPair();
+    TEST_ASSERT_TRUE(seedPair->importSeed(seed, sizeof(seed)));
+    TEST_ASSERT_TRUE(empty.load(*seedPair));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(seedPair->getPublicKey()->key, empty.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    ED25519PublicKey seedPublicKey;
+    memcpy(&seedPublicKey, seedPair->getPublicKey(), sizeof(seedPublicKey));
+
+    // the context does not depend on the key pair anymore
+    delete seedPair;
+    TEST_ASSERT_TRUE(empty.sign(message, MESSAGE_SIZE, signature));
+    ED25519KeyPair verifier;
+    verifier.link(&seedPublicKey);
+    TEST_ASSERT_TRUE(verifier.verify(message, MESSAGE_SIZE, &signature));
+
+    empty.clear();
+    TEST_ASSERT_FALSE(empty.valid());
+    TEST_ASSERT_FALSE(empty.sign(message, MESSAGE_SIZE, signature));
+}
+
+void TestSigningContextWipe() {
+    ED25519PrivateKey privateKey;
+    ED25519PublicKey publicKey;
+    crypto_sign_keypair(publicKey.key, privateKey.key);
+    ED25519KeyPair imported;
+    imported.link(&publicKey, &privateKey);
+    ED25519ExpandedKey expanded;
+    ed25519Expand(&expanded, privateKey.key);
+
+    uint64_t storage[(sizeof(ED25519SigningContext) + 7) / 8];
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(storage);
+    ED25519SigningContext *context = new(storage) ED25519SigningContext(imported);
+    TEST_ASSERT_TRUE(context->valid());
+    TEST_ASSERT_TRUE(contains(bytes, sizeof(ED25519SigningContext), expanded.scalar, sizeof(expanded.scalar)));
+    TEST_ASSERT_TRUE(contains(bytes, sizeof(ED25519SigningContext), expanded.prefix, sizeof(expanded.prefix)));
+
+    context->~ED25519SigningContext();
+    TEST_ASSERT_FALSE_MESSAGE(contains(bytes, sizeof(ED25519SigningContext), expanded.scalar, sizeof(expanded.scalar)),
+                              "scalar not wiped");
+    TEST_ASSERT_FALSE_MESSAGE(contains(bytes, sizeof(ED25519SigningContext), expanded.prefix, sizeof(expanded.prefix)),
+                              "prefix not wiped");
+    ed25519Wipe(&expanded, sizeof(expanded));
+}
+
+void TestSigningContextBenchmark() {
+    ED25519SigningContext context(keyPair);
+    ED25519PrivateKey privateKey;
+    ED25519PublicKey publicKey;
+    crypto_sign_keypair(publicKey.key, privateKey.key);
+    unsigned char *signedMessage = new unsigned char[crypto_sign_BYTES + MESSAGE_SIZE];
+    crypto_uint16 signedLength;
+    ED25519Signature signature;
+    Timer timer;
+
+    timer.start();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) crypto_sign(signedMessage, &signedLength, message, 64, privateKey.key);
+    const int naclTime = timer.read_us();
+
+    timer.reset();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) delete keyPair.sign(message, 64);
+    const int keyPairTime = timer.read_us();
+
+    timer.reset();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) context.sign(message, 64, signature);
+    const int contextTime = timer.read_us();
+    timer.stop();
+
+    delete[] signedMessage;
+    printf("64 byte message: crypto_sign %dus, key pair %dus, signing context %dus per signature\r\n",
+           naclTime / BENCHMARK_ROUNDS, keyPairTime / BENCHMARK_ROUNDS, contextTime / BENCHMARK_ROUNDS);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    keyPair.generate();
+    randombytes(message, sizeof(message));
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Signing context sign", TestSigningContextSign, greentea_case_failure_abort_handler),
+            Case("Signing context segments", TestSigningContextSegments, greentea_case_failure_abort_handler),
+            Case("Signing context keys", TestSigningContextKeys, greentea_case_failure_abort_handler),
+            Case("Signing context wipe", TestSigningContextWipe, greentea_case_failure_abort_handler),
+            Case("Signing context benchmark", TestSigningContextBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -0,0 +1,270 @@
+/*
+ * Tests for the signature pre-checks.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-25
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <SignatureFilter.h>
+#include <CryptoStats.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define PACKETS 64
+
+static ED25519KeyPair keyPair;
+static const unsigned char message[] = "pre-checked message";
+static ED25519Signature signature;
+
+// L, the order of the base point, little endian
+static const unsigned char order[32] = {
+        0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+// a point of order 8 and y = p + 2, a non-canonical encoding of y = 2
+static const unsigned char orderEight[32] = {
+        0x26, 0xe8, 0x95, 0x8f, 0xc2, 0xb2, 0x27, 0xb0, 0x45, 0xc3, 0xf4, 0x89, 0xf2, 0xef, 0x98, 0xf0,
+        0xd5, 0xdf, 0xac, 0x05, 0xd3, 0xc6, 0x33, 0x39, 0xb1, 0x38, 0x02, 0x88, 0x6d, 0x53, 0xfc, 0x05
+};
+static const unsigned char nonCanonical[32] = {
+        0xef, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+};
+
+static FilterResult check(ED25519SignatureFilter &filter, const unsigned char *sig, const unsigned char *key) {
+    return filter.check(sig, crypto_sign_BYTES, key, crypto_sign_PUBLICKEYBYTES);
+}
+
+void TestFilterValid() {
+    ED25519SignatureFilter filter;
+    const unsigned char *publicKey = keyPair.getPublicKey()->key;
+
+    TEST_ASSERT_EQUAL_INT(FILTER_PASSED, check(filter, signature.signature, publicKey));
+    TEST_ASSERT_TRUE(filter.verify(message, sizeof(message), signature.signature, crypto_sign_BYTES,
+                                   publicKey, crypto_sign_PUBLICKEYBYTES));
+
+    // a well formed but wrong signature passes the checks and fails the verification
+    ED25519Signature wrong = signature;
+    wrong.signature[32] ^= 1;
+    TEST_ASSERT_FALSE(filter.verify(message, sizeof(message), wrong.signature, crypto_sign_BYTES,
+                                    publicKey, crypto_sign_PUBLICKEYBYTES));
+    TEST_ASSERT_FALSE(filter.verify(message, sizeof(message) - 1, signature.signature, crypto_sign_BYTES,
+                                    publicKey, crypto_sign_PUBLICKEYBYTES));
+
+    TEST_ASSERT_EQUAL_UINT32(4, filter.checked());
+    TEST_ASSERT_EQUAL_UINT32(0, filter.rejected());
+}
+
+void TestFilterLength() {
+    ED25519SignatureFilter filter;
+    const unsigned char *publicKey = keyPair.getPublicKey()->key;
+
+    TEST_ASSERT_EQUAL_INT(FILTER_LENGTH, filter.check(signature.signature, crypto_sign_BYTES - 1,
+                                                      publicKey, crypto_sign_PUBLICKEYBYTES));
+    TEST_ASSERT_EQUAL_INT(FILTER_LENGTH, filter.check(signature.signature, crypto_sign_BYTES + 1,
+                                                      publicKey, crypto_sign_PUBLICKEYBYTES));
+    TEST_ASSERT_EQUAL_INT(FILTER_LENGTH, filter.check(signature.signature, crypto_sign_BYTES,
+                                                      publicKey, crypto_sign_PUBLICKEYBYTES - 1));
+    TEST_ASSERT_EQUAL_INT(FILTER_LENGTH, filter.check(NULL, crypto_sign_BYTES, publicKey, crypto_sign_PUBLICKEYBYTES));
+    TEST_ASSERT_EQUAL_INT(FILTER_LENGTH, filter.check(signature.signature, crypto_sign_BYTES, NULL,
+                                                      crypto_sign_PUBLICKEYBYTES));
+    TEST_ASSERT_FALSE(filter.verify(NULL, 1, signature.signature, crypto_sign_BYTES,
+                                    publicKey, crypto_sign_PUBLICKEYBYTES));
+
+    TEST_ASSERT_EQUAL_UINT32(5, filter.checked());
+    TEST_ASSERT_EQUAL_UINT32(5, filter.rejected(FILTER_LENGTH));
+}
+
+void TestFilterScalar() {
+    ED25519SignatureFilter filter;
+    const unsigned char *publicKey = keyPair.getPublicKey()->key;
+
+    // S + L is the same scalar modulo L, the reference verification accepts it
+    ED25519Signature malleable = signature;
+    unsigned int carry = 0;
+    for (int i = 0; i < 32; i++) {
+        carry += malleable.signature[32 + i] + order[i];
+        malleable.signature[32 + i] = static_cast<unsigned char>(carry);
+        carry >>= 8;
+    }
+    TEST_ASSERT_EQUAL_INT(FILTER_SCALAR, check(filter, malleable.signature, publicKey));
+    TEST_ASSERT_FALSE(filter.verify(message, sizeof(message), malleable.signature, crypto_sign_BYTES,
+                                    publicKey, crypto_sign_PUBLICKEYBYTES));
+
+    ED25519Signature limit = signature;
+    memcpy(limit.signature + 32, order, 32);
+    TEST_ASSERT_EQUAL_INT(FILTER_SCALAR, check(filter, limit.signature, publicKey));
+    limit.signature[32]--;
+    TEST_ASSERT_EQUAL_INT(FILTER_PASSED, check(filter, limit.signature, publicKey));
+
+    TEST_ASSERT_EQUAL_UINT32(3, filter.rejected(FILTER_SCALAR));
+}
+
+void TestFilterPoints() {
+    ED25519SignatureFilter filter;
+    const unsigned char *publicKey = keyPair.getPublicKey()->key;
+    unsigned char point[32];
+    ED25519Signature bad = signature;
+
+    // small order points, with either sign of x
+    for (int sign = 0; sign < 2; sign++) {
+        memset(point, 0, sizeof(point));
+        point[0] = 1;
+        point[31] |= sign << 7;
+        memcpy(bad.signature, point, 32);
+        TEST_ASSERT_EQUAL_INT(FILTER_COMMITMENT, check(filter, bad.signature, publicKey));
+        TEST_ASSERT_EQUAL_INT(FILTER_PUBLIC_KEY, check(filter, signature.signature, point));
+
+        memcpy(point, orderEight, sizeof(point));
+        point[31] |= sign << 7;
+        memcpy(bad.signature, point, 32);
+        TEST_ASSERT_EQUAL_INT(FILTER_COMMITMENT, check(filter, bad.signature, publicKey));
+        TEST_ASSERT_EQUAL_INT(FILTER_PUBLIC_KEY, check(filter, signature.signature, point));
+    }
+
+    // y >= p
+    memcpy(bad.signature, nonCanonical, 32);
+    TEST_ASSERT_EQUAL_INT(FILTER_COMMITMENT, check(filter, bad.signature, publicKey));
+    TEST_ASSERT_EQUAL_INT(FILTER_PUBLIC_KEY, check(filter, signature.signature, nonCanonical));
+
+    // y = 2 is not on the curve
+    memset(point, 0, sizeof(point));
+    point[0] = 2;
+    memcpy(bad.signature, point, 32);
+    TEST_ASSERT_EQUAL_INT(FILTER_COMMITMENT, check(filter, bad.signature, publicKey));
+    TEST_ASSERT_EQUAL_INT(FILTER_PUBLIC_KEY, check(filter, signature.signature, point));
+
+    TEST_ASSERT_EQUAL_UINT32(6, filter.rejected(FILTER_COMMITMENT));
+    TEST_ASSERT_EQUAL_UINT32(6, filter.rejected(FILTER_PUBLIC_KEY));
+    TEST_ASSERT_EQUAL_UINT32(12, filter.rejected());
+    TEST_ASSERT_EQUAL_UINT32(0, filter.rejected(FILTER_PASSED));
+
+    filter.resetCounters();
+    TEST_ASSERT_EQUAL_UINT32(0, filter.checked());
+    TEST_ASSERT_EQUAL_UINT32(0, filter.rejected());
+}
+
+void TestFilterBlacklist() {
+    ED25519SignatureFilter filter;
+    ED25519PublicKey *publicKey = keyPair.getPublicKey();
+
+    TEST_ASSERT_EQUAL_INT(FILTER_PASSED, check(filter, signature.signature, publicKey->key));
+    TEST_ASSERT_TRUE(filter.block(publicKey));
+    TEST_ASSERT_EQUAL_INT(FILTER_BLACKLISTED, check(filter, signature.signature, publicKey->key));
+    TEST_ASSERT_FALSE(filter.verify(message, sizeof(message), signature.signature, crypto_sign_BYTES,
+                                    publicKey->key, crypto_sign_PUBLICKEYBYTES));
+
+    ED25519PublicKey other;
+    for (int i = 1; i < SIGNATURE_FILTER_BLACKLIST; i++) {
+        randombytes(other.key, sizeof(other.key));
+        TEST_ASSERT_TRUE(filter.block(&other));
+    }
+    TEST_ASSERT_FALSE_MESSAGE(filter.block(&other), "blacklist overflow");
+    TEST_ASSERT_FALSE(filter.block(NULL));
+    TEST_ASSERT_EQUAL_UINT32(2, filter.rejected(FILTER_BLACKLISTED));
+}
+
+#ifdef UBIRCH_CRYPTO_STATS_ENABLED
+void TestFilterStats() {
+    ED25519SignatureFilter filter;
+    const unsigned char *publicKey = keyPair.getPublicKey()->key;
+    const CryptoOperationStats *s = cryptoStats()->operations;
+    ED25519Signature malleable = signature;
+    malleable.signature[63] |= 0xf0;
+
+    cryptoStatsReset();
+    filter.verify(message, sizeof(message), signature.signature, crypto_sign_BYTES,
+                  publicKey, crypto_sign_PUBLICKEYBYTES);
+    filter.verify(message, sizeof(message), malleable.signature, crypto_sign_BYTES,
+                  publicKey, crypto_sign_PUBLICKEYBYTES);
+    check(filter, malleable.signature, publicKey);
+
+    // only the rejected signatures are counted as such, the valid one as a verification
+    TEST_ASSERT_EQUAL_UINT32(2, s[CRYPTO_STATS_REJECT].calls);
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_VERIFY].calls);
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_VERIFY].failures);
+}
+#endif
+
+void TestFilterBenchmark() {
+    ED25519SignatureFilter filter;
+    ED25519KeyPair verifier;
+    verifier.link(keyPair.getPublicKey());
+    const unsigned char *publicKey = keyPair.getPublicKey()->key;
+    unsigned char packets[PACKETS][crypto_sign_BYTES];
+    Timer timer;
+
+    // random garbage with a canonical S, the worst case for the pre-checks
+    randombytes(packets[0], sizeof(packets));
+    for (int i = 0; i < PACKETS; i++) packets[i][63] &= 0x0f;
+
+    timer.start();
+    int accepted = 0;
+    for (int i = 0; i < PACKETS; i++) {
+        accepted += filter.verify(message, sizeof(message), packets[i], crypto_sign_BYTES,
+                                  publicKey, crypto_sign_PUBLICKEYBYTES);
+    }
+    const int filteredTime = timer.read_us();
+
+    timer.reset();
+    for (int i = 0; i < PACKETS; i++) {
+        accepted += verifier.verify(message, sizeof(message), reinterpret_cast<ED25519Signature *>(packets[i]));
+    }
+    const int verifiedTime = timer.read_us();
+    timer.stop();
+
+    TEST_ASSERT_EQUAL_INT(0, accepted);
+    printf("%d garbage packets: %u rejected by the pre-checks, %dus/packet filtered, %dus/packet verified\r\n",
+           PACKETS, (unsigned int) filter.rejected(), filteredTime / PACKETS, verifiedTime / PACKETS);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    keyPair.generate();
+    ED25519Signature *s = keyPair.sign(message, sizeof(message));
+    signature = *s;
+    delete s;
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Signature filter valid signatures", TestFilterValid, greentea_case_failure_abort_handler),
+            Case("Signature filter lengths", TestFilterLength, greentea_case_failure_abort_handler),
+            Case("Signature filter non-canonical S", TestFilterScalar, greentea_case_failure_abort_handler),
+            Case("Signature filter bad points", TestFilterPoints, greentea_case_failure_abort_handler),
+            Case("Signature filter blacklist", TestFilterBlacklist, greentea_case_failure_abort_handler),
+#ifdef UBIRCH_CRYPTO_STATS_ENABLED
+            Case("Signature filter statistics", TestFilterStats, greentea_case_failure_abort_handler),
+#endif
+            Case("Signature filter benchmark", TestFilterBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -0,0 +1,250 @@
+/*
+ * Tests for the incremental SHA-512.
+ *
+ * Test vectors from FIPS 180-2, incremental hashing is checked against the NaCl one-shot hash.
+ * The multi-buffer hash is checked against the incremental hash.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-10
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <SHA512.h>
+#include <SHA512x4.h>
+#include <BatchVerifier.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+static const unsigned char emptyDigest[SHA512_BYTES] = {
+        0xcf, 0x83, 0xe1, 0x35, 0x7e, 0xef, 0xb8, 0xbd, 0xf1, 0x54, 0x28, 0x50, 0xd6, 0x6d, 0x80, 0x07,
+        0xd6, 0x20, 0xe4, 0x05, 0x0b, 0x57, 0x15, 0xdc, 0x83, 0xf4, 0xa9, 0x21, 0xd3, 0x6c, 0xe9, 0xce,
+        0x47, 0xd0, 0xd1, 0x3c, 0x5d, 0x85, 0xf2, 0xb0, 0xff, 0x83, 0x18, 0xd2, 0x87, 0x7e, 0xec, 0x2f,
+        0x63, 0xb9, 0x31, 0xbd, 0x47, 0x41, 0x7a, 0x81, 0xa5, 0x38, 0x32, 0x7a, 0xf9, 0x27, 0xda, 0x3e
+};
+
+static const unsigned char abcDigest[SHA512_BYTES] = {
+        0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+        0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2, 0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+        0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+        0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f
+};
+
+static const char *twoBlockMessage = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+        "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+
+static const unsigned char twoBlockDigest[SHA512_BYTES] = {
+        0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda, 0x8c, 0xf4, 0xf7, 0x28, 0x14, 0xfc, 0x14, 0x3f,
+        0x8f, 0x77, 0x79, 0xc6, 0xeb, 0x9f, 0x7f, 0xa1, 0x72, 0x99, 0xae, 0xad, 0xb6, 0x88, 0x90, 0x18,
+        0x50, 0x1d, 0x28, 0x9e, 0x49, 0x00, 0xf7, 0xe4, 0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a,
+        0xc7, 0xd3, 0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54, 0x5e, 0x96, 0xe5, 0x5b, 0x87, 0x4b, 0xe9, 0x09
+};
+
+void TestSHA512Vectors() {
+    SHA512 hash;
+    unsigned char digest[SHA512_BYTES];
+
+    hash.finish(digest);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(emptyDigest, digest, SHA512_BYTES, "empty message digest");
+
+    hash.reset();
+    hash.update(reinterpret_cast<const unsigned char *>("abc"), 3);
+    hash.finish(digest);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(abcDigest, digest, SHA512_BYTES, "'abc' digest");
+
+    hash.reset();
+    hash.update(reinterpret_cast<const unsigned char *>(twoBlockMessage), strlen(twoBlockMessage));
+    hash.finish(digest);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(twoBlockDigest, digest, SHA512_BYTES, "two block message digest");
+}
+
+control_t TestSHA512IncrementalPieces(const size_t n) {
+    const size_t size = 1024 + 37 * n;
+    unsigned char *message = new unsigned char[size];
+    randombytes(message, size);
+
+    unsigned char expected[SHA512_BYTES], digest[SHA512_BYTES];
+    crypto_hash_sha512(expected, message, static_cast<crypto_uint16>(size));
+
+    // feed the message in pieces of varying size, crossing block boundaries
+    SHA512 hash;
+    size_t pos = 0, piece = n;
+    while (pos < size) {
+        if (piece > size - pos) piece = size - pos;
+        hash.update(message + pos, piece);
+        pos += piece;
+        piece = piece * 3 + 1;
+    }
+    hash.finish(digest);
+    delete[] message;
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, digest, SHA512_BYTES, "incremental digest mismatch");
+
+    return (n < 10) ? CaseRepeatAll : CaseNext;
+}
+
+void TestSHA512MultiBuffer() {
+    static const size_t lengths[] = {0, 1, 36, 111, 112, 127, 128, 129, 239, 240, 255, 256, 700};
+    const size_t count = sizeof(lengths) / sizeof(lengths[0]);
+
+    unsigned char *data = new unsigned char[1024];
+    randombytes(data, 1024);
+
+    // every combination of four lengths, each message split into two segments
+    for (size_t first = 0; first < count; first++) {
+        SHA512Lane lanes[SHA512_LANES];
+        ED25519Segment segments[SHA512_LANES][2];
+        unsigned char digests[SHA512_LANES][SHA512_BYTES], expected[SHA512_LANES][SHA512_BYTES];
+
+        for (size_t l = 0; l < SHA512_LANES; l++) {
+            const size_t length = lengths[(first + l * 3) % count];
+            const size_t split = length / 3;
+            segments[l][0].data = data + l;
+            segments[l][0].length = split;
+            segments[l][1].data = data + l + split;
+            segments[l][1].length = length - split;
+            lanes[l].segments = segments[l];
+            lanes[l].count = 2;
+            lanes[l].digest = digests[l];
+
+            SHA512 hash;
+            hash.update(data + l, length);
+            hash.finish(expected[l]);
+        }
+
+        for (size_t n = 1; n <= SHA512_LANES; n++) {
+            memset(digests, 0, sizeof(digests));
+            sha512x4(lanes, n);
+            for (size_t l = 0; l < n; l++) {
+                TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected[l], digests[l], SHA512_BYTES, "multi-buffer digest");
+            }
+        }
+    }
+
+    delete[] data;
+}
+
+void TestSHA512BatchVerify() {
+    const size_t count = 10;
+    ED25519KeyPair keyPairs[2];
+    keyPairs[0].generate();
+    keyPairs[1].generate();
+
+    unsigned char messages[count][64];
+    ED25519Signature signatures[count];
+    ED25519VerifyJob jobs[count];
+    randombytes(&messages[0][0], sizeof(messages));
+
+    for (size_t i = 0; i < count; i++) {
+        ED25519KeyPair &keyPair = keyPairs[i & 1];
+        ED25519Signature *signature = keyPair.sign(messages[i], 36 + i);
+        signatures[i] = *signature;
+        delete signature;
+
+        jobs[i].publicKey = keyPair.getPublicKey();
+        jobs[i].message = messages[i];
+        jobs[i].length = 36 + i;
+        jobs[i].signature = &signatures[i];
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(count, ed25519VerifyBatch(jobs, count));
+    for (size_t i = 0; i < count; i++) TEST_ASSERT_TRUE(jobs[i].valid);
+
+    // a modified message, a signature of the wrong key and a missing message
+    messages[3][0] ^= 1;
+    jobs[6].publicKey = keyPairs[1].getPublicKey();
+    jobs[9].message = NULL;
+    TEST_ASSERT_EQUAL_UINT32(count - 3, ed25519VerifyBatch(jobs, count));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(i != 3 && i != 6 && i != 9, jobs[i].valid, "wrong batch result");
+        ED25519KeyPair publicKey;
+        publicKey.link(jobs[i].publicKey);
+        TEST_ASSERT_EQUAL_MESSAGE(publicKey.verify(jobs[i].message, jobs[i].length, jobs[i].signature),
+                                  jobs[i].valid, "batch result differs from verify()");
+    }
+}
+
+void TestSHA512MultiBufferBenchmark() {
+    static const size_t sizes[] = {36, 64, 128, 256, 512};
+    const int messages = 64;
+
+    // the hash input of a signature check is R || A || M
+    const size_t prefix = 64;
+    unsigned char *data = new unsigned char[prefix + 512];
+    randombytes(data, prefix + 512);
+    unsigned char digest[SHA512_BYTES];
+    unsigned char digests[SHA512_LANES][SHA512_BYTES];
+    Timer timer;
+
+    printf("multi-buffer SHA-512 (%s)\r\n", sha512x4Vectorized() ? "AVX2" : "portable");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const size_t length = prefix + sizes[s];
+
+        timer.reset();
+        timer.start();
+        for (int i = 0; i < messages; i++) {
+            SHA512 hash;
+            hash.update(data, length);
+            hash.finish(digest);
+        }
+        const int singleTime = timer.read_us();
+
+        ED25519Segment segment = {data, length};
+        SHA512Lane lanes[SHA512_LANES];
+        for (int l = 0; l < SHA512_LANES; l++) {
+            lanes[l].segments = &segment;
+            lanes[l].count = 1;
+            lanes[l].digest = digests[l];
+        }
+        timer.reset();
+        for (int i = 0; i < messages; i += SHA512_LANES) sha512x4(lanes, SHA512_LANES);
+        const int multiTime = timer.read_us();
+        timer.stop();
+
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(digest, digests[SHA512_LANES - 1], SHA512_BYTES);
+        printf("%4d byte messages: single %dus, multi-buffer %dus (%d messages)\r\n",
+               (int) sizes[s], singleTime, multiTime, messages);
+    }
+
+    delete[] data;
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("SHA512 FIPS 180-2 test vectors", TestSHA512Vectors, greentea_case_failure_abort_handler),
+            Case("SHA512 incremental pieces", TestSHA512IncrementalPieces, greentea_case_failure_abort_handler),
+            Case("SHA512 multi-buffer", TestSHA512MultiBuffer, greentea_case_failure_abort_handler),
+            Case("SHA512 multi-buffer batch verify", TestSHA512BatchVerify, greentea_case_failure_abort_handler),
+            Case("SHA512 multi-buffer benchmark", TestSHA512MultiBufferBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -168,6 +168,101 @@ void TestLinkKeyPair() {
                                   "set private key failed, address mismatch");
 }
 
+void TestImportSeed() {
+    ED25519KeyPair seedKeyPair;
+    TEST_ASSERT_FALSE(seedKeyPair.importSeed(testPrivateKey.key, crypto_sign_SECRETKEYBYTES));
+    TEST_ASSERT_TRUE(seedKeyPair.importSeed(testPrivateKey.key, ED25519_SEED_BYTES));
+
+    ED25519PublicKey *derivedPublicKey = seedKeyPair.getPublicKey();
+    TEST_ASSERT_NOT_NULL_MESSAGE(derivedPublicKey, "public key not derived from seed");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(testPublicKey.key, derivedPublicKey->key,
+                                         crypto_sign_PUBLICKEYBYTES, "derived public key does not match");
+
+    // the seed signature must be identical to the NaCl signature using the full secret key
+    const char *message = "The quick brown fox jumps over the lazy dog";
+    const size_t length = strlen(message);
+    unsigned char signedMessage[crypto_sign_BYTES + 64];
+    crypto_uint16 signedLength;
+    crypto_sign(signedMessage, &signedLength, reinterpret_cast<const unsigned char *>(message),
+                static_cast<crypto_uint16>(length), testPrivateKey.key);
+
+    for (int i = 0; i < 2; i++) {
+        ED25519Signature *signature = seedKeyPair.sign(reinterpret_cast<const unsigned char *>(message), length);
+        TEST_ASSERT_NOT_NULL(signature);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(signedMessage, signature->signature, crypto_sign_BYTES,
+                                             "seed signature does not match");
+        delete signature;
+    }
+}
+
+void TestLinkSeed() {
+    ED25519KeyPair seedKeyPair;
+    seedKeyPair.linkSeed(reinterpret_cast<const ED25519Seed *>(testPrivateKey.key));
+
+    const char *message = "The quick brown fox jumps over the lazy dog";
+    ED25519Signature *signature = seedKeyPair.sign(reinterpret_cast<const unsigned char *>(message), strlen(message));
+    TEST_ASSERT_NOT_NULL(signature);
+
+    ED25519KeyPair verifyKeyPair;
+    verifyKeyPair.link(&testPublicKey);
+    TEST_ASSERT_TRUE_MESSAGE(verifyKeyPair.verify(reinterpret_cast<const unsigned char *>(message), strlen(message),
+                                                  signature), "seed signature verification failed");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(testPublicKey.key, seedKeyPair.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    delete signature;
+
+    // switching to a full key pair drops the derived keys
+    seedKeyPair.import(testPublicKey, testPrivateKey);
+    signature = seedKeyPair.sign(reinterpret_cast<const unsigned char *>(message), strlen(message));
+    TEST_ASSERT_TRUE(verifyKeyPair.verify(reinterpret_cast<const unsigned char *>(message), strlen(message),
+                                          signature));
+    delete signature;
+}
+
+void TestSignVerifySegments() {
+    ED25519KeyPair keyPair;
+    keyPair.import(testPublicKey, testPrivateKey);
+
+    const unsigned char *message = reinterpret_cast<const unsigned char *>("The quick brown fox jumps over the lazy dog");
+    const size_t length = strlen(reinterpret_cast<const char *>(message));
+    const ED25519Segment segments[4] = {
+            {message,      4},
+            {NULL,         0},
+            {message + 4,  16},
+            {message + 20, length - 20}
+    };
+
+    // the segments are signed as if they were one message
+    ED25519Signature *signature = keyPair.sign(segments, 4);
+    ED25519Signature *expected = keyPair.sign(message, length);
+    TEST_ASSERT_NOT_NULL(signature);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected->signature, signature->signature, crypto_sign_BYTES,
+                                         "segment signature differs");
+    TEST_ASSERT_TRUE(keyPair.verify(message, length, signature));
+    TEST_ASSERT_TRUE(keyPair.verify(segments, 4, expected));
+    TEST_ASSERT_FALSE_MESSAGE(keyPair.verify(segments, 3, signature), "missing segment accepted");
+
+    unsigned char changed[16];
+    memcpy(changed, message + 4, sizeof(changed));
+    changed[0] ^= 1;
+    const ED25519Segment changedSegments[3] = {segments[0], {changed, sizeof(changed)}, segments[3]};
+    TEST_ASSERT_FALSE_MESSAGE(keyPair.verify(changedSegments, 3, signature), "changed segment accepted");
+
+    const ED25519Segment missing[2] = {{NULL, 4}, segments[3]};
+    TEST_ASSERT_NULL(keyPair.sign(missing, 2));
+    TEST_ASSERT_FALSE(keyPair.verify(missing, 2, signature));
+    TEST_ASSERT_NULL(keyPair.sign(static_cast<const ED25519Segment *>(NULL), 1));
+    TEST_ASSERT_FALSE(keyPair.verify(segments, 0, signature));
+    TEST_ASSERT_FALSE(keyPair.verify(segments, 4, NULL));
+
+    ED25519KeyPair publicOnly;
+    publicOnly.link(&testPublicKey);
+    TEST_ASSERT_NULL(publicOnly.sign(segments, 4));
+    TEST_ASSERT_TRUE(publicOnly.verify(segments, 4, signature));
+
+    delete signature;
+    delete expected;
+}
+
 control_t TestSignMessageStaticKey(const size_t repeated) {
     char k[20], v[20];
     Base64 base64;
@@ -246,6 +341,9 @@ int main() {
             Case("Crypto test import keypair from arrays", TestImportKeyPairFromArrays, greentea_case_failure_abort_handler),
             Case("Crypto test import public key from array", TestImportPublicKeyFromArray, greentea_case_failure_abort_handler),
             Case("Crypto test set keypair", TestLinkKeyPair, greentea_case_failure_abort_handler),
+            Case("Crypto test import seed", TestImportSeed, greentea_case_failure_abort_handler),
+            Case("Crypto test link seed", TestLinkSeed, greentea_case_failure_abort_handler),
+            Case("Crypto test sign/verify segments", TestSignVerifySegments, greentea_case_failure_abort_handler),
             Case("Crypto test sign message", TestSignMessageStaticKey, greentea_case_failure_abort_handler),
             Case("Crypto test verify message", TestVerifyMessageStaticKey, greentea_case_failure_abort_handler),
             Case("Crypto test sign/verify self", TestSignAndVerifySelf, greentea_case_failure_abort_handler),
@@ -0,0 +1,274 @@
+/*
+ * Tests for the flash resident key store.
+ *
+ * The flash is emulated in RAM, so the tests do not wear out the device flash.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-08
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <FlashKeyStore.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+#include "../COMMON/RAMFlashStorage.h"
+
+using namespace utest::v1;
+
+#define SECTOR_SIZE 1024
+#define SECTORS 4
+#define FLASH_FILE "FlashKeyStoreTests.flash"
+
+class TestKeyPair : public ED25519KeyPair {
+public:
+    ED25519PrivateKey *getPrivateKey() { return privateKey; }
+};
+
+void TestFormatEmptyStore() {
+    RAMFlashStorage storage(SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+    FlashKeyStore store(storage);
+
+    TEST_ASSERT_TRUE_MESSAGE(store.format(), "format failed");
+    for (unsigned int slot = 0; slot < FLASH_KEY_STORE_SLOTS; slot++) {
+        TEST_ASSERT_NULL(store.getPublicKey(slot));
+        TEST_ASSERT_NULL(store.getPrivateKey(slot));
+    }
+    TEST_ASSERT_FALSE(store.store(FLASH_KEY_STORE_SLOTS, ED25519PublicKey(), ED25519PrivateKey()));
+}
+
+void TestStoreAndLinkInPlace() {
+    RAMFlashStorage storage(SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+    FlashKeyStore store(storage);
+    TEST_ASSERT_TRUE(store.format());
+
+    TestKeyPair generated;
+    generated.generate();
+    TEST_ASSERT_TRUE_MESSAGE(store.store(1, *generated.getPublicKey(), *generated.getPrivateKey()), "store failed");
+
+    TestKeyPair linked;
+    TEST_ASSERT_TRUE_MESSAGE(store.link(1, linked), "link failed");
+    TEST_ASSERT_EQUAL_PTR(store.getPrivateKey(1), linked.getPrivateKey());
+    TEST_ASSERT_EQUAL_PTR(store.getPublicKey(1), linked.getPublicKey());
+    TEST_ASSERT_TRUE_MESSAGE((const unsigned char *) linked.getPublicKey() >= storage.memory &&
+                             (const unsigned char *) linked.getPublicKey() < storage.memory + storage.size(),
+                             "public key not linked into flash");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(generated.getPublicKey()->key, linked.getPublicKey()->key,
+                                 crypto_sign_PUBLICKEYBYTES);
+
+    const char *message = "The quick brown fox jumps over the lazy dog";
+    ED25519Signature *signature = linked.sign(reinterpret_cast<const unsigned char *>(message), strlen(message));
+    TEST_ASSERT_NOT_NULL(signature);
+    TEST_ASSERT_TRUE_MESSAGE(generated.verify(reinterpret_cast<const unsigned char *>(message), strlen(message),
+                                              signature), "signature of linked key failed");
+    delete signature;
+
+    // generated keys are written without leaving a copy in RAM
+    TEST_ASSERT_TRUE_MESSAGE(store.generate(2), "generate failed");
+    TEST_ASSERT_TRUE(store.link(2, linked));
+    signature = linked.sign(reinterpret_cast<const unsigned char *>(message), strlen(message));
+    TEST_ASSERT_TRUE_MESSAGE(linked.verify(reinterpret_cast<const unsigned char *>(message), strlen(message),
+                                           signature), "signature of generated key failed");
+    delete signature;
+}
+
+void TestRemountAndRemove() {
+    RAMFlashStorage storage(SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+    TestKeyPair first, second;
+    first.generate();
+    second.generate();
+
+    {
+        FlashKeyStore store(storage);
+        TEST_ASSERT_TRUE(store.format());
+        TEST_ASSERT_TRUE(store.store(0, *first.getPublicKey(), *first.getPrivateKey()));
+        TEST_ASSERT_TRUE(store.store(2, *first.getPublicKey(), *first.getPrivateKey()));
+        TEST_ASSERT_TRUE(store.store(0, *second.getPublicKey(), *second.getPrivateKey()));
+        TEST_ASSERT_TRUE(store.remove(2));
+    }
+
+    FlashKeyStore store(storage);
+    TEST_ASSERT_TRUE_MESSAGE(store.mount(), "mount failed");
+    TEST_ASSERT_NOT_NULL(store.getPublicKey(0));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(second.getPublicKey()->key, store.getPublicKey(0)->key,
+                                         crypto_sign_PUBLICKEYBYTES, "most recent key not found");
+    TEST_ASSERT_NULL_MESSAGE(store.getPublicKey(2), "removed key still present");
+
+    // an interrupted write must not break the store
+    size_t torn = 0;
+    while (storage.memory[torn] != 0xFF) torn += sizeof(FlashKeyRecord);
+    const unsigned char garbage[8] = {0x55, 0x42, 0x4B, 0x53, 0x00, 0x00, 0x00, 0x00};
+    TEST_ASSERT_TRUE(storage.program(torn, garbage, sizeof(garbage)));
+    FlashKeyStore remounted(storage);
+    TEST_ASSERT_TRUE(remounted.mount());
+    TEST_ASSERT_TRUE(remounted.store(3, *first.getPublicKey(), *first.getPrivateKey()));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(first.getPublicKey()->key, remounted.getPublicKey(3)->key,
+                                 crypto_sign_PUBLICKEYBYTES);
+}
+
+void TestWearLevelling() {
+    RAMFlashStorage storage(SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+    FlashKeyStore store(storage);
+    TEST_ASSERT_TRUE(store.format());
+    memset(storage.erases, 0, SECTORS * sizeof(storage.erases[0]));
+
+    TestKeyPair keyPair;
+    keyPair.generate();
+    ED25519PublicKey publicKey;
+    memcpy(&publicKey, keyPair.getPublicKey(), sizeof(publicKey));
+
+    const unsigned int writes = 40 * SECTORS * SECTOR_SIZE / sizeof(FlashKeyRecord);
+    for (unsigned int i = 0; i < writes; i++) {
+        publicKey.key[0] = static_cast<unsigned char>(i);
+        TEST_ASSERT_TRUE_MESSAGE(store.store(i % FLASH_KEY_STORE_SLOTS, publicKey, *keyPair.getPrivateKey()),
+                                 "store failed");
+    }
+
+    unsigned int min = storage.erases[0], max = storage.erases[0];
+    for (int s = 0; s < SECTORS; s++) {
+        printf("sector %d: %u erases\r\n", s, storage.erases[s]);
+        if (storage.erases[s] < min) min = storage.erases[s];
+        if (storage.erases[s] > max) max = storage.erases[s];
+    }
+    TEST_ASSERT_TRUE_MESSAGE(max - min <= 1, "uneven sector wear");
+
+    FlashKeyStore remounted(storage);
+    TEST_ASSERT_TRUE(remounted.mount());
+    for (unsigned int slot = 0; slot < FLASH_KEY_STORE_SLOTS; slot++) {
+        TEST_ASSERT_NOT_NULL(remounted.getPublicKey(slot));
+        TEST_ASSERT_EQUAL_HEX8((writes - FLASH_KEY_STORE_SLOTS + slot) & 0xFF, remounted.getPublicKey(slot)->key[0]);
+    }
+}
+
+#ifndef __MBED__
+
+void TestFileStorageReopen() {
+    TestKeyPair first, second;
+    first.generate();
+    second.generate();
+    const char *message = "The quick brown fox jumps over the lazy dog";
+    ED25519Signature *signature;
+    remove(FLASH_FILE);
+
+    {
+        FileFlashStorage storage(FLASH_FILE, SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+        TEST_ASSERT_TRUE_MESSAGE(storage.isOpen(), "flash file not opened");
+        FlashKeyStore store(storage);
+        TEST_ASSERT_TRUE(store.format());
+        TEST_ASSERT_TRUE(store.store(0, *first.getPublicKey(), *first.getPrivateKey()));
+        TEST_ASSERT_TRUE(store.generate(1));
+
+        TestKeyPair linked;
+        TEST_ASSERT_TRUE(store.link(0, linked));
+        TEST_ASSERT_TRUE_MESSAGE((const unsigned char *) linked.getPublicKey() >= storage.address() &&
+                                 (const unsigned char *) linked.getPublicKey() < storage.address() + storage.size(),
+                                 "public key not linked into the mapped file");
+
+        // a write appends a new record, the key pair has to be linked again
+        TEST_ASSERT_TRUE(store.store(0, *second.getPublicKey(), *second.getPrivateKey()));
+        TEST_ASSERT_TRUE(store.getPublicKey(0) != linked.getPublicKey());
+        TEST_ASSERT_TRUE(store.link(0, linked));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(second.getPublicKey()->key, linked.getPublicKey()->key,
+                                     crypto_sign_PUBLICKEYBYTES);
+    }
+
+    FileFlashStorage storage(FLASH_FILE, SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+    TEST_ASSERT_TRUE_MESSAGE(storage.isOpen(), "flash file not reopened");
+    FlashKeyStore store(storage);
+    TEST_ASSERT_TRUE_MESSAGE(store.mount(), "mount of reopened file failed");
+    TEST_ASSERT_NOT_NULL(store.getPublicKey(1));
+    TEST_ASSERT_NULL(store.getPublicKey(2));
+
+    TestKeyPair linked;
+    TEST_ASSERT_TRUE(store.link(0, linked));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(second.getPublicKey()->key, linked.getPublicKey()->key,
+                                         crypto_sign_PUBLICKEYBYTES, "most recent key not found after reopen");
+    signature = linked.sign(reinterpret_cast<const unsigned char *>(message), strlen(message));
+    TEST_ASSERT_NOT_NULL(signature);
+    TEST_ASSERT_TRUE_MESSAGE(second.verify(reinterpret_cast<const unsigned char *>(message), strlen(message),
+                                           signature), "signature of reopened key failed");
+    delete signature;
+
+    TEST_ASSERT_TRUE(store.link(1, linked));
+    signature = linked.sign(reinterpret_cast<const unsigned char *>(message), strlen(message));
+    TEST_ASSERT_TRUE_MESSAGE(linked.verify(reinterpret_cast<const unsigned char *>(message), strlen(message),
+                                           signature), "signature of generated key failed after reopen");
+    delete signature;
+
+    remove(FLASH_FILE);
+}
+
+#endif
+
+void TestBenchmarkLinkVersusImport() {
+    RAMFlashStorage storage(SECTORS * SECTOR_SIZE, SECTOR_SIZE);
+    FlashKeyStore store(storage);
+    TEST_ASSERT_TRUE(store.format());
+
+    TestKeyPair generated;
+    generated.generate();
+    TEST_ASSERT_TRUE(store.store(0, *generated.getPublicKey(), *generated.getPrivateKey()));
+
+    const int rounds = 1000;
+    Timer timer;
+    timer.start();
+    for (int i = 0; i < rounds; i++) {
+        ED25519KeyPair keyPair;
+        store.link(0, keyPair);
+    }
+    const int linkTime = timer.read_us();
+
+    timer.reset();
+    for (int i = 0; i < rounds; i++) {
+        ED25519KeyPair keyPair;
+        keyPair.import(*store.getPublicKey(0), *store.getPrivateKey(0));
+    }
+    const int importTime = timer.read_us();
+
+    timer.reset();
+    FlashKeyStore mounted(storage);
+    mounted.mount();
+    const int mountTime = timer.read_us();
+
+    printf("link: %dus, import: %dus (%d rounds), mount: %dus\r\n", linkTime, importTime, rounds, mountTime);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(150, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Key store format empty store", TestFormatEmptyStore, greentea_case_failure_abort_handler),
+            Case("Key store store and link in place", TestStoreAndLinkInPlace, greentea_case_failure_abort_handler),
+            Case("Key store remount and remove", TestRemountAndRemove, greentea_case_failure_abort_handler),
+            Case("Key store wear levelling", TestWearLevelling, greentea_case_failure_abort_handler),
+#ifndef __MBED__
+            Case("Key store file storage reopen", TestFileStorageReopen, greentea_case_failure_abort_handler),
+#endif
+            Case("Key store benchmark link vs. import", TestBenchmarkLinkVersusImport, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -0,0 +1,190 @@
+/*
+ * Tests for the Merkle tree batch signing.
+ *
+ * The incremental tree is checked against a straightforward recursive
+ * implementation of the RFC 6962 tree hash.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-14
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <MerkleBatch.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define RECORD_SIZE 36
+#define RECORDS 17
+#define MAX_PROOF 8
+
+static unsigned char records[RECORDS][RECORD_SIZE];
+
+// RFC 6962 MTH(D[n]), split at the largest power of two smaller than n
+static void referenceRoot(unsigned char *hash, size_t first, size_t n) {
+    if (n == 1) {
+        MerkleBatch::leafHash(hash, records[first], RECORD_SIZE);
+        return;
+    }
+    size_t k = 1;
+    while (k << 1 < n) k <<= 1;
+
+    unsigned char left[MERKLE_HASH_BYTES], right[MERKLE_HASH_BYTES];
+    referenceRoot(left, first, k);
+    referenceRoot(right, first + k, n - k);
+    MerkleBatch::nodeHash(hash, left, right);
+}
+
+void TestMerkleRoot() {
+    MerkleBatch batch(RECORDS);
+    unsigned char expected[MERKLE_HASH_BYTES], root[MERKLE_HASH_BYTES];
+
+    for (size_t n = 1; n <= RECORDS; n++) {
+        TEST_ASSERT_TRUE(batch.add(records[n - 1], RECORD_SIZE));
+        TEST_ASSERT_EQUAL_UINT32(n, batch.count());
+
+        referenceRoot(expected, 0, n);
+        batch.root(root);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, root, MERKLE_HASH_BYTES, "root mismatch");
+    }
+    TEST_ASSERT_FALSE_MESSAGE(batch.add(records[0], RECORD_SIZE), "full batch accepted a record");
+
+    batch.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, batch.count());
+    TEST_ASSERT_TRUE(batch.add(records[0], RECORD_SIZE));
+    referenceRoot(expected, 0, 1);
+    batch.root(root);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, root, MERKLE_HASH_BYTES, "root mismatch after reset");
+}
+
+void TestMerkleProofs() {
+    unsigned char root[MERKLE_HASH_BYTES], leaf[MERKLE_HASH_BYTES];
+    unsigned char path[MAX_PROOF * MERKLE_HASH_BYTES];
+
+    for (size_t n = 1; n <= RECORDS; n++) {
+        MerkleBatch batch(n);
+        for (size_t i = 0; i < n; i++) batch.add(records[i], RECORD_SIZE);
+        batch.root(root);
+
+        for (size_t i = 0; i < n; i++) {
+            const int hashes = batch.proof(i, path, MAX_PROOF);
+            TEST_ASSERT_TRUE_MESSAGE(hashes >= 0, "proof failed");
+
+            MerkleBatch::leafHash(leaf, records[i], RECORD_SIZE);
+            TEST_ASSERT_TRUE_MESSAGE(MerkleVerifier::verifyPath(root, n, leaf, i, path, hashes), "proof rejected");
+
+            // the proof is bound to the record and its index, the size comes from the signed header
+            TEST_ASSERT_FALSE(MerkleVerifier::verifyPath(root, n, leaf, i + 1, path, hashes));
+            if (hashes > 0) {
+                TEST_ASSERT_FALSE(MerkleVerifier::verifyPath(root, n, leaf, i, path, hashes - 1));
+                path[0] ^= 1;
+                TEST_ASSERT_FALSE(MerkleVerifier::verifyPath(root, n, leaf, i, path, hashes));
+            }
+            leaf[0] ^= 1;
+            path[0] ^= 1;
+            TEST_ASSERT_FALSE(MerkleVerifier::verifyPath(root, n, leaf, i, path, hashes));
+        }
+        TEST_ASSERT_EQUAL_INT(-1, batch.proof(n, path, MAX_PROOF));
+    }
+
+    MerkleBatch batch(RECORDS);
+    for (size_t i = 0; i < RECORDS; i++) batch.add(records[i], RECORD_SIZE);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(-1, batch.proof(0, path, 1), "proof overflowed path");
+}
+
+void TestMerkleSignedBatch() {
+    ED25519KeyPair keyPair, other;
+    keyPair.generate();
+    other.generate();
+
+    MerkleBatch batch(RECORDS);
+    unsigned char header[MERKLE_HEADER_BYTES];
+    TEST_ASSERT_NULL_MESSAGE(batch.sign(keyPair, header), "empty batch signed");
+    for (size_t i = 0; i < RECORDS; i++) batch.add(records[i], RECORD_SIZE);
+
+    ED25519Signature *signature = batch.sign(keyPair, header);
+    TEST_ASSERT_NOT_NULL(signature);
+
+    MerkleVerifier verifier;
+    unsigned char path[MAX_PROOF * MERKLE_HASH_BYTES];
+    int hashes = batch.proof(5, path, MAX_PROOF);
+    TEST_ASSERT_FALSE_MESSAGE(verifier.verify(records[5], RECORD_SIZE, 5, path, hashes), "unverified batch used");
+
+    TEST_ASSERT_FALSE_MESSAGE(verifier.begin(other, header, signature), "wrong key accepted");
+    header[7] ^= 1;
+    TEST_ASSERT_FALSE_MESSAGE(verifier.begin(keyPair, header, signature), "modified header accepted");
+    header[7] ^= 1;
+    TEST_ASSERT_TRUE(verifier.begin(keyPair, header, signature));
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, verifier.count());
+
+    for (size_t i = 0; i < RECORDS; i++) {
+        hashes = batch.proof(i, path, MAX_PROOF);
+        TEST_ASSERT_TRUE_MESSAGE(verifier.verify(records[i], RECORD_SIZE, i, path, hashes), "record rejected");
+        TEST_ASSERT_FALSE_MESSAGE(verifier.verify(records[(i + 1) % RECORDS], RECORD_SIZE, i, path, hashes),
+                                  "wrong record accepted");
+    }
+
+    delete signature;
+}
+
+void TestMerkleBenchmark() {
+    ED25519KeyPair keyPair;
+    keyPair.generate();
+    Timer timer;
+
+    timer.start();
+    for (size_t i = 0; i < RECORDS; i++) delete keyPair.sign(records[i], RECORD_SIZE);
+    const int signTime = timer.read_us();
+
+    timer.reset();
+    MerkleBatch batch(RECORDS);
+    unsigned char header[MERKLE_HEADER_BYTES];
+    unsigned char path[MAX_PROOF * MERKLE_HASH_BYTES];
+    for (size_t i = 0; i < RECORDS; i++) batch.add(records[i], RECORD_SIZE);
+    delete batch.sign(keyPair, header);
+    for (size_t i = 0; i < RECORDS; i++) batch.proof(i, path, MAX_PROOF);
+    const int batchTime = timer.read_us();
+    timer.stop();
+
+    printf("%d records: %d signatures %dus, batch with proofs %dus\r\n", RECORDS, RECORDS, signTime, batchTime);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    randombytes(&records[0][0], sizeof(records));
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Merkle batch root", TestMerkleRoot, greentea_case_failure_abort_handler),
+            Case("Merkle batch proofs", TestMerkleProofs, greentea_case_failure_abort_handler),
+            Case("Merkle batch signed header", TestMerkleSignedBatch, greentea_case_failure_abort_handler),
+            Case("Merkle batch benchmark", TestMerkleBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
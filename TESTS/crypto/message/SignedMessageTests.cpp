@@ -0,0 +1,173 @@
+/*
+ * Tests for the signed message view.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-02-01
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <Base64.h>
+#include <SignedMessage.h>
+#include <CryptoStats.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define MESSAGES 20
+
+static ED25519KeyPair signer;
+static ED25519KeyPair other;
+static unsigned char selfSigned[SIGNED_MESSAGE_BYTES];
+static unsigned char otherSigned[SIGNED_MESSAGE_BYTES];
+
+// [publicKey | nonce | signature] of the key in the message, signed by the signer
+static void makeMessage(unsigned char *message, ED25519KeyPair &keyPair, ED25519KeyPair &signedBy) {
+    memcpy(message, keyPair.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    randombytes(message + crypto_sign_PUBLICKEYBYTES, SIGNED_MESSAGE_NONCE_BYTES);
+    ED25519Signature *signature = signedBy.sign(message, SIGNED_MESSAGE_PAYLOAD_BYTES);
+    memcpy(message + SIGNED_MESSAGE_PAYLOAD_BYTES, signature->signature, crypto_sign_BYTES);
+    delete signature;
+}
+
+void TestSignedMessageFields() {
+    const SignedMessageView message(selfSigned, sizeof(selfSigned));
+    TEST_ASSERT_TRUE(message.valid());
+
+    // the fields point into the buffer
+    TEST_ASSERT_EQUAL_PTR(selfSigned, message.publicKey().key);
+    TEST_ASSERT_EQUAL_PTR(selfSigned + crypto_sign_PUBLICKEYBYTES, message.nonce());
+    TEST_ASSERT_EQUAL_PTR(selfSigned, message.payload());
+    TEST_ASSERT_EQUAL_PTR(selfSigned + SIGNED_MESSAGE_PAYLOAD_BYTES, message.signature().signature);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(signer.getPublicKey()->key, message.publicKey().key, crypto_sign_PUBLICKEYBYTES);
+
+    // the length is checked once
+    TEST_ASSERT_FALSE(SignedMessageView(selfSigned, sizeof(selfSigned) - 1).valid());
+    TEST_ASSERT_FALSE(SignedMessageView(selfSigned, sizeof(selfSigned) + 1).valid());
+    TEST_ASSERT_FALSE(SignedMessageView(NULL, sizeof(selfSigned)).valid());
+    TEST_ASSERT_FALSE(SignedMessageView(selfSigned, 0).verify());
+}
+
+void TestSignedMessageVerify() {
+    TEST_ASSERT_TRUE_MESSAGE(SignedMessageView(selfSigned, sizeof(selfSigned)).verify(), "self signed failed");
+    TEST_ASSERT_FALSE(SignedMessageView(otherSigned, sizeof(otherSigned)).verify());
+    TEST_ASSERT_TRUE_MESSAGE(SignedMessageView(otherSigned, sizeof(otherSigned)).verify(*other.getPublicKey()),
+                             "message signed by another key failed");
+    TEST_ASSERT_FALSE(SignedMessageView(otherSigned, sizeof(otherSigned)).verify(*signer.getPublicKey()));
+
+    // every part of the message is covered
+    unsigned char tampered[SIGNED_MESSAGE_BYTES];
+    for (size_t i = 0; i < SIGNED_MESSAGE_BYTES; i += 9) {
+        memcpy(tampered, selfSigned, sizeof(tampered));
+        tampered[i] ^= 0x10;
+        TEST_ASSERT_FALSE(SignedMessageView(tampered, sizeof(tampered)).verify());
+    }
+}
+
+void TestSignedMessageReceiveBuffer() {
+    Base64 base64;
+    size_t encodedLength;
+    char *encoded = base64.Encode(reinterpret_cast<const char *>(selfSigned), sizeof(selfSigned), &encodedLength);
+    char received[255];
+    memcpy(received, encoded, encodedLength + 1);
+    delete[] encoded;
+
+#ifdef UBIRCH_CRYPTO_STATS_ENABLED
+    cryptoStatsReset();
+    const CryptoOperationStats *s = cryptoStats()->operations;
+#endif
+
+    // decode where the message arrived and verify it there
+    unsigned char *buffer = reinterpret_cast<unsigned char *>(received);
+    size_t length;
+    TEST_ASSERT_TRUE(base64.Decode(received, strlen(received), buffer, sizeof(received), &length));
+    const SignedMessageView message(buffer, length);
+    TEST_ASSERT_TRUE(message.valid());
+    TEST_ASSERT_TRUE(message.verify());
+    TEST_ASSERT_EQUAL_PTR(received, message.publicKey().key);
+
+#ifdef UBIRCH_CRYPTO_STATS_ENABLED
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_DECODE].calls);
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_DECODE].bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_VERIFY].calls);
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_VERIFY].bytes);
+#endif
+}
+
+void TestSignedMessageBenchmark() {
+    Base64 base64;
+    size_t encodedLength, length;
+    char *encoded = base64.Encode(reinterpret_cast<const char *>(selfSigned), sizeof(selfSigned), &encodedLength);
+    char received[255];
+    Timer timer;
+
+    // decode into a new buffer, copy the key into another one, cast the signature
+    timer.start();
+    for (int i = 0; i < MESSAGES; i++) {
+        char *decoded = base64.Decode(encoded, encodedLength, &length);
+        ED25519KeyPair key;
+        key.importPublicKey(reinterpret_cast<const unsigned char *>(decoded), crypto_sign_PUBLICKEYBYTES);
+        TEST_ASSERT_TRUE(key.verify(reinterpret_cast<const unsigned char *>(decoded), SIGNED_MESSAGE_PAYLOAD_BYTES,
+                                    reinterpret_cast<const ED25519Signature *>(decoded +
+                                                                               SIGNED_MESSAGE_PAYLOAD_BYTES)));
+        delete[] decoded;
+    }
+    const int copyTime = timer.read_us();
+
+    timer.reset();
+    for (int i = 0; i < MESSAGES; i++) {
+        memcpy(received, encoded, encodedLength);
+        unsigned char *buffer = reinterpret_cast<unsigned char *>(received);
+        TEST_ASSERT_TRUE(base64.Decode(received, encodedLength, buffer, sizeof(received), &length));
+        TEST_ASSERT_TRUE(SignedMessageView(buffer, length).verify());
+    }
+    const int viewTime = timer.read_us();
+    timer.stop();
+    delete[] encoded;
+
+    printf("decode and verify: with copies %dus/message, in the receive buffer %dus/message\r\n",
+           copyTime / MESSAGES, viewTime / MESSAGES);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(120, "default_auto");
+    signer.generate();
+    other.generate();
+    makeMessage(selfSigned, signer, signer);
+    makeMessage(otherSigned, signer, other);
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Signed message fields", TestSignedMessageFields, greentea_case_failure_abort_handler),
+            Case("Signed message verify", TestSignedMessageVerify, greentea_case_failure_abort_handler),
+            Case("Signed message receive buffer", TestSignedMessageReceiveBuffer,
+                 greentea_case_failure_abort_handler),
+            Case("Signed message benchmark", TestSignedMessageBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
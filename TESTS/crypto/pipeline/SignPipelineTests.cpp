@@ -0,0 +1,242 @@
+/*
+ * Tests for the double buffered sign and transmit pipeline.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-30
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <Base64.h>
+#include <SignPipeline.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define RECORDED_PACKETS 8
+#define THROUGHPUT_PACKETS 40
+#define PAYLOAD_SIZE 128
+// the pause between two packets and how long the producer at least waits in the back pressure test (ms)
+#define BACK_PRESSURE_GAP 5
+#define BACK_PRESSURE_WAIT 40
+
+// a simulated radio that takes a fixed time per packet and keeps the first packets
+class SlowSink : public PacketSink {
+public:
+    void reset(int delay) {
+        this->delay = delay;
+        count = 0;
+        fail = false;
+    }
+
+    bool transmit(const unsigned char *packet, size_t length) {
+        if (delay > 0) wait_ms(delay);
+        if (count < RECORDED_PACKETS && length <= sizeof(packets[0])) {
+            memcpy(packets[count], packet, length);
+            lengths[count] = length;
+        }
+        count++;
+        return !fail;
+    }
+
+    int delay;
+    volatile size_t count;
+    bool fail;
+    unsigned char packets[RECORDED_PACKETS][SIGN_PIPELINE_ENCODED_BYTES];
+    size_t lengths[RECORDED_PACKETS];
+};
+
+static ED25519KeyPair keyPair;
+static ED25519SigningContext *context;
+static SlowSink sink;
+static unsigned char payload[SIGN_PIPELINE_PAYLOAD + RECORDED_PACKETS];
+
+void TestSignPipelinePackets() {
+    sink.reset(0);
+    SignPipeline *pipeline = new SignPipeline(*context, sink);
+    TEST_ASSERT_NULL(pipeline->acquire(0));
+    TEST_ASSERT_TRUE(pipeline->start());
+    TEST_ASSERT_FALSE(pipeline->start());
+
+    const size_t lengths[RECORDED_PACKETS] = {0, 1, 2, 3, 16, 100, 255, SIGN_PIPELINE_PAYLOAD};
+    for (size_t i = 0; i < RECORDED_PACKETS; i++) {
+        TEST_ASSERT_TRUE(pipeline->send(payload + i, lengths[i], SIGN_PIPELINE_FOREVER));
+    }
+    TEST_ASSERT_FALSE(pipeline->send(payload, SIGN_PIPELINE_PAYLOAD + 1, SIGN_PIPELINE_FOREVER));
+    TEST_ASSERT_TRUE(pipeline->flush(1000));
+    TEST_ASSERT_EQUAL_UINT32(RECORDED_PACKETS, pipeline->sent());
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline->failed());
+
+    // the packets arrive in order, as Base64 encoded [signature | payload]
+    Base64 base64;
+    for (size_t i = 0; i < RECORDED_PACKETS; i++) {
+        size_t decodedLength;
+        char *decoded = base64.Decode(reinterpret_cast<const char *>(sink.packets[i]), sink.lengths[i],
+                                      &decodedLength);
+        TEST_ASSERT_EQUAL_UINT32(crypto_sign_BYTES + lengths[i], decodedLength);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(payload + i, decoded + crypto_sign_BYTES, lengths[i]);
+
+        ED25519Signature expected;
+        TEST_ASSERT_TRUE(context->sign(payload + i, lengths[i], expected));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.signature, decoded, crypto_sign_BYTES);
+        free(decoded);
+    }
+    delete pipeline;
+}
+
+void TestSignPipelineBinary() {
+    sink.reset(0);
+    SignPipeline *pipeline = new SignPipeline(*context, sink, false);
+    TEST_ASSERT_TRUE(pipeline->start());
+    TEST_ASSERT_FALSE(pipeline->submit(10));
+
+    // the payload is written into the packet buffer, nothing is copied
+    unsigned char *buffer = pipeline->acquire(0);
+    TEST_ASSERT_NOT_NULL(buffer);
+    TEST_ASSERT_EQUAL_PTR(buffer, pipeline->acquire(0));
+    memcpy(buffer, payload, PAYLOAD_SIZE);
+    TEST_ASSERT_FALSE(pipeline->submit(SIGN_PIPELINE_PAYLOAD + 1));
+    TEST_ASSERT_TRUE(pipeline->submit(PAYLOAD_SIZE));
+    TEST_ASSERT_TRUE(pipeline->flush(1000));
+
+    ED25519Signature expected;
+    TEST_ASSERT_TRUE(context->sign(payload, PAYLOAD_SIZE, expected));
+    TEST_ASSERT_EQUAL_UINT32(crypto_sign_BYTES + PAYLOAD_SIZE, sink.lengths[0]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.signature, sink.packets[0], crypto_sign_BYTES);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, sink.packets[0] + crypto_sign_BYTES, PAYLOAD_SIZE);
+
+    // stop sends what is queued and drops the buffer that is not submitted
+    TEST_ASSERT_NOT_NULL(pipeline->acquire(0));
+    pipeline->stop();
+    TEST_ASSERT_EQUAL_UINT32(1, sink.count);
+    TEST_ASSERT_NULL(pipeline->acquire(0));
+    delete pipeline;
+}
+
+void TestSignPipelineBackPressure() {
+    // the caller signs, the transport has to be slower than filling all buffers
+    Timer timer;
+    ED25519Signature signature;
+    timer.start();
+    for (int i = 0; i < 10; i++) context->sign(payload, PAYLOAD_SIZE, signature);
+    const int signTime = timer.read_us() / 10000 + 1;
+    const int delay = SIGN_PIPELINE_BUFFERS * (signTime + BACK_PRESSURE_GAP) + BACK_PRESSURE_WAIT;
+    const uint32_t timeout = static_cast<uint32_t>(4 * delay);
+    sink.reset(delay);
+    SignPipeline *pipeline = new SignPipeline(*context, sink, false);
+    TEST_ASSERT_TRUE(pipeline->start());
+
+    // one packet is on its way, the others fill the free buffers
+    for (int i = 0; i < SIGN_PIPELINE_BUFFERS; i++) {
+        TEST_ASSERT_TRUE(pipeline->send(payload, PAYLOAD_SIZE, 0));
+        wait_ms(BACK_PRESSURE_GAP);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline->stalls());
+
+    // the transport is behind, the producer has to wait for the rest of the first packet
+    TEST_ASSERT_NULL(pipeline->acquire(0));
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline->stalls());
+    timer.reset();
+    TEST_ASSERT_NOT_NULL(pipeline->acquire(timeout));
+    TEST_ASSERT_TRUE_MESSAGE(timer.read_ms() >= BACK_PRESSURE_WAIT / 2, "acquire() did not wait for the transport");
+    TEST_ASSERT_EQUAL_UINT32(2, pipeline->stalls());
+    TEST_ASSERT_TRUE(pipeline->submit(PAYLOAD_SIZE));
+
+    TEST_ASSERT_TRUE(pipeline->flush(timeout));
+    TEST_ASSERT_EQUAL_UINT32(SIGN_PIPELINE_BUFFERS + 1, pipeline->sent());
+
+    // failed packets are counted, not repeated
+    sink.delay = 0;
+    sink.fail = true;
+    TEST_ASSERT_TRUE(pipeline->send(payload, PAYLOAD_SIZE, timeout));
+    TEST_ASSERT_TRUE(pipeline->flush(timeout));
+    TEST_ASSERT_EQUAL_UINT32(SIGN_PIPELINE_BUFFERS + 1, pipeline->sent());
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline->failed());
+    delete pipeline;
+}
+
+void TestSignPipelineThroughput() {
+    // let the transport take about as long as signing and encoding
+    Timer timer;
+    ED25519Signature signature;
+    Base64Encoder encoder;
+    char encoded[SIGN_PIPELINE_ENCODED_BYTES];
+    timer.start();
+    for (int i = 0; i < 10; i++) {
+        context->sign(payload, PAYLOAD_SIZE, signature);
+        encoder.Finish(encoded + encoder.Update(payload, PAYLOAD_SIZE, encoded));
+    }
+    const int signTime = timer.read_us() / 10;
+    sink.reset(signTime / 1000 > 0 ? signTime / 1000 : 1);
+
+    // one packet after the other
+    unsigned char packet[SIGN_PIPELINE_PACKET_BYTES];
+    timer.reset();
+    for (int i = 0; i < THROUGHPUT_PACKETS; i++) {
+        context->sign(payload, PAYLOAD_SIZE, signature);
+        memcpy(packet, signature.signature, crypto_sign_BYTES);
+        memcpy(packet + crypto_sign_BYTES, payload, PAYLOAD_SIZE);
+        const size_t length = encoder.Update(packet, crypto_sign_BYTES + PAYLOAD_SIZE, encoded);
+        sink.transmit(reinterpret_cast<unsigned char *>(encoded), length + encoder.Finish(encoded + length));
+    }
+    const int sequentialTime = timer.read_us();
+
+    // signing overlaps with sending
+    SignPipeline *pipeline = new SignPipeline(*context, sink);
+    TEST_ASSERT_TRUE(pipeline->start());
+    timer.reset();
+    for (int i = 0; i < THROUGHPUT_PACKETS; i++) {
+        TEST_ASSERT_TRUE(pipeline->send(payload, PAYLOAD_SIZE, SIGN_PIPELINE_FOREVER));
+    }
+    TEST_ASSERT_TRUE(pipeline->flush(SIGN_PIPELINE_FOREVER));
+    const int pipelineTime = timer.read_us();
+    timer.stop();
+    TEST_ASSERT_EQUAL_UINT32(THROUGHPUT_PACKETS, pipeline->sent());
+
+    printf("%d byte payload, transport %dms: sequential %d packets/s, pipeline (%d buffers) %d packets/s, %u stalls\r\n",
+           PAYLOAD_SIZE, sink.delay, (int) (THROUGHPUT_PACKETS * 1000000LL / sequentialTime), SIGN_PIPELINE_BUFFERS,
+           (int) (THROUGHPUT_PACKETS * 1000000LL / pipelineTime), (unsigned) pipeline->stalls());
+    delete pipeline;
+    TEST_ASSERT_TRUE_MESSAGE(pipelineTime < sequentialTime, "the pipeline is not faster");
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(120, "default_auto");
+    keyPair.generate();
+    context = new ED25519SigningContext(keyPair);
+    randombytes(payload, sizeof(payload));
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Sign pipeline packets", TestSignPipelinePackets, greentea_case_failure_abort_handler),
+            Case("Sign pipeline binary", TestSignPipelineBinary, greentea_case_failure_abort_handler),
+            Case("Sign pipeline back-pressure", TestSignPipelineBackPressure, greentea_case_failure_abort_handler),
+            Case("Sign pipeline throughput", TestSignPipelineThroughput, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -0,0 +1,234 @@
+/*
+ * Tests for the key pairs based on algorithm policies.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-22
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <StaticKeyPair.h>
+#include <KeyPair.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define BENCHMARK_ROUNDS 20
+
+// RFC 8032, 7.1 TEST 1
+static const unsigned char ed25519SecretKey[crypto_sign_SECRETKEYBYTES] = {
+        0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+        0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60,
+        0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+        0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a
+};
+static const unsigned char ed25519Signature[crypto_sign_BYTES] = {
+        0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+        0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+        0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+        0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b
+};
+
+// RFC 8032, 7.3 TEST abc
+static const unsigned char ed25519phSecretKey[crypto_sign_SECRETKEYBYTES] = {
+        0x83, 0x3f, 0xe6, 0x24, 0x09, 0x23, 0x7b, 0x9d, 0x62, 0xec, 0x77, 0x58, 0x75, 0x20, 0x91, 0x1e,
+        0x9a, 0x75, 0x9c, 0xec, 0x1d, 0x19, 0x75, 0x5b, 0x7d, 0xa9, 0x01, 0xb9, 0x6d, 0xca, 0x3d, 0x42,
+        0xec, 0x17, 0x2b, 0x93, 0xad, 0x5e, 0x56, 0x3b, 0xf4, 0x93, 0x2c, 0x70, 0xe1, 0x24, 0x50, 0x34,
+        0xc3, 0x54, 0x67, 0xef, 0x2e, 0xfd, 0x4d, 0x64, 0xeb, 0xf8, 0x19, 0x68, 0x34, 0x67, 0xe2, 0xbf
+};
+static const unsigned char ed25519phSignature[crypto_sign_BYTES] = {
+        0x98, 0xa7, 0x02, 0x22, 0xf0, 0xb8, 0x12, 0x1a, 0xa9, 0xd3, 0x0f, 0x81, 0x3d, 0x68, 0x3f, 0x80,
+        0x9e, 0x46, 0x2b, 0x46, 0x9c, 0x7f, 0xf8, 0x76, 0x39, 0x49, 0x9b, 0xb9, 0x4e, 0x6d, 0xae, 0x41,
+        0x31, 0xf8, 0x50, 0x42, 0x46, 0x3c, 0x2a, 0x35, 0x5a, 0x20, 0x03, 0xd0, 0x62, 0xad, 0xf5, 0xaa,
+        0xa1, 0x0b, 0x8c, 0x61, 0xe6, 0x36, 0x06, 0x2a, 0xaa, 0xd1, 0x1c, 0x2a, 0x26, 0x08, 0x34, 0x06
+};
+
+// RFC 7748, 6.1
+static const unsigned char alicePrivate[X25519_BYTES] = {
+        0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d, 0x3c, 0x16, 0xc1, 0x72, 0x51, 0xb2, 0x66, 0x45,
+        0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a, 0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a
+};
+static const unsigned char alicePublic[X25519_BYTES] = {
+        0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54, 0x74, 0x8b, 0x7d, 0xdc, 0xb4, 0x3e, 0xf7, 0x5a,
+        0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4, 0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a
+};
+static const unsigned char bobPrivate[X25519_BYTES] = {
+        0x5d, 0xab, 0x08, 0x7e, 0x62, 0x4a, 0x8a, 0x4b, 0x79, 0xe1, 0x7f, 0x8b, 0x83, 0x80, 0x0e, 0xe6,
+        0x6f, 0x3b, 0xb1, 0x29, 0x26, 0x18, 0xb6, 0xfd, 0x1c, 0x2f, 0x8b, 0x27, 0xff, 0x88, 0xe0, 0xeb
+};
+static const unsigned char bobPublic[X25519_BYTES] = {
+        0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4, 0xd3, 0x5b, 0x61, 0xc2, 0xec, 0xe4, 0x35, 0x37,
+        0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d, 0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f
+};
+static const unsigned char sharedSecret[X25519_BYTES] = {
+        0x4a, 0x5d, 0x9d, 0x5b, 0xa4, 0xce, 0x2d, 0xe1, 0x72, 0x8e, 0x3b, 0xf4, 0x80, 0x35, 0x0f, 0x25,
+        0xe0, 0x7e, 0x21, 0xc9, 0x47, 0xd1, 0x9e, 0x33, 0x76, 0xf0, 0x9b, 0x3c, 0x1e, 0x16, 0x17, 0x42
+};
+
+void TestStaticED25519() {
+    ED25519StaticKeyPair keyPair;
+    unsigned char signature[ED25519Algorithm::SIGNATURE_BYTES];
+
+    TEST_ASSERT_NULL(keyPair.getPublicKey());
+    TEST_ASSERT_FALSE_MESSAGE(keyPair.sign(NULL, 0, signature), "signed without key");
+    TEST_ASSERT_FALSE(keyPair.import(ed25519SecretKey + 32, 31, ed25519SecretKey, 64));
+    TEST_ASSERT_TRUE(keyPair.import(ed25519SecretKey + 32, 32, ed25519SecretKey, 64));
+
+    // the RFC test signs the empty message
+    TEST_ASSERT_TRUE(keyPair.sign(NULL, 0, signature));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ed25519Signature, signature, sizeof(signature));
+    TEST_ASSERT_TRUE(keyPair.verify(NULL, 0, signature));
+    signature[63] ^= 0x01;
+    TEST_ASSERT_FALSE(keyPair.verify(NULL, 0, signature));
+
+    // signatures are interchangeable with the ED25519KeyPair
+    const unsigned char message[] = "policy based key pair";
+    ED25519KeyPair reference;
+    reference.generate();
+    ED25519Signature *expected = reference.sign(message, sizeof(message));
+    ED25519StaticKeyPair verifier;
+    TEST_ASSERT_TRUE(verifier.importPublicKey(reference.getPublicKey()->key, 32));
+    TEST_ASSERT_TRUE(verifier.verify(message, sizeof(message), expected->signature));
+    TEST_ASSERT_FALSE_MESSAGE(verifier.sign(message, sizeof(message), signature), "signed with public key only");
+    delete expected;
+
+    ED25519StaticKeyPair generated;
+    TEST_ASSERT_TRUE(generated.generate());
+    TEST_ASSERT_TRUE(generated.sign(message, sizeof(message), signature));
+    ED25519KeyPair linked;
+    linked.link(reinterpret_cast<const ED25519PublicKey *>(generated.getPublicKey()));
+    TEST_ASSERT_TRUE(linked.verify(message, sizeof(message), reinterpret_cast<ED25519Signature *>(signature)));
+}
+
+void TestStaticED25519ph() {
+    ED25519phStaticKeyPair keyPair;
+    unsigned char signature[ED25519phAlgorithm::SIGNATURE_BYTES];
+    const unsigned char message[3] = {'a', 'b', 'c'};
+
+    TEST_ASSERT_TRUE(keyPair.import(ed25519phSecretKey + 32, 32, ed25519phSecretKey, 64));
+    TEST_ASSERT_TRUE(keyPair.sign(message, sizeof(message), signature));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ed25519phSignature, signature, sizeof(signature));
+    TEST_ASSERT_TRUE(keyPair.verify(message, sizeof(message), signature));
+    TEST_ASSERT_FALSE(keyPair.verify(message, sizeof(message) - 1, signature));
+
+    // a pure ED25519 signature of the same key does not pass as Ed25519ph
+    ED25519StaticKeyPair pure;
+    TEST_ASSERT_TRUE(pure.import(ed25519phSecretKey + 32, 32, ed25519phSecretKey, 64));
+    TEST_ASSERT_TRUE(pure.sign(message, sizeof(message), signature));
+    TEST_ASSERT_FALSE(keyPair.verify(message, sizeof(message), signature));
+}
+
+void TestStaticX25519() {
+    X25519StaticKeyPair alice, bob;
+    unsigned char shared[X25519Algorithm::SHARED_SECRET_BYTES];
+
+    TEST_ASSERT_FALSE(alice.agree(shared, bobPublic));
+    TEST_ASSERT_TRUE(alice.import(alicePublic, 32, alicePrivate, 32));
+    TEST_ASSERT_TRUE(bob.import(bobPublic, 32, bobPrivate, 32));
+
+    unsigned char publicKey[X25519_BYTES];
+    x25519Base(publicKey, alicePrivate);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(alicePublic, publicKey, X25519_BYTES);
+    x25519Base(publicKey, bobPrivate);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bobPublic, publicKey, X25519_BYTES);
+
+    TEST_ASSERT_TRUE(alice.agree(shared, bob.getPublicKey()));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(sharedSecret, shared, X25519_BYTES);
+    TEST_ASSERT_TRUE(bob.agree(shared, alice.getPublicKey()));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(sharedSecret, shared, X25519_BYTES);
+
+    // a low order point gives an all zero secret
+    const unsigned char zero[X25519_BYTES] = {0};
+    TEST_ASSERT_FALSE(alice.agree(shared, zero));
+
+    X25519StaticKeyPair carol, dave;
+    unsigned char carolShared[X25519_BYTES], daveShared[X25519_BYTES];
+    TEST_ASSERT_TRUE(carol.generate());
+    TEST_ASSERT_TRUE(dave.generate());
+    TEST_ASSERT_TRUE(carol.agree(carolShared, dave.getPublicKey()));
+    TEST_ASSERT_TRUE(dave.agree(daveShared, carol.getPublicKey()));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(carolShared, daveShared, X25519_BYTES);
+}
+
+void TestStaticBenchmark() {
+    ED25519KeyPair dynamicKeyPair;
+    ED25519StaticKeyPair staticKeyPair;
+    dynamicKeyPair.generate();
+    staticKeyPair.generate();
+
+    unsigned char message[100], signature[crypto_sign_BYTES];
+    randombytes(message, sizeof(message));
+    Timer timer;
+
+    timer.start();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) delete dynamicKeyPair.sign(message, sizeof(message));
+    timer.stop();
+    const int dynamicSign = timer.read_us() / BENCHMARK_ROUNDS;
+    timer.reset();
+
+    timer.start();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) staticKeyPair.sign(message, sizeof(message), signature);
+    timer.stop();
+    const int staticSign = timer.read_us() / BENCHMARK_ROUNDS;
+    timer.reset();
+
+    ED25519Signature *dynamicSignature = dynamicKeyPair.sign(message, sizeof(message));
+    timer.start();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++)
+        TEST_ASSERT_TRUE(dynamicKeyPair.verify(message, sizeof(message), dynamicSignature));
+    timer.stop();
+    const int dynamicVerify = timer.read_us() / BENCHMARK_ROUNDS;
+    timer.reset();
+    delete dynamicSignature;
+
+    timer.start();
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++)
+        TEST_ASSERT_TRUE(staticKeyPair.verify(message, sizeof(message), signature));
+    timer.stop();
+    const int staticVerify = timer.read_us() / BENCHMARK_ROUNDS;
+
+    printf("ED25519KeyPair:       %4d bytes (+%d heap), sign %dus, verify %dus\r\n",
+           (int) sizeof(ED25519KeyPair),
+           (int) (sizeof(ED25519PublicKey) + sizeof(ED25519PrivateKey) + sizeof(ED25519KeyCache)),
+           dynamicSign, dynamicVerify);
+    printf("ED25519StaticKeyPair: %4d bytes (+0 heap), sign %dus, verify %dus\r\n",
+           (int) sizeof(ED25519StaticKeyPair), staticSign, staticVerify);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(120, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Static key pair ED25519", TestStaticED25519, greentea_case_failure_abort_handler),
+            Case("Static key pair Ed25519ph", TestStaticED25519ph, greentea_case_failure_abort_handler),
+            Case("Static key pair X25519", TestStaticX25519, greentea_case_failure_abort_handler),
+            Case("Static key pair benchmark", TestStaticBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -21,9 +21,13 @@
  * ```
  */
 
+#include "mbed.h"
 #include <unity/unity.h>
 #include <Base64.h>
 #include <KeyPair.h>
+#include <ReplayWindow.h>
+#include <SessionTicket.h>
+#include <SignedMessage.h>
 
 #include "utest/utest.h"
 #include "greentea-client/test_env.h"
@@ -31,8 +35,16 @@
 
 using namespace utest::v1;
 
-static const int messageLength = crypto_sign_PUBLICKEYBYTES + 4;
-static const size_t signedMessageLength = messageLength + crypto_sign_BYTES;
+static const int messageLength = SIGNED_MESSAGE_PAYLOAD_BYTES;
+static const size_t signedMessageLength = SIGNED_MESSAGE_BYTES;
+
+// kept from the full key exchange for the resumption
+static ED25519KeyPair deviceKey;
+static SessionTicket ticket;
+// the nonce counter of the device key and the replay window of the server key
+static uint32_t deviceCounter;
+static ReplayWindow serverWindow;
+static int exchangeTime;
 
 // we need to read the server side data in slices, as sending too many characters fails
 void greentea_parse_kv_slice(char *k, char *v, const int keySize, const unsigned int valueSize,
@@ -49,7 +61,7 @@ void greentea_parse_kv_slice(char *k, char *v, const int keySize, const unsigned
 
 void TestCryptoKeyExchange() {
     char k[48], v[255];
-    ED25519KeyPair deviceKey, serverKey;
+    Timer timer;
     Base64 base64;
     size_t b64Length;
     char *encodedMessage;
@@ -61,14 +73,21 @@ void TestCryptoKeyExchange() {
 
     // generate the device key
     deviceKey.generate();
+    timer.start();
 
     // STEP 1 - send device message (Dpub, Dnonce) signed by device to server
     printf("STEP 1 (D->S)\r\n");
-    randombytes(deviceNone, 4);
+    ReplayWindow::put(deviceNone, ++deviceCounter);
+    // sign public key and nonce where they are, without concatenating them first
+    const ED25519Segment deviceMessage[2] = {
+            {deviceKey.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES},
+            {deviceNone,                    4}
+    };
+    ED25519Signature *deviceMessageSignature = deviceKey.sign(deviceMessage, 2);
+    TEST_ASSERT_NOT_NULL(deviceMessageSignature);
+    // prepare complete signed device message, including the signature
     memcpy(deviceSignedDeviceMessage, deviceKey.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
     memcpy(deviceSignedDeviceMessage + crypto_sign_PUBLICKEYBYTES, deviceNone, 4);
-    // prepare complete signed device message, including the signature
-    ED25519Signature *deviceMessageSignature = deviceKey.sign(deviceSignedDeviceMessage, messageLength);
     memcpy(deviceSignedDeviceMessage + messageLength, deviceMessageSignature, crypto_sign_BYTES);
     delete deviceMessageSignature;
     // encode message in base64 and send to server
@@ -80,33 +99,34 @@ void TestCryptoKeyExchange() {
     printf("STEP 2 (S->D)\r\n");
     greentea_parse_kv_slice(k, v, sizeof(k), sizeof(v), 30);
     TEST_ASSERT_EQUAL_STRING("serverSignedServerMessage", k);
-    char *serverSignedServerMessage = base64.Decode(v, strlen(v), &b64Length);
-    serverKey.importPublicKey(reinterpret_cast<const unsigned char *>(serverSignedServerMessage),
-                              crypto_sign_PUBLICKEYBYTES);
-
-    TEST_ASSERT_EQUAL_INT_MESSAGE(signedMessageLength, b64Length, "server message length mismatch");
-    bool serverSignedServerMessageVerification = serverKey.verify(
-            (const unsigned char *) serverSignedServerMessage, messageLength,
-            (ED25519Signature *) (serverSignedServerMessage + messageLength));
-    TEST_ASSERT_TRUE_MESSAGE(serverSignedServerMessageVerification, "message verification failed");
+    // the server message is signed again in step 4, it gets its own buffer
+    unsigned char serverSignedServerMessage[signedMessageLength];
+    TEST_ASSERT_TRUE(base64.Decode(v, strlen(v), serverSignedServerMessage, sizeof(serverSignedServerMessage),
+                                   &b64Length));
+    const SignedMessageView serverMessage(serverSignedServerMessage, b64Length);
+    TEST_ASSERT_TRUE_MESSAGE(serverMessage.valid(), "server message length mismatch");
+    const uint32_t serverNonce = ReplayWindow::nonce(serverMessage.nonce());
+    TEST_ASSERT_TRUE_MESSAGE(serverWindow.check(serverNonce), "replayed server message");
+    TEST_ASSERT_TRUE_MESSAGE(serverMessage.verify(), "message verification failed");
+    TEST_ASSERT_TRUE(serverWindow.accept(serverNonce));
 
     // STEP 3 - receive device message (Dpub, Dnonce) signed by server from server
     printf("STEP 3 (S->D)\r\n");
     greentea_parse_kv_slice(k, v, sizeof(k), sizeof(v), 30);
     TEST_ASSERT_EQUAL_STRING("serverSignedDeviceMessage", k);
-    char *serverSignedDeviceMessage = base64.Decode(v, strlen(v), &b64Length);
-    TEST_ASSERT_EQUAL_INT_MESSAGE(signedMessageLength, b64Length, "server message length mismatch");
-    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(deviceSignedDeviceMessage, serverSignedDeviceMessage, messageLength,
+    // decoded and verified in the receive buffer
+    unsigned char *serverSignedDeviceMessage = reinterpret_cast<unsigned char *>(v);
+    TEST_ASSERT_TRUE(base64.Decode(v, strlen(v), serverSignedDeviceMessage, sizeof(v), &b64Length));
+    const SignedMessageView signedDeviceMessage(serverSignedDeviceMessage, b64Length);
+    TEST_ASSERT_TRUE_MESSAGE(signedDeviceMessage.valid(), "server message length mismatch");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(deviceSignedDeviceMessage, signedDeviceMessage.payload(), messageLength,
                                          "message changed");
-    bool serverSignedDeviceMessageVerification = serverKey.verify(
-            (const unsigned char *) serverSignedDeviceMessage, messageLength,
-            (ED25519Signature *) (serverSignedDeviceMessage + messageLength));
-    TEST_ASSERT_TRUE_MESSAGE(serverSignedDeviceMessageVerification, "message verification failed");
-    free(serverSignedDeviceMessage);
+    // the server must have signed our own public key and nonce
+    TEST_ASSERT_TRUE_MESSAGE(signedDeviceMessage.verify(serverMessage.publicKey()), "message verification failed");
 
     // STEP 4 - send server message (Spub, Snonce) signed by device to server
     printf("STEP 4 (D->S)\r\n");
-    unsigned char *deviceSignedServerMessage = (unsigned char *) serverSignedServerMessage;
+    unsigned char *deviceSignedServerMessage = serverSignedServerMessage;
     ED25519Signature *serverMessageSignature = deviceKey.sign(deviceSignedServerMessage, messageLength);
     memcpy(deviceSignedServerMessage + messageLength, serverMessageSignature, crypto_sign_BYTES);
     delete serverMessageSignature;
@@ -114,11 +134,45 @@ void TestCryptoKeyExchange() {
     encodedMessage = base64.Encode((const char *) deviceSignedServerMessage, signedMessageLength, &b64Length);
     greentea_send_kv("deviceSignedServerMessage", encodedMessage);
     free(encodedMessage);
-    free(serverSignedServerMessage);
 
     greentea_parse_kv(k, v, sizeof(k), sizeof(v));
     TEST_ASSERT_EQUAL_STRING("serverVerification", k);
     TEST_ASSERT_EQUAL_STRING_MESSAGE("SUCCESS", v, "key exchange final step failed");
+    exchangeTime = timer.read_ms();
+
+    // both sides verified each other, keep the ticket for the next connection
+    TEST_ASSERT_TRUE(ticket.issue(deviceSignedDeviceMessage, deviceSignedServerMessage, SESSION_DEVICE));
+}
+
+void TestSessionResumption() {
+    char k[48], v[255];
+    Base64 base64;
+    size_t b64Length;
+    unsigned char request[SESSION_RESUME_BYTES];
+    Timer timer;
+
+    TEST_ASSERT_TRUE_MESSAGE(ticket.valid(), "no ticket from the key exchange");
+    timer.start();
+    TEST_ASSERT_TRUE(ticket.request(deviceKey, request));
+    char *encodedRequest = base64.Encode((const char *) request, sizeof(request), &b64Length);
+    greentea_send_kv("resumeRequest", encodedRequest);
+
+    greentea_parse_kv_slice(k, v, sizeof(k), sizeof(v), 30);
+    TEST_ASSERT_EQUAL_STRING("resumeResponse", k);
+    char *response = base64.Decode(v, strlen(v), &b64Length);
+    TEST_ASSERT_TRUE_MESSAGE(ticket.confirm((const unsigned char *) response, b64Length), "resumption failed");
+    free(response);
+    const int resumeTime = timer.read_ms();
+    timer.stop();
+
+    printf("full key exchange %dms, resumption %dms, saved %dms\r\n",
+           exchangeTime, resumeTime, exchangeTime - resumeTime);
+
+    // the server does not accept the same request twice
+    greentea_send_kv("resumeRequest", encodedRequest);
+    free(encodedRequest);
+    greentea_parse_kv_slice(k, v, sizeof(k), sizeof(v), 30);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("resumeRejected", k, "replayed request accepted");
 }
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
@@ -130,6 +184,7 @@ utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
 int main() {
     Case cases[] = {
             Case("Crypto test key exchange", TestCryptoKeyExchange, greentea_case_failure_abort_handler),
+            Case("Crypto test session resumption", TestSessionResumption, greentea_case_failure_abort_handler),
     };
 
     Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
@@ -0,0 +1,223 @@
+/*
+ * Tests for the nonce replay window.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-12
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <ReplayWindow.h>
+#include <SignedMessage.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define NONCE_OFFSET crypto_sign_PUBLICKEYBYTES
+#define MESSAGE_LENGTH (crypto_sign_PUBLICKEYBYTES + 4)
+#define PEERS 1000
+#define HANDSHAKES 50
+
+void TestReplayInOrder() {
+    ReplayWindow window;
+
+    TEST_ASSERT_TRUE_MESSAGE(window.check(0), "empty window must accept nonce 0");
+    for (uint32_t nonce = 0; nonce < 100; nonce++) {
+        TEST_ASSERT_TRUE_MESSAGE(window.accept(nonce), "fresh nonce rejected");
+        TEST_ASSERT_FALSE_MESSAGE(window.check(nonce), "replayed nonce accepted");
+    }
+    TEST_ASSERT_FALSE_MESSAGE(window.accept(99), "replayed nonce accepted");
+    TEST_ASSERT_FALSE_MESSAGE(window.accept(42), "old nonce accepted");
+}
+
+void TestReplayOutOfOrder() {
+    ReplayWindow window;
+
+    TEST_ASSERT_TRUE(window.accept(1000));
+    TEST_ASSERT_TRUE_MESSAGE(window.accept(1000 - REPLAY_WINDOW_SIZE + 1), "oldest nonce in window rejected");
+    TEST_ASSERT_FALSE_MESSAGE(window.check(1000 - REPLAY_WINDOW_SIZE), "nonce outside window accepted");
+    TEST_ASSERT_TRUE_MESSAGE(window.accept(990), "delayed nonce rejected");
+    TEST_ASSERT_FALSE_MESSAGE(window.accept(990), "delayed nonce accepted twice");
+
+    // moving the window keeps the delayed nonces
+    TEST_ASSERT_TRUE(window.accept(1005));
+    TEST_ASSERT_FALSE_MESSAGE(window.check(990), "delayed nonce forgotten after shift");
+    TEST_ASSERT_FALSE_MESSAGE(window.check(1000), "highest nonce forgotten after shift");
+    TEST_ASSERT_TRUE_MESSAGE(window.check(1001), "unseen nonce rejected after shift");
+
+    // a large jump clears the window
+    TEST_ASSERT_TRUE(window.accept(0xFFFFFFF0));
+    TEST_ASSERT_FALSE(window.check(1005));
+    TEST_ASSERT_TRUE(window.check(0xFFFFFFEF));
+    TEST_ASSERT_TRUE(window.accept(0xFFFFFFFF));
+    TEST_ASSERT_FALSE(window.check(0xFFFFFFF0));
+
+    window.reset();
+    TEST_ASSERT_TRUE_MESSAGE(window.check(1005), "reset window rejected nonce");
+}
+
+void TestReplayCheckOnly() {
+    ReplayWindow window;
+
+    // check must not change the window, a forged message must not consume its nonce
+    TEST_ASSERT_TRUE(window.check(7));
+    TEST_ASSERT_TRUE(window.check(7));
+    TEST_ASSERT_TRUE(window.accept(7));
+    TEST_ASSERT_TRUE(window.check(8));
+    TEST_ASSERT_TRUE(window.accept(8));
+}
+
+void TestReplayNonce() {
+    const unsigned char bytes[4] = {0x12, 0x34, 0x56, 0x78};
+    TEST_ASSERT_EQUAL_UINT32(0x12345678, ReplayWindow::nonce(bytes));
+
+    unsigned char written[4];
+    ReplayWindow::put(written, 0x12345678);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bytes, written, sizeof(bytes));
+}
+
+void TestReplaySignedMessages() {
+    ED25519KeyPair keyPair;
+    keyPair.generate();
+
+    ED25519Peer peer;
+    memcpy(peer.publicKey.key, keyPair.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    ED25519KeyPair peerKey;
+    peerKey.link(&peer.publicKey);
+
+    unsigned char message[MESSAGE_LENGTH];
+    memcpy(message, keyPair.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    message[NONCE_OFFSET] = 0x00;
+    message[NONCE_OFFSET + 1] = 0x00;
+    message[NONCE_OFFSET + 2] = 0x01;
+    message[NONCE_OFFSET + 3] = 0x00;
+
+    ED25519Signature *signature = keyPair.sign(message, MESSAGE_LENGTH);
+    TEST_ASSERT_NOT_NULL(signature);
+
+    const uint32_t nonce = ReplayWindow::nonce(message + NONCE_OFFSET);
+    TEST_ASSERT_EQUAL_UINT32(0x100, nonce);
+
+    // a forged signature must not move the window
+    signature->signature[0] ^= 1;
+    TEST_ASSERT_TRUE(peer.window.check(nonce));
+    TEST_ASSERT_FALSE(peerKey.verify(message, MESSAGE_LENGTH, signature));
+    signature->signature[0] ^= 1;
+
+    TEST_ASSERT_TRUE(peer.window.check(nonce));
+    TEST_ASSERT_TRUE(peerKey.verify(message, MESSAGE_LENGTH, signature));
+    TEST_ASSERT_TRUE(peer.window.accept(nonce));
+
+    // the replay is rejected without verifying
+    TEST_ASSERT_FALSE_MESSAGE(peer.window.check(nonce), "replayed message accepted");
+
+    delete signature;
+}
+
+// handshake messages [publicKey | counter nonce | signature], kept to be replayed later
+static unsigned char handshakes[HANDSHAKES][SIGNED_MESSAGE_BYTES];
+
+void TestReplayHandshakeCounter() {
+    ED25519KeyPair device;
+    device.generate();
+    ED25519Peer peer;
+    memcpy(peer.publicKey.key, device.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+
+    uint32_t counter = 0;
+    for (int i = 0; i < HANDSHAKES; i++) {
+        memcpy(handshakes[i], device.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+        ReplayWindow::put(handshakes[i] + NONCE_OFFSET, ++counter);
+        ED25519Signature *signature = device.sign(handshakes[i], SIGNED_MESSAGE_PAYLOAD_BYTES);
+        TEST_ASSERT_NOT_NULL(signature);
+        memcpy(handshakes[i] + SIGNED_MESSAGE_PAYLOAD_BYTES, signature->signature, crypto_sign_BYTES);
+        delete signature;
+    }
+
+    // delivered with every pair swapped, as a network may reorder them
+    for (int i = 0; i < HANDSHAKES; i++) {
+        const SignedMessageView message(handshakes[i ^ 1], SIGNED_MESSAGE_BYTES);
+        const uint32_t nonce = ReplayWindow::nonce(message.nonce());
+        TEST_ASSERT_TRUE_MESSAGE(peer.window.check(nonce), "fresh handshake rejected");
+        TEST_ASSERT_TRUE(message.verify(peer.publicKey));
+        TEST_ASSERT_TRUE(peer.window.accept(nonce));
+    }
+
+    // every captured handshake is a replay, no matter how old
+    for (int i = 0; i < HANDSHAKES; i++) {
+        const SignedMessageView message(handshakes[i], SIGNED_MESSAGE_BYTES);
+        TEST_ASSERT_TRUE(message.verify(peer.publicKey));
+        TEST_ASSERT_FALSE_MESSAGE(peer.window.check(ReplayWindow::nonce(message.nonce())),
+                                  "replayed handshake accepted");
+    }
+    TEST_ASSERT_TRUE_MESSAGE(peer.window.check(counter + 1), "next handshake rejected");
+}
+
+void TestReplayPeerTable() {
+    ED25519Peer *peers = new ED25519Peer[PEERS];
+    Timer timer;
+
+    timer.start();
+    for (uint32_t nonce = 0; nonce < 16; nonce++) {
+        for (int i = 0; i < PEERS; i++) {
+            if (peers[i].window.check(nonce)) peers[i].window.accept(nonce);
+        }
+    }
+    const int acceptTime = timer.read_us();
+
+    timer.reset();
+    int rejected = 0;
+    for (uint32_t nonce = 0; nonce < 16; nonce++) {
+        for (int i = 0; i < PEERS; i++) {
+            if (!peers[i].window.check(nonce)) rejected++;
+        }
+    }
+    const int rejectTime = timer.read_us();
+    timer.stop();
+
+    TEST_ASSERT_EQUAL_INT(16 * PEERS, rejected);
+    printf("%d peers, %d bytes each: accept %dus, reject %dus (%d checks)\r\n",
+           PEERS, (int) sizeof(ED25519Peer), acceptTime, rejectTime, 16 * PEERS);
+
+    delete[] peers;
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Replay window in order", TestReplayInOrder, greentea_case_failure_abort_handler),
+            Case("Replay window out of order", TestReplayOutOfOrder, greentea_case_failure_abort_handler),
+            Case("Replay window check only", TestReplayCheckOnly, greentea_case_failure_abort_handler),
+            Case("Replay window nonce", TestReplayNonce, greentea_case_failure_abort_handler),
+            Case("Replay window signed messages", TestReplaySignedMessages, greentea_case_failure_abort_handler),
+            Case("Replay window handshake counter", TestReplayHandshakeCounter, greentea_case_failure_abort_handler),
+            Case("Replay window peer table", TestReplayPeerTable, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
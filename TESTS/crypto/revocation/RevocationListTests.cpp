@@ -0,0 +1,321 @@
+/*
+ * Tests for the revocation list and its Bloom filter.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-31
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <RevocationList.h>
+#include <SignatureFilter.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+#include "../COMMON/RAMFlashStorage.h"
+
+using namespace utest::v1;
+
+#define SECTOR_SIZE 1024
+#define SMALL_KEYS 60
+#define DELTA_KEYS 8
+
+// the device measures what fits into its RAM, the host the full fleet
+#ifdef __MBED__
+#define BENCHMARK_KEYS 1000
+#else
+#define BENCHMARK_KEYS 100000
+#endif
+#define BENCHMARK_LOOKUPS 10000
+
+static ED25519KeyPair authority;
+static ED25519KeyPair device;
+
+static int compareKeys(const void *a, const void *b) {
+    return memcmp(a, b, crypto_sign_PUBLICKEYBYTES);
+}
+
+static void randomKeys(unsigned char *keys, size_t count) {
+    randombytes(keys, count * crypto_sign_PUBLICKEYBYTES);
+    qsort(keys, count, crypto_sign_PUBLICKEYBYTES, compareKeys);
+}
+
+// what the revocation authority sends: ['UBRV' | sequence | count | keys | signature]
+static size_t makeDelta(unsigned char *delta, uint32_t sequence, const unsigned char *keys, size_t count,
+                        ED25519KeyPair &signer) {
+    delta[0] = 'U';
+    delta[1] = 'B';
+    delta[2] = 'R';
+    delta[3] = 'V';
+    delta[4] = static_cast<unsigned char>(sequence >> 24);
+    delta[5] = static_cast<unsigned char>(sequence >> 16);
+    delta[6] = static_cast<unsigned char>(sequence >> 8);
+    delta[7] = static_cast<unsigned char>(sequence);
+    delta[8] = static_cast<unsigned char>(count >> 8);
+    delta[9] = static_cast<unsigned char>(count);
+    memcpy(delta + REVOCATION_DELTA_HEADER_BYTES, keys, count * crypto_sign_PUBLICKEYBYTES);
+
+    const size_t signedLength = REVOCATION_DELTA_HEADER_BYTES + count * crypto_sign_PUBLICKEYBYTES;
+    ED25519Signature *signature = signer.sign(delta, signedLength);
+    memcpy(delta + signedLength, signature->signature, crypto_sign_BYTES);
+    delete signature;
+    return signedLength + crypto_sign_BYTES;
+}
+
+void TestRevocationFormatAndMount() {
+    RAMFlashStorage storage(4 * SECTOR_SIZE, SECTOR_SIZE);
+    unsigned char filter[REVOCATION_FILTER_BYTES(SMALL_KEYS)];
+    RevocationList list(storage, filter, sizeof(filter));
+
+    TEST_ASSERT_FALSE_MESSAGE(list.mount(), "mounted erased storage");
+    TEST_ASSERT_TRUE_MESSAGE(list.format(), "format failed");
+    TEST_ASSERT_EQUAL_UINT32(0, list.count());
+    TEST_ASSERT_EQUAL_UINT32(0, list.sequence());
+    TEST_ASSERT_EQUAL_UINT32(2 * SECTOR_SIZE / crypto_sign_PUBLICKEYBYTES - 1, list.capacity());
+    TEST_ASSERT_FALSE(list.isRevoked(device.getPublicKey()->key));
+    TEST_ASSERT_TRUE(list.mount());
+
+    // a sector is the smallest half
+    RAMFlashStorage tiny(SECTOR_SIZE, SECTOR_SIZE);
+    RevocationList unsupported(tiny, filter, sizeof(filter));
+    TEST_ASSERT_FALSE(unsupported.format());
+}
+
+void TestRevocationDeltas() {
+    RAMFlashStorage storage(4 * SECTOR_SIZE, SECTOR_SIZE);
+    unsigned char filter[REVOCATION_FILTER_BYTES(SMALL_KEYS)];
+    RevocationList list(storage, filter, sizeof(filter));
+    TEST_ASSERT_TRUE(list.format());
+
+    unsigned char keys[2 * DELTA_KEYS][crypto_sign_PUBLICKEYBYTES];
+    randomKeys(keys[0], DELTA_KEYS);
+    unsigned char delta[REVOCATION_DELTA_BYTES(DELTA_KEYS)];
+    size_t length = makeDelta(delta, 1, keys[0], DELTA_KEYS, authority);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(delta), length);
+
+    // only the authority can revoke keys
+    TEST_ASSERT_FALSE(list.apply(delta, length, device));
+    delta[REVOCATION_DELTA_HEADER_BYTES] ^= 1;
+    TEST_ASSERT_FALSE_MESSAGE(list.apply(delta, length, authority), "tampered delta applied");
+    delta[REVOCATION_DELTA_HEADER_BYTES] ^= 1;
+    TEST_ASSERT_FALSE(list.apply(delta, length - 1, authority));
+    TEST_ASSERT_EQUAL_UINT32(0, list.count());
+
+    TEST_ASSERT_TRUE_MESSAGE(list.apply(delta, length, authority), "delta not applied");
+    TEST_ASSERT_EQUAL_UINT32(DELTA_KEYS, list.count());
+    TEST_ASSERT_EQUAL_UINT32(1, list.sequence());
+    for (int i = 0; i < DELTA_KEYS; i++) TEST_ASSERT_TRUE(list.isRevoked(keys[i]));
+    TEST_ASSERT_FALSE(list.isRevoked(device.getPublicKey()->key));
+
+    // a delta is applied once and in order
+    TEST_ASSERT_FALSE_MESSAGE(list.apply(delta, length, authority), "delta replayed");
+    length = makeDelta(delta, 3, keys[0], DELTA_KEYS, authority);
+    TEST_ASSERT_FALSE(list.apply(delta, length, authority));
+
+    // unsorted keys are rejected
+    unsigned char sorted[2][crypto_sign_PUBLICKEYBYTES];
+    randomKeys(sorted[0], 2);
+    unsigned char reversed[2][crypto_sign_PUBLICKEYBYTES];
+    memcpy(reversed[0], sorted[1], crypto_sign_PUBLICKEYBYTES);
+    memcpy(reversed[1], sorted[0], crypto_sign_PUBLICKEYBYTES);
+    length = makeDelta(delta, 2, reversed[0], 2, authority);
+    TEST_ASSERT_FALSE(list.apply(delta, length, authority));
+
+    // keys that are revoked again are kept once
+    randomKeys(keys[DELTA_KEYS], DELTA_KEYS);
+    memcpy(keys[DELTA_KEYS], keys[2], crypto_sign_PUBLICKEYBYTES);
+    qsort(keys[DELTA_KEYS], DELTA_KEYS, crypto_sign_PUBLICKEYBYTES, compareKeys);
+    length = makeDelta(delta, 2, keys[DELTA_KEYS], DELTA_KEYS, authority);
+    TEST_ASSERT_TRUE(list.apply(delta, length, authority));
+    TEST_ASSERT_EQUAL_UINT32(2 * DELTA_KEYS - 1, list.count());
+    TEST_ASSERT_EQUAL_UINT32(2, list.sequence());
+
+    // the list survives a restart, the filter is filled again
+    RevocationList mounted(storage, filter, sizeof(filter));
+    memset(filter, 0, sizeof(filter));
+    TEST_ASSERT_TRUE(mounted.mount());
+    TEST_ASSERT_EQUAL_UINT32(2 * DELTA_KEYS - 1, mounted.count());
+    TEST_ASSERT_EQUAL_UINT32(2, mounted.sequence());
+    for (int i = 0; i < 2 * DELTA_KEYS; i++) TEST_ASSERT_TRUE(mounted.isRevoked(keys[i]));
+    TEST_ASSERT_FALSE(mounted.isRevoked(device.getPublicKey()->key));
+    TEST_ASSERT_EQUAL_UINT32(2 * DELTA_KEYS + 1, mounted.lookups());
+}
+
+void TestRevocationInterruptedUpdate() {
+    RAMFlashStorage storage(4 * SECTOR_SIZE, SECTOR_SIZE);
+    unsigned char filter[REVOCATION_FILTER_BYTES(SMALL_KEYS)];
+    RevocationList list(storage, filter, sizeof(filter));
+    TEST_ASSERT_TRUE(list.format());
+
+    unsigned char keys[SMALL_KEYS][crypto_sign_PUBLICKEYBYTES];
+    randomKeys(keys[0], SMALL_KEYS);
+    unsigned char delta[REVOCATION_DELTA_BYTES(SMALL_KEYS)];
+    size_t length = makeDelta(delta, 1, keys[0], DELTA_KEYS, authority);
+    TEST_ASSERT_TRUE(list.apply(delta, length, authority));
+
+    // power is lost while the next list is written
+    length = makeDelta(delta, 2, keys[DELTA_KEYS], DELTA_KEYS, authority);
+    storage.programs = DELTA_KEYS;
+    TEST_ASSERT_FALSE(list.apply(delta, length, authority));
+    storage.programs = -1;
+
+    RevocationList restarted(storage, filter, sizeof(filter));
+    TEST_ASSERT_TRUE(restarted.mount());
+    TEST_ASSERT_EQUAL_UINT32(1, restarted.sequence());
+    TEST_ASSERT_EQUAL_UINT32(DELTA_KEYS, restarted.count());
+    TEST_ASSERT_TRUE(restarted.isRevoked(keys[0]));
+    TEST_ASSERT_FALSE(restarted.isRevoked(keys[DELTA_KEYS]));
+
+    // the delta can be applied again and a full list does not take more
+    TEST_ASSERT_TRUE(restarted.apply(delta, length, authority));
+    TEST_ASSERT_TRUE(restarted.isRevoked(keys[DELTA_KEYS]));
+    RAMFlashStorage small(2 * SECTOR_SIZE, SECTOR_SIZE);
+    RevocationList full(small, filter, sizeof(filter));
+    TEST_ASSERT_TRUE(full.format());
+    length = makeDelta(delta, 1, keys[0], SMALL_KEYS, authority);
+    TEST_ASSERT_FALSE_MESSAGE(full.apply(delta, length, authority), "list larger than its capacity");
+    TEST_ASSERT_EQUAL_UINT32(0, full.count());
+}
+
+void TestRevocationSignatureFilter() {
+    RAMFlashStorage storage(4 * SECTOR_SIZE, SECTOR_SIZE);
+    unsigned char filter[REVOCATION_FILTER_BYTES(SMALL_KEYS)];
+    RevocationList list(storage, filter, sizeof(filter));
+    TEST_ASSERT_TRUE(list.format());
+
+    const unsigned char message[] = "message of a revoked device";
+    ED25519Signature *signature = device.sign(message, sizeof(message));
+    ED25519SignatureFilter signatureFilter;
+    signatureFilter.link(&list);
+    TEST_ASSERT_TRUE(signatureFilter.verify(message, sizeof(message), signature->signature, crypto_sign_BYTES,
+                                            device.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES));
+
+    unsigned char delta[REVOCATION_DELTA_BYTES(1)];
+    const size_t length = makeDelta(delta, 1, device.getPublicKey()->key, 1, authority);
+    TEST_ASSERT_TRUE(list.apply(delta, length, authority));
+    TEST_ASSERT_FALSE_MESSAGE(signatureFilter.verify(message, sizeof(message), signature->signature,
+                                                     crypto_sign_BYTES, device.getPublicKey()->key,
+                                                     crypto_sign_PUBLICKEYBYTES), "revoked key accepted");
+    TEST_ASSERT_EQUAL_UINT32(1, signatureFilter.rejected(FILTER_BLACKLISTED));
+
+    signatureFilter.link(NULL);
+    TEST_ASSERT_EQUAL(FILTER_PASSED, signatureFilter.check(signature->signature, crypto_sign_BYTES,
+                                                           device.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES));
+    delete signature;
+}
+
+void TestRevocationLookupCost() {
+    const size_t bank = (BENCHMARK_KEYS + 1) * crypto_sign_PUBLICKEYBYTES;
+    const size_t sectors = (bank + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    RAMFlashStorage *storage = new RAMFlashStorage(2 * sectors * SECTOR_SIZE, SECTOR_SIZE);
+    const size_t filterSize = REVOCATION_FILTER_BYTES(BENCHMARK_KEYS);
+    unsigned char *filter = new unsigned char[filterSize];
+    RevocationList *list = new RevocationList(*storage, filter, filterSize);
+    TEST_ASSERT_TRUE(list->format());
+
+    // revoke the keys in the largest deltas a delta can hold
+    unsigned char *keys = new unsigned char[BENCHMARK_KEYS * crypto_sign_PUBLICKEYBYTES];
+    const size_t deltaKeys = BENCHMARK_KEYS < REVOCATION_DELTA_MAX_KEYS ? BENCHMARK_KEYS : 50000;
+    unsigned char *delta = new unsigned char[REVOCATION_DELTA_BYTES(deltaKeys)];
+    Timer timer;
+    timer.start();
+    for (size_t done = 0; done < BENCHMARK_KEYS; done += deltaKeys) {
+        randomKeys(keys + done * crypto_sign_PUBLICKEYBYTES, deltaKeys);
+        const size_t length = makeDelta(delta, list->sequence() + 1, keys + done * crypto_sign_PUBLICKEYBYTES,
+                                        deltaKeys, authority);
+        TEST_ASSERT_TRUE(list->apply(delta, length, authority));
+    }
+    const int applyTime = timer.read_ms();
+    TEST_ASSERT_EQUAL_UINT32(BENCHMARK_KEYS, list->count());
+    delete[] delta;
+
+    unsigned char *unknown = new unsigned char[BENCHMARK_LOOKUPS * crypto_sign_PUBLICKEYBYTES];
+    randombytes(unknown, BENCHMARK_LOOKUPS * crypto_sign_PUBLICKEYBYTES);
+
+    list->resetCounters();
+    timer.reset();
+    size_t revoked = 0;
+    for (int i = 0; i < BENCHMARK_LOOKUPS; i++) revoked += list->isRevoked(unknown + i * crypto_sign_PUBLICKEYBYTES);
+    const int unknownTime = timer.read_us();
+    TEST_ASSERT_EQUAL_UINT32(0, revoked);
+    const uint32_t falsePositives = list->falsePositives();
+
+    timer.reset();
+    for (int i = 0; i < BENCHMARK_LOOKUPS; i++) {
+        revoked += list->isRevoked(keys + (i * 7919 % BENCHMARK_KEYS) * crypto_sign_PUBLICKEYBYTES);
+    }
+    const int revokedTime = timer.read_us();
+    TEST_ASSERT_EQUAL_UINT32(BENCHMARK_LOOKUPS, revoked);
+
+    // what a plain list costs
+    timer.reset();
+    const int scans = 10;
+    for (int i = 0; i < scans; i++) {
+        for (size_t k = 0; k < BENCHMARK_KEYS; k++) {
+            if (!memcmp(keys + k * crypto_sign_PUBLICKEYBYTES, unknown + i * crypto_sign_PUBLICKEYBYTES,
+                        crypto_sign_PUBLICKEYBYTES))
+                revoked++;
+        }
+    }
+    const int scanTime = timer.read_us();
+    timer.stop();
+    TEST_ASSERT_EQUAL_UINT32(BENCHMARK_LOOKUPS, revoked);
+
+    printf("%u revoked keys: filter %u bytes RAM (%d bits/key), list %u bytes flash, %u deltas in %dms\r\n",
+           (unsigned) BENCHMARK_KEYS, (unsigned) filterSize, REVOCATION_FILTER_BITS_PER_KEY,
+           (unsigned) ((BENCHMARK_KEYS + 1) * crypto_sign_PUBLICKEYBYTES), (unsigned) list->sequence(), applyTime);
+    printf("per 100000 keys: filter %u bytes RAM, list %u bytes flash (x2 for the update), plain list %u bytes\r\n",
+           (unsigned) REVOCATION_FILTER_BYTES(100000), (unsigned) (100001 * crypto_sign_PUBLICKEYBYTES),
+           (unsigned) (100000 * crypto_sign_PUBLICKEYBYTES));
+    printf("lookup: unknown key %dns (%u.%02u%% false positives), revoked key %dns, linear scan %dus\r\n",
+           (int) (unknownTime * 1000LL / BENCHMARK_LOOKUPS), (unsigned) (falsePositives * 100 / BENCHMARK_LOOKUPS),
+           (unsigned) (falsePositives * 10000 / BENCHMARK_LOOKUPS % 100),
+           (int) (revokedTime * 1000LL / BENCHMARK_LOOKUPS), scanTime / scans);
+
+    TEST_ASSERT_TRUE_MESSAGE(falsePositives < BENCHMARK_LOOKUPS / 20, "too many false positives");
+    delete[] unknown;
+    delete[] keys;
+    delete list;
+    delete[] filter;
+    delete storage;
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(300, "default_auto");
+    authority.generate();
+    device.generate();
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Revocation format and mount", TestRevocationFormatAndMount, greentea_case_failure_abort_handler),
+            Case("Revocation deltas", TestRevocationDeltas, greentea_case_failure_abort_handler),
+            Case("Revocation interrupted update", TestRevocationInterruptedUpdate,
+                 greentea_case_failure_abort_handler),
+            Case("Revocation signature filter", TestRevocationSignatureFilter, greentea_case_failure_abort_handler),
+            Case("Revocation lookup cost", TestRevocationLookupCost, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
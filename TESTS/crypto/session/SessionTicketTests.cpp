@@ -0,0 +1,221 @@
+/*
+ * Tests for the session resumption tickets, with both sides on the device.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-26
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <SessionTicket.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+static ED25519KeyPair deviceKey, serverKey;
+static unsigned char deviceMessage[SESSION_MESSAGE_BYTES], serverMessage[SESSION_MESSAGE_BYTES];
+
+static void exchange(SessionTicket &device, SessionTicket &server) {
+    TEST_ASSERT_TRUE(device.issue(deviceMessage, serverMessage, SESSION_DEVICE));
+    TEST_ASSERT_TRUE(server.issue(deviceMessage, serverMessage, SESSION_SERVER));
+}
+
+void TestSessionIssue() {
+    SessionTicket device, server;
+    TEST_ASSERT_FALSE(device.valid());
+    TEST_ASSERT_NULL(device.getPeerKey());
+    TEST_ASSERT_FALSE(device.issue(NULL, serverMessage, SESSION_DEVICE));
+
+    exchange(device, server);
+    TEST_ASSERT_TRUE(device.valid());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(serverKey.getPublicKey()->key, device.getPeerKey()->key, crypto_sign_PUBLICKEYBYTES);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(deviceKey.getPublicKey()->key, server.getPeerKey()->key, crypto_sign_PUBLICKEYBYTES);
+    TEST_ASSERT_EQUAL_UINT32(0, device.getCounter());
+
+    device.clear();
+    TEST_ASSERT_FALSE(device.valid());
+}
+
+void TestSessionResume() {
+    SessionTicket device, server;
+    unsigned char request[SESSION_RESUME_BYTES], response[SESSION_RESUME_BYTES];
+    exchange(device, server);
+
+    for (uint32_t i = 1; i <= 3; i++) {
+        TEST_ASSERT_TRUE(device.request(deviceKey, request));
+        TEST_ASSERT_TRUE_MESSAGE(server.accept(serverKey, request, sizeof(request), response), "request rejected");
+        TEST_ASSERT_TRUE_MESSAGE(device.confirm(response, sizeof(response)), "response rejected");
+        TEST_ASSERT_EQUAL_UINT32(i, device.getCounter());
+        TEST_ASSERT_EQUAL_UINT32(i, server.getCounter());
+    }
+
+    // a recorded request or response can not be used again
+    TEST_ASSERT_FALSE_MESSAGE(server.accept(serverKey, request, sizeof(request), response), "replay accepted");
+    unsigned char old[SESSION_RESUME_BYTES];
+    memcpy(old, response, sizeof(old));
+    TEST_ASSERT_TRUE(device.request(deviceKey, request));
+    TEST_ASSERT_FALSE_MESSAGE(device.confirm(old, sizeof(old)), "old response accepted");
+    TEST_ASSERT_TRUE(server.accept(serverKey, request, sizeof(request), response));
+    TEST_ASSERT_TRUE(device.confirm(response, sizeof(response)));
+
+    // the roles can not be mixed up
+    TEST_ASSERT_FALSE(server.request(serverKey, request));
+    TEST_ASSERT_FALSE(device.accept(deviceKey, request, sizeof(request), response));
+    TEST_ASSERT_FALSE(server.confirm(response, sizeof(response)));
+}
+
+void TestSessionReject() {
+    SessionTicket device, server, other;
+    unsigned char request[SESSION_RESUME_BYTES], response[SESSION_RESUME_BYTES], changed[SESSION_RESUME_BYTES];
+    exchange(device, server);
+    TEST_ASSERT_TRUE(device.request(deviceKey, request));
+
+    TEST_ASSERT_FALSE(server.accept(serverKey, request, sizeof(request) - 1, response));
+    TEST_ASSERT_FALSE(server.accept(serverKey, NULL, sizeof(request), response));
+
+    // any changed byte breaks the request
+    for (size_t i = 0; i < sizeof(request); i += 7) {
+        memcpy(changed, request, sizeof(changed));
+        changed[i] ^= 0x01;
+        TEST_ASSERT_FALSE_MESSAGE(server.accept(serverKey, changed, sizeof(changed), response), "changed request");
+    }
+
+    // a ticket of another exchange has another id
+    unsigned char otherMessage[SESSION_MESSAGE_BYTES];
+    memcpy(otherMessage, serverMessage, sizeof(otherMessage));
+    otherMessage[crypto_sign_PUBLICKEYBYTES] ^= 1;
+    TEST_ASSERT_TRUE(other.issue(deviceMessage, otherMessage, SESSION_SERVER));
+    TEST_ASSERT_FALSE_MESSAGE(other.accept(serverKey, request, sizeof(request), response), "foreign ticket");
+
+    // a request signed by another key fails, and does not move the counter
+    ED25519KeyPair impostor;
+    impostor.generate();
+    SessionTicket forged;
+    TEST_ASSERT_TRUE(forged.issue(deviceMessage, serverMessage, SESSION_DEVICE));
+    TEST_ASSERT_TRUE(forged.request(impostor, changed));
+    TEST_ASSERT_FALSE_MESSAGE(server.accept(serverKey, changed, sizeof(changed), response), "forged request");
+    TEST_ASSERT_EQUAL_UINT32(0, server.getCounter());
+
+    TEST_ASSERT_TRUE(server.accept(serverKey, request, sizeof(request), response));
+    response[SESSION_RESUME_BYTES - 1] ^= 1;
+    TEST_ASSERT_FALSE(device.confirm(response, sizeof(response)));
+
+    // without a ticket nothing works
+    SessionTicket empty;
+    TEST_ASSERT_FALSE(empty.request(deviceKey, request));
+    TEST_ASSERT_FALSE(empty.confirm(response, sizeof(response)));
+}
+
+void TestSessionRecord() {
+    SessionTicket device, server, loaded;
+    unsigned char record[SESSION_RECORD_BYTES], request[SESSION_RESUME_BYTES], response[SESSION_RESUME_BYTES];
+    exchange(device, server);
+
+    TEST_ASSERT_FALSE(loaded.save(record, sizeof(record)));
+    TEST_ASSERT_FALSE(device.save(record, sizeof(record) - 1));
+
+    TEST_ASSERT_TRUE(device.request(deviceKey, request));
+    TEST_ASSERT_TRUE(device.save(record, sizeof(record)));
+    TEST_ASSERT_TRUE(loaded.load(record, sizeof(record)));
+    TEST_ASSERT_EQUAL_UINT32(1, loaded.getCounter());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(device.getPeerKey()->key, loaded.getPeerKey()->key, crypto_sign_PUBLICKEYBYTES);
+
+    // the reloaded server ticket continues where the saved one stopped
+    TEST_ASSERT_TRUE(server.save(record, sizeof(record)));
+    SessionTicket reloaded;
+    TEST_ASSERT_TRUE(reloaded.load(record, sizeof(record)));
+    TEST_ASSERT_TRUE(reloaded.accept(serverKey, request, sizeof(request), response));
+    TEST_ASSERT_TRUE(loaded.confirm(response, sizeof(response)));
+
+    for (size_t i = 0; i < sizeof(record); i += 5) {
+        unsigned char damaged[SESSION_RECORD_BYTES];
+        memcpy(damaged, record, sizeof(damaged));
+        damaged[i] ^= 0x20;
+        TEST_ASSERT_FALSE_MESSAGE(reloaded.load(damaged, sizeof(damaged)), "damaged record loaded");
+        TEST_ASSERT_FALSE(reloaded.valid());
+    }
+    TEST_ASSERT_FALSE(reloaded.load(record, sizeof(record) - 1));
+}
+
+void TestSessionBenchmark() {
+    SessionTicket device, server;
+    unsigned char request[SESSION_RESUME_BYTES], response[SESSION_RESUME_BYTES];
+    Timer timer;
+
+    // the device side of the full exchange: sign D[D], verify S[S] and S[D], sign D[S]
+    ED25519Signature *serverSigned = serverKey.sign(serverMessage, SESSION_MESSAGE_BYTES);
+    ED25519Signature *deviceSigned = serverKey.sign(deviceMessage, SESSION_MESSAGE_BYTES);
+    ED25519KeyPair peer;
+    peer.link(serverKey.getPublicKey());
+    timer.start();
+    ED25519Signature *signature = deviceKey.sign(deviceMessage, SESSION_MESSAGE_BYTES);
+    delete signature;
+    TEST_ASSERT_TRUE(peer.verify(serverMessage, SESSION_MESSAGE_BYTES, serverSigned));
+    TEST_ASSERT_TRUE(peer.verify(deviceMessage, SESSION_MESSAGE_BYTES, deviceSigned));
+    signature = deviceKey.sign(serverMessage, SESSION_MESSAGE_BYTES);
+    delete signature;
+    const int fullTime = timer.read_us();
+    delete serverSigned;
+    delete deviceSigned;
+
+    // the device side of the resumption: sign the request, verify the response
+    exchange(device, server);
+    TEST_ASSERT_TRUE(device.request(deviceKey, request));
+    TEST_ASSERT_TRUE(server.accept(serverKey, request, sizeof(request), response));
+    timer.reset();
+    TEST_ASSERT_TRUE(device.request(deviceKey, request));
+    const int requestTime = timer.read_us();
+    TEST_ASSERT_TRUE(server.accept(serverKey, request, sizeof(request), response));
+    timer.reset();
+    TEST_ASSERT_TRUE(device.confirm(response, sizeof(response)));
+    const int resumeTime = requestTime + timer.read_us();
+    timer.stop();
+
+    printf("device crypto: full exchange %dus (4 messages), resumption %dus (2 messages), saved %dus\r\n",
+           fullTime, resumeTime, fullTime - resumeTime);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    deviceKey.generate();
+    serverKey.generate();
+    memcpy(deviceMessage, deviceKey.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    memcpy(serverMessage, serverKey.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+    randombytes(deviceMessage + crypto_sign_PUBLICKEYBYTES, 4);
+    randombytes(serverMessage + crypto_sign_PUBLICKEYBYTES, 4);
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Session ticket issue", TestSessionIssue, greentea_case_failure_abort_handler),
+            Case("Session ticket resume", TestSessionResume, greentea_case_failure_abort_handler),
+            Case("Session ticket reject", TestSessionReject, greentea_case_failure_abort_handler),
+            Case("Session ticket record", TestSessionRecord, greentea_case_failure_abort_handler),
+            Case("Session ticket benchmark", TestSessionBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
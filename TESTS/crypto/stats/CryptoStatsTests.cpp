@@ -0,0 +1,165 @@
+/*
+ * Tests for the runtime statistics of the crypto operations.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-20
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <CryptoStats.h>
+#include <KeyPair.h>
+#include <Base64.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+// the test build enables the statistics in TESTS/settings.json
+#ifndef UBIRCH_CRYPTO_STATS_ENABLED
+#error [NOT_SUPPORTED] crypto statistics are disabled
+#endif
+
+using namespace utest::v1;
+
+static const char *operationNames[CRYPTO_STATS_OPERATIONS] = {
+        "generate", "sign", "verify", "encode", "decode", "reject"
+};
+
+void TestStatsCounters() {
+    cryptoStatsReset();
+    const CryptoOperationStats *s = cryptoStats()->operations;
+
+    ED25519KeyPair keyPair;
+    keyPair.generate();
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_GENERATE].calls);
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_GENERATE].failures);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(ED25519PublicKey) + sizeof(ED25519PrivateKey), s[CRYPTO_STATS_GENERATE].bytes);
+    TEST_ASSERT_TRUE_MESSAGE(s[CRYPTO_STATS_GENERATE].cycles > 0, "no time measured");
+
+    const unsigned char message[16] = "crypto stats";
+    for (int i = 0; i < 3; i++) {
+        ED25519Signature *signature = keyPair.sign(message, sizeof(message));
+        TEST_ASSERT_TRUE(keyPair.verify(message, sizeof(message), signature));
+        signature->signature[0] ^= 1;
+        TEST_ASSERT_FALSE(keyPair.verify(message, sizeof(message), signature));
+        delete signature;
+    }
+    TEST_ASSERT_FALSE(keyPair.verify(static_cast<const unsigned char *>(NULL), 0, NULL));
+
+    // the first signature expands the key into the key cache of the key pair
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_GENERATE].calls);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(ED25519PublicKey) + sizeof(ED25519PrivateKey) + sizeof(ED25519KeyCache),
+                             s[CRYPTO_STATS_GENERATE].bytes);
+    TEST_ASSERT_EQUAL_UINT32(3, s[CRYPTO_STATS_SIGN].calls);
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_SIGN].failures);
+    TEST_ASSERT_EQUAL_UINT32(3 * sizeof(ED25519Signature), s[CRYPTO_STATS_SIGN].bytes);
+    TEST_ASSERT_EQUAL_UINT32(7, s[CRYPTO_STATS_VERIFY].calls);
+    TEST_ASSERT_EQUAL_UINT32(4, s[CRYPTO_STATS_VERIFY].failures);
+    // the message is verified in place, nothing is allocated
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_VERIFY].bytes);
+    TEST_ASSERT_TRUE(s[CRYPTO_STATS_VERIFY].maxCycles > 0);
+    TEST_ASSERT_TRUE(s[CRYPTO_STATS_VERIFY].cycles >= s[CRYPTO_STATS_VERIFY].maxCycles);
+
+    Base64 base64;
+    size_t encodedLength, decodedLength;
+    char *encoded = base64.Encode(reinterpret_cast<const char *>(message), sizeof(message), &encodedLength);
+    char *decoded = base64.Decode(encoded, encodedLength, &decodedLength);
+    TEST_ASSERT_NULL(base64.Decode(encoded, encodedLength - 1, &decodedLength));
+    delete[] encoded;
+    delete[] decoded;
+
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_ENCODE].calls);
+    TEST_ASSERT_EQUAL_UINT32(encodedLength + 1, s[CRYPTO_STATS_ENCODE].bytes);
+    TEST_ASSERT_EQUAL_UINT32(2, s[CRYPTO_STATS_DECODE].calls);
+    TEST_ASSERT_EQUAL_UINT32(1, s[CRYPTO_STATS_DECODE].failures);
+    TEST_ASSERT_EQUAL_UINT32(256 + sizeof(message) + 1, s[CRYPTO_STATS_DECODE].bytes);
+
+    for (int i = 0; i < CRYPTO_STATS_OPERATIONS; i++) {
+        printf("%-8s calls %3u failures %3u cycles %10u max %10u heap %6u\r\n", operationNames[i],
+               (unsigned int) s[i].calls, (unsigned int) s[i].failures, (unsigned int) s[i].cycles,
+               (unsigned int) s[i].maxCycles, (unsigned int) s[i].bytes);
+    }
+
+    cryptoStatsReset();
+    for (int i = 0; i < CRYPTO_STATS_OPERATIONS; i++) TEST_ASSERT_EQUAL_UINT32(0, s[i].calls);
+}
+
+void TestStatsKeyCache() {
+    cryptoStatsReset();
+    const CryptoOperationStats *s = cryptoStats()->operations;
+
+    const unsigned char seed[ED25519_SEED_BYTES] = {1};
+    ED25519KeyPair keyPair;
+    TEST_ASSERT_TRUE(keyPair.importSeed(seed, sizeof(seed)));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(ED25519KeyCache), s[CRYPTO_STATS_GENERATE].bytes);
+
+    // the cache is reused for the public key and the signatures
+    TEST_ASSERT_NOT_NULL(keyPair.getPublicKey());
+    const unsigned char message[4] = {1, 2, 3, 4};
+    delete keyPair.sign(message, sizeof(message));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(ED25519KeyCache), s[CRYPTO_STATS_GENERATE].bytes);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(ED25519Signature), s[CRYPTO_STATS_SIGN].bytes);
+    // nothing was generated
+    TEST_ASSERT_EQUAL_UINT32(0, s[CRYPTO_STATS_GENERATE].calls);
+}
+
+void TestStatsExport() {
+    cryptoStatsReset();
+    ED25519KeyPair keyPair;
+    keyPair.generate();
+    const unsigned char message[4] = {1, 2, 3, 4};
+    delete keyPair.sign(message, sizeof(message));
+    delete keyPair.sign(message, sizeof(message));
+
+    unsigned char blob[CRYPTO_STATS_BLOB_BYTES];
+    TEST_ASSERT_EQUAL_INT(0, cryptoStatsExport(blob, sizeof(blob) - 1));
+    TEST_ASSERT_EQUAL_INT(CRYPTO_STATS_BLOB_BYTES, cryptoStatsExport(blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL_HEX8(CRYPTO_STATS_VERSION, blob[0]);
+    TEST_ASSERT_EQUAL_HEX8(CRYPTO_STATS_OPERATIONS, blob[1]);
+
+    // each operation is calls, failures, cycles (8 bytes), max cycles and heap bytes, big endian
+    const unsigned char *sign = blob + 2 + CRYPTO_STATS_SIGN * 24;
+    const unsigned char calls[4] = {0, 0, 0, 2};
+    const unsigned char failures[4] = {0, 0, 0, 0};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(calls, sign, 4);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(failures, sign + 4, 4);
+    uint64_t cycles = 0;
+    for (int i = 0; i < 8; i++) cycles = (cycles << 8) | sign[8 + i];
+    TEST_ASSERT_TRUE(cycles == cryptoStats()->operations[CRYPTO_STATS_SIGN].cycles);
+    TEST_ASSERT_EQUAL_UINT32(2 * sizeof(ED25519Signature), (uint32_t) (sign[20] << 24 | sign[21] << 16 | sign[22] << 8 | sign[23]));
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Crypto stats counters", TestStatsCounters, greentea_case_failure_abort_handler),
+            Case("Crypto stats key cache", TestStatsKeyCache, greentea_case_failure_abort_handler),
+            Case("Crypto stats export", TestStatsExport, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -0,0 +1,275 @@
+/*
+ * Tests for the single pass stream signer, the stream verifier and the fused sign and Base64 pipeline.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-17
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <StreamSigner.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+using namespace utest::v1;
+
+#define PAYLOAD_SIZE 4096
+#define CHUNK_SIZE 96
+
+static ED25519KeyPair keyPair;
+static unsigned char payload[PAYLOAD_SIZE];
+
+// stands in for external flash, every byte read is counted
+class PayloadReader {
+public:
+    size_t bytesRead;
+
+    PayloadReader() : bytesRead(0), position(0) {}
+
+    void rewind() { position = 0; }
+
+    size_t read(unsigned char *chunk, size_t length) {
+        if (length > PAYLOAD_SIZE - position) length = PAYLOAD_SIZE - position;
+        memcpy(chunk, payload + position, length);
+        position += length;
+        bytesRead += length;
+        return length;
+    }
+
+private:
+    size_t position;
+};
+
+void TestStreamSigner() {
+    ED25519StreamSigner signer(keyPair);
+    ED25519Signature first, second;
+
+    TEST_ASSERT_FALSE_MESSAGE(signer.finish(&first), "finished without begin");
+
+    for (int round = 0; round < 2; round++) {
+        ED25519Signature *signature = round ? &second : &first;
+        TEST_ASSERT_TRUE(signer.begin());
+        for (size_t i = 0; i < PAYLOAD_SIZE; i += 100) {
+            signer.update(payload + i, PAYLOAD_SIZE - i < 100 ? PAYLOAD_SIZE - i : 100);
+        }
+        TEST_ASSERT_TRUE(signer.finish(signature));
+        TEST_ASSERT_TRUE_MESSAGE(keyPair.verify(payload, PAYLOAD_SIZE, signature), "stream signature rejected");
+    }
+
+    // the nonce is random, so two signatures of the same payload differ
+    TEST_ASSERT_FALSE(memcmp(first.signature, second.signature, crypto_sign_BYTES) == 0);
+
+    payload[0] ^= 1;
+    TEST_ASSERT_FALSE(keyPair.verify(payload, PAYLOAD_SIZE, &first));
+    payload[0] ^= 1;
+
+    ED25519KeyPair publicOnly;
+    publicOnly.link(keyPair.getPublicKey());
+    ED25519StreamSigner publicSigner(publicOnly);
+    TEST_ASSERT_FALSE_MESSAGE(publicSigner.begin(), "signer started without private key");
+}
+
+void TestStreamVerifier() {
+    ED25519StreamVerifier verifier;
+    ED25519Signature *signature = keyPair.sign(payload, PAYLOAD_SIZE);
+    ED25519PublicKey *publicKey = keyPair.getPublicKey();
+
+    TEST_ASSERT_FALSE_MESSAGE(verifier.finish(), "finished without begin");
+    TEST_ASSERT_FALSE(verifier.begin(NULL, publicKey));
+    TEST_ASSERT_FALSE(verifier.begin(signature, NULL));
+
+    TEST_ASSERT_TRUE(verifier.begin(signature, publicKey));
+    for (size_t i = 0; i < PAYLOAD_SIZE; i += CHUNK_SIZE) {
+        verifier.update(payload + i, PAYLOAD_SIZE - i < CHUNK_SIZE ? PAYLOAD_SIZE - i : CHUNK_SIZE);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(verifier.finish(), "streamed signature rejected");
+    TEST_ASSERT_FALSE_MESSAGE(verifier.finish(), "finished twice");
+
+    // empty chunks change nothing
+    TEST_ASSERT_TRUE(verifier.begin(signature, publicKey));
+    verifier.update(payload, 0);
+    verifier.update(payload, PAYLOAD_SIZE);
+    verifier.update(NULL, 0);
+    TEST_ASSERT_TRUE(verifier.finish());
+
+    // a changed payload, signature or key and a missing chunk are detected
+    TEST_ASSERT_TRUE(verifier.begin(signature, publicKey));
+    verifier.update(payload, PAYLOAD_SIZE - 1);
+    TEST_ASSERT_FALSE_MESSAGE(verifier.finish(), "truncated payload accepted");
+
+    payload[PAYLOAD_SIZE / 2] ^= 1;
+    TEST_ASSERT_TRUE(verifier.begin(signature, publicKey));
+    verifier.update(payload, PAYLOAD_SIZE);
+    TEST_ASSERT_FALSE_MESSAGE(verifier.finish(), "changed payload accepted");
+    payload[PAYLOAD_SIZE / 2] ^= 1;
+
+    for (int i = 0; i < crypto_sign_BYTES; i += 31) {
+        ED25519Signature broken = *signature;
+        broken.signature[i] ^= 0x10;
+        TEST_ASSERT_TRUE(verifier.begin(&broken, publicKey));
+        verifier.update(payload, PAYLOAD_SIZE);
+        TEST_ASSERT_FALSE_MESSAGE(verifier.finish(), "changed signature accepted");
+    }
+
+    ED25519KeyPair other;
+    other.generate();
+    TEST_ASSERT_TRUE(verifier.begin(signature, other.getPublicKey()));
+    verifier.update(payload, PAYLOAD_SIZE);
+    TEST_ASSERT_FALSE_MESSAGE(verifier.finish(), "wrong key accepted");
+
+    // the verifier keeps its own copies, the caller may reuse its buffers
+    ED25519Signature copy = *signature;
+    TEST_ASSERT_TRUE(verifier.begin(&copy, publicKey));
+    memset(copy.signature, 0, crypto_sign_BYTES);
+    verifier.update(payload, PAYLOAD_SIZE);
+    TEST_ASSERT_TRUE(verifier.finish());
+
+    // signatures of the stream signer verify too
+    ED25519StreamSigner signer(keyPair);
+    ED25519Signature streamed;
+    TEST_ASSERT_TRUE(signer.begin());
+    signer.update(payload, PAYLOAD_SIZE);
+    TEST_ASSERT_TRUE(signer.finish(&streamed));
+    TEST_ASSERT_TRUE(verifier.begin(&streamed, publicKey));
+    verifier.update(payload, PAYLOAD_SIZE);
+    TEST_ASSERT_TRUE(verifier.finish());
+
+    delete signature;
+}
+
+void TestStreamVerifierBenchmark() {
+    ED25519Signature *signature = keyPair.sign(payload, PAYLOAD_SIZE);
+    ED25519PublicKey *publicKey = keyPair.getPublicKey();
+    Timer timer;
+
+    // the whole payload is received first, then verified
+    timer.start();
+    const bool bufferedValid = keyPair.verify(payload, PAYLOAD_SIZE, signature);
+    const int bufferedTime = timer.read_us();
+
+    // the chunks are hashed as they arrive, finish() is what is left after the last one
+    ED25519StreamVerifier verifier;
+    int chunkTime = 0;
+    verifier.begin(signature, publicKey);
+    for (size_t i = 0; i < PAYLOAD_SIZE; i += CHUNK_SIZE) {
+        timer.reset();
+        verifier.update(payload + i, PAYLOAD_SIZE - i < CHUNK_SIZE ? PAYLOAD_SIZE - i : CHUNK_SIZE);
+        chunkTime += timer.read_us();
+    }
+    timer.reset();
+    const bool streamedValid = verifier.finish();
+    const int finishTime = timer.read_us();
+    timer.stop();
+
+    TEST_ASSERT_TRUE(bufferedValid);
+    TEST_ASSERT_TRUE(streamedValid);
+    printf("%d bytes: verify after last byte %dus, streamed %dus after last byte (%dus while receiving)\r\n",
+           PAYLOAD_SIZE, bufferedTime, finishTime, chunkTime);
+
+    delete signature;
+}
+
+void TestBase64Signer() {
+    ED25519Base64Signer signer(keyPair);
+    Base64 base64;
+    PayloadReader reader;
+
+    size_t expectedLength;
+    char *expected = base64.Encode(reinterpret_cast<const char *>(payload), PAYLOAD_SIZE, &expectedLength);
+    char *encoded = new char[expectedLength + 4];
+    unsigned char chunk[CHUNK_SIZE];
+
+    TEST_ASSERT_TRUE(signer.begin());
+    size_t encodedLength = 0, length;
+    while ((length = reader.read(chunk, CHUNK_SIZE)) > 0) {
+        encodedLength += signer.update(chunk, length, encoded + encodedLength);
+    }
+    ED25519Signature signature;
+    size_t lastLength;
+    TEST_ASSERT_TRUE(signer.finish(encoded + encodedLength, &lastLength, &signature));
+    encodedLength += lastLength;
+
+    TEST_ASSERT_EQUAL_INT(PAYLOAD_SIZE, reader.bytesRead);
+    TEST_ASSERT_EQUAL_INT(expectedLength, encodedLength);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, encoded, expectedLength, "encoding differs");
+    TEST_ASSERT_TRUE_MESSAGE(keyPair.verify(payload, PAYLOAD_SIZE, &signature), "signature rejected");
+
+    delete[] expected;
+    delete[] encoded;
+}
+
+void TestBase64SignerBenchmark() {
+    Base64 base64;
+    Timer timer;
+    size_t encodedLength, length;
+
+    // separate passes: read the payload to sign it, then read it again to encode it
+    PayloadReader separateReader;
+    unsigned char *copy = new unsigned char[PAYLOAD_SIZE];
+    timer.start();
+    separateReader.read(copy, PAYLOAD_SIZE);
+    ED25519Signature *signature = keyPair.sign(copy, PAYLOAD_SIZE);
+    separateReader.rewind();
+    separateReader.read(copy, PAYLOAD_SIZE);
+    char *encoded = base64.Encode(reinterpret_cast<const char *>(copy), PAYLOAD_SIZE, &encodedLength);
+    const int separateTime = timer.read_us();
+    delete signature;
+    delete[] encoded;
+    delete[] copy;
+
+    // fused: every chunk is read once and goes to the hash and the encoder
+    PayloadReader fusedReader;
+    ED25519Base64Signer signer(keyPair);
+    ED25519Signature fusedSignature;
+    unsigned char chunk[CHUNK_SIZE];
+    char out[BASE64_ENCODED_BYTES(CHUNK_SIZE)];
+    timer.reset();
+    signer.begin();
+    while ((length = fusedReader.read(chunk, CHUNK_SIZE)) > 0) signer.update(chunk, length, out);
+    signer.finish(out, &encodedLength, &fusedSignature);
+    const int fusedTime = timer.read_us();
+    timer.stop();
+
+    printf("%d bytes: separate %dus (%d bytes read, 2 hash passes), fused %dus (%d bytes read, 1 hash pass)\r\n",
+           PAYLOAD_SIZE, separateTime, (int) separateReader.bytesRead, fusedTime, (int) fusedReader.bytesRead);
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    keyPair.generate();
+    randombytes(payload, PAYLOAD_SIZE);
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Stream signer", TestStreamSigner, greentea_case_failure_abort_handler),
+            Case("Stream verifier", TestStreamVerifier, greentea_case_failure_abort_handler),
+            Case("Stream verifier benchmark", TestStreamVerifierBenchmark, greentea_case_failure_abort_handler),
+            Case("Stream signer Base64 pipeline", TestBase64Signer, greentea_case_failure_abort_handler),
+            Case("Stream signer Base64 benchmark", TestBase64SignerBenchmark, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
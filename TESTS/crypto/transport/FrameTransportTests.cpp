@@ -0,0 +1,265 @@
+/*
+ * Tests for the framed binary transport.
+ *
+ * Two transports are connected back to back through in-memory streams. The
+ * host side implementation is tested with TESTS/host_tests/framing.py.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-18
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <FrameTransport.h>
+#include <KeyPair.h>
+#include <Base64.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+#ifndef __MBED__
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+using namespace utest::v1;
+
+#define PIPE_SIZE 2048
+#define SIGNED_MESSAGE_LENGTH (crypto_sign_PUBLICKEYBYTES + 4 + crypto_sign_BYTES)
+
+// one direction of the connection, counting the bytes on the wire
+class Pipe {
+public:
+    unsigned char data[PIPE_SIZE];
+    size_t head, tail, bytes;
+
+    Pipe() : head(0), tail(0), bytes(0) {}
+
+    void put(const unsigned char *d, size_t length) {
+        for (size_t i = 0; i < length; i++) data[tail++ % PIPE_SIZE] = d[i];
+        bytes += length;
+    }
+
+    size_t get(unsigned char *d, size_t length) {
+        size_t n = 0;
+        while (n < length && head < tail) d[n++] = data[head++ % PIPE_SIZE];
+        return n;
+    }
+
+    size_t available() { return tail - head; }
+};
+
+// the end of a connection, reading from one pipe and writing to the other
+class PipeStream : public FrameStream {
+public:
+    PipeStream(Pipe &in, Pipe &out) : in(in), out(out) {}
+
+    size_t read(unsigned char *data, size_t length, uint32_t timeout) { return in.get(data, length); }
+
+    bool write(const unsigned char *data, size_t length) {
+        out.put(data, length);
+        return true;
+    }
+
+private:
+    Pipe &in, &out;
+};
+
+void TestFrameRoundTrip() {
+    Pipe toDevice, toHost;
+    PipeStream hostStream(toHost, toDevice), deviceStream(toDevice, toHost);
+    FrameTransport host(hostStream), device(deviceStream);
+
+    const unsigned char messages[3][4] = {{1, 2, 3, 4}, {FRAME_SYNC, FRAME_SYNC, 0, 0}, {0xFF, 0, 0xFF, 0}};
+    unsigned char payload[FRAME_MAX_PAYLOAD];
+
+    TEST_ASSERT_FALSE_MESSAGE(host.send(messages[0], 4, 10), "sent without credit");
+    TEST_ASSERT_EQUAL_INT(0, toDevice.available());
+
+    device.begin();
+    for (int i = 0; i < FRAME_WINDOW; i++) TEST_ASSERT_TRUE(host.send(messages[i % 3], 4, 10));
+    TEST_ASSERT_FALSE_MESSAGE(host.send(messages[2], 4, 10), "sent more frames than the window");
+
+    // every received frame gives a new credit
+    for (int i = 0; i < FRAME_WINDOW + 1; i++) {
+        TEST_ASSERT_EQUAL_INT(4, device.receive(payload, sizeof(payload), 10));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(messages[i % 3], payload, 4);
+        if (i == 0) {
+            TEST_ASSERT_TRUE_MESSAGE(host.send(messages[FRAME_WINDOW % 3], 4, 10), "no credit after receive");
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(-1, device.receive(payload, sizeof(payload), 10));
+
+    // empty and maximum size frames
+    TEST_ASSERT_TRUE(host.send(payload, 0, 10));
+    TEST_ASSERT_EQUAL_INT(0, device.receive(payload, sizeof(payload), 10));
+    randombytes(payload, FRAME_MAX_PAYLOAD);
+    unsigned char received[FRAME_MAX_PAYLOAD];
+    TEST_ASSERT_TRUE(host.send(payload, FRAME_MAX_PAYLOAD, 10));
+    TEST_ASSERT_FALSE(host.send(payload, FRAME_MAX_PAYLOAD + 1, 10));
+    TEST_ASSERT_EQUAL_INT(FRAME_MAX_PAYLOAD, device.receive(received, sizeof(received), 10));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, received, FRAME_MAX_PAYLOAD);
+
+    TEST_ASSERT_EQUAL_UINT32(0, device.errors());
+    TEST_ASSERT_EQUAL_UINT32(0, device.lost());
+}
+
+void TestFrameCorruption() {
+    Pipe toDevice, toHost;
+    PipeStream hostStream(toHost, toDevice), deviceStream(toDevice, toHost);
+    FrameTransport host(hostStream), device(deviceStream);
+    const unsigned char message[8] = {FRAME_SYNC, FRAME_DATA, 0, 0, 1, 2, 3, 4};
+    unsigned char payload[16];
+
+    // line noise before the first frame
+    const unsigned char noise[5] = {0x00, FRAME_SYNC, FRAME_DATA, 0xFF, FRAME_SYNC};
+    toDevice.put(noise, sizeof(noise));
+    device.begin();
+
+    // a frame with a flipped bit is dropped, the next one still arrives
+    TEST_ASSERT_TRUE(host.send(message, sizeof(message), 10));
+    toDevice.data[(toDevice.tail - 3) % PIPE_SIZE] ^= 0x10;
+    TEST_ASSERT_TRUE(host.send(message, 4, 10));
+
+    TEST_ASSERT_EQUAL_INT(4, device.receive(payload, sizeof(payload), 10));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(message, payload, 4);
+    TEST_ASSERT_TRUE_MESSAGE(device.errors() > 0, "broken frame not counted");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, device.lost(), "lost frame not counted");
+
+    // the lost frame freed its credit again
+    TEST_ASSERT_TRUE(host.send(message, sizeof(message), 10));
+    TEST_ASSERT_TRUE(host.send(message, sizeof(message), 10));
+    TEST_ASSERT_EQUAL_INT(sizeof(message), device.receive(payload, sizeof(payload), 10));
+    TEST_ASSERT_EQUAL_INT(sizeof(message), device.receive(payload, sizeof(payload), 10));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(message, payload, sizeof(message));
+}
+
+void TestFrameSignedMessages() {
+    Pipe toDevice, toHost;
+    PipeStream hostStream(toHost, toDevice), deviceStream(toDevice, toHost);
+    FrameTransport host(hostStream), device(deviceStream);
+    ED25519KeyPair keyPair;
+    keyPair.generate();
+
+    const int messages = 16;
+    unsigned char signedMessage[SIGNED_MESSAGE_LENGTH];
+
+    device.begin();
+    for (int i = 0; i < messages; i++) {
+        memcpy(signedMessage, keyPair.getPublicKey()->key, crypto_sign_PUBLICKEYBYTES);
+        randombytes(signedMessage + crypto_sign_PUBLICKEYBYTES, 4);
+        ED25519Signature *signature = keyPair.sign(signedMessage, crypto_sign_PUBLICKEYBYTES + 4);
+        memcpy(signedMessage + crypto_sign_PUBLICKEYBYTES + 4, signature->signature, crypto_sign_BYTES);
+        delete signature;
+
+        TEST_ASSERT_TRUE(host.send(signedMessage, sizeof(signedMessage), 10));
+
+        unsigned char received[SIGNED_MESSAGE_LENGTH];
+        TEST_ASSERT_EQUAL_INT(SIGNED_MESSAGE_LENGTH, device.receive(received, sizeof(received), 10));
+        TEST_ASSERT_TRUE(keyPair.verify(received, crypto_sign_PUBLICKEYBYTES + 4,
+                                        reinterpret_cast<ED25519Signature *>(received + crypto_sign_PUBLICKEYBYTES + 4)));
+    }
+
+    // the same messages as Base64 key/value slices of 30 characters, like the protocol test does it
+    Base64 base64;
+    size_t encodedLength;
+    char *encoded = base64.Encode(reinterpret_cast<const char *>(signedMessage), sizeof(signedMessage),
+                                  &encodedLength);
+    delete[] encoded;
+    const size_t slices = (encodedLength + 29) / 30;
+    const size_t slicedBytes = messages * (slices * strlen("{{serverSignedServerMessage;}}\n") + encodedLength);
+    const size_t framedBytes = toDevice.bytes + toHost.bytes;
+
+    printf("%d signed messages: framed %d bytes (%dms at 115200 baud), sliced %d bytes (%dms)\r\n",
+           messages, (int) framedBytes, (int) (framedBytes * 10000 / 115200),
+           (int) slicedBytes, (int) (slicedBytes * 10000 / 115200));
+}
+
+#ifndef __MBED__
+
+void TestFrameFileStreamPty() {
+    // the host transport on the pty master, the device transport on the raw slave side
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    TEST_ASSERT_TRUE_MESSAGE(master >= 0, "no pty available");
+    TEST_ASSERT_EQUAL_INT(0, grantpt(master));
+    TEST_ASSERT_EQUAL_INT(0, unlockpt(master));
+    const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    TEST_ASSERT_TRUE(slave >= 0);
+    struct termios tio;
+    TEST_ASSERT_EQUAL_INT(0, tcgetattr(slave, &tio));
+    cfmakeraw(&tio);
+    TEST_ASSERT_EQUAL_INT(0, tcsetattr(slave, TCSANOW, &tio));
+
+    FileFrameStream hostStream(master), deviceStream(slave);
+    FrameTransport host(hostStream), device(deviceStream);
+
+    // nothing arrives, the read times out
+    unsigned char payload[FRAME_MAX_PAYLOAD];
+    TEST_ASSERT_EQUAL_INT(0, hostStream.read(payload, sizeof(payload), 10));
+
+    unsigned char message[FRAME_MAX_PAYLOAD];
+    for (size_t i = 0; i < sizeof(message); i++) message[i] = static_cast<unsigned char>(i);
+    message[0] = FRAME_SYNC;
+
+    // frames in both directions, more than the credit window
+    host.begin();
+    device.begin();
+    for (int i = 0; i < 3 * FRAME_WINDOW; i++) {
+        const size_t length = i % 2 ? sizeof(message) : 1 + i;
+        TEST_ASSERT_TRUE_MESSAGE(host.send(message, length, 1000), "no credit for the host");
+        TEST_ASSERT_EQUAL_INT(length, device.receive(payload, sizeof(payload), 1000));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(message, payload, length);
+
+        TEST_ASSERT_TRUE_MESSAGE(device.send(message, length, 1000), "no credit for the device");
+        TEST_ASSERT_EQUAL_INT(length, host.receive(payload, sizeof(payload), 1000));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(message, payload, length);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, host.errors() + device.errors());
+    TEST_ASSERT_EQUAL_UINT32(0, host.lost() + device.lost());
+
+    close(slave);
+    close(master);
+}
+
+#endif
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Frame transport round trip", TestFrameRoundTrip, greentea_case_failure_abort_handler),
+            Case("Frame transport corruption", TestFrameCorruption, greentea_case_failure_abort_handler),
+            Case("Frame transport signed messages", TestFrameSignedMessages, greentea_case_failure_abort_handler),
+#ifndef __MBED__
+            Case("Frame transport file stream over a pty", TestFrameFileStreamPty,
+                 greentea_case_failure_abort_handler),
+#endif
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
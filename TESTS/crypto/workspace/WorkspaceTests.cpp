@@ -0,0 +1,150 @@
+/*
+ * Tests for signing and verifying with a workspace.
+ *
+ * The stack usage is measured with Thread::max_stack(), which needs
+ * MBED_STACK_STATS_ENABLED (see TESTS/settings.json). A workspace saves the
+ * temporaries of ED25519Core, the NaCl group operations still use the stack.
+ *
+ * @author Matthias L. Jugel
+ * @date 2018-01-21
+ *
+ * Copyright 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "mbed.h"
+#include <nacl/armnacl.h>
+#include <KeyPair.h>
+#include <SHA512.h>
+
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "greentea-client/test_env.h"
+#include "../../../ubirch-mbed-nacl-cm0/TESTS/testhelper.h"
+
+extern "C" {
+#include "ge25519.h"
+#include "sc25519.h"
+}
+
+using namespace utest::v1;
+
+#define MESSAGE_LENGTH 100
+#define THREAD_STACK_SIZE 8192
+// what the stack frames of the two paths may differ by apart from the temporaries
+#define FRAME_SLACK 64
+
+static ED25519KeyPair keyPair;
+static ED25519Workspace workspace;
+static unsigned char message[MESSAGE_LENGTH];
+static ED25519Signature *signature;
+static bool valid;
+
+void TestWorkspaceSignVerify() {
+    const ED25519Workspace empty = {{0}};
+    keyPair.generate();
+    for (int i = 0; i < 8; i++) {
+        randombytes(message, sizeof(message));
+
+        ED25519Signature *expected = keyPair.sign(message, sizeof(message));
+        ED25519Signature *actual = keyPair.sign(message, sizeof(message), workspace);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected->signature, actual->signature, crypto_sign_BYTES);
+        // no secret is left in the workspace after signing
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(empty.storage, workspace.storage, sizeof(workspace));
+
+        TEST_ASSERT_TRUE(keyPair.verify(message, sizeof(message), actual, workspace));
+        actual->signature[i] ^= 0x01;
+        TEST_ASSERT_FALSE(keyPair.verify(message, sizeof(message), actual, workspace));
+        actual->signature[i] ^= 0x01;
+        message[i] ^= 0x80;
+        TEST_ASSERT_FALSE(keyPair.verify(message, sizeof(message), actual, workspace));
+        TEST_ASSERT_FALSE(keyPair.verify(message, 0, actual, workspace));
+        TEST_ASSERT_FALSE(keyPair.verify(NULL, sizeof(message), actual, workspace));
+
+        delete expected;
+        delete actual;
+    }
+
+    ED25519KeyPair verifier;
+    TEST_ASSERT_FALSE_MESSAGE(verifier.verify(message, sizeof(message), signature, workspace), "verified without key");
+    TEST_ASSERT_NULL(verifier.sign(message, sizeof(message), workspace));
+}
+
+static void sign() {
+    signature = keyPair.sign(message, sizeof(message));
+}
+
+static void signWithWorkspace() {
+    signature = keyPair.sign(message, sizeof(message), workspace);
+}
+
+static void verify() {
+    valid = keyPair.verify(message, sizeof(message), signature);
+}
+
+static void verifyWithWorkspace() {
+    valid = keyPair.verify(message, sizeof(message), signature, workspace);
+}
+
+static uint32_t measure(void (*operation)()) {
+    Thread thread(osPriorityNormal, THREAD_STACK_SIZE);
+    thread.start(operation);
+    thread.join();
+    return thread.max_stack();
+}
+
+void TestWorkspaceStackUsage() {
+    keyPair.generate();
+    randombytes(message, sizeof(message));
+    // expand the key before, the measurement is about the signature only
+    delete keyPair.sign(message, sizeof(message));
+
+    const uint32_t signStack = measure(sign);
+    delete signature;
+    const uint32_t signWorkspaceStack = measure(signWithWorkspace);
+    const uint32_t verifyStack = measure(verify);
+    TEST_ASSERT_TRUE(valid);
+    const uint32_t verifyWorkspaceStack = measure(verifyWithWorkspace);
+    TEST_ASSERT_TRUE(valid);
+    delete signature;
+
+    printf("stack: sign %u, sign with workspace %u, verify %u, verify with workspace %u (workspace %u bytes)\r\n",
+           (unsigned int) signStack, (unsigned int) signWorkspaceStack,
+           (unsigned int) verifyStack, (unsigned int) verifyWorkspaceStack, (unsigned int) sizeof(ED25519Workspace));
+    // the SHA-512 state and digest, the check bytes, three scalars and two points leave the stack
+    const uint32_t temporaries = sizeof(SHA512) + SHA512_BYTES + 32 + 3 * sizeof(sc25519) + 2 * sizeof(ge25519);
+    TEST_ASSERT_TRUE_MESSAGE(temporaries <= sizeof(ED25519Workspace), "workspace too small");
+    TEST_ASSERT_TRUE_MESSAGE(signWorkspaceStack + temporaries <= signStack + FRAME_SLACK,
+                             "workspace does not take the temporaries off the stack when signing");
+    TEST_ASSERT_TRUE_MESSAGE(verifyWorkspaceStack + temporaries <= verifyStack + FRAME_SLACK,
+                             "workspace does not take the temporaries off the stack when verifying");
+}
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+
+int main() {
+    Case cases[] = {
+            Case("Workspace sign and verify", TestWorkspaceSignVerify, greentea_case_failure_abort_handler),
+            Case("Workspace stack usage", TestWorkspaceStackUsage, greentea_case_failure_abort_handler),
+    };
+
+    Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+    Harness::run(specification);
+}
@@ -3,9 +3,25 @@ from time import sleep
 
 import msgpack
 import os
+import sys
 from mbed_host_tests import BaseHostTest, event_callback
 import ed25519
 
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from replay import NonceCounters, ReplayWindow
+from session import SessionTickets
+from verification import VerificationClient
+
+SIGNED_MESSAGE_BYTES = 100
+
+
+def split_signed_message(data):
+    """Check the length of a [pubKey (32) | nonce (4) | signature (64)] message once
+    and return its (message, pubKey, nonce, signature) parts."""
+    if len(data) != SIGNED_MESSAGE_BYTES:
+        raise ValueError("signed message length mismatch")
+    return data[0:36], data[0:32], data[32:36], data[36:]
+
 
 class CryptoProtocolTests(BaseHostTest):
     """
@@ -25,13 +41,34 @@ class CryptoProtocolTests(BaseHostTest):
      STEP 4: device sends server message signed back (includes server-pub, nonce)
 
      If everything is correct, both will have a verified version of the partners public key.
+
+     The nonces are counters per key (see replay.py), a replayed device message is rejected
+     before its signature is checked.
+
+     Both sides keep a session ticket then (see session.py). A reconnect sends a single signed
+     resumption request instead of repeating the four steps.
+
+     Set UBIRCH_VERIFICATION_SERVICE to the socket of a running tools/VerificationService.cpp
+     to verify the device signatures there instead of in Python.
     """
 
     def __init__(self):
         # generate key pair (server side)
         self.private, self.public = ed25519.create_keypair(entropy=os.urandom)
+        self.verificationService = None
+        self.tickets = SessionTickets()
+        self.nonces = NonceCounters()
+        self.windows = {}
+        if os.environ.get("UBIRCH_VERIFICATION_SERVICE"):
+            self.verificationService = VerificationClient()
         BaseHostTest.__init__(self)
 
+    def verify(self, publicKey, message, signature):
+        if self.verificationService is None:
+            ed25519.VerifyingKey(publicKey).verify(signature, bytes(message))
+        elif not self.verificationService.verify(publicKey, message, signature):
+            raise ed25519.BadSignatureError()
+
     @event_callback("deviceSignedDeviceMessage")
     def __step1_2_3(self, key, value, timestamp):
         # STEP 1 - receive device signed device message
@@ -40,18 +77,28 @@ class CryptoProtocolTests(BaseHostTest):
         self.log("** signed message length: "+str(len(deviceSignedDeviceMessage)))
 
         # extract required parts of the device signed device message (Dpub,Dnonce)-tuple
-        deviceMessage = deviceSignedDeviceMessage[0:36]
-        devicePubKey = deviceSignedDeviceMessage[0:32]
-        deviceNonce = deviceSignedDeviceMessage[32:36]
-        deviceSignature = deviceSignedDeviceMessage[36:]
+        try:
+            deviceMessage, devicePubKey, deviceNonce, deviceSignature = \
+                split_signed_message(deviceSignedDeviceMessage)
+        except ValueError as e:
+            self.send_kv("error", str(e))
+            return
         self.log("** devicePubKey=["+str(len(devicePubKey))+"] " + devicePubKey.encode('hex') + ", nonce=["+str(len(deviceNonce))+"] " + deviceNonce.encode('hex'))
         self.log("** deviceSignature=["+str(len(deviceSignature))+"] "+deviceSignature.encode('hex'))
 
+        # a replayed message is rejected without verifying it
+        window = self.windows.setdefault(devicePubKey, ReplayWindow())
+        if not window.check(deviceNonce):
+            self.send_kv("error", "REPLAYED NONCE")
+            return
+
         # check the device signed message and send back a server signed copy
         try:
             # remember the device public key
-            self.deviceVerifyingKey = ed25519.VerifyingKey(devicePubKey)
-            self.deviceVerifyingKey.verify(deviceSignature, bytes(deviceMessage))
+            self.devicePubKey = devicePubKey
+            self.deviceMessage = deviceMessage
+            self.verify(devicePubKey, deviceMessage, deviceSignature)
+            window.accept(deviceNonce)
         except ed25519.BadSignatureError:
             self.send_kv("error", "VERIFICATION FAILED")
             return
@@ -61,7 +108,7 @@ class CryptoProtocolTests(BaseHostTest):
 
         # STEP 2 - send server signed server message
         serverPubKey = self.public.to_bytes()
-        serverNonce = os.urandom(4)
+        serverNonce = self.nonces.next(devicePubKey)
         self.serverMessage = serverPubKey + serverNonce
         serverSignature = self.private.sign(bytes(self.serverMessage))
         serverSignedServerMessage = self.serverMessage + serverSignature
@@ -93,17 +140,28 @@ class CryptoProtocolTests(BaseHostTest):
         deviceSignedServerMessage = value.decode("base64")
         self.log("** signed message length: "+str(len(deviceSignedServerMessage)))
 
-        # extract required parts of the device signed server message (Dpub,Dnonce)-tuple
-        serverMessage = deviceSignedServerMessage[0:36]
-        deviceSignature = deviceSignedServerMessage[36:]
-
         # check the device signed server message and report server side success
         try:
+            serverMessage, _, _, deviceSignature = split_signed_message(deviceSignedServerMessage)
             if self.serverMessage != serverMessage: raise Exception("server message changed")
-            self.deviceVerifyingKey.verify(deviceSignature, bytes(serverMessage))
+            self.verify(self.devicePubKey, serverMessage, deviceSignature)
+            self.tickets.issue(self.deviceMessage, self.serverMessage)
             self.send_kv("serverVerification", "SUCCESS")
         except ed25519.BadSignatureError:
             self.send_kv("error", "VERIFICATION FAILED")
             return
         except Exception as e:
-            self.send_kv("error", e.message)
\ No newline at end of file
+            self.send_kv("error", e.message)
+
+    @event_callback("resumeRequest")
+    def __resume(self, key, value, timestamp):
+        # a reconnect of a device that completed the key exchange before
+        self.log("SERVER <--------------(D[R])------------- DEVICE")
+        response = self.tickets.accept(self.private, value.decode("base64"))
+        if response is None:
+            self.send_kv("resumeRejected", "UNKNOWN TICKET OR REPLAY")
+            return
+        encodedResponse = base64.b64encode(response)
+        for pos in xrange(0, len(encodedResponse), 30):
+            self.send_kv("resumeResponse", encodedResponse[pos:pos+30])
+        self.log("SERVER ---------------(S[A])------------> DEVICE")
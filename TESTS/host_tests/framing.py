@@ -0,0 +1,270 @@
+"""
+Framed binary transport, the host side of source/FrameTransport.h.
+
+Frames replace the Base64 key/value slices for bulk binary data:
+
+  [0x7E | type | seq | length (2, big endian) | payload | CRC-32 (4, big endian)]
+
+The CRC-32 (zlib) covers type, seq, length and payload. The receiver hands
+out credits (CREDIT frames with the sequence number up to which the sender
+may send), so a busy device never has to drop a frame.
+
+Usage:
+  python framing.py selftest          run a loopback test over a pty pair
+  python framing.py benchmark [n]     compare frames and Base64 slices over a pty pair
+  python framing.py echo <tty>        echo all frames received on a tty or pty
+"""
+import base64
+import os
+import select
+import struct
+import sys
+import time
+import zlib
+
+FRAME_SYNC = 0x7E
+FRAME_DATA = 0x44
+FRAME_CREDIT = 0x43
+FRAME_HEADER_BYTES = 5
+FRAME_CRC_BYTES = 4
+FRAME_MAX_PAYLOAD = 256
+FRAME_WINDOW = 2
+FRAME_IDLE_TIMEOUT = 0.1
+
+
+def _before(a, b):
+    """sequence numbers wrap around, a is before b if the distance is less than half the range"""
+    d = (b - a) & 0xFF
+    return 0 < d < 0x80
+
+
+def encode(frame_type, sequence, payload):
+    header = struct.pack(">BBBH", FRAME_SYNC, frame_type, sequence & 0xFF, len(payload))
+    crc = zlib.crc32(header[1:] + payload) & 0xFFFFFFFF
+    return header + payload + struct.pack(">I", crc)
+
+
+class FrameTransport(object):
+    """Sends and receives frames over a file descriptor (tty, pty or pipe)."""
+
+    def __init__(self, fd, window=FRAME_WINDOW):
+        self.fd = fd
+        self.window = window
+        self.tx_sequence = 0
+        self.tx_limit = 0
+        self.rx_sequence = 0
+        self.rx_granted = 0
+        self.frames = []
+        self.buffer = bytearray()
+        self.errors = 0
+        self.lost = 0
+
+    def begin(self):
+        self._grant(True)
+
+    def send(self, payload, timeout=1.0):
+        if len(payload) > FRAME_MAX_PAYLOAD:
+            return False
+        deadline = time.time() + timeout
+        while not _before(self.tx_sequence, self.tx_limit):
+            if self._poll(FRAME_IDLE_TIMEOUT):
+                continue
+            if time.time() >= deadline:
+                return False
+            # the other side may be waiting for our credit just as well
+            self._grant(True)
+        self._write(encode(FRAME_DATA, self.tx_sequence, bytes(payload)))
+        self.tx_sequence = (self.tx_sequence + 1) & 0xFF
+        return True
+
+    def receive(self, timeout=1.0):
+        deadline = time.time() + timeout
+        while not self.frames:
+            if self._poll(min(FRAME_IDLE_TIMEOUT, timeout)):
+                continue
+            if time.time() >= deadline:
+                return None
+            # our last credit may have been lost
+            self._grant(True)
+        payload = self.frames.pop(0)
+        self._grant(False)
+        return payload
+
+    def _write(self, data):
+        while data:
+            n = os.write(self.fd, data)
+            data = data[n:]
+
+    def _grant(self, repeat):
+        limit = (self.rx_sequence + self.window - len(self.frames)) & 0xFF
+        if limit == self.rx_granted and not repeat:
+            return
+        self.rx_granted = limit
+        self._write(encode(FRAME_CREDIT, 0, bytes(bytearray([limit]))))
+
+    def _poll(self, timeout):
+        r, _, _ = select.select([self.fd], [], [], timeout)
+        if not r:
+            return False
+        data = os.read(self.fd, 4096)
+        if not data:
+            return False
+        self.buffer.extend(data)
+        self._parse()
+        return True
+
+    def _parse(self):
+        b = self.buffer
+        while b:
+            if b[0] != FRAME_SYNC:
+                # skip to the next possible frame start
+                start = b.find(bytearray([FRAME_SYNC]))
+                del b[:start if start >= 0 else len(b)]
+                continue
+            if len(b) < 2:
+                return
+            frame_type = b[1]
+            if frame_type not in (FRAME_DATA, FRAME_CREDIT):
+                self._resync()
+                continue
+            if len(b) < FRAME_HEADER_BYTES:
+                return
+            length = (b[3] << 8) | b[4]
+            if length > FRAME_MAX_PAYLOAD or (frame_type == FRAME_CREDIT and length != 1):
+                self._resync()
+                continue
+            total = FRAME_HEADER_BYTES + length + FRAME_CRC_BYTES
+            if len(b) < total:
+                return
+            crc, = struct.unpack(">I", bytes(b[total - FRAME_CRC_BYTES:total]))
+            if crc != zlib.crc32(bytes(b[1:FRAME_HEADER_BYTES + length])) & 0xFFFFFFFF:
+                self._resync()
+                continue
+            self._process(frame_type, b[2], bytes(b[FRAME_HEADER_BYTES:FRAME_HEADER_BYTES + length]))
+            del b[:total]
+
+    def _resync(self):
+        self.errors += 1
+        del self.buffer[:1]
+
+    def _process(self, frame_type, sequence, payload):
+        if frame_type == FRAME_CREDIT:
+            limit = bytearray(payload)[0]
+            # ignore credits that are older than what we already sent
+            if _before(self.tx_sequence, limit) or limit == self.tx_sequence:
+                self.tx_limit = limit
+            return
+        # drop repeated frames and frames sent without credit
+        if _before(sequence, self.rx_sequence):
+            return
+        if len(self.frames) == self.window:
+            self.errors += 1
+            return
+        self.lost += (sequence - self.rx_sequence) & 0xFF
+        self.rx_sequence = (sequence + 1) & 0xFF
+        self.frames.append(payload)
+
+
+def slices(key, payload, size=30):
+    """the bytes the Base64 key/value slicing of the greentea tests puts on the wire"""
+    encoded = base64.b64encode(payload).decode("ascii")
+    return "".join("{{%s;%s}}\n" % (key, encoded[pos:pos + size])
+                   for pos in range(0, len(encoded), size)).encode("ascii")
+
+
+def _pty_pair():
+    import pty
+    import tty
+    master, slave = pty.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    return master, slave
+
+
+def selftest():
+    host_fd, device_fd = _pty_pair()
+    host, device = FrameTransport(host_fd), FrameTransport(device_fd)
+
+    assert not host.send(b"\x01", timeout=0.2), "sent without credit"
+    device.begin()
+    messages = [os.urandom(i * 7 % (FRAME_MAX_PAYLOAD + 1)) for i in range(300)]
+    messages.append(bytes(bytearray([FRAME_SYNC] * 16)))
+    received = []
+    for m in messages:
+        while not host.send(m, timeout=0.05):
+            received.append(device.receive(timeout=0.05))
+    while len(received) < len(messages):
+        payload = device.receive(timeout=0.5)
+        assert payload is not None, "frame missing"
+        received.append(payload)
+    assert received == messages, "frames differ"
+
+    # broken frames are skipped and the gap is counted
+    os.write(host_fd, b"\x00\x7e\x44" + encode(FRAME_DATA, host.tx_sequence, b"broken")[:-1] + b"\x00")
+    host.tx_sequence += 1
+    assert host.send(b"intact")
+    assert device.receive() == b"intact"
+    assert device.errors > 0 and device.lost == 1, (device.errors, device.lost)
+
+    os.close(host_fd)
+    os.close(device_fd)
+    print("OK: %d frames, %d errors, %d lost" % (len(received), device.errors, device.lost))
+
+
+def benchmark(messages=64):
+    host_fd, device_fd = _pty_pair()
+    host, device = FrameTransport(host_fd), FrameTransport(device_fd)
+    # a signed key exchange message: public key, nonce and signature
+    payload = os.urandom(32 + 4 + 64)
+
+    sliced = slices("deviceSignedDeviceMessage", payload)
+    start = time.time()
+    for _ in range(messages):
+        os.write(host_fd, sliced)
+        data = b""
+        while len(data) < len(sliced):
+            data += os.read(device_fd, len(sliced) - len(data))
+    sliced_time = time.time() - start
+
+    device.begin()
+    framed = len(encode(FRAME_DATA, 0, payload))
+    start = time.time()
+    for _ in range(messages):
+        assert host.send(payload)
+        assert device.receive() == payload
+    framed_time = time.time() - start
+
+    # the credit frames go back to the sender, 10 bit per byte on the serial line
+    credit = len(encode(FRAME_CREDIT, 0, b"\x00"))
+    for name, size, elapsed in (("sliced", len(sliced), sliced_time), ("framed", framed + credit, framed_time)):
+        print("%s: %4d bytes/message, %6.1f ms at 115200 baud, %6.3f ms over pty" %
+              (name, size, size * 10 * 1000.0 / 115200, elapsed * 1000.0 / messages))
+    os.close(host_fd)
+    os.close(device_fd)
+
+
+def echo(path):
+    import tty
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    transport = FrameTransport(fd)
+    transport.begin()
+    while True:
+        payload = transport.receive(timeout=10.0)
+        if payload is None:
+            break
+        transport.send(payload, timeout=10.0)
+    os.close(fd)
+
+
+if __name__ == "__main__":
+    command = sys.argv[1] if len(sys.argv) > 1 else "selftest"
+    if command == "selftest":
+        selftest()
+    elif command == "benchmark":
+        benchmark(int(sys.argv[2]) if len(sys.argv) > 2 else 64)
+    elif command == "echo":
+        echo(sys.argv[2])
+    else:
+        print(__doc__)
+        sys.exit(1)
@@ -0,0 +1,85 @@
+"""
+Nonce counters and replay windows, the host side of source/ReplayWindow.h.
+
+The 4 byte nonce of a key exchange message is a big endian counter that
+the sender keeps per key. The receiver keeps the highest nonce of every
+peer and a bitmap of the REPLAY_WINDOW_SIZE nonces below it. A nonce that
+was seen before, or is at or below highest - REPLAY_WINDOW_SIZE, is a
+replay.
+
+Usage:
+  python replay.py selftest
+"""
+import struct
+import sys
+
+REPLAY_WINDOW_SIZE = 32
+
+
+def nonce(counter):
+    return struct.pack(">I", counter)
+
+
+class ReplayWindow(object):
+    """The replay window of a single peer."""
+
+    def __init__(self):
+        self.highest = 0
+        self.seen = 0
+
+    def check(self, value):
+        counter = struct.unpack(">I", value)[0]
+        if self.seen == 0 or counter > self.highest:
+            return True
+        age = self.highest - counter
+        return age < REPLAY_WINDOW_SIZE and not self.seen & (1 << age)
+
+    def accept(self, value):
+        """Mark a nonce as seen, only after the message was verified."""
+        if not self.check(value):
+            return False
+        counter = struct.unpack(">I", value)[0]
+        if self.seen == 0:
+            self.highest, self.seen = counter, 1
+        elif counter > self.highest:
+            shift = counter - self.highest
+            self.seen = 1 if shift >= REPLAY_WINDOW_SIZE else ((self.seen << shift) | 1) & 0xFFFFFFFF
+            self.highest = counter
+        else:
+            self.seen |= 1 << (self.highest - counter)
+        return True
+
+
+class NonceCounters(object):
+    """The next nonce for every peer key."""
+
+    def __init__(self):
+        self.counters = {}
+
+    def next(self, key):
+        self.counters[key] = self.counters.get(key, 0) + 1
+        return nonce(self.counters[key])
+
+
+def selftest():
+    window = ReplayWindow()
+    for counter in range(1, 100):
+        assert window.accept(nonce(counter)), "fresh nonce rejected"
+        assert not window.check(nonce(counter)), "replayed nonce accepted"
+    assert window.accept(nonce(120))
+    assert window.accept(nonce(110)), "delayed nonce rejected"
+    assert not window.accept(nonce(110)), "delayed nonce accepted twice"
+    assert not window.check(nonce(120 - REPLAY_WINDOW_SIZE)), "nonce outside window accepted"
+    assert not window.check(nonce(1)), "old nonce accepted"
+
+    counters = NonceCounters()
+    assert counters.next(b"a") == nonce(1) and counters.next(b"a") == nonce(2)
+    assert counters.next(b"b") == nonce(1), "counters are not per key"
+    print("OK")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or sys.argv[1] != "selftest":
+        print(__doc__)
+        sys.exit(1)
+    selftest()
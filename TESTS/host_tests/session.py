@@ -0,0 +1,129 @@
+"""
+Session resumption, the server side of source/SessionTicket.h.
+
+After a full key exchange both sides keep a ticket with the verified key of
+the peer, an id and a counter. The id is the start of
+SHA-512(device message || server message), the messages being the
+[publicKey | nonce] tuples of the exchange. A reconnect is one signed
+request and one signed response, numbers are big endian:
+
+  request:  ['R' | id (16) | counter (4) | device signature (64)]
+  response: ['A' | id (16) | counter (4) | server signature (64)]
+
+Only counters above the last accepted one are accepted, so recorded
+requests can not be replayed.
+
+Usage:
+  python session.py selftest
+"""
+import binascii
+import hashlib
+import json
+import os
+import struct
+import sys
+
+MESSAGE_BYTES = 32 + 4
+TICKET_ID_BYTES = 16
+SIGNED_BYTES = 1 + TICKET_ID_BYTES + 4
+RESUME_BYTES = SIGNED_BYTES + 64
+REQUEST = b"R"
+RESPONSE = b"A"
+
+
+def ticket_id(device_message, server_message):
+    return hashlib.sha512(bytes(device_message) + bytes(server_message)).digest()[:TICKET_ID_BYTES]
+
+
+class SessionTickets(object):
+    """The tickets of all devices that completed a key exchange, optionally kept in a JSON file."""
+
+    def __init__(self, path=None):
+        self.path = path
+        self.tickets = {}
+        if path and os.path.exists(path):
+            with open(path) as f:
+                for key, (public_key, counter) in json.load(f).items():
+                    self.tickets[binascii.unhexlify(key)] = (binascii.unhexlify(public_key), counter)
+
+    def _save(self):
+        if not self.path:
+            return
+        data = dict((binascii.hexlify(key).decode("ascii"), (binascii.hexlify(public_key).decode("ascii"), counter))
+                    for key, (public_key, counter) in self.tickets.items())
+        with open(self.path + ".tmp", "w") as f:
+            json.dump(data, f)
+        os.rename(self.path + ".tmp", self.path)
+
+    def issue(self, device_message, server_message):
+        """keep a ticket after the exchange succeeded, returns the ticket id"""
+        if len(device_message) != MESSAGE_BYTES or len(server_message) != MESSAGE_BYTES:
+            raise ValueError("key exchange messages have the wrong length")
+        key = ticket_id(device_message, server_message)
+        self.tickets[key] = (bytes(device_message[:32]), 0)
+        self._save()
+        return key
+
+    def accept(self, signing_key, request):
+        """check a resumption request, returns the signed response or None"""
+        request = bytes(request)
+        if len(request) != RESUME_BYTES or request[0:1] != REQUEST:
+            return None
+        key = request[1:1 + TICKET_ID_BYTES]
+        if key not in self.tickets:
+            return None
+        public_key, last = self.tickets[key]
+        counter, = struct.unpack(">I", request[1 + TICKET_ID_BYTES:SIGNED_BYTES])
+        if counter <= last:
+            return None
+
+        import ed25519
+        try:
+            ed25519.VerifyingKey(public_key).verify(request[SIGNED_BYTES:], request[:SIGNED_BYTES])
+        except ed25519.BadSignatureError:
+            return None
+
+        self.tickets[key] = (public_key, counter)
+        self._save()
+        response = RESPONSE + key + struct.pack(">I", counter)
+        return response + signing_key.sign(response)
+
+
+def selftest():
+    import ed25519
+    import tempfile
+
+    device_private, device_public = ed25519.create_keypair(entropy=os.urandom)
+    server_private, server_public = ed25519.create_keypair(entropy=os.urandom)
+    device_message = device_public.to_bytes() + os.urandom(4)
+    server_message = server_public.to_bytes() + os.urandom(4)
+
+    path = os.path.join(tempfile.mkdtemp(), "tickets.json")
+    key = SessionTickets(path).issue(device_message, server_message)
+
+    def request(counter, signer=device_private):
+        message = REQUEST + key + struct.pack(">I", counter)
+        return message + signer.sign(message)
+
+    tickets = SessionTickets(path)
+    response = tickets.accept(server_private, request(1))
+    assert response is not None, "request rejected"
+    assert response[:SIGNED_BYTES] == RESPONSE + key + struct.pack(">I", 1)
+    server_public.verify(response[SIGNED_BYTES:], response[:SIGNED_BYTES])
+
+    assert tickets.accept(server_private, request(1)) is None, "replay accepted"
+    assert SessionTickets(path).accept(server_private, request(1)) is None, "replay accepted after reload"
+    assert tickets.accept(server_private, request(2, server_private)) is None, "forged request accepted"
+    broken = bytearray(request(2))
+    broken[5] ^= 1
+    assert tickets.accept(server_private, bytes(broken)) is None, "unknown ticket accepted"
+    assert tickets.accept(server_private, request(2)) is not None
+    os.remove(path)
+    print("OK")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or sys.argv[1] != "selftest":
+        print(__doc__)
+        sys.exit(1)
+    selftest()
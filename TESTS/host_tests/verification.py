@@ -0,0 +1,114 @@
+"""
+Client of the native verification service (tools/VerificationService.cpp).
+
+The host tests use it instead of verifying with the ed25519 package when
+the environment variable UBIRCH_VERIFICATION_SERVICE names the socket of a
+running service.
+
+Usage:
+  python verification.py load [socket] [messages] [window]
+
+The load generator keeps up to `window` requests in flight and reports the
+throughput and the latency percentiles. It needs the ed25519 package to
+create the signed messages.
+"""
+import os
+import socket
+import struct
+import sys
+import time
+
+MESSAGE_BYTES = 32 + 4
+RESPONSE_BYTES = 5
+DEFAULT_SOCKET = "/tmp/ubirch-verify.sock"
+
+
+class VerificationClient(object):
+    def __init__(self, path=None):
+        self.socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.socket.connect(path or os.environ.get("UBIRCH_VERIFICATION_SERVICE", DEFAULT_SOCKET))
+        self.next_id = 0
+        self.buffer = b""
+
+    def close(self):
+        self.socket.close()
+
+    def submit(self, signer, message, signature):
+        """send a [publicKey|nonce] message and its signature, returns the request id"""
+        if len(signer) != 32 or len(message) != MESSAGE_BYTES or len(signature) != 64:
+            raise ValueError("signer, message or signature has the wrong length")
+        request_id = self.next_id
+        self.next_id = (self.next_id + 1) & 0xFFFFFFFF
+        self.socket.sendall(struct.pack(">I", request_id) + bytes(signer) + bytes(message) + bytes(signature))
+        return request_id
+
+    def result(self):
+        """wait for the next result, returns (request id, valid)"""
+        while len(self.buffer) < RESPONSE_BYTES:
+            data = self.socket.recv(4096)
+            if not data:
+                raise IOError("verification service closed the connection")
+            self.buffer += data
+        request_id, status = struct.unpack(">IB", self.buffer[:RESPONSE_BYTES])
+        self.buffer = self.buffer[RESPONSE_BYTES:]
+        return request_id, status == 1
+
+    def verify(self, signer, message, signature):
+        request_id = self.submit(signer, message, signature)
+        while True:
+            result_id, valid = self.result()
+            if result_id == request_id:
+                return valid
+
+
+def load(path, messages, window):
+    import ed25519
+
+    # a pool of signed messages from several devices, every 16th one broken
+    pool = []
+    for i in range(64):
+        private, public = ed25519.create_keypair(entropy=os.urandom)
+        message = public.to_bytes() + os.urandom(4)
+        signature = private.sign(message)
+        if i % 16 == 15:
+            broken = bytearray(signature)
+            broken[40] ^= 1
+            signature = bytes(broken)
+        pool.append(((public.to_bytes(), message, signature), i % 16 != 15))
+
+    client = VerificationClient(path)
+    sent = {}
+    latencies = []
+    errors = 0
+    start = time.time()
+    for n in range(messages):
+        if len(sent) >= window:
+            request_id, valid = client.result()
+            expected, submitted = sent.pop(request_id)
+            latencies.append(time.time() - submitted)
+            errors += valid != expected
+        request, expected = pool[n % len(pool)]
+        sent[client.submit(*request)] = (expected, time.time())
+    while sent:
+        request_id, valid = client.result()
+        expected, submitted = sent.pop(request_id)
+        latencies.append(time.time() - submitted)
+        errors += valid != expected
+    elapsed = time.time() - start
+    client.close()
+
+    latencies.sort()
+    percentile = lambda p: latencies[min(len(latencies) - 1, int(len(latencies) * p))] * 1000.0
+    print("%d messages in %.2fs: %.0f messages/s, latency p50 %.2fms, p99 %.2fms, max %.2fms, %d wrong results" %
+          (messages, elapsed, messages / elapsed, percentile(0.50), percentile(0.99), latencies[-1] * 1000.0, errors))
+    return errors == 0
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or sys.argv[1] != "load":
+        print(__doc__)
+        sys.exit(1)
+    ok = load(sys.argv[2] if len(sys.argv) > 2 else None,
+              int(sys.argv[3]) if len(sys.argv) > 3 else 10000,
+              int(sys.argv[4]) if len(sys.argv) > 4 else 64)
+    sys.exit(0 if ok else 1)
@@ -1,9 +1,45 @@
+add_executable(tests-crypto-backend TESTS/crypto/backend/ED25519BackendTests.cpp)
+target_link_libraries(tests-crypto-backend ubirch-mbed-crypto)
 add_executable(tests-crypto-base64 TESTS/crypto/base64/Base64Tests.cpp)
 target_link_libraries(tests-crypto-base64 ubirch-mbed-crypto)
+add_executable(tests-crypto-cache TESTS/crypto/cache/VerificationCacheTests.cpp)
+target_link_libraries(tests-crypto-cache ubirch-mbed-crypto)
+add_executable(tests-crypto-chain TESTS/crypto/chain/SignatureChainTests.cpp)
+target_link_libraries(tests-crypto-chain ubirch-mbed-crypto)
+add_executable(tests-crypto-context TESTS/crypto/context/SigningContextTests.cpp)
+target_link_libraries(tests-crypto-context ubirch-mbed-crypto)
+add_executable(tests-crypto-filter TESTS/crypto/filter/SignatureFilterTests.cpp)
+target_link_libraries(tests-crypto-filter ubirch-mbed-crypto)
+add_executable(tests-crypto-hash TESTS/crypto/hash/SHA512Tests.cpp)
+target_link_libraries(tests-crypto-hash ubirch-mbed-crypto)
 add_executable(tests-crypto-keys TESTS/crypto/keys/KeyHandlingTests.cpp)
 target_link_libraries(tests-crypto-keys ubirch-mbed-crypto)
+add_executable(tests-crypto-keystore TESTS/crypto/keystore/FlashKeyStoreTests.cpp)
+target_link_libraries(tests-crypto-keystore ubirch-mbed-crypto)
+add_executable(tests-crypto-merkle TESTS/crypto/merkle/MerkleBatchTests.cpp)
+target_link_libraries(tests-crypto-merkle ubirch-mbed-crypto)
+add_executable(tests-crypto-message TESTS/crypto/message/SignedMessageTests.cpp)
+target_link_libraries(tests-crypto-message ubirch-mbed-crypto)
+add_executable(tests-crypto-pipeline TESTS/crypto/pipeline/SignPipelineTests.cpp)
+target_link_libraries(tests-crypto-pipeline ubirch-mbed-crypto)
+add_executable(tests-crypto-policy TESTS/crypto/policy/StaticKeyPairTests.cpp)
+target_link_libraries(tests-crypto-policy ubirch-mbed-crypto)
 add_executable(tests-crypto-protocol TESTS/crypto/protocol/KeyExchangeTests.cpp)
 target_link_libraries(tests-crypto-protocol ubirch-mbed-crypto)
+add_executable(tests-crypto-replay TESTS/crypto/replay/ReplayWindowTests.cpp)
+target_link_libraries(tests-crypto-replay ubirch-mbed-crypto)
+add_executable(tests-crypto-revocation TESTS/crypto/revocation/RevocationListTests.cpp)
+target_link_libraries(tests-crypto-revocation ubirch-mbed-crypto)
+add_executable(tests-crypto-session TESTS/crypto/session/SessionTicketTests.cpp)
+target_link_libraries(tests-crypto-session ubirch-mbed-crypto)
+add_executable(tests-crypto-stats TESTS/crypto/stats/CryptoStatsTests.cpp)
+target_link_libraries(tests-crypto-stats ubirch-mbed-crypto)
+add_executable(tests-crypto-stream TESTS/crypto/stream/StreamSignerTests.cpp)
+target_link_libraries(tests-crypto-stream ubirch-mbed-crypto)
+add_executable(tests-crypto-transport TESTS/crypto/transport/FrameTransportTests.cpp)
+target_link_libraries(tests-crypto-transport ubirch-mbed-crypto)
+add_executable(tests-crypto-workspace TESTS/crypto/workspace/WorkspaceTests.cpp)
+target_link_libraries(tests-crypto-workspace ubirch-mbed-crypto)
 
 ADD_CUSTOM_TARGET(mbed-cli-test
         COMMAND ${CMAKE_COMMAND} -E echo "mbed test -n tests-* --build BUILD/${CMAKE_BUILD_TYPE} --profile ${MBED_BUILD_PROFILE}"
@@ -0,0 +1,129 @@
+/*!
+ * @file
+ * @brief Algorithm policies for StaticKeyPair.
+ *
+ * Each policy is a struct with the key and signature sizes as enum
+ * constants and static functions for the operations of the algorithm.
+ * Signature algorithms provide sign() and verify(), key agreement
+ * algorithms provide agree(). All functions are resolved at compile time.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-22
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_ALGORITHMS_H
+#define UBIRCH_MBED_CRYPTO_ALGORITHMS_H
+
+#include <nacl/armnacl.h>
+#include "ED25519Core.h"
+#include "SHA512.h"
+#include "X25519.h"
+
+/**
+ * ED25519 signatures (RFC 8032). The secret key is the NaCl secret key, seed and public key.
+ */
+struct ED25519Algorithm {
+    enum {
+        PUBLIC_KEY_BYTES = crypto_sign_PUBLICKEYBYTES,
+        SECRET_KEY_BYTES = crypto_sign_SECRETKEYBYTES,
+        SIGNATURE_BYTES = crypto_sign_BYTES
+    };
+
+    static bool generate(unsigned char *publicKey, unsigned char *secretKey) {
+        return crypto_sign_keypair(publicKey, secretKey) == 0;
+    }
+
+    static void sign(unsigned char *signature, const unsigned char *secretKey,
+                     const unsigned char *message, size_t length) {
+        ED25519ExpandedKey expanded;
+        ed25519Expand(&expanded, secretKey);
+        ed25519Sign(signature, &expanded, secretKey + ED25519_SEED_BYTES, message, length);
+        ed25519Wipe(&expanded, sizeof(expanded));
+    }
+
+    static bool verify(const unsigned char *signature, const unsigned char *publicKey,
+                       const unsigned char *message, size_t length) {
+        const ED25519Segment segment = {message, length};
+        return ed25519VerifySegments(signature, publicKey, &segment, 1);
+    }
+};
+
+/**
+ * Ed25519ph signatures (RFC 8032) without context. The message is hashed
+ * with SHA-512 first, which allows signing data that is streamed in pieces.
+ */
+struct ED25519phAlgorithm {
+    enum {
+        PUBLIC_KEY_BYTES = crypto_sign_PUBLICKEYBYTES,
+        SECRET_KEY_BYTES = crypto_sign_SECRETKEYBYTES,
+        SIGNATURE_BYTES = crypto_sign_BYTES
+    };
+
+    static bool generate(unsigned char *publicKey, unsigned char *secretKey) {
+        return crypto_sign_keypair(publicKey, secretKey) == 0;
+    }
+
+    static void sign(unsigned char *signature, const unsigned char *secretKey,
+                     const unsigned char *message, size_t length) {
+        unsigned char digest[SHA512_BYTES];
+        ED25519ExpandedKey expanded;
+        prehash(digest, message, length);
+        ed25519Expand(&expanded, secretKey);
+        ed25519SignPrehashed(signature, &expanded, secretKey + ED25519_SEED_BYTES, digest, NULL, 0);
+        ed25519Wipe(&expanded, sizeof(expanded));
+    }
+
+    static bool verify(const unsigned char *signature, const unsigned char *publicKey,
+                       const unsigned char *message, size_t length) {
+        unsigned char digest[SHA512_BYTES];
+        prehash(digest, message, length);
+        return ed25519VerifyPrehashed(signature, publicKey, digest, NULL, 0);
+    }
+
+private:
+    static void prehash(unsigned char *digest, const unsigned char *message, size_t length) {
+        SHA512 hash;
+        hash.update(message, length);
+        hash.finish(digest);
+    }
+};
+
+/**
+ * X25519 key agreement (RFC 7748).
+ */
+struct X25519Algorithm {
+    enum {
+        PUBLIC_KEY_BYTES = X25519_BYTES,
+        SECRET_KEY_BYTES = X25519_BYTES,
+        SHARED_SECRET_BYTES = X25519_BYTES
+    };
+
+    static bool generate(unsigned char *publicKey, unsigned char *secretKey) {
+        randombytes(secretKey, X25519_BYTES);
+        x25519Base(publicKey, secretKey);
+        return true;
+    }
+
+    static bool agree(unsigned char *sharedSecret, const unsigned char *secretKey, const unsigned char *peerPublicKey) {
+        return x25519(sharedSecret, secretKey, peerPublicKey);
+    }
+};
+
+#endif //UBIRCH_MBED_CRYPTO_ALGORITHMS_H
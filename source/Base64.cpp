@@ -39,6 +39,7 @@
 typedef unsigned int uint32_t;
 #endif
 #include "Base64.h"
+#include "CryptoStats.h"
 
 static const unsigned char encoding_table[] = {
     'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
@@ -67,10 +68,15 @@ Base64::~Base64()
 
 char * Base64::Encode(const char *data, size_t input_length, size_t *output_length)
 {
+    CRYPTO_STATS(CRYPTO_STATS_ENCODE);
     *output_length = 4 * ((input_length + 2) / 3);
 
     char *encoded_data = new char[*output_length+1];  // often used for text, so add room for NULL
-    if (encoded_data == NULL) return NULL;
+    if (encoded_data == NULL) {
+        CRYPTO_STATS_FAILED();
+        return NULL;
+    }
+    CRYPTO_STATS_ALLOCATED(*output_length + 1);
 
     for (unsigned int i = 0, j = 0; i < input_length;) {
 
@@ -96,18 +102,27 @@ char * Base64::Encode(const char *data, size_t input_length, size_t *output_leng
 
 char * Base64::Decode(const char *data, size_t input_length, size_t *output_length)
 {
-    if (decoding_table == NULL)
+    CRYPTO_STATS(CRYPTO_STATS_DECODE);
+    if (decoding_table == NULL) {
         build_decoding_table();
+        CRYPTO_STATS_ALLOCATED(256);
+    }
 
-    if (input_length % 4 != 0) 
+    if (input_length % 4 != 0) {
+        CRYPTO_STATS_FAILED();
         return NULL;
+    }
 
     *output_length = input_length / 4 * 3;
     if (data[input_length - 1] == '=') (*output_length)--;
     if (data[input_length - 2] == '=') (*output_length)--;
 
     char *decoded_data = new char[*output_length+1];  // often used for text, so add room for NULL
-    if (decoded_data == NULL)return NULL;
+    if (decoded_data == NULL) {
+        CRYPTO_STATS_FAILED();
+        return NULL;
+    }
+    CRYPTO_STATS_ALLOCATED(*output_length + 1);
 
     for (unsigned int i = 0, j = 0; i < input_length;) {
 
@@ -133,6 +148,57 @@ char * Base64::Decode(const char *data, size_t input_length, size_t *output_leng
 }
 
 
+// the value of a base64 character, -1 for anything else
+static int sextet(unsigned char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+
+bool Base64::Decode(const char *data, size_t input_length, unsigned char *output, size_t output_size,
+                    size_t *output_length)
+{
+    CRYPTO_STATS(CRYPTO_STATS_DECODE);
+    if ((data == NULL && input_length > 0) || output_length == NULL || input_length % 4 != 0) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+
+    size_t length = input_length / 4 * 3;
+    if (input_length > 0 && data[input_length - 1] == '=') length--;
+    if (input_length > 0 && data[input_length - 2] == '=') length--;
+    if (length > output_size || (output == NULL && length > 0)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+
+    for (size_t i = 0, j = 0; i < input_length; i += 4) {
+        // padding is only allowed where the length says so
+        uint32_t triple = 0;
+        for (size_t k = 0; k < 4; k++) {
+            const int value = sextet((unsigned char) data[i + k]);
+            if (value < 0 && !(data[i + k] == '=' && j + k >= length + 1 && i + 4 == input_length)) {
+                CRYPTO_STATS_FAILED();
+                return false;
+            }
+            triple = (triple << 6) | (value < 0 ? 0 : (uint32_t) value);
+        }
+
+        if (j < length) output[j++] = (unsigned char) ((triple >> 2 * 8) & 0xFF);
+        if (j < length) output[j++] = (unsigned char) ((triple >> 1 * 8) & 0xFF);
+        if (j < length) output[j++] = (unsigned char) ((triple >> 0 * 8) & 0xFF);
+    }
+
+    *output_length = length;
+    return true;
+}
+
+
 void Base64::build_decoding_table()
 {
     decoding_table = new unsigned char[256];
@@ -140,3 +206,61 @@ void Base64::build_decoding_table()
     for (unsigned char i = 0; i < 64; i++)
         decoding_table[encoding_table[i]] = i;
 }
+
+
+Base64Encoder::Base64Encoder()
+{
+    pending_length = 0;
+}
+
+
+size_t Base64Encoder::Update(const unsigned char *data, size_t input_length, char *output)
+{
+    size_t i = 0, j = 0;
+
+    // complete the group started by the previous chunk
+    while (pending_length > 0 && i < input_length) {
+        if (pending_length == 2) {
+            uint32_t triple = ((uint32_t) pending[0] << 0x10) + ((uint32_t) pending[1] << 0x08) + data[i++];
+            output[j++] = encoding_table[(triple >> 3 * 6) & 0x3F];
+            output[j++] = encoding_table[(triple >> 2 * 6) & 0x3F];
+            output[j++] = encoding_table[(triple >> 1 * 6) & 0x3F];
+            output[j++] = encoding_table[(triple >> 0 * 6) & 0x3F];
+            pending_length = 0;
+        } else {
+            pending[pending_length++] = data[i++];
+        }
+    }
+
+    for (; i + 3 <= input_length; i += 3) {
+        uint32_t triple = ((uint32_t) data[i] << 0x10) + ((uint32_t) data[i + 1] << 0x08) + data[i + 2];
+        output[j++] = encoding_table[(triple >> 3 * 6) & 0x3F];
+        output[j++] = encoding_table[(triple >> 2 * 6) & 0x3F];
+        output[j++] = encoding_table[(triple >> 1 * 6) & 0x3F];
+        output[j++] = encoding_table[(triple >> 0 * 6) & 0x3F];
+    }
+
+    while (i < input_length)
+        pending[pending_length++] = data[i++];
+
+    return j;
+}
+
+
+size_t Base64Encoder::Finish(char *output)
+{
+    if (pending_length == 0)
+        return 0;
+
+    uint32_t triple = (uint32_t) pending[0] << 0x10;
+    if (pending_length == 2)
+        triple += (uint32_t) pending[1] << 0x08;
+
+    output[0] = encoding_table[(triple >> 3 * 6) & 0x3F];
+    output[1] = encoding_table[(triple >> 2 * 6) & 0x3F];
+    output[2] = pending_length == 2 ? encoding_table[(triple >> 1 * 6) & 0x3F] : '=';
+    output[3] = '=';
+
+    pending_length = 0;
+    return 4;
+}
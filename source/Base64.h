@@ -104,10 +104,88 @@ public:
     * @returns NULL if something went very wrong.
     */
     char *Decode(const char *data, size_t input_length, size_t *output_length);
+
+    /** Decodes a base64 encoded stream into a buffer of the caller.
+    *
+    * Nothing is allocated, not even the decoding table. The output may be the
+    * input buffer itself, the decoded bytes never overtake the characters still
+    * to be read, so a received message can be decoded where it is.
+    *
+    * @param data is a pointer to the encoded data to decode.
+    * @param input_length is the number of bytes to process.
+    * @param output is the buffer for the decoded bytes, no null termination is added.
+    * @param output_size is the size of the buffer.
+    * @param output_length is a pointer to a size_t value into which is written the
+    *        number of bytes in the output.
+    *
+    * @returns false if the data is not base64 or does not fit into the buffer.
+    */
+    bool Decode(const char *data, size_t input_length, unsigned char *output, size_t output_size,
+                size_t *output_length);
     
 private:
     void build_decoding_table();
     unsigned char *decoding_table;
 };
 
+/** The maximum number of characters for input_length bytes, see Base64Encoder::MaxOutput()
+*
+* A constant expression for a constant length, so it can size an array.
+*/
+#define BASE64_ENCODED_BYTES(input_length) (4 * (((input_length) + 2) / 3))
+
+/** Streaming Base64 encoder
+*
+* Encodes data that arrives in chunks, without allocating memory. Up to two
+* bytes of a chunk are kept until the next chunk completes the group of
+* three. The output is the same as Base64::Encode() on the whole data.
+*
+* @code
+* Base64Encoder encoder;
+* char out[BASE64_ENCODED_BYTES(sizeof(chunk))];
+* while (read(chunk, &length))
+*     write(out, encoder.Update(chunk, length, out));
+* write(out, encoder.Finish(out));
+* @endcode
+*/
+class Base64Encoder
+{
+public:
+    /** Constructor
+    *
+    */
+    Base64Encoder();
+
+    /** Encodes the next chunk of data
+    *
+    * @param data is a pointer to the chunk.
+    * @param input_length is the number of bytes in the chunk.
+    * @param output is the buffer for the encoded characters, it must hold
+    *        MaxOutput(input_length) characters.
+    *
+    * @returns the number of characters written, no null termination is added.
+    */
+    size_t Update(const unsigned char *data, size_t input_length, char *output);
+
+    /** Encodes the remaining bytes and adds the padding
+    *
+    * The encoder can be used for the next stream afterwards.
+    *
+    * @param output is the buffer for the last characters, it must hold 4 characters.
+    *
+    * @returns the number of characters written, no null termination is added.
+    */
+    size_t Finish(char *output);
+
+    /** The maximum number of characters Update() writes for a chunk
+    *
+    * @param input_length is the number of bytes in the chunk.
+    */
+    static size_t MaxOutput(size_t input_length) { return BASE64_ENCODED_BYTES(input_length); }
+
+private:
+    unsigned char pending[2];
+    size_t pending_length;
+};
+
 #endif // BASE64_H
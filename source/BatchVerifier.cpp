@@ -0,0 +1,71 @@
+/*!
+ * @file
+ * @brief Verification of many signatures at once.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-16
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "BatchVerifier.h"
+#include "SHA512x4.h"
+
+size_t ed25519VerifyBatch(ED25519VerifyJob *jobs, size_t count) {
+    size_t valid = 0;
+
+    for (size_t first = 0; first < count; first += SHA512_LANES) {
+        const size_t n = count - first < SHA512_LANES ? count - first : SHA512_LANES;
+        ED25519VerifyJob *batch = jobs + first;
+
+        ED25519Segment segments[SHA512_LANES][3];
+        unsigned char hram[SHA512_LANES][SHA512_BYTES];
+        SHA512Lane lanes[SHA512_LANES];
+        size_t lanesUsed = 0;
+        size_t lane[SHA512_LANES];
+
+        // H(R || A || M) of all well formed jobs in one pass
+        for (size_t i = 0; i < n; i++) {
+            ED25519VerifyJob *job = batch + i;
+            job->valid = false;
+            if (job->publicKey == NULL || job->signature == NULL || job->message == NULL || job->length == 0)
+                continue;
+
+            ED25519Segment *s = segments[lanesUsed];
+            s[0].data = job->signature->signature;
+            s[0].length = 32;
+            s[1].data = job->publicKey->key;
+            s[1].length = crypto_sign_PUBLICKEYBYTES;
+            s[2].data = job->message;
+            s[2].length = job->length;
+            lanes[lanesUsed].segments = s;
+            lanes[lanesUsed].count = 3;
+            lanes[lanesUsed].digest = hram[lanesUsed];
+            lane[lanesUsed++] = i;
+        }
+        sha512x4(lanes, lanesUsed);
+
+        for (size_t l = 0; l < lanesUsed; l++) {
+            ED25519VerifyJob *job = batch + lane[l];
+            job->valid = ed25519Verify(job->signature->signature, job->publicKey->key, hram[l]);
+            if (job->valid) valid++;
+        }
+    }
+
+    return valid;
+}
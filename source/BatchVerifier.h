@@ -0,0 +1,55 @@
+/*!
+ * @file
+ * @brief Verification of many signatures at once.
+ *
+ * Every signature is checked on its own, with the same result as
+ * ED25519KeyPair::verify(). The hashes H(R || A || M) of four messages are
+ * calculated together with the multi-buffer SHA-512 and the messages are
+ * hashed in place, without the copies crypto_sign_open() needs.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-16
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_BATCHVERIFIER_H
+#define UBIRCH_MBED_CRYPTO_BATCHVERIFIER_H
+
+#include "KeyPair.h"
+
+/**
+ * A signed message to verify and the result of the verification.
+ */
+typedef struct ED25519VerifyJob {
+    const ED25519PublicKey *publicKey;
+    const unsigned char *message;
+    size_t length;
+    const ED25519Signature *signature;
+    bool valid;
+} ED25519VerifyJob;
+
+/**
+ * Verify a batch of signed messages and set the valid flag of each job.
+ * @param jobs the messages to verify
+ * @param count the number of jobs
+ * @return the number of valid signatures
+ */
+size_t ed25519VerifyBatch(ED25519VerifyJob *jobs, size_t count);
+
+#endif //UBIRCH_MBED_CRYPTO_BATCHVERIFIER_H
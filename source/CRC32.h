@@ -0,0 +1,44 @@
+/*!
+ * @file
+ * @brief CRC-32 checksum.
+ *
+ * The IEEE 802.3 CRC-32 as used by zlib, so checksums can be checked with
+ * zlib.crc32() on the host side.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-18
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_CRC32_H
+#define UBIRCH_MBED_CRYPTO_CRC32_H
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Calculate or continue a CRC-32 checksum.
+ * @param crc the checksum of the preceding data, 0 to start
+ * @param data the data
+ * @param length the length of the data
+ * @return the checksum including the data
+ */
+uint32_t crc32(uint32_t crc, const unsigned char *data, size_t length);
+
+#endif //UBIRCH_MBED_CRYPTO_CRC32_H
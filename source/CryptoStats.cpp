@@ -0,0 +1,121 @@
+/*!
+ * @file
+ * @brief Runtime statistics of the crypto operations.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-20
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "CryptoStats.h"
+
+#ifdef UBIRCH_CRYPTO_STATS_ENABLED
+
+#include <cstring>
+
+#ifdef __MBED__
+#include "mbed.h"
+#define STATS_LOCK() core_util_critical_section_enter()
+#define STATS_UNLOCK() core_util_critical_section_exit()
+#else
+#include <ctime>
+#define STATS_LOCK()
+#define STATS_UNLOCK()
+#endif
+
+static CryptoStats stats;
+
+static uint32_t now() {
+#if defined(__MBED__) && defined(DWT)
+    // the cycle counter is off after reset
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#elif defined(__MBED__)
+    return us_ticker_read();
+#else
+    return static_cast<uint32_t>(clock());
+#endif
+}
+
+const CryptoStats *cryptoStats() {
+    return &stats;
+}
+
+void cryptoStatsReset() {
+    STATS_LOCK();
+    memset(&stats, 0, sizeof(stats));
+    STATS_UNLOCK();
+}
+
+static unsigned char *put(unsigned char *p, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) *p++ = static_cast<unsigned char>(value >> (8 * i));
+    return p;
+}
+
+size_t cryptoStatsExport(unsigned char *blob, size_t length) {
+    if (blob == NULL || length < CRYPTO_STATS_BLOB_BYTES) return 0;
+
+    CryptoStats copy;
+    STATS_LOCK();
+    memcpy(&copy, &stats, sizeof(copy));
+    STATS_UNLOCK();
+
+    unsigned char *p = blob;
+    *p++ = CRYPTO_STATS_VERSION;
+    *p++ = CRYPTO_STATS_OPERATIONS;
+    for (int i = 0; i < CRYPTO_STATS_OPERATIONS; i++) {
+        const CryptoOperationStats &operation = copy.operations[i];
+        p = put(p, operation.calls, 4);
+        p = put(p, operation.failures, 4);
+        p = put(p, operation.cycles, 8);
+        p = put(p, operation.maxCycles, 4);
+        p = put(p, operation.bytes, 4);
+    }
+
+    return static_cast<size_t>(p - blob);
+}
+
+void cryptoStatsAllocated(CryptoStatsOperation operation, size_t bytes) {
+    STATS_LOCK();
+    stats.operations[operation].bytes += static_cast<uint32_t>(bytes);
+    STATS_UNLOCK();
+}
+
+CryptoStatsScope::CryptoStatsScope(CryptoStatsOperation operation)
+        : operation(operation), start(now()), bytes(0), failure(false), discarded(false) {}
+
+CryptoStatsScope::~CryptoStatsScope() {
+    if (discarded) return;
+    const uint32_t cycles = now() - start;
+
+    STATS_LOCK();
+    CryptoOperationStats &s = stats.operations[operation];
+    s.calls++;
+    if (failure) s.failures++;
+    s.cycles += cycles;
+    if (cycles > s.maxCycles) s.maxCycles = cycles;
+    s.bytes += bytes;
+    STATS_UNLOCK();
+}
+
+#endif
@@ -0,0 +1,142 @@
+/*!
+ * @file
+ * @brief Runtime statistics of the crypto operations.
+ *
+ * Counts calls, failures, cycles and heap bytes of key generation, signing,
+ * verification, Base64 encoding and decoding and of the signatures rejected
+ * by the ED25519SignatureFilter pre-checks. The statistics are off by
+ * default; define UBIRCH_CRYPTO_STATS_ENABLED (e.g. in the macros of
+ * mbed_app.json) to turn them on. When disabled the instrumentation
+ * compiles to nothing and none of the functions below exist.
+ *
+ * Time is measured with the DWT cycle counter on cores that have one
+ * (Cortex-M3 and up). Cortex-M0 counts microseconds of the us ticker.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-20
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_CRYPTOSTATS_H
+#define UBIRCH_MBED_CRYPTO_CRYPTOSTATS_H
+
+#ifdef UBIRCH_CRYPTO_STATS_ENABLED
+
+#include <cstddef>
+#include <stdint.h>
+
+/** The version of the exported statistics blob. */
+#define CRYPTO_STATS_VERSION 2
+
+enum CryptoStatsOperation {
+    /** key generation, the heap bytes include all key material of a key pair */
+    CRYPTO_STATS_GENERATE = 0,
+    CRYPTO_STATS_SIGN,
+    CRYPTO_STATS_VERIFY,
+    CRYPTO_STATS_ENCODE,
+    CRYPTO_STATS_DECODE,
+    CRYPTO_STATS_REJECT,
+    CRYPTO_STATS_OPERATIONS
+};
+
+/**
+ * The statistics of one operation.
+ */
+typedef struct CryptoOperationStats {
+    uint32_t calls;
+    uint32_t failures;
+    uint64_t cycles;
+    uint32_t maxCycles;
+    uint32_t bytes;
+} CryptoOperationStats;
+
+typedef struct CryptoStats {
+    CryptoOperationStats operations[CRYPTO_STATS_OPERATIONS];
+} CryptoStats;
+
+/** The size of the exported blob: version, count and the big endian fields of each operation. */
+#define CRYPTO_STATS_BLOB_BYTES (2 + CRYPTO_STATS_OPERATIONS * (4 + 4 + 8 + 4 + 4))
+
+/**
+ * @return the statistics collected since start or the last reset
+ */
+const CryptoStats *cryptoStats();
+
+/**
+ * Clear all statistics.
+ */
+void cryptoStatsReset();
+
+/**
+ * Export the statistics as a compact blob for telemetry.
+ * @param blob the output buffer
+ * @param length the size of the buffer, at least CRYPTO_STATS_BLOB_BYTES
+ * @return the number of bytes written, 0 if the buffer is too small
+ */
+size_t cryptoStatsExport(unsigned char *blob, size_t length);
+
+/**
+ * Count heap bytes that are allocated outside of a measured operation,
+ * like the key cache a key pair creates on first use.
+ * @param operation the operation the bytes are counted for
+ * @param bytes the number of bytes allocated
+ */
+void cryptoStatsAllocated(CryptoStatsOperation operation, size_t bytes);
+
+/**
+ * Measures an operation from construction to destruction. Use the
+ * CRYPTO_STATS macros instead, they disappear when the statistics are off.
+ */
+class CryptoStatsScope {
+public:
+    CryptoStatsScope(CryptoStatsOperation operation);
+
+    ~CryptoStatsScope();
+
+    void failed() { failure = true; }
+
+    void allocated(size_t bytes) { this->bytes += static_cast<uint32_t>(bytes); }
+
+    void discard() { discarded = true; }
+
+private:
+    CryptoStatsOperation operation;
+    uint32_t start;
+    uint32_t bytes;
+    bool failure;
+    bool discarded;
+};
+
+#define CRYPTO_STATS(operation) CryptoStatsScope cryptoStatsScope(operation)
+#define CRYPTO_STATS_FAILED() cryptoStatsScope.failed()
+#define CRYPTO_STATS_ALLOCATED(bytes) cryptoStatsScope.allocated(bytes)
+#define CRYPTO_STATS_DISCARD() cryptoStatsScope.discard()
+#define CRYPTO_STATS_ALLOCATED_TO(operation, bytes) cryptoStatsAllocated(operation, bytes)
+
+#else
+
+#define CRYPTO_STATS(operation)
+#define CRYPTO_STATS_FAILED() do {} while (0)
+#define CRYPTO_STATS_ALLOCATED(bytes) do {} while (0)
+#define CRYPTO_STATS_DISCARD() do {} while (0)
+#define CRYPTO_STATS_ALLOCATED_TO(operation, bytes) do {} while (0)
+
+#endif
+
+#endif //UBIRCH_MBED_CRYPTO_CRYPTOSTATS_H
@@ -0,0 +1,80 @@
+/*!
+ * @file
+ * @brief Interchangeable implementations of the ED25519 group arithmetic.
+ *
+ * ED25519KeyPair derives, signs and verifies through a backend, a struct
+ * with static functions that is selected at compile time, like the
+ * algorithm policies of StaticKeyPair. The device uses ED25519ArmNaClBackend,
+ * ED25519Core on top of the Cortex-M0 NaCl build.
+ *
+ * Other backends live outside of the library and are pulled in with
+ * ED25519_BACKEND_HEADER, a header that declares them and the values of
+ * ED25519_BACKEND it handles. tools/backend has the ref10 code of BoringSSL
+ * for host builds, `make -C tools backend-comparison` compares it with NaCl.
+ *
+ * The workspace functions of ED25519Core always use the NaCl arithmetic.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-29
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_ED25519BACKEND_H
+#define UBIRCH_MBED_CRYPTO_ED25519BACKEND_H
+
+#include "ED25519Core.h"
+
+#define ED25519_BACKEND_ARMNACL 1
+
+#ifndef ED25519_BACKEND
+#define ED25519_BACKEND ED25519_BACKEND_ARMNACL
+#endif
+
+/**
+ * The NaCl arithmetic, see ED25519Core.h.
+ */
+struct ED25519ArmNaClBackend {
+    static const char *name() { return "armnacl"; }
+
+    static void derivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded) {
+        ed25519DerivePublicKey(publicKey, expanded);
+    }
+
+    static void sign(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                     const ED25519Segment *segments, size_t count) {
+        ed25519SignSegments(signature, expanded, publicKey, segments, count);
+    }
+
+    static bool verify(const unsigned char *signature, const unsigned char *publicKey,
+                       const ED25519Segment *segments, size_t count) {
+        return ed25519VerifySegments(signature, publicKey, segments, count);
+    }
+};
+
+#ifdef ED25519_BACKEND_HEADER
+#include ED25519_BACKEND_HEADER
+#endif
+
+#if ED25519_BACKEND == ED25519_BACKEND_ARMNACL
+typedef ED25519ArmNaClBackend ED25519DefaultBackend;
+#elif !defined(ED25519_BACKEND_HEADER)
+#error "ED25519_BACKEND is unknown, set ED25519_BACKEND_HEADER to the header of its backend"
+#endif
+
+#endif //UBIRCH_MBED_CRYPTO_ED25519BACKEND_H
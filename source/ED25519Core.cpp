@@ -0,0 +1,275 @@
+/*!
+ * @file
+ * @brief Low level ED25519 building blocks.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-10
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include <new>
+#include <nacl/armnacl.h>
+#include "ED25519Core.h"
+#include "SHA512.h"
+
+extern "C" {
+#include "ge25519.h"
+#include "sc25519.h"
+}
+
+// the temporaries of signing and verifying, on the stack or in a workspace
+typedef struct ED25519Temporaries {
+    SHA512 hash;
+    unsigned char digest[SHA512_BYTES];
+    unsigned char check[32];
+    sc25519 r, k, a;
+    ge25519 P, Q;
+} ED25519Temporaries;
+
+// does not compile if the workspace is too small, increase ED25519_WORKSPACE_BYTES
+typedef char ed25519WorkspaceTooSmall[sizeof(ED25519Temporaries) <= sizeof(ED25519Workspace) ? 1 : -1];
+
+// the RFC 8032 dom2 prefix of Ed25519ph, empty for plain ED25519
+typedef struct ED25519Domain {
+    unsigned char prefix[34];
+    const unsigned char *context;
+    size_t contextLength;
+} ED25519Domain;
+
+static void domain(SHA512 &hash, const ED25519Domain *domain) {
+    if (domain == NULL) return;
+    hash.update(domain->prefix, sizeof(domain->prefix));
+    hash.update(domain->context, domain->contextLength);
+}
+
+static void hram(SHA512 &hash, unsigned char *digest, const ED25519Domain *dom, const unsigned char *signature,
+                 const unsigned char *publicKey, const ED25519Segment *segments, size_t count) {
+    hash.reset();
+    domain(hash, dom);
+    hash.update(signature, 32);
+    hash.update(publicKey, 32);
+    for (size_t i = 0; i < count; i++) hash.update(segments[i].data, segments[i].length);
+    hash.finish(digest);
+}
+
+static void sign(ED25519Temporaries &t, unsigned char *signature, const ED25519ExpandedKey *expanded,
+                 const unsigned char *publicKey, const ED25519Domain *dom, const ED25519Segment *segments,
+                 size_t count, const SHA512 *prefixed = NULL) {
+    // r = H(prefix || M), R = rB
+    if (prefixed != NULL) {
+        t.hash = *prefixed;
+    } else {
+        domain(t.hash, dom);
+        t.hash.update(expanded->prefix, sizeof(expanded->prefix));
+    }
+    for (size_t i = 0; i < count; i++) t.hash.update(segments[i].data, segments[i].length);
+    t.hash.finish(t.digest);
+    sc25519_from64bytes(&t.r, t.digest);
+    ge25519_scalarmult_base(&t.P, &t.r);
+    ge25519_pack(signature, &t.P);
+
+    // k = H(R || A || M), S = r + ka
+    hram(t.hash, t.digest, dom, signature, publicKey, segments, count);
+    sc25519_from64bytes(&t.k, t.digest);
+    sc25519_from32bytes(&t.a, expanded->scalar);
+    sc25519_mul(&t.k, &t.k, &t.a);
+    sc25519_add(&t.k, &t.k, &t.r);
+    sc25519_to32bytes(signature + 32, &t.k);
+
+    ed25519Wipe(&t.r, sizeof(t.r));
+    ed25519Wipe(&t.a, sizeof(t.a));
+}
+
+static bool verify(ED25519Temporaries &t, const unsigned char *signature, const unsigned char *publicKey,
+                   const ED25519Domain *dom, const ED25519Segment *segments, size_t count) {
+    // R' = sB - kA, using the negated public key
+    if (ge25519_unpackneg_vartime(&t.Q, publicKey)) return false;
+    hram(t.hash, t.digest, dom, signature, publicKey, segments, count);
+    sc25519_from64bytes(&t.k, t.digest);
+    sc25519_from32bytes(&t.r, signature + 32);
+    ge25519_double_scalarmult_vartime(&t.P, &t.Q, &t.k, &t.r);
+    ge25519_pack(t.check, &t.P);
+
+    return crypto_verify_32(signature, t.check) == 0;
+}
+
+bool ed25519ValidSegments(const ED25519Segment *segments, size_t count) {
+    // all segments must be there, only empty ones may be NULL
+    if (segments == NULL || count == 0) return false;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].data == NULL && segments[i].length > 0) return false;
+    }
+    return true;
+}
+
+void ed25519Expand(ED25519ExpandedKey *expanded, const unsigned char *seed) {
+    unsigned char digest[SHA512_BYTES];
+    crypto_hash_sha512(digest, seed, ED25519_SEED_BYTES);
+    digest[0] &= 248;
+    digest[31] &= 127;
+    digest[31] |= 64;
+
+    memcpy(expanded->scalar, digest, ED25519_SCALAR_BYTES);
+    memcpy(expanded->prefix, digest + ED25519_SCALAR_BYTES, sizeof(expanded->prefix));
+    ed25519Wipe(digest, sizeof(digest));
+}
+
+void ed25519DerivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded) {
+    sc25519 a;
+    ge25519 A;
+
+    sc25519_from32bytes(&a, expanded->scalar);
+    ge25519_scalarmult_base(&A, &a);
+    ge25519_pack(publicKey, &A);
+    ed25519Wipe(&a, sizeof(a));
+}
+
+void ed25519Sign(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                 const unsigned char *message, size_t length) {
+    const ED25519Segment segment = {message, length};
+    ed25519SignSegments(signature, expanded, publicKey, &segment, 1);
+}
+
+void ed25519SignSegments(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                         const ED25519Segment *segments, size_t count) {
+    ED25519Temporaries t;
+    sign(t, signature, expanded, publicKey, NULL, segments, count);
+}
+
+void ed25519SignSegments(ED25519Workspace *workspace, unsigned char *signature, const ED25519ExpandedKey *expanded,
+                         const unsigned char *publicKey, const ED25519Segment *segments, size_t count) {
+    ED25519Temporaries *t = new(workspace->storage) ED25519Temporaries;
+    sign(*t, signature, expanded, publicKey, NULL, segments, count);
+    t->~ED25519Temporaries();
+    ed25519Wipe(workspace, sizeof(ED25519Workspace));
+}
+
+void ed25519SignPrefixed(unsigned char *signature, const SHA512 &prefixed, const ED25519ExpandedKey *expanded,
+                         const unsigned char *publicKey, const ED25519Segment *segments, size_t count) {
+    ED25519Temporaries t;
+    sign(t, signature, expanded, publicKey, NULL, segments, count, &prefixed);
+}
+
+void ed25519RandomNonce(unsigned char *nonce, unsigned char *R, const ED25519ExpandedKey *expanded,
+                        const unsigned char *random) {
+    unsigned char digest[SHA512_BYTES];
+    sc25519 r;
+    ge25519 commitment;
+    SHA512 hash;
+
+    hash.update(expanded->prefix, sizeof(expanded->prefix));
+    hash.update(random, 32);
+    hash.finish(digest);
+    sc25519_from64bytes(&r, digest);
+    ge25519_scalarmult_base(&commitment, &r);
+    ge25519_pack(R, &commitment);
+    sc25519_to32bytes(nonce, &r);
+
+    ed25519Wipe(digest, sizeof(digest));
+    ed25519Wipe(&r, sizeof(r));
+}
+
+void ed25519SignFinish(unsigned char *S, const unsigned char *nonce, const ED25519ExpandedKey *expanded,
+                       const unsigned char *hram) {
+    sc25519 r, k, a;
+
+    sc25519_from32bytes(&r, nonce);
+    sc25519_from64bytes(&k, hram);
+    sc25519_from32bytes(&a, expanded->scalar);
+    sc25519_mul(&k, &k, &a);
+    sc25519_add(&k, &k, &r);
+    sc25519_to32bytes(S, &k);
+
+    ed25519Wipe(&r, sizeof(r));
+    ed25519Wipe(&a, sizeof(a));
+}
+
+void ed25519Hram(unsigned char *digest, const unsigned char *signature, const unsigned char *publicKey,
+                 const ED25519Segment *segments, size_t count) {
+    SHA512 hash;
+    hram(hash, digest, NULL, signature, publicKey, segments, count);
+}
+
+bool ed25519Verify(const unsigned char *signature, const unsigned char *publicKey, const unsigned char *hram) {
+    unsigned char check[32];
+    sc25519 k, s;
+    ge25519 A, R;
+
+    // R' = sB - kA, using the negated public key
+    if (ge25519_unpackneg_vartime(&A, publicKey)) return false;
+    sc25519_from64bytes(&k, hram);
+    sc25519_from32bytes(&s, signature + 32);
+    ge25519_double_scalarmult_vartime(&R, &A, &k, &s);
+    ge25519_pack(check, &R);
+
+    return crypto_verify_32(signature, check) == 0;
+}
+
+bool ed25519VerifySegments(const unsigned char *signature, const unsigned char *publicKey,
+                           const ED25519Segment *segments, size_t count) {
+    ED25519Temporaries t;
+    return verify(t, signature, publicKey, NULL, segments, count);
+}
+
+bool ed25519VerifySegments(ED25519Workspace *workspace, const unsigned char *signature, const unsigned char *publicKey,
+                           const ED25519Segment *segments, size_t count) {
+    ED25519Temporaries *t = new(workspace->storage) ED25519Temporaries;
+    const bool valid = verify(*t, signature, publicKey, NULL, segments, count);
+    t->~ED25519Temporaries();
+    return valid;
+}
+
+static bool prehashDomain(ED25519Domain *domain, const unsigned char *context, size_t contextLength) {
+    static const char label[] = "SigEd25519 no Ed25519 collisions";
+    if (contextLength > 255 || (context == NULL && contextLength > 0)) return false;
+
+    memcpy(domain->prefix, label, 32);
+    domain->prefix[32] = 1;
+    domain->prefix[33] = static_cast<unsigned char>(contextLength);
+    domain->context = context;
+    domain->contextLength = contextLength;
+    return true;
+}
+
+bool ed25519SignPrehashed(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                          const unsigned char *digest, const unsigned char *context, size_t contextLength) {
+    ED25519Domain domain;
+    if (!prehashDomain(&domain, context, contextLength)) return false;
+
+    const ED25519Segment segment = {digest, SHA512_BYTES};
+    ED25519Temporaries t;
+    sign(t, signature, expanded, publicKey, &domain, &segment, 1);
+    return true;
+}
+
+bool ed25519VerifyPrehashed(const unsigned char *signature, const unsigned char *publicKey,
+                            const unsigned char *digest, const unsigned char *context, size_t contextLength) {
+    ED25519Domain domain;
+    if (!prehashDomain(&domain, context, contextLength)) return false;
+
+    const ED25519Segment segment = {digest, SHA512_BYTES};
+    ED25519Temporaries t;
+    return verify(t, signature, publicKey, &domain, &segment, 1);
+}
+
+void ed25519Wipe(void *data, size_t length) {
+    volatile unsigned char *p = static_cast<volatile unsigned char *>(data);
+    while (length--) *p++ = 0;
+}
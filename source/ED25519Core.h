@@ -0,0 +1,253 @@
+/*!
+ * @file
+ * @brief Low level ED25519 building blocks.
+ *
+ * These functions implement the ED25519 signature scheme on top of the
+ * NaCl group and scalar arithmetic. In contrast to crypto_sign() they work
+ * with an expanded secret key and hash the message in place, so neither
+ * the secret nor the message has to be hashed or copied more than needed.
+ * The signatures are identical to the ones created by crypto_sign().
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-10
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_ED25519CORE_H
+#define UBIRCH_MBED_CRYPTO_ED25519CORE_H
+
+#include <cstddef>
+#include <stdint.h>
+
+class SHA512;
+
+#define ED25519_SEED_BYTES 32
+#define ED25519_SCALAR_BYTES 32
+
+/**
+ * The size of a workspace. It holds the SHA-512 state and digest, three
+ * scalars and two points, less than 1 KB with the 32 byte field elements of
+ * the Cortex-M0 NaCl. The library does not compile if the temporaries of the
+ * NaCl build in use do not fit.
+ */
+#ifndef ED25519_WORKSPACE_BYTES
+#define ED25519_WORKSPACE_BYTES 1024
+#endif
+
+/**
+ * The expanded secret: the clamped secret scalar and the prefix used
+ * to derive the signature nonce, both derived from the 32 byte seed.
+ */
+typedef struct ED25519ExpandedKey {
+    unsigned char scalar[ED25519_SCALAR_BYTES];
+    unsigned char prefix[32];
+} ED25519ExpandedKey;
+
+/**
+ * A piece of a message that is not stored in one contiguous buffer.
+ */
+typedef struct ED25519Segment {
+    const unsigned char *data;
+    size_t length;
+} ED25519Segment;
+
+/**
+ * Check a list of segments before it is signed or verified.
+ * @param segments the message segments
+ * @param count the number of segments
+ * @return false if there are no segments or a segment that is not empty has no data
+ */
+bool ed25519ValidSegments(const ED25519Segment *segments, size_t count);
+
+/**
+ * Memory for the temporaries (hash state, scalars and points) of signing and
+ * verifying. A workspace can be used by one call at a time only.
+ *
+ * Only the temporaries of this layer move off the stack, which saves their
+ * size, not more. The NaCl group operations (ge25519_scalarmult_base(),
+ * ge25519_double_scalarmult_vartime()) and crypto_hashblocks_sha512() keep
+ * their own temporaries on the stack of the caller, so a thread that signs
+ * or verifies with a workspace still needs a few KB of stack. Moving those
+ * as well would take changes to the NaCl library.
+ */
+typedef struct ED25519Workspace {
+    uint64_t storage[(ED25519_WORKSPACE_BYTES + 7) / 8];
+} ED25519Workspace;
+
+/**
+ * Expand a secret seed (the first 32 bytes of a NaCl secret key).
+ * @param expanded the expanded key
+ * @param seed the ED25519_SEED_BYTES long seed
+ */
+void ed25519Expand(ED25519ExpandedKey *expanded, const unsigned char *seed);
+
+/**
+ * Derive the public key of an expanded secret key.
+ * @param publicKey the output buffer for the public key
+ * @param expanded the expanded secret key
+ */
+void ed25519DerivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded);
+
+/**
+ * Sign a message.
+ * @param signature the output buffer for the signature
+ * @param expanded the expanded secret key
+ * @param publicKey the public key belonging to the secret key
+ * @param message the message to sign
+ * @param length the message length
+ */
+void ed25519Sign(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                 const unsigned char *message, size_t length);
+
+/**
+ * Sign a message that consists of several segments, without concatenating them.
+ * @param signature the output buffer for the signature
+ * @param expanded the expanded secret key
+ * @param publicKey the public key belonging to the secret key
+ * @param segments the message segments, in order
+ * @param count the number of segments
+ */
+void ed25519SignSegments(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                         const ED25519Segment *segments, size_t count);
+
+/**
+ * Sign a message that consists of several segments, keeping the temporaries in a workspace.
+ * @param workspace the workspace, it is wiped afterwards
+ * @param signature the output buffer for the signature
+ * @param expanded the expanded secret key
+ * @param publicKey the public key belonging to the secret key
+ * @param segments the message segments, in order
+ * @param count the number of segments
+ */
+void ed25519SignSegments(ED25519Workspace *workspace, unsigned char *signature, const ED25519ExpandedKey *expanded,
+                         const unsigned char *publicKey, const ED25519Segment *segments, size_t count);
+
+/**
+ * Sign a message that consists of several segments, starting the nonce hash from a state
+ * that already absorbed the prefix of the expanded key, see ED25519SigningContext.
+ * @param signature the output buffer for the signature
+ * @param prefixed the SHA-512 state after update(expanded->prefix), it is copied, not changed
+ * @param expanded the expanded secret key
+ * @param publicKey the public key belonging to the secret key
+ * @param segments the message segments, in order
+ * @param count the number of segments
+ */
+void ed25519SignPrefixed(unsigned char *signature, const SHA512 &prefixed, const ED25519ExpandedKey *expanded,
+                         const unsigned char *publicKey, const ED25519Segment *segments, size_t count);
+
+/**
+ * Create a random signature nonce r = H(prefix || random) and its commitment R = rB.
+ * The nonce does not depend on the message, so the message needs to be hashed only
+ * once, for H(R || A || M). The signature is a regular ED25519 signature, but the
+ * message is not hashed into the nonce: if random ever repeats, two signatures with
+ * the same nonce reveal the private key. The random bytes must never be reused.
+ * @param nonce the output buffer for the 32 byte secret nonce r
+ * @param R the output buffer for the 32 byte commitment, the first half of the signature
+ * @param expanded the expanded secret key
+ * @param random 32 fresh random bytes
+ */
+void ed25519RandomNonce(unsigned char *nonce, unsigned char *R, const ED25519ExpandedKey *expanded,
+                        const unsigned char *random);
+
+/**
+ * Calculate the second half of a signature, S = r + H(R || A || M) * a.
+ * @param S the output buffer for the 32 byte second half of the signature
+ * @param nonce the 32 byte secret nonce r
+ * @param expanded the expanded secret key
+ * @param hram the hash calculated by ed25519Hram() or incrementally
+ */
+void ed25519SignFinish(unsigned char *S, const unsigned char *nonce, const ED25519ExpandedKey *expanded,
+                       const unsigned char *hram);
+
+/**
+ * Calculate the hash H(R || A || M) of a signature, with the message in segments.
+ * @param hram the output buffer for the 64 byte hash
+ * @param signature the signature, only R (the first 32 bytes) is used
+ * @param publicKey the public key
+ * @param segments the message segments, in order
+ * @param count the number of segments
+ */
+void ed25519Hram(unsigned char *hram, const unsigned char *signature, const unsigned char *publicKey,
+                 const ED25519Segment *segments, size_t count);
+
+/**
+ * Verify a signature, given the hash H(R || A || M). The result is the same as crypto_sign_open().
+ * @param signature the signature
+ * @param publicKey the public key
+ * @param hram the hash calculated by ed25519Hram()
+ * @return true if the signature is valid
+ */
+bool ed25519Verify(const unsigned char *signature, const unsigned char *publicKey, const unsigned char *hram);
+
+/**
+ * Verify the signature of a message that consists of several segments.
+ * @param signature the signature
+ * @param publicKey the public key
+ * @param segments the message segments, in order
+ * @param count the number of segments
+ * @return true if the signature is valid
+ */
+bool ed25519VerifySegments(const unsigned char *signature, const unsigned char *publicKey,
+                           const ED25519Segment *segments, size_t count);
+
+/**
+ * Verify the signature of a message that consists of several segments, keeping the temporaries in a workspace.
+ * @param workspace the workspace
+ * @param signature the signature
+ * @param publicKey the public key
+ * @param segments the message segments, in order
+ * @param count the number of segments
+ * @return true if the signature is valid
+ */
+bool ed25519VerifySegments(ED25519Workspace *workspace, const unsigned char *signature, const unsigned char *publicKey,
+                           const ED25519Segment *segments, size_t count);
+
+/**
+ * Sign the SHA-512 digest of a message with Ed25519ph (RFC 8032).
+ * @param signature the output buffer for the signature
+ * @param expanded the expanded secret key
+ * @param publicKey the public key belonging to the secret key
+ * @param digest the 64 byte SHA-512 digest of the message
+ * @param context the context, may be NULL if contextLength is 0
+ * @param contextLength the context length, at most 255
+ * @return false if the context is too long
+ */
+bool ed25519SignPrehashed(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                          const unsigned char *digest, const unsigned char *context, size_t contextLength);
+
+/**
+ * Verify an Ed25519ph signature (RFC 8032) of a SHA-512 digest.
+ * @param signature the signature
+ * @param publicKey the public key
+ * @param digest the 64 byte SHA-512 digest of the message
+ * @param context the context, may be NULL if contextLength is 0
+ * @param contextLength the context length, at most 255
+ * @return true if the signature is valid
+ */
+bool ed25519VerifyPrehashed(const unsigned char *signature, const unsigned char *publicKey,
+                            const unsigned char *digest, const unsigned char *context, size_t contextLength);
+
+/**
+ * Overwrite sensitive data in a way the compiler does not optimize away.
+ * @param data the data to clear
+ * @param length the length of the data
+ */
+void ed25519Wipe(void *data, size_t length);
+
+#endif //UBIRCH_MBED_CRYPTO_ED25519CORE_H
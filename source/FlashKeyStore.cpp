@@ -0,0 +1,220 @@
+/*!
+ * @file
+ * @brief Flash resident key store.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-08
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "FlashKeyStore.h"
+#include "CRC32.h"
+
+#define RECORD_SIZE     sizeof(FlashKeyRecord)
+#define RECORD_MAGIC    0x534B4255u
+#define RECORD_KEY      0x00A5u
+#define RECORD_REMOVED  0x005Au
+#define RECORD_NONE     ((size_t) -1)
+
+// the checksum covers the complete record, except for the checksum itself
+static uint32_t recordChecksum(const FlashKeyRecord *record) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(record);
+    const size_t crcOffset = offsetof(FlashKeyRecord, crc);
+    uint32_t crc = crc32(0, bytes, crcOffset);
+    return crc32(crc, bytes + crcOffset + sizeof(record->crc), RECORD_SIZE - crcOffset - sizeof(record->crc));
+}
+
+FlashKeyStore::FlashKeyStore(FlashStorage &storage) : storage(storage), mounted(false), head(0), sequence(0) {
+    for (unsigned int slot = 0; slot < FLASH_KEY_STORE_SLOTS; slot++) latest[slot] = RECORD_NONE;
+}
+
+bool FlashKeyStore::mount() {
+    mounted = false;
+
+    const size_t sector = storage.sectorSize();
+    const size_t program = storage.programSize();
+    if (storage.address() == NULL || program == 0 || sector == 0 ||
+        RECORD_SIZE % program || sector % RECORD_SIZE || storage.size() % sector ||
+        storage.size() / sector < 2 || sector / RECORD_SIZE < FLASH_KEY_STORE_SLOTS + 1)
+        return false;
+
+    // find the most recent record of every slot and the overall newest record
+    size_t newest = RECORD_NONE;
+    for (unsigned int slot = 0; slot < FLASH_KEY_STORE_SLOTS; slot++) latest[slot] = RECORD_NONE;
+    for (size_t offset = 0; offset < storage.size(); offset += RECORD_SIZE) {
+        const FlashKeyRecord *r = record(offset);
+        if (!isValid(r)) continue;
+
+        if (newest == RECORD_NONE || r->sequence > record(newest)->sequence) newest = offset;
+        if (r->slot < FLASH_KEY_STORE_SLOTS &&
+            (latest[r->slot] == RECORD_NONE || r->sequence > record(latest[r->slot])->sequence))
+            latest[r->slot] = offset;
+    }
+
+    if (newest == RECORD_NONE) {
+        head = 0;
+        sequence = 0;
+    } else {
+        head = (newest + RECORD_SIZE) % storage.size();
+        sequence = record(newest)->sequence + 1;
+    }
+
+    // finish an interrupted clean up, the sector after the head must be erased
+    mounted = reclaim((head / sector + 1) % (storage.size() / sector) * sector);
+
+    return mounted;
+}
+
+bool FlashKeyStore::format() {
+    mounted = false;
+    if (!storage.erase(0, storage.size())) return false;
+    return mount();
+}
+
+bool FlashKeyStore::store(unsigned int slot, const ED25519PublicKey &publicKey, const ED25519PrivateKey &privateKey) {
+    return write(slot, RECORD_KEY, &publicKey, &privateKey);
+}
+
+bool FlashKeyStore::generate(unsigned int slot) {
+    ED25519PublicKey publicKey;
+    ED25519PrivateKey privateKey;
+    crypto_sign_keypair(publicKey.key, privateKey.key);
+
+    bool stored = store(slot, publicKey, privateKey);
+    memset(&privateKey, 0, sizeof(privateKey));
+
+    return stored;
+}
+
+bool FlashKeyStore::remove(unsigned int slot) {
+    if (!mounted || slot >= FLASH_KEY_STORE_SLOTS) return false;
+    if (active(slot) == NULL) return true;
+
+    return write(slot, RECORD_REMOVED, NULL, NULL);
+}
+
+bool FlashKeyStore::link(unsigned int slot, ED25519KeyPair &keyPair) {
+    const FlashKeyRecord *r = active(slot);
+    if (r == NULL) return false;
+
+    keyPair.link(&r->publicKey, &r->privateKey);
+    return true;
+}
+
+const ED25519PublicKey *FlashKeyStore::getPublicKey(unsigned int slot) {
+    const FlashKeyRecord *r = active(slot);
+    return r == NULL ? NULL : &r->publicKey;
+}
+
+const ED25519PrivateKey *FlashKeyStore::getPrivateKey(unsigned int slot) {
+    const FlashKeyRecord *r = active(slot);
+    return r == NULL ? NULL : &r->privateKey;
+}
+
+const FlashKeyRecord *FlashKeyStore::record(size_t offset) {
+    return reinterpret_cast<const FlashKeyRecord *>(storage.address() + offset);
+}
+
+const FlashKeyRecord *FlashKeyStore::active(unsigned int slot) {
+    if (!mounted || slot >= FLASH_KEY_STORE_SLOTS || latest[slot] == RECORD_NONE) return NULL;
+
+    const FlashKeyRecord *r = record(latest[slot]);
+    return r->flags == RECORD_KEY ? r : NULL;
+}
+
+bool FlashKeyStore::isValid(const FlashKeyRecord *record) {
+    return record->magic == RECORD_MAGIC &&
+           (record->flags == RECORD_KEY || record->flags == RECORD_REMOVED) &&
+           record->crc == recordChecksum(record);
+}
+
+bool FlashKeyStore::isErased(size_t offset, size_t length) {
+    const unsigned char *p = storage.address() + offset;
+    for (size_t i = 0; i < length; i++) if (p[i] != 0xFF) return false;
+    return true;
+}
+
+bool FlashKeyStore::write(unsigned int slot, uint16_t flags, const ED25519PublicKey *publicKey,
+                          const ED25519PrivateKey *privateKey) {
+    if (!mounted || slot >= FLASH_KEY_STORE_SLOTS) return false;
+
+    // skip locations damaged by an interrupted write
+    while (!isErased(head, RECORD_SIZE)) if (!advance()) return false;
+
+    FlashKeyRecord r;
+    memset(&r, 0, sizeof(r));
+    r.magic = RECORD_MAGIC;
+    r.slot = static_cast<uint16_t>(slot);
+    r.flags = flags;
+    r.sequence = sequence;
+    if (publicKey != NULL) memcpy(&r.publicKey, publicKey, sizeof(r.publicKey));
+    if (privateKey != NULL) memcpy(&r.privateKey, privateKey, sizeof(r.privateKey));
+    r.crc = recordChecksum(&r);
+
+    bool written = storage.program(head, &r, RECORD_SIZE);
+    memset(&r, 0, sizeof(r));
+    if (!written) return false;
+
+    latest[slot] = head;
+    sequence++;
+
+    return advance();
+}
+
+bool FlashKeyStore::advance() {
+    head += RECORD_SIZE;
+    if (head % storage.sectorSize()) return true;
+
+    // the head moved into the (erased) next sector, make sure the one after it is free, too
+    head %= storage.size();
+    return reclaim((head + storage.sectorSize()) % storage.size());
+}
+
+bool FlashKeyStore::reclaim(size_t sectorOffset) {
+    const size_t sector = storage.sectorSize();
+    if (isErased(sectorOffset, sector)) return true;
+
+    // removed slots in this sector are simply dropped
+    size_t moves = 0;
+    for (unsigned int slot = 0; slot < FLASH_KEY_STORE_SLOTS; slot++) {
+        if (latest[slot] == RECORD_NONE || latest[slot] / sector != sectorOffset / sector) continue;
+        if (record(latest[slot])->flags == RECORD_KEY) moves++;
+        else latest[slot] = RECORD_NONE;
+    }
+
+    // the active records are moved to the head, which must stay within its sector
+    if (head % sector + moves * RECORD_SIZE >= sector || !isErased(head, moves * RECORD_SIZE)) return false;
+    for (unsigned int slot = 0; slot < FLASH_KEY_STORE_SLOTS; slot++) {
+        if (latest[slot] == RECORD_NONE || latest[slot] / sector != sectorOffset / sector) continue;
+
+        FlashKeyRecord r;
+        memcpy(&r, record(latest[slot]), RECORD_SIZE);
+        r.sequence = sequence;
+        r.crc = recordChecksum(&r);
+        bool written = storage.program(head, &r, RECORD_SIZE);
+        memset(&r, 0, sizeof(r));
+        if (!written) return false;
+
+        latest[slot] = head;
+        sequence++;
+        head += RECORD_SIZE;
+    }
+
+    return storage.erase(sectorOffset, sector);
+}
@@ -0,0 +1,171 @@
+/*!
+ * @file
+ * @brief Flash resident key store.
+ *
+ * Keeps ED25519 key pairs in fixed slots in memory mapped flash. Keys
+ * are never copied into RAM, the key pair is linked directly to the
+ * flash location using ED25519KeyPair::link().
+ *
+ * Records are appended round robin over all sectors of the storage area,
+ * so every sector is erased equally often. One sector is always kept
+ * erased, the still valid records of the oldest sector are moved to the
+ * head before it is erased.
+ *
+ * A record does not stay in place: every store(), generate() or remove()
+ * appends a new record and may move and erase older ones. Pointers into
+ * the flash, including linked key pairs, are only valid until the next
+ * write and must be linked again after it.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-08
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_FLASHKEYSTORE_H
+#define UBIRCH_MBED_CRYPTO_FLASHKEYSTORE_H
+
+#include "FlashStorage.h"
+#include "KeyPair.h"
+
+#ifndef FLASH_KEY_STORE_SLOTS
+#define FLASH_KEY_STORE_SLOTS 4
+#endif
+
+/**
+ * The on-flash record of a key slot. The size is a multiple of all common
+ * flash program sizes, the keys can be linked in place.
+ */
+typedef struct FlashKeyRecord {
+    uint32_t magic;
+    uint16_t slot;
+    uint16_t flags;
+    uint32_t sequence;
+    uint32_t crc;
+    ED25519PublicKey publicKey;
+    ED25519PrivateKey privateKey;
+    unsigned char reserved[16];
+} FlashKeyRecord;
+
+/**
+ * A wear levelled key store with fixed slots in memory mapped flash.
+ *
+ * @code
+ * FlashIAPStorage storage(0x3C000, 0x4000);
+ * FlashKeyStore store(storage);
+ * if (!store.mount()) store.format();
+ *
+ * ED25519KeyPair keyPair;
+ * if (!store.link(0, keyPair)) {
+ *     store.generate(0);
+ *     store.link(0, keyPair);
+ * }
+ * @endcode
+ */
+class FlashKeyStore {
+public:
+    /**
+     * Create a key store on top of the storage area. The storage area needs at
+     * least two sectors and each sector must hold more records than there are slots.
+     * @param storage the storage area to use
+     */
+    FlashKeyStore(FlashStorage &storage);
+
+    /**
+     * Scan the storage area and find the most recent record of each slot.
+     * @return false if the storage geometry is not supported or it could not be repaired
+     */
+    bool mount();
+
+    /**
+     * Erase the complete storage area, removing all keys.
+     * @return true if the storage was erased
+     */
+    bool format();
+
+    /**
+     * Store a key pair in a slot, replacing an existing key pair.
+     * @param slot the slot number
+     * @param publicKey the public key
+     * @param privateKey the private key
+     * @return true if the key pair was written
+     */
+    bool store(unsigned int slot, const ED25519PublicKey &publicKey, const ED25519PrivateKey &privateKey);
+
+    /**
+     * Generate a new key pair directly into a slot, replacing an existing key pair.
+     * @param slot the slot number
+     * @return true if the key pair was generated and written
+     */
+    bool generate(unsigned int slot);
+
+    /**
+     * Remove the key pair in a slot.
+     * @param slot the slot number
+     * @return true if the slot is empty now
+     */
+    bool remove(unsigned int slot);
+
+    /**
+     * Link a key pair to the keys stored in a slot. No key material is copied.
+     * The link is valid until the next store(), generate() or remove() on this
+     * store, any of them may move or erase the record. Link again after a write.
+     * @param slot the slot number
+     * @param keyPair the key pair to link
+     * @return false if the slot is empty
+     */
+    bool link(unsigned int slot, ED25519KeyPair &keyPair);
+
+    /**
+     * Get the public key stored in a slot.
+     * @param slot the slot number
+     * @return a pointer into the flash, valid until the next write, or NULL if the slot is empty
+     */
+    const ED25519PublicKey *getPublicKey(unsigned int slot);
+
+    /**
+     * Get the private key stored in a slot.
+     * @param slot the slot number
+     * @return a pointer into the flash, valid until the next write, or NULL if the slot is empty
+     */
+    const ED25519PrivateKey *getPrivateKey(unsigned int slot);
+
+private:
+    FlashStorage &storage;
+    bool mounted;
+    size_t head;
+    uint32_t sequence;
+    size_t latest[FLASH_KEY_STORE_SLOTS];
+
+    const FlashKeyRecord *record(size_t offset);
+
+    const FlashKeyRecord *active(unsigned int slot);
+
+    bool isValid(const FlashKeyRecord *record);
+
+    bool isErased(size_t offset, size_t length);
+
+    bool write(unsigned int slot, uint16_t flags, const ED25519PublicKey *publicKey,
+               const ED25519PrivateKey *privateKey);
+
+    bool advance();
+
+    bool reclaim(size_t sectorOffset);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_FLASHKEYSTORE_H
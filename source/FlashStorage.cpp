@@ -0,0 +1,147 @@
+/*!
+ * @file
+ * @brief Memory mapped flash storage implementations.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-08
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "FlashStorage.h"
+
+#if DEVICE_FLASH
+
+FlashIAPStorage::FlashIAPStorage(uint32_t start, size_t size) : start(start), length(size) {
+    flash.init();
+}
+
+FlashIAPStorage::~FlashIAPStorage() {
+    flash.deinit();
+}
+
+const unsigned char *FlashIAPStorage::address() {
+    return reinterpret_cast<const unsigned char *>(start);
+}
+
+size_t FlashIAPStorage::size() {
+    return length;
+}
+
+size_t FlashIAPStorage::sectorSize() {
+    return flash.get_sector_size(start);
+}
+
+size_t FlashIAPStorage::programSize() {
+    return flash.get_page_size();
+}
+
+bool FlashIAPStorage::erase(size_t offset, size_t length) {
+    if (offset + length > this->length) return false;
+    return flash.erase(start + offset, length) == 0;
+}
+
+bool FlashIAPStorage::program(size_t offset, const void *data, size_t length) {
+    if (offset + length > this->length) return false;
+    return flash.program(data, start + offset, length) == 0;
+}
+
+#endif
+
+#ifndef __MBED__
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+FileFlashStorage::FileFlashStorage(const char *path, size_t size, size_t sectorSize, size_t programSize)
+        : fd(-1), mapped(NULL), length(size), sector(sectorSize), page(programSize) {
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) return;
+
+    // a new (or too short) file is erased first, like fresh flash
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    void *map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    mapped = static_cast<unsigned char *>(map);
+    if (static_cast<size_t>(st.st_size) < length) {
+        size_t erased = static_cast<size_t>(st.st_size) / sector * sector;
+        erase(erased, length - erased);
+    }
+}
+
+FileFlashStorage::~FileFlashStorage() {
+    if (mapped != NULL) munmap(mapped, length);
+    if (fd >= 0) close(fd);
+}
+
+bool FileFlashStorage::isOpen() {
+    return mapped != NULL;
+}
+
+const unsigned char *FileFlashStorage::address() {
+    return mapped;
+}
+
+size_t FileFlashStorage::size() {
+    return length;
+}
+
+size_t FileFlashStorage::sectorSize() {
+    return sector;
+}
+
+size_t FileFlashStorage::programSize() {
+    return page;
+}
+
+bool FileFlashStorage::erase(size_t offset, size_t length) {
+    if (mapped == NULL || offset % sector || length % sector || offset + length > this->length) return false;
+
+    unsigned char *erased = new unsigned char[sector];
+    memset(erased, 0xFF, sector);
+    bool success = true;
+    for (size_t pos = offset; success && pos < offset + length; pos += sector) {
+        success = pwrite(fd, erased, sector, static_cast<off_t>(pos)) == static_cast<ssize_t>(sector);
+    }
+    delete[] erased;
+
+    return success;
+}
+
+bool FileFlashStorage::program(size_t offset, const void *data, size_t length) {
+    if (mapped == NULL || offset % page || length % page || offset + length > this->length) return false;
+
+    // flash can only be programmed once after an erase
+    for (size_t i = 0; i < length; i++) if (mapped[offset + i] != 0xFF) return false;
+
+    return pwrite(fd, data, length, static_cast<off_t>(offset)) == static_cast<ssize_t>(length);
+}
+
+#endif
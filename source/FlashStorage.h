@@ -0,0 +1,174 @@
+/*!
+ * @file
+ * @brief Memory mapped flash storage abstraction.
+ *
+ * The key store keeps keys in memory mapped flash and hands out pointers
+ * directly into it. This header abstracts the flash area, so the same code
+ * runs on the device (internal flash via FlashIAP) and on a host, where a
+ * memory mapped file stands in for the flash.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-08
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_FLASHSTORAGE_H
+#define UBIRCH_MBED_CRYPTO_FLASHSTORAGE_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#ifdef __MBED__
+#include "mbed.h"
+#endif
+
+/**
+ * A memory mapped flash area. Reads happen directly through the mapped
+ * address, only erase and program go through this interface.
+ *
+ * Like NOR flash, an erased area reads as 0xFF and a location can be
+ * programmed once before it has to be erased again.
+ */
+class FlashStorage {
+public:
+    virtual ~FlashStorage() {};
+
+    /**
+     * Get the memory mapped start address of the storage area.
+     * @return a pointer to the first byte of the storage area
+     */
+    virtual const unsigned char *address() = 0;
+
+    /**
+     * @return the size of the storage area in bytes
+     */
+    virtual size_t size() = 0;
+
+    /**
+     * @return the size of an erasable sector in bytes
+     */
+    virtual size_t sectorSize() = 0;
+
+    /**
+     * @return the minimum size and alignment of a program operation in bytes
+     */
+    virtual size_t programSize() = 0;
+
+    /**
+     * Erase sectors of the storage area.
+     * @param offset the sector aligned offset into the storage area
+     * @param length the number of bytes to erase, a multiple of the sector size
+     * @return true if the area was erased
+     */
+    virtual bool erase(size_t offset, size_t length) = 0;
+
+    /**
+     * Program data into an erased part of the storage area.
+     * @param offset the program size aligned offset into the storage area
+     * @param data the data to write
+     * @param length the number of bytes to write, a multiple of the program size
+     * @return true if the data was written
+     */
+    virtual bool program(size_t offset, const void *data, size_t length) = 0;
+};
+
+#if DEVICE_FLASH
+
+/**
+ * Internal flash of the device, accessed using the mbed FlashIAP driver.
+ */
+class FlashIAPStorage : public FlashStorage {
+public:
+    /**
+     * Use a region of the internal flash as storage.
+     * @param start the sector aligned start address of the region
+     * @param size the size of the region, a multiple of the sector size
+     */
+    FlashIAPStorage(uint32_t start, size_t size);
+
+    ~FlashIAPStorage();
+
+    const unsigned char *address();
+
+    size_t size();
+
+    size_t sectorSize();
+
+    size_t programSize();
+
+    bool erase(size_t offset, size_t length);
+
+    bool program(size_t offset, const void *data, size_t length);
+
+private:
+    FlashIAP flash;
+    uint32_t start;
+    size_t length;
+};
+
+#endif
+
+#ifndef __MBED__
+
+/**
+ * A file that stands in for flash on a host. The file is memory mapped
+ * read-only, erase and program write through the file descriptor. Programming
+ * an area that is not erased fails, just like on the real flash.
+ */
+class FileFlashStorage : public FlashStorage {
+public:
+    /**
+     * Create a file backed storage area.
+     * @param path the file to use, it will be created and erased if it does not exist
+     * @param size the size of the storage area
+     * @param sectorSize the emulated sector size
+     * @param programSize the emulated program size
+     */
+    FileFlashStorage(const char *path, size_t size, size_t sectorSize = 4096, size_t programSize = 8);
+
+    ~FileFlashStorage();
+
+    /**
+     * @return true if the file could be opened and mapped
+     */
+    bool isOpen();
+
+    const unsigned char *address();
+
+    size_t size();
+
+    size_t sectorSize();
+
+    size_t programSize();
+
+    bool erase(size_t offset, size_t length);
+
+    bool program(size_t offset, const void *data, size_t length);
+
+private:
+    int fd;
+    unsigned char *mapped;
+    size_t length;
+    size_t sector;
+    size_t page;
+};
+
+#endif
+
+#endif //UBIRCH_MBED_CRYPTO_FLASHSTORAGE_H
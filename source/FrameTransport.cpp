@@ -0,0 +1,241 @@
+/*!
+ * @file
+ * @brief Framed binary transport with credit based flow control.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-18
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "FrameTransport.h"
+#include "CRC32.h"
+
+#ifdef __MBED__
+
+SerialFrameStream::SerialFrameStream(PinName tx, PinName rx, int baud) : serial(tx, rx, baud), overrunCount(0) {
+    serial.attach(callback(this, &SerialFrameStream::receiveInterrupt), Serial::RxIrq);
+}
+
+void SerialFrameStream::receiveInterrupt() {
+    while (serial.readable()) {
+        const unsigned char c = static_cast<unsigned char>(serial.getc());
+        if (buffer.full()) overrunCount++;
+        else buffer.push(c);
+    }
+}
+
+size_t SerialFrameStream::read(unsigned char *data, size_t length, uint32_t timeout) {
+    Timer timer;
+    timer.start();
+    while (buffer.empty() && static_cast<uint32_t>(timer.read_ms()) < timeout) wait_ms(1);
+
+    size_t n = 0;
+    while (n < length && buffer.pop(data[n])) n++;
+    return n;
+}
+
+bool SerialFrameStream::write(const unsigned char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) serial.putc(data[i]);
+    return true;
+}
+
+#else
+
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+
+FileFrameStream::FileFrameStream(int fd) : fd(fd) {}
+
+size_t FileFrameStream::read(unsigned char *data, size_t length, uint32_t timeout) {
+    struct pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    p.revents = 0;
+    if (poll(&p, 1, static_cast<int>(timeout)) <= 0) return 0;
+
+    const ssize_t n = ::read(fd, data, length);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+bool FileFrameStream::write(const unsigned char *data, size_t length) {
+    while (length > 0) {
+        const ssize_t n = ::write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#endif
+
+// sequence numbers wrap around, a is before b if the distance is less than half the range
+#define SEQUENCE_BEFORE(a, b) (static_cast<uint8_t>((b) - (a)) != 0 && static_cast<uint8_t>((b) - (a)) < 0x80)
+
+FrameTransport::FrameTransport(FrameStream &stream)
+        : stream(stream), txSequence(0), txLimit(0), rxSequence(0), rxGranted(0), slotHead(0), slotCount(0),
+          frameLength(0), errorCount(0), lostCount(0) {}
+
+void FrameTransport::begin() {
+    grant(true);
+}
+
+bool FrameTransport::send(const unsigned char *payload, size_t length, uint32_t timeout) {
+    if (length > FRAME_MAX_PAYLOAD) return false;
+
+    uint32_t idle = 0;
+    while (!SEQUENCE_BEFORE(txSequence, txLimit)) {
+        if (poll(FRAME_IDLE_TIMEOUT)) continue;
+        idle += FRAME_IDLE_TIMEOUT;
+        if (idle >= timeout) return false;
+        // the other side may be waiting for our credit just as well
+        grant(true);
+    }
+
+    return writeFrame(FRAME_DATA, txSequence++, payload, length);
+}
+
+int FrameTransport::receive(unsigned char *payload, size_t maxLength, uint32_t timeout) {
+    uint32_t idle = 0;
+    while (slotCount == 0) {
+        const uint32_t wait = timeout < FRAME_IDLE_TIMEOUT ? timeout : FRAME_IDLE_TIMEOUT;
+        if (poll(wait)) continue;
+        idle += wait;
+        if (idle >= timeout) return -1;
+        // our last credit may have been lost
+        grant(true);
+    }
+
+    const size_t length = slotLength[slotHead];
+    memcpy(payload, slots[slotHead], length < maxLength ? length : maxLength);
+    slotHead = (slotHead + 1) % FRAME_WINDOW;
+    slotCount--;
+    grant(false);
+
+    return static_cast<int>(length);
+}
+
+bool FrameTransport::writeFrame(uint8_t type, uint8_t sequence, const unsigned char *payload, size_t length) {
+    unsigned char header[FRAME_HEADER_BYTES] = {
+            FRAME_SYNC, type, sequence,
+            static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length)
+    };
+    uint32_t crc = crc32(0, header + 1, FRAME_HEADER_BYTES - 1);
+    crc = crc32(crc, payload, length);
+    const unsigned char trailer[FRAME_CRC_BYTES] = {
+            static_cast<unsigned char>(crc >> 24), static_cast<unsigned char>(crc >> 16),
+            static_cast<unsigned char>(crc >> 8), static_cast<unsigned char>(crc)
+    };
+
+    return stream.write(header, sizeof(header)) &&
+           (length == 0 || stream.write(payload, length)) &&
+           stream.write(trailer, sizeof(trailer));
+}
+
+void FrameTransport::grant(bool repeat) {
+    const uint8_t limit = static_cast<uint8_t>(rxSequence + FRAME_WINDOW - slotCount);
+    if (limit == rxGranted && !repeat) return;
+
+    rxGranted = limit;
+    writeFrame(FRAME_CREDIT, 0, &limit, 1);
+}
+
+bool FrameTransport::poll(uint32_t timeout) {
+    unsigned char buffer[64];
+    const size_t n = stream.read(buffer, sizeof(buffer), timeout);
+    for (size_t i = 0; i < n; i++) parse(buffer[i]);
+    return n > 0;
+}
+
+void FrameTransport::parse(unsigned char byte) {
+    if (frameLength == 0 && byte != FRAME_SYNC) return;
+    frame[frameLength++] = byte;
+
+    // a broken frame may hide the start of the next one, check what is left after dropping it
+    while (frameLength > 1) {
+        if (frame[0] != FRAME_SYNC) {
+            // skip to the next possible frame start
+            size_t start = 1;
+            while (start < frameLength && frame[start] != FRAME_SYNC) start++;
+            frameLength -= start;
+            memmove(frame, frame + start, frameLength);
+            continue;
+        }
+
+        const uint8_t type = frame[1];
+        if (type != FRAME_DATA && type != FRAME_CREDIT) {
+            resync();
+            continue;
+        }
+        if (frameLength < FRAME_HEADER_BYTES) return;
+
+        const size_t length = (static_cast<size_t>(frame[3]) << 8) | frame[4];
+        if (length > FRAME_MAX_PAYLOAD || (type == FRAME_CREDIT && length != 1)) {
+            resync();
+            continue;
+        }
+        const size_t total = FRAME_HEADER_BYTES + length + FRAME_CRC_BYTES;
+        if (frameLength < total) return;
+
+        const unsigned char *trailer = frame + FRAME_HEADER_BYTES + length;
+        const uint32_t crc = (static_cast<uint32_t>(trailer[0]) << 24) | (static_cast<uint32_t>(trailer[1]) << 16) |
+                             (static_cast<uint32_t>(trailer[2]) << 8) | trailer[3];
+        if (crc != crc32(0, frame + 1, FRAME_HEADER_BYTES - 1 + length)) {
+            resync();
+            continue;
+        }
+
+        process(type, frame[2], frame + FRAME_HEADER_BYTES, length);
+        frameLength -= total;
+        memmove(frame, frame + total, frameLength);
+    }
+}
+
+void FrameTransport::resync() {
+    // drop the sync byte of the broken frame, parse() skips ahead to the next one
+    errorCount++;
+    frameLength--;
+    memmove(frame, frame + 1, frameLength);
+}
+
+void FrameTransport::process(uint8_t type, uint8_t sequence, const unsigned char *payload, size_t length) {
+    if (type == FRAME_CREDIT) {
+        // ignore credits that are older than what we already sent
+        if (SEQUENCE_BEFORE(txSequence, payload[0]) || payload[0] == txSequence) txLimit = payload[0];
+        return;
+    }
+
+    // drop repeated frames and frames sent without credit
+    if (SEQUENCE_BEFORE(sequence, rxSequence)) return;
+    if (slotCount == FRAME_WINDOW) {
+        errorCount++;
+        return;
+    }
+
+    lostCount += static_cast<uint8_t>(sequence - rxSequence);
+    rxSequence = static_cast<uint8_t>(sequence + 1);
+
+    const size_t slot = (slotHead + slotCount) % FRAME_WINDOW;
+    memcpy(slots[slot], payload, length);
+    slotLength[slot] = length;
+    slotCount++;
+}
@@ -0,0 +1,239 @@
+/*!
+ * @file
+ * @brief Framed binary transport with credit based flow control.
+ *
+ * Binary data is sent in frames instead of Base64 slices:
+ *
+ * ```
+ * [0x7E | type | seq | length (2, big endian) | payload | CRC-32 (4, big endian)]
+ * ```
+ *
+ * The CRC-32 covers type, seq, length and payload. A receiver that sees a
+ * broken frame searches for the next 0x7E and continues from there.
+ *
+ * Flow control works with credits: the receiver tells the sender the
+ * sequence number up to which it may send (a CREDIT frame), based on the
+ * free frame buffers. The sender never sends more frames than the receiver
+ * can hold, so nothing gets lost while the device is busy. Lost credit
+ * frames are repeated while the receiver waits. The host side lives in
+ * TESTS/host_tests/framing.py.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-18
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_FRAMETRANSPORT_H
+#define UBIRCH_MBED_CRYPTO_FRAMETRANSPORT_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#ifdef __MBED__
+#include "mbed.h"
+#endif
+
+#define FRAME_SYNC 0x7E
+#define FRAME_DATA 0x44
+#define FRAME_CREDIT 0x43
+#define FRAME_HEADER_BYTES 5
+#define FRAME_CRC_BYTES 4
+
+/** The largest payload of a frame. */
+#ifndef FRAME_MAX_PAYLOAD
+#define FRAME_MAX_PAYLOAD 256
+#endif
+
+/** The number of received frames that can be buffered, the credit window. */
+#ifndef FRAME_WINDOW
+#define FRAME_WINDOW 2
+#endif
+
+/** How long to wait for data before repeating a credit, in milliseconds. */
+#ifndef FRAME_IDLE_TIMEOUT
+#define FRAME_IDLE_TIMEOUT 100
+#endif
+
+/**
+ * A byte stream carrying the frames, e.g. a serial port.
+ */
+class FrameStream {
+public:
+    virtual ~FrameStream() {};
+
+    /**
+     * Read the bytes that are available, waiting for at least one byte.
+     * @param data the buffer for the data
+     * @param length the size of the buffer
+     * @param timeout the time to wait for data in milliseconds
+     * @return the number of bytes read, 0 if nothing arrived in time
+     */
+    virtual size_t read(unsigned char *data, size_t length, uint32_t timeout) = 0;
+
+    /**
+     * Write all bytes to the stream.
+     * @param data the data to write
+     * @param length the number of bytes to write
+     * @return true if the data was written
+     */
+    virtual bool write(const unsigned char *data, size_t length) = 0;
+};
+
+#ifdef __MBED__
+
+/** The size of the interrupt driven receive buffer. */
+#ifndef FRAME_SERIAL_BUFFER
+#define FRAME_SERIAL_BUFFER 64
+#endif
+
+/**
+ * A serial port of the device. Received bytes are collected in an interrupt
+ * driven buffer until the transport reads them.
+ */
+class SerialFrameStream : public FrameStream {
+public:
+    /**
+     * Open a serial port.
+     * @param tx the transmit pin
+     * @param rx the receive pin
+     * @param baud the baud rate
+     */
+    SerialFrameStream(PinName tx, PinName rx, int baud = 115200);
+
+    size_t read(unsigned char *data, size_t length, uint32_t timeout);
+
+    bool write(const unsigned char *data, size_t length);
+
+    /**
+     * @return the number of bytes lost because the receive buffer was full
+     */
+    uint32_t overruns() const { return overrunCount; }
+
+private:
+    RawSerial serial;
+    CircularBuffer<unsigned char, FRAME_SERIAL_BUFFER> buffer;
+    volatile uint32_t overrunCount;
+
+    void receiveInterrupt();
+};
+
+#else
+
+/**
+ * A file descriptor on a host, e.g. a tty or one side of a pty pair.
+ */
+class FileFrameStream : public FrameStream {
+public:
+    /**
+     * Use an open file descriptor, it is not closed by the stream.
+     * @param fd the file descriptor
+     */
+    FileFrameStream(int fd);
+
+    size_t read(unsigned char *data, size_t length, uint32_t timeout);
+
+    bool write(const unsigned char *data, size_t length);
+
+private:
+    int fd;
+};
+
+#endif
+
+/**
+ * Sends and receives frames over a stream.
+ *
+ * @code
+ * SerialFrameStream stream(USBTX, USBRX);
+ * FrameTransport transport(stream);
+ * transport.begin();
+ * transport.send(signedMessage, sizeof(signedMessage), 1000);
+ * int length = transport.receive(buffer, sizeof(buffer), 1000);
+ * @endcode
+ */
+class FrameTransport {
+public:
+    /**
+     * Create a transport on top of a stream.
+     * @param stream the stream to use
+     */
+    FrameTransport(FrameStream &stream);
+
+    /**
+     * Announce the receive window to the other side.
+     */
+    void begin();
+
+    /**
+     * Send a frame, waiting for credit if the other side is busy.
+     * @param payload the payload
+     * @param length the payload length, at most FRAME_MAX_PAYLOAD
+     * @param timeout the time to wait for credit, in milliseconds
+     * @return false if the payload is too large or no credit arrived in time
+     */
+    bool send(const unsigned char *payload, size_t length, uint32_t timeout);
+
+    /**
+     * Receive the next frame.
+     * @param payload the buffer for the payload
+     * @param maxLength the size of the buffer, payloads that do not fit are cut off
+     * @param timeout the time to wait while nothing arrives, in milliseconds
+     * @return the payload length, -1 if no frame arrived in time
+     */
+    int receive(unsigned char *payload, size_t maxLength, uint32_t timeout);
+
+    /** @return the number of frames dropped because of a wrong checksum or length */
+    uint32_t errors() const { return errorCount; }
+
+    /** @return the number of frames that never arrived, found by the gaps in the sequence */
+    uint32_t lost() const { return lostCount; }
+
+private:
+    FrameStream &stream;
+
+    uint8_t txSequence;
+    uint8_t txLimit;
+
+    uint8_t rxSequence;
+    uint8_t rxGranted;
+    unsigned char slots[FRAME_WINDOW][FRAME_MAX_PAYLOAD];
+    size_t slotLength[FRAME_WINDOW];
+    size_t slotHead;
+    size_t slotCount;
+
+    unsigned char frame[FRAME_HEADER_BYTES + FRAME_MAX_PAYLOAD + FRAME_CRC_BYTES];
+    size_t frameLength;
+
+    uint32_t errorCount;
+    uint32_t lostCount;
+
+    bool writeFrame(uint8_t type, uint8_t sequence, const unsigned char *payload, size_t length);
+
+    void grant(bool repeat);
+
+    bool poll(uint32_t timeout);
+
+    void parse(unsigned char byte);
+
+    void resync();
+
+    void process(uint8_t type, uint8_t sequence, const unsigned char *payload, size_t length);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_FRAMETRANSPORT_H
@@ -26,39 +26,118 @@
  */
 
 #include "KeyPair.h"
+#include "ED25519Backend.h"
+#include "CryptoStats.h"
 
-ED25519KeyPair::ED25519KeyPair() : KeyPair(), generated(false) {}
+ED25519KeyPair::ED25519KeyPair() : KeyPair(), seed(NULL), cache(NULL), generated(false) {}
 
 ED25519KeyPair::~ED25519KeyPair() {
+    if (cache != NULL && publicKey == &cache->publicKey) publicKey = NULL;
     if (generated) {
         delete privateKey;
         delete publicKey;
     }
+    if (cache != NULL) {
+        ed25519Wipe(cache, sizeof(ED25519KeyCache));
+        delete cache;
+    }
 }
 
 void ED25519KeyPair::generate() {
+    CRYPTO_STATS(CRYPTO_STATS_GENERATE);
     generated = true;
+    invalidate();
 
     publicKey = new ED25519PublicKey();
     privateKey = new ED25519PrivateKey();
     memset(publicKey->key, 0, sizeof(ED25519PublicKey));
     memset(privateKey->key, 0, sizeof(ED25519PrivateKey));
-
-    crypto_sign_keypair(publicKey->key, privateKey->key);
+    CRYPTO_STATS_ALLOCATED(sizeof(ED25519PublicKey) + sizeof(ED25519PrivateKey));
+
+    // the same as crypto_sign_keypair(), with the arithmetic of the selected backend
+    ED25519ExpandedKey expanded;
+    randombytes(privateKey->key, ED25519_SEED_BYTES);
+    ed25519Expand(&expanded, privateKey->key);
+    ED25519DefaultBackend::derivePublicKey(publicKey->key, &expanded);
+    memcpy(privateKey->key + ED25519_SEED_BYTES, publicKey->key, crypto_sign_PUBLICKEYBYTES);
+    ed25519Wipe(&expanded, sizeof(expanded));
 }
 
 ED25519PublicKey *ED25519KeyPair::getPublicKey() {
+    // in seed mode the public key is derived when it is needed
+    if (publicKey == NULL && seed != NULL) expand();
     return publicKey;
 }
 
 void ED25519KeyPair::link(const ED25519PublicKey *publicKey, const ED25519PrivateKey *privateKey) {
+    invalidate();
     this->publicKey = const_cast<ED25519PublicKey *>(publicKey);
     this->privateKey = const_cast<ED25519PrivateKey *>(privateKey);
 }
 
+void ED25519KeyPair::linkSeed(const ED25519Seed *seed) {
+    invalidate();
+    this->seed = seed;
+}
+
+bool ED25519KeyPair::importSeed(const unsigned char *seed, int length) {
+    if (seed == NULL || length != ED25519_SEED_BYTES) return false;
+
+    invalidate();
+    if (cache == NULL) {
+        cache = new ED25519KeyCache();
+        CRYPTO_STATS_ALLOCATED_TO(CRYPTO_STATS_GENERATE, sizeof(ED25519KeyCache));
+    }
+    memcpy(cache->seed.seed, seed, ED25519_SEED_BYTES);
+    this->seed = &cache->seed;
+
+    return true;
+}
+
+const ED25519KeyCache *ED25519KeyPair::expand() {
+    if (cache != NULL && cache->valid) return cache;
+
+    const unsigned char *secret = seed != NULL ? seed->seed : (privateKey != NULL ? privateKey->key : NULL);
+    if (secret == NULL) return NULL;
+
+    if (cache == NULL) {
+        cache = new ED25519KeyCache();
+        CRYPTO_STATS_ALLOCATED_TO(CRYPTO_STATS_GENERATE, sizeof(ED25519KeyCache));
+    }
+    ed25519Expand(&cache->expanded, secret);
+    if (seed != NULL) {
+        ED25519DefaultBackend::derivePublicKey(cache->publicKey.key, &cache->expanded);
+        if (publicKey == NULL) publicKey = &cache->publicKey;
+    } else {
+        // the NaCl secret key carries the public key in its second half
+        memcpy(cache->publicKey.key, privateKey->key + ED25519_SEED_BYTES, crypto_sign_PUBLICKEYBYTES);
+    }
+    cache->valid = true;
+
+    return cache;
+}
+
+void ED25519KeyPair::invalidate() {
+    if (cache == NULL) {
+        seed = NULL;
+        return;
+    }
+    if (publicKey == &cache->publicKey) publicKey = NULL;
+    // an imported seed is kept in the cache, it is dropped with everything else
+    seed = NULL;
+    ed25519Wipe(cache, sizeof(ED25519KeyCache));
+}
+
 void ED25519KeyPair::import(const ED25519PublicKey &publicKey, const ED25519PrivateKey &privateKey) {
-    if (this->publicKey == NULL) this->publicKey = new ED25519PublicKey();
-    if (this->privateKey == NULL) this->privateKey = new ED25519PrivateKey();
+    invalidate();
+    if (this->publicKey == NULL) {
+        this->publicKey = new ED25519PublicKey();
+        CRYPTO_STATS_ALLOCATED_TO(CRYPTO_STATS_GENERATE, sizeof(ED25519PublicKey));
+    }
+    if (this->privateKey == NULL) {
+        this->privateKey = new ED25519PrivateKey();
+        CRYPTO_STATS_ALLOCATED_TO(CRYPTO_STATS_GENERATE, sizeof(ED25519PrivateKey));
+    }
 
     memcpy(this->publicKey->key, publicKey.key, crypto_sign_PUBLICKEYBYTES);
     memcpy(this->privateKey->key, privateKey.key, crypto_sign_SECRETKEYBYTES);
@@ -67,48 +146,94 @@ void ED25519KeyPair::import(const ED25519PublicKey &publicKey, const ED25519Priv
 }
 
 ED25519Signature *ED25519KeyPair::sign(const unsigned char *message, size_t length) {
-    if (privateKey == NULL) return NULL;
+    CRYPTO_STATS(CRYPTO_STATS_SIGN);
+    const ED25519KeyCache *keys = expand();
+    if (keys == NULL) {
+        CRYPTO_STATS_FAILED();
+        return NULL;
+    }
+
+    // sign the message in place, using the cached expanded secret
+    ED25519Signature *signature = new ED25519Signature;
+    CRYPTO_STATS_ALLOCATED(sizeof(ED25519Signature));
+    const ED25519Segment segment = {message, length};
+    ED25519DefaultBackend::sign(signature->signature, &keys->expanded, keys->publicKey.key, &segment, 1);
 
-    // sign the message
-    crypto_uint16 signedLength;
-    unsigned char *signedMessage = new unsigned char[crypto_sign_BYTES + length];
-    crypto_sign(signedMessage, &signedLength,
-                reinterpret_cast<const unsigned char *>(message), static_cast<crypto_uint16>(length),
-                privateKey->key);
+    return signature;
+}
+
+ED25519Signature *ED25519KeyPair::sign(const unsigned char *message, size_t length, ED25519Workspace &workspace) {
+    CRYPTO_STATS(CRYPTO_STATS_SIGN);
+    const ED25519KeyCache *keys = expand();
+    if (keys == NULL) {
+        CRYPTO_STATS_FAILED();
+        return NULL;
+    }
 
-    // extract the signature
     ED25519Signature *signature = new ED25519Signature;
-    memcpy(signature->signature, signedMessage, crypto_sign_BYTES);
-    delete[] signedMessage;
+    CRYPTO_STATS_ALLOCATED(sizeof(ED25519Signature));
+    const ED25519Segment segment = {message, length};
+    ed25519SignSegments(&workspace, signature->signature, &keys->expanded, keys->publicKey.key, &segment, 1);
 
     return signature;
 }
 
-bool ED25519KeyPair::verify(const unsigned char *message, size_t length, const ED25519Signature *signature) {
-    if(publicKey == NULL) return false;
-    if ((message == NULL) || (length == 0) || (signature == NULL)) return false;
+ED25519Signature *ED25519KeyPair::sign(const ED25519Segment *segments, size_t count) {
+    CRYPTO_STATS(CRYPTO_STATS_SIGN);
+    const ED25519KeyCache *keys = expand();
+    if (keys == NULL || !ed25519ValidSegments(segments, count)) {
+        CRYPTO_STATS_FAILED();
+        return NULL;
+    }
 
-    // allocate signed message buffer and verificationBuffer (both must be length + signature length!)
-    // internally the NaCl library uses the verification buffer as a playground
-    const size_t signedMessageLength = crypto_sign_BYTES + length;
-    unsigned char *signedMessage = new unsigned char[signedMessageLength];
-    unsigned char *verifiedMessage = new unsigned char[signedMessageLength];
+    ED25519Signature *signature = new ED25519Signature;
+    CRYPTO_STATS_ALLOCATED(sizeof(ED25519Signature));
+    ED25519DefaultBackend::sign(signature->signature, &keys->expanded, keys->publicKey.key, segments, count);
 
-    memcpy(signedMessage, signature->signature, crypto_sign_BYTES);
-    memcpy(signedMessage + crypto_sign_BYTES, message, length);
-    memset(verifiedMessage, 0, signedMessageLength);
+    return signature;
+}
 
-    crypto_uint16 verifiedMessageLength;
-    bool sigVerified = !crypto_sign_open(verifiedMessage, &verifiedMessageLength,
-                                        signedMessage, static_cast<crypto_uint16>(crypto_sign_BYTES + length),
-                                        publicKey->key);
+bool ED25519KeyPair::verify(const unsigned char *message, size_t length, const ED25519Signature *signature) {
+    CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+    if (publicKey == NULL || (message == NULL) || (length == 0) || (signature == NULL)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
 
-    bool msgVerified = verifiedMessageLength == length && !memcmp(message, verifiedMessage, length);
+    const ED25519Segment segment = {message, length};
+    if (!ED25519DefaultBackend::verify(signature->signature, publicKey->key, &segment, 1)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+    return true;
+}
 
-    delete[] signedMessage;
-    delete[] verifiedMessage;
+bool ED25519KeyPair::verify(const unsigned char *message, size_t length, const ED25519Signature *signature,
+                            ED25519Workspace &workspace) {
+    CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+    if (publicKey == NULL || (message == NULL) || (length == 0) || (signature == NULL)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
 
-    return sigVerified && msgVerified;
+    const ED25519Segment segment = {message, length};
+    if (!ed25519VerifySegments(&workspace, signature->signature, publicKey->key, &segment, 1)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+    return true;
 }
 
+bool ED25519KeyPair::verify(const ED25519Segment *segments, size_t count, const ED25519Signature *signature) {
+    CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+    if (publicKey == NULL || !ed25519ValidSegments(segments, count) || signature == NULL) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
 
+    if (!ED25519DefaultBackend::verify(signature->signature, publicKey->key, segments, count)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+    return true;
+}
@@ -32,10 +32,15 @@
 #include <nacl/armnacl.h>
 #include <cstring>
 #include <cstdio>
+#include "ED25519Core.h"
 
 /**
  * The KeyPair can have arbitrary types as public and private keys.
  *
+ * Derived classes provide generate() and getPublicKey(). They are not
+ * virtual, a device uses one algorithm and the calls are resolved at
+ * compile time. See StaticKeyPair.h for key pairs based on algorithm policies.
+ *
  * @tparam PUBLIC the public key type, e.g. unsigned char ed25519pub[crypto_sign_PUBLICKEYBYTES]
  * @tparam PRIVATE the private key type, e.g. unsigned char ed25519priv[crypto_sign_SECRETKEYBYTES]
  */
@@ -45,23 +50,10 @@ protected:
     PUBLIC *publicKey;
     PRIVATE *privateKey;
 
-public:
     /**
      * Initialize an empty key pair.
      */
     KeyPair() : publicKey(NULL), privateKey(NULL) {};
-
-    /**
-     * Generate the public/private key pair using the
-     * configured algorithm.
-     */
-    virtual void generate() = 0;
-
-    /**
-     * Get a pointer to the public key.
-     * @return a pointer to the public key.
-     */
-    virtual PUBLIC *getPublicKey() = 0;
 };
 
 typedef struct ED25519PublicKey {
@@ -76,6 +68,24 @@ typedef struct ED25519Signature {
     unsigned char signature[crypto_sign_BYTES];
 } ED25519Signature;
 
+/**
+ * The 32 byte secret seed of an ED25519 key pair. It is the first half of
+ * the NaCl secret key, the second half is a copy of the public key.
+ */
+typedef struct ED25519Seed {
+    unsigned char seed[ED25519_SEED_BYTES];
+} ED25519Seed;
+
+/**
+ * Secret key material derived on first use and kept for further operations.
+ */
+typedef struct ED25519KeyCache {
+    ED25519ExpandedKey expanded;
+    ED25519PublicKey publicKey;
+    ED25519Seed seed;
+    bool valid;
+} ED25519KeyCache;
+
 /**
  * A class holding an ED25519 key pair.
  */
@@ -121,10 +131,27 @@ public:
 
         if (this->privateKey == NULL) this->privateKey = new ED25519PrivateKey();
         memcpy(this->privateKey->key, privateKey, crypto_sign_SECRETKEYBYTES);
+        invalidate();
 
         return true;
     }
 
+    /**
+     * Link to an existing storage location of an ED25519 secret seed. The seed
+     * is all that is needed to sign, the public key is derived on first use.
+     * @param seed a pointer to the seed
+     */
+    void linkSeed(const ED25519Seed *seed);
+
+    /**
+     * Import an ED25519 secret seed from a char array. The seed will be copied
+     * and the public key is derived on first use.
+     * @param seed the seed
+     * @param length the seed length, must be ED25519_SEED_BYTES
+     * @return false if the seed has the wrong length
+     */
+    bool importSeed(const unsigned char *seed, int length);
+
     /**
      * Import an ED25519 public key from a char array.
      * @param publicKey
@@ -133,6 +160,7 @@ public:
     bool importPublicKey(const unsigned char *publicKey, int length) {
         if (publicKey == NULL || length != crypto_sign_PUBLICKEYBYTES) return false;
 
+        if (cache != NULL && this->publicKey == &cache->publicKey) this->publicKey = NULL;
         if (this->publicKey == NULL) this->publicKey = new ED25519PublicKey();
         memcpy(this->publicKey->key, publicKey, crypto_sign_PUBLICKEYBYTES);
 
@@ -141,7 +169,8 @@ public:
 
 
     /**
-     * Sign a message using the ED25519 private key.
+     * Sign a message using the ED25519 private key or seed. The secret is expanded
+     * on the first signature and kept in a small cache for further signatures.
      * @param message the message to sign
      * @param length the length of the message to sign, don't rely on \0 termination
      * @param signature the signature to check the message
@@ -150,8 +179,73 @@ public:
      */
     ED25519Signature *sign(const unsigned char *message, size_t length);
 
+    /**
+     * Sign a message, keeping the temporaries of this layer in a workspace instead of on the
+     * stack, see ED25519Workspace. The signature is the same as the one created without workspace.
+     * @param message the message to sign
+     * @param length the length of the message to sign
+     * @param workspace the workspace, it must not be used by another thread at the same time
+     * @returns the signature
+     * @returns NULL if the private key is not available
+     */
+    ED25519Signature *sign(const unsigned char *message, size_t length, ED25519Workspace &workspace);
+
+    /**
+     * Sign a message that is spread over several buffers, e.g. a header, a payload in a
+     * ring buffer and a nonce. The segments are hashed in place, nothing is copied.
+     * The signature is the same as that of the concatenated segments.
+     * @param segments the message segments, in order
+     * @param count the number of segments
+     * @returns the signature
+     * @returns NULL if the private key is not available or a segment is missing
+     * @note a NULL literal as first argument is ambiguous with sign(message, length),
+     *       pass a typed pointer, e.g. static_cast<const unsigned char *>(NULL)
+     */
+    ED25519Signature *sign(const ED25519Segment *segments, size_t count);
+
     bool verify(const unsigned char *message, size_t length, const ED25519Signature *signature);
 
+    /**
+     * Verify the signature of a message that is spread over several buffers.
+     * The segments are hashed in place, nothing is copied.
+     * @param segments the message segments, in order
+     * @param count the number of segments
+     * @param signature the signature of the concatenated segments
+     * @return true if the signature is valid
+     * @note a NULL literal as first argument is ambiguous with verify(message, length, signature),
+     *       pass a typed pointer, e.g. static_cast<const unsigned char *>(NULL)
+     */
+    bool verify(const ED25519Segment *segments, size_t count, const ED25519Signature *signature);
+
+    /**
+     * Verify a message, keeping the temporaries of this layer in a workspace instead of on the
+     * stack, see ED25519Workspace. The result is the same as that of verify() without workspace.
+     * @param message the signed message
+     * @param length the length of the message
+     * @param signature the signature
+     * @param workspace the workspace, it must not be used by another thread at the same time
+     * @return true if the signature is valid
+     */
+    bool verify(const unsigned char *message, size_t length, const ED25519Signature *signature,
+                ED25519Workspace &workspace);
+
+    /**
+     * Expand the secret key or seed, if not done yet. This is internal, for the
+     * signers of this library that build on the ED25519Core functions. The cache
+     * is owned by the key pair and changes with its keys.
+     * @return the cache or NULL if there is no secret key or seed
+     */
+    const ED25519KeyCache *expand();
+
+protected:
+    const ED25519Seed *seed;
+    ED25519KeyCache *cache;
+
+    /**
+     * Drop the derived key material, the keys have changed.
+     */
+    void invalidate();
+
 private:
     bool generated;
 };
@@ -0,0 +1,198 @@
+/*!
+ * @file
+ * @brief Merkle tree batch signing.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-14
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "MerkleBatch.h"
+#include "SHA512.h"
+
+static const unsigned char headerTag[4] = {'M', 'R', 'K', 'L'};
+
+MerkleBatch::MerkleBatch(size_t capacity) : capacity(capacity), levels(0), records(0) {
+    // level l holds the capacity >> l perfect subtrees of 2^l leaves
+    size_t total = 0;
+    for (size_t n = capacity; n > 0; n >>= 1) {
+        total += n;
+        levels++;
+    }
+    nodes = new unsigned char[total * MERKLE_HASH_BYTES];
+}
+
+MerkleBatch::~MerkleBatch() {
+    delete[] nodes;
+}
+
+unsigned char *MerkleBatch::node(size_t level, size_t index) {
+    size_t offset = 0;
+    for (size_t l = 0; l < level; l++) offset += capacity >> l;
+    return nodes + (offset + index) * MERKLE_HASH_BYTES;
+}
+
+bool MerkleBatch::add(const unsigned char *record, size_t length) {
+    if (records >= capacity) return false;
+
+    size_t index = records++;
+    leafHash(node(0, index), record, length);
+
+    // every right child completes a perfect subtree one level up
+    for (size_t level = 0; index & 1; level++, index >>= 1) {
+        nodeHash(node(level + 1, index >> 1), node(level, index - 1), node(level, index));
+    }
+
+    return true;
+}
+
+void MerkleBatch::edge(unsigned char *hash, size_t level) {
+    // fold the incomplete right edge below level, the lower subtrees are right of the higher ones
+    bool empty = true;
+    for (size_t l = 0; l < level && l < levels; l++) {
+        if (!((records >> l) & 1)) continue;
+        const unsigned char *subtree = node(l, (records >> l) - 1);
+        if (empty) memcpy(hash, subtree, MERKLE_HASH_BYTES);
+        else nodeHash(hash, subtree, hash);
+        empty = false;
+    }
+}
+
+void MerkleBatch::root(unsigned char *root) {
+    if (records == 0) {
+        unsigned char digest[SHA512_BYTES];
+        SHA512 hash;
+        hash.finish(digest);
+        memcpy(root, digest, MERKLE_HASH_BYTES);
+        return;
+    }
+    edge(root, levels);
+}
+
+ED25519Signature *MerkleBatch::sign(ED25519KeyPair &keyPair, unsigned char *header) {
+    if (records == 0) return NULL;
+
+    memcpy(header, headerTag, sizeof(headerTag));
+    header[4] = static_cast<unsigned char>(records >> 24);
+    header[5] = static_cast<unsigned char>(records >> 16);
+    header[6] = static_cast<unsigned char>(records >> 8);
+    header[7] = static_cast<unsigned char>(records);
+    root(header + 8);
+
+    return keyPair.sign(header, MERKLE_HEADER_BYTES);
+}
+
+int MerkleBatch::proof(size_t index, unsigned char *path, size_t maxHashes) {
+    if (index >= records) return -1;
+
+    int hashes = 0;
+    // width is the number of nodes at the current level, including an incomplete last one
+    for (size_t level = 0, width = records; width > 1; level++, index >>= 1, width = (width + 1) >> 1) {
+        const size_t sibling = index ^ 1;
+        if (sibling >= width) continue;
+        if (static_cast<size_t>(hashes) >= maxHashes) return -1;
+
+        unsigned char *hash = path + hashes * MERKLE_HASH_BYTES;
+        if (sibling < records >> level) memcpy(hash, node(level, sibling), MERKLE_HASH_BYTES);
+        else edge(hash, level);
+        hashes++;
+    }
+
+    return hashes;
+}
+
+void MerkleBatch::reset() {
+    records = 0;
+}
+
+void MerkleBatch::leafHash(unsigned char *hash, const unsigned char *record, size_t length) {
+    static const unsigned char prefix = 0x00;
+    unsigned char digest[SHA512_BYTES];
+    SHA512 sha512;
+    sha512.update(&prefix, 1);
+    sha512.update(record, length);
+    sha512.finish(digest);
+    memcpy(hash, digest, MERKLE_HASH_BYTES);
+}
+
+void MerkleBatch::nodeHash(unsigned char *hash, const unsigned char *left, const unsigned char *right) {
+    static const unsigned char prefix = 0x01;
+    unsigned char digest[SHA512_BYTES];
+    SHA512 sha512;
+    sha512.update(&prefix, 1);
+    sha512.update(left, MERKLE_HASH_BYTES);
+    sha512.update(right, MERKLE_HASH_BYTES);
+    sha512.finish(digest);
+    memcpy(hash, digest, MERKLE_HASH_BYTES);
+}
+
+MerkleVerifier::MerkleVerifier() : records(0), valid(false) {}
+
+bool MerkleVerifier::begin(ED25519KeyPair &keyPair, const unsigned char *header, const ED25519Signature *signature) {
+    valid = false;
+    if (header == NULL || memcmp(header, headerTag, sizeof(headerTag)) != 0) return false;
+    if (!keyPair.verify(header, MERKLE_HEADER_BYTES, signature)) return false;
+
+    records = (static_cast<size_t>(header[4]) << 24) | (static_cast<size_t>(header[5]) << 16) |
+              (static_cast<size_t>(header[6]) << 8) | static_cast<size_t>(header[7]);
+    memcpy(root, header + 8, MERKLE_HASH_BYTES);
+    valid = records > 0;
+
+    return valid;
+}
+
+bool MerkleVerifier::verify(const unsigned char *record, size_t length, size_t index,
+                            const unsigned char *path, size_t hashes) {
+    if (!valid) return false;
+
+    unsigned char leaf[MERKLE_HASH_BYTES];
+    MerkleBatch::leafHash(leaf, record, length);
+
+    return verifyPath(root, records, leaf, index, path, hashes);
+}
+
+bool MerkleVerifier::verifyPath(const unsigned char *root, size_t size, const unsigned char *leaf, size_t index,
+                                const unsigned char *path, size_t hashes) {
+    if (index >= size) return false;
+
+    size_t fn = index, sn = size - 1;
+    unsigned char hash[MERKLE_HASH_BYTES];
+    memcpy(hash, leaf, MERKLE_HASH_BYTES);
+
+    for (size_t i = 0; i < hashes; i++) {
+        const unsigned char *p = path + i * MERKLE_HASH_BYTES;
+        if (sn == 0) return false;
+
+        if ((fn & 1) || fn == sn) {
+            MerkleBatch::nodeHash(hash, p, hash);
+            // skip the levels where our node was the incomplete last one and had no sibling
+            while (!(fn & 1) && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        } else {
+            MerkleBatch::nodeHash(hash, hash, p);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+
+    return sn == 0 && memcmp(hash, root, MERKLE_HASH_BYTES) == 0;
+}
@@ -0,0 +1,199 @@
+/*!
+ * @file
+ * @brief Merkle tree batch signing.
+ *
+ * Instead of signing every record, records are collected in a Merkle tree
+ * and only the root is signed. Each record is then sent with an inclusion
+ * proof, the receiver checks the proof against the signed root.
+ *
+ * The tree follows RFC 6962 (Certificate Transparency), using the first
+ * 32 bytes of SHA-512 as the hash:
+ * leaf = H(0x00 || record), node = H(0x01 || left || right).
+ * Proofs are checked with the algorithm of RFC 9162, section 2.1.3.2.
+ *
+ * The signed batch header is "MRKL" || record count (4 bytes, big endian) || root.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-14
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_MERKLEBATCH_H
+#define UBIRCH_MBED_CRYPTO_MERKLEBATCH_H
+
+#include "KeyPair.h"
+
+#define MERKLE_HASH_BYTES 32
+#define MERKLE_HEADER_BYTES (4 + 4 + MERKLE_HASH_BYTES)
+
+/**
+ * Collects records in a Merkle tree and signs the root.
+ *
+ * All perfect subtrees are kept as the records arrive, so the root and all
+ * proofs are available without rehashing. A batch of capacity n needs less
+ * than 2 * n * MERKLE_HASH_BYTES bytes of memory.
+ *
+ * @code
+ * MerkleBatch batch(32);
+ * for (...) batch.add(reading, readingLength);
+ *
+ * unsigned char header[MERKLE_HEADER_BYTES];
+ * ED25519Signature *signature = batch.sign(keyPair, header);
+ * for (size_t i = 0; i < batch.count(); i++) {
+ *     int hashes = batch.proof(i, path, sizeof(path) / MERKLE_HASH_BYTES);
+ *     send(record[i], i, path, hashes);
+ * }
+ * @endcode
+ */
+class MerkleBatch {
+public:
+    /**
+     * Create an empty batch.
+     * @param capacity the maximum number of records
+     */
+    MerkleBatch(size_t capacity);
+
+    ~MerkleBatch();
+
+    /**
+     * Add a record to the tree. The record itself is not kept.
+     * @param record the record data
+     * @param length the record length
+     * @return false if the batch is full
+     */
+    bool add(const unsigned char *record, size_t length);
+
+    /**
+     * @return the number of records in the batch
+     */
+    size_t count() const { return records; }
+
+    /**
+     * Get the current root. The root of an empty batch is the hash of no data.
+     * @param root the output buffer for the MERKLE_HASH_BYTES long root
+     */
+    void root(unsigned char *root);
+
+    /**
+     * Create and sign the batch header.
+     * @param keyPair the key pair to sign with
+     * @param header the output buffer for the MERKLE_HEADER_BYTES long header
+     * @return the signature of the header, NULL if the batch is empty or there is no private key
+     */
+    ED25519Signature *sign(ED25519KeyPair &keyPair, unsigned char *header);
+
+    /**
+     * Create the inclusion proof of a record.
+     * @param index the index of the record in the batch
+     * @param path the output buffer for the proof hashes
+     * @param maxHashes the number of MERKLE_HASH_BYTES long hashes that fit into path
+     * @return the number of hashes in the proof, -1 if the index is invalid or path is too small
+     */
+    int proof(size_t index, unsigned char *path, size_t maxHashes);
+
+    /**
+     * Remove all records, to start the next batch.
+     */
+    void reset();
+
+    /**
+     * Hash a record into a leaf.
+     * @param hash the output buffer for the hash
+     * @param record the record data
+     * @param length the record length
+     */
+    static void leafHash(unsigned char *hash, const unsigned char *record, size_t length);
+
+    /**
+     * Hash two child nodes into their parent.
+     * @param hash the output buffer for the hash, may be one of the children
+     * @param left the left child
+     * @param right the right child
+     */
+    static void nodeHash(unsigned char *hash, const unsigned char *left, const unsigned char *right);
+
+private:
+    unsigned char *nodes;
+    size_t capacity;
+    size_t levels;
+    size_t records;
+
+    unsigned char *node(size_t level, size_t index);
+
+    void edge(unsigned char *hash, size_t level);
+};
+
+/**
+ * Checks records against a signed batch header.
+ *
+ * @code
+ * MerkleVerifier verifier;
+ * if (!verifier.begin(peerKey, header, signature)) return false;
+ * if (!verifier.verify(record, recordLength, index, path, hashes)) return false;
+ * @endcode
+ */
+class MerkleVerifier {
+public:
+    MerkleVerifier();
+
+    /**
+     * Verify the signature of a batch header. Records can only be verified after that.
+     * @param keyPair the key pair holding the public key of the sender
+     * @param header the MERKLE_HEADER_BYTES long header
+     * @param signature the signature of the header
+     * @return true if the header is valid
+     */
+    bool begin(ED25519KeyPair &keyPair, const unsigned char *header, const ED25519Signature *signature);
+
+    /**
+     * Verify that a record is part of the signed batch.
+     * @param record the record data
+     * @param length the record length
+     * @param index the index of the record in the batch
+     * @param path the proof hashes
+     * @param hashes the number of hashes in the proof
+     * @return true if the record is included in the batch
+     */
+    bool verify(const unsigned char *record, size_t length, size_t index, const unsigned char *path, size_t hashes);
+
+    /**
+     * @return the number of records in the verified batch, 0 if no header was verified
+     */
+    size_t count() const { return valid ? records : 0; }
+
+    /**
+     * Check an inclusion proof against a root.
+     * @param root the tree root
+     * @param size the number of records in the tree
+     * @param leaf the leaf hash of the record
+     * @param index the index of the record
+     * @param path the proof hashes
+     * @param hashes the number of hashes in the proof
+     * @return true if the proof leads to the root
+     */
+    static bool verifyPath(const unsigned char *root, size_t size, const unsigned char *leaf, size_t index,
+                           const unsigned char *path, size_t hashes);
+
+private:
+    unsigned char root[MERKLE_HASH_BYTES];
+    size_t records;
+    bool valid;
+};
+
+#endif //UBIRCH_MBED_CRYPTO_MERKLEBATCH_H
@@ -0,0 +1,72 @@
+/*!
+ * @file
+ * @brief Sliding window nonce replay filter.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-12
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "ReplayWindow.h"
+
+ReplayWindow::ReplayWindow() : highest(0), seen(0) {}
+
+bool ReplayWindow::check(uint32_t nonce) const {
+    // an empty window accepts anything, bit 0 is always set once a nonce was accepted
+    if (seen == 0 || nonce > highest) return true;
+
+    const uint32_t age = highest - nonce;
+    if (age >= REPLAY_WINDOW_SIZE) return false;
+
+    return !(seen & (1u << age));
+}
+
+bool ReplayWindow::accept(uint32_t nonce) {
+    if (!check(nonce)) return false;
+
+    if (seen == 0) {
+        highest = nonce;
+        seen = 1;
+    } else if (nonce > highest) {
+        const uint32_t shift = nonce - highest;
+        seen = shift >= REPLAY_WINDOW_SIZE ? 1 : (seen << shift) | 1;
+        highest = nonce;
+    } else {
+        seen |= 1u << (highest - nonce);
+    }
+
+    return true;
+}
+
+void ReplayWindow::reset() {
+    highest = 0;
+    seen = 0;
+}
+
+uint32_t ReplayWindow::nonce(const unsigned char *bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+void ReplayWindow::put(unsigned char *bytes, uint32_t nonce) {
+    bytes[0] = static_cast<unsigned char>(nonce >> 24);
+    bytes[1] = static_cast<unsigned char>(nonce >> 16);
+    bytes[2] = static_cast<unsigned char>(nonce >> 8);
+    bytes[3] = static_cast<unsigned char>(nonce);
+}
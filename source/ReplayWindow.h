@@ -0,0 +1,110 @@
+/*!
+ * @file
+ * @brief Sliding window nonce replay filter.
+ *
+ * Each peer keeps the highest nonce seen so far and a bitmap of the nonces
+ * just below it. A message is rejected in O(1) if its nonce was already
+ * seen or is too old to be tracked, before the much more expensive signature
+ * verification runs. Anything at or below highest - REPLAY_WINDOW_SIZE is
+ * rejected, out of order delivery within the window is fine.
+ *
+ * The nonce of the key exchange is a sequence counter for that: the sender
+ * keeps one counter per key, increments it for every message and writes it
+ * with ReplayWindow::put(). The counter must survive a reset of the sender
+ * (keep it in flash), and the key must be replaced before it wraps.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-12
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_REPLAYWINDOW_H
+#define UBIRCH_MBED_CRYPTO_REPLAYWINDOW_H
+
+#include <stdint.h>
+#include "KeyPair.h"
+
+/** The number of nonces below the highest nonce that are tracked. */
+#define REPLAY_WINDOW_SIZE 32
+
+/**
+ * The replay window of a single peer, 8 bytes of state.
+ *
+ * @code
+ * uint32_t nonce = ReplayWindow::nonce(message + crypto_sign_PUBLICKEYBYTES);
+ * if (!peer.window.check(nonce)) return false;   // replay, no need to verify
+ * if (!peerKey.verify(message, 36, signature)) return false;
+ * peer.window.accept(nonce);
+ * @endcode
+ */
+class ReplayWindow {
+public:
+    /**
+     * Create an empty window, the first nonce will always be accepted.
+     */
+    ReplayWindow();
+
+    /**
+     * Check whether a nonce is fresh, without changing the window.
+     * @param nonce the nonce to check
+     * @return false if the nonce was seen before or is outside the window
+     */
+    bool check(uint32_t nonce) const;
+
+    /**
+     * Mark a nonce as seen. Call this only after the message was verified,
+     * otherwise forged messages could move the window.
+     * @param nonce the nonce to accept
+     * @return false if the nonce is a replay, the window is unchanged then
+     */
+    bool accept(uint32_t nonce);
+
+    /**
+     * Forget all nonces seen.
+     */
+    void reset();
+
+    /**
+     * Read a 4 byte big endian nonce from a message.
+     * @param bytes the start of the nonce in the message
+     * @return the nonce
+     */
+    static uint32_t nonce(const unsigned char *bytes);
+
+    /**
+     * Write a nonce as 4 big endian bytes into a message.
+     * @param bytes the start of the nonce in the message
+     * @param nonce the counter value to write
+     */
+    static void put(unsigned char *bytes, uint32_t nonce);
+
+private:
+    uint32_t highest;
+    uint32_t seen;
+};
+
+/**
+ * A peer public key with its replay window, to be kept in a peer table.
+ */
+typedef struct ED25519Peer {
+    ED25519PublicKey publicKey;
+    ReplayWindow window;
+} ED25519Peer;
+
+#endif //UBIRCH_MBED_CRYPTO_REPLAYWINDOW_H
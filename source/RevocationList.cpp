@@ -0,0 +1,212 @@
+/*!
+ * @file
+ * @brief A revocation list of device keys with a Bloom filter in front.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-31
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include <cstddef>
+#include "RevocationList.h"
+#include "CRC32.h"
+
+#define KEY_BYTES       crypto_sign_PUBLICKEYBYTES
+#define HEADER_MAGIC    0x4C524255u
+#define DELTA_MAGIC     0x55425256u
+
+static uint32_t get32(const unsigned char *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static uint32_t load32(const unsigned char *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// the checksum covers the keys and the header fields in front of it
+static uint32_t listChecksum(const RevocationHeader *header, uint32_t keysChecksum) {
+    return crc32(keysChecksum, reinterpret_cast<const unsigned char *>(header), offsetof(RevocationHeader, crc));
+}
+
+RevocationList::RevocationList(FlashStorage &storage, unsigned char *filter, size_t filterSize)
+        : storage(storage), filter(filter), filterBits(static_cast<uint32_t>(filterSize * 8)), mounted(false),
+          active(0) {
+    resetCounters();
+}
+
+const RevocationHeader *RevocationList::header(size_t offset) const {
+    return reinterpret_cast<const RevocationHeader *>(storage.address() + offset);
+}
+
+const unsigned char *RevocationList::keys() const {
+    return storage.address() + active + sizeof(RevocationHeader);
+}
+
+size_t RevocationList::bankSize() const {
+    return storage.size() / storage.sectorSize() / 2 * storage.sectorSize();
+}
+
+size_t RevocationList::capacity() const {
+    return bankSize() / KEY_BYTES - 1;
+}
+
+bool RevocationList::isValid(size_t offset) const {
+    const RevocationHeader *h = header(offset);
+    if (h->magic != HEADER_MAGIC || h->count > capacity()) return false;
+
+    const unsigned char *list = reinterpret_cast<const unsigned char *>(h + 1);
+    return h->crc == listChecksum(h, crc32(0, list, h->count * KEY_BYTES));
+}
+
+bool RevocationList::mount() {
+    mounted = false;
+
+    const size_t sector = storage.sectorSize();
+    const size_t program = storage.programSize();
+    if (storage.address() == NULL || filter == NULL || filterBits == 0 || program == 0 || sector == 0 ||
+        KEY_BYTES % program || sector % KEY_BYTES || storage.size() % sector || storage.size() / sector < 2)
+        return false;
+
+    // the newest complete list wins, a list without header was interrupted
+    const size_t other = bankSize();
+    const bool first = isValid(0);
+    const bool second = isValid(other);
+    if (!first && !second) return false;
+    active = !first || (second && header(other)->sequence > header(0)->sequence) ? other : 0;
+
+    memset(filter, 0, (filterBits + 7) / 8);
+    const unsigned char *list = keys();
+    for (uint32_t i = 0; i < header()->count; i++) insert(list + i * KEY_BYTES);
+
+    mounted = true;
+    return true;
+}
+
+bool RevocationList::format() {
+    mounted = false;
+    if (!storage.erase(0, storage.size())) return false;
+    if (!write(0, 0, NULL, 0)) return false;
+    return mount();
+}
+
+// double hashing on the key itself, public keys are uniformly distributed already
+void RevocationList::insert(const unsigned char *publicKey) {
+    uint32_t hash = load32(publicKey);
+    const uint32_t step = load32(publicKey + 4) | 1;
+    for (int i = 0; i < REVOCATION_FILTER_PROBES; i++, hash += step) {
+        const uint32_t bit = hash % filterBits;
+        filter[bit >> 3] |= static_cast<unsigned char>(1 << (bit & 7));
+    }
+}
+
+bool RevocationList::mayContain(const unsigned char *publicKey) const {
+    uint32_t hash = load32(publicKey);
+    const uint32_t step = load32(publicKey + 4) | 1;
+    for (int i = 0; i < REVOCATION_FILTER_PROBES; i++, hash += step) {
+        const uint32_t bit = hash % filterBits;
+        if (!(filter[bit >> 3] & (1 << (bit & 7)))) return false;
+    }
+    return true;
+}
+
+bool RevocationList::isRevoked(const unsigned char *publicKey) {
+    if (!mounted || publicKey == NULL) return false;
+    lookupCount++;
+    if (!mayContain(publicKey)) return false;
+
+    const unsigned char *list = keys();
+    size_t low = 0, high = header()->count;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const int order = memcmp(list + middle * KEY_BYTES, publicKey, KEY_BYTES);
+        if (order == 0) return true;
+        if (order < 0) low = middle + 1;
+        else high = middle;
+    }
+    falsePositiveCount++;
+    return false;
+}
+
+// merge the active list and the added keys into the bank at offset, the header goes last
+bool RevocationList::write(size_t offset, uint32_t sequence, const unsigned char *added, size_t count) {
+    const unsigned char *list = mounted ? keys() : NULL;
+    const size_t listCount = mounted ? header()->count : 0;
+
+    size_t position = offset + sizeof(RevocationHeader);
+    size_t i = 0, j = 0;
+    uint32_t crc = 0;
+    while (i < listCount || j < count) {
+        const unsigned char *key;
+        if (j == count) key = list + i++ * KEY_BYTES;
+        else if (i == listCount) key = added + j++ * KEY_BYTES;
+        else {
+            const int order = memcmp(list + i * KEY_BYTES, added + j * KEY_BYTES, KEY_BYTES);
+            key = order <= 0 ? list + i++ * KEY_BYTES : added + j++ * KEY_BYTES;
+            // a key that is revoked again is kept once
+            if (order == 0) j++;
+        }
+        if (!storage.program(position, key, KEY_BYTES)) return false;
+        crc = crc32(crc, key, KEY_BYTES);
+        position += KEY_BYTES;
+    }
+
+    RevocationHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = HEADER_MAGIC;
+    h.sequence = sequence;
+    h.count = static_cast<uint32_t>((position - offset - sizeof(RevocationHeader)) / KEY_BYTES);
+    h.crc = listChecksum(&h, crc);
+    return storage.program(offset, &h, sizeof(h));
+}
+
+bool RevocationList::apply(const unsigned char *delta, size_t length, ED25519KeyPair &authority) {
+    if (!mounted || delta == NULL || length < REVOCATION_DELTA_BYTES(0)) return false;
+
+    const uint32_t next = get32(delta + 4);
+    const size_t count = (static_cast<size_t>(delta[8]) << 8) | delta[9];
+    if (get32(delta) != DELTA_MAGIC || length != REVOCATION_DELTA_BYTES(count) || next != sequence() + 1 ||
+        header()->count + count > capacity())
+        return false;
+
+    // strictly ascending keys merge in one pass without extra memory
+    const unsigned char *added = delta + REVOCATION_DELTA_HEADER_BYTES;
+    for (size_t k = 1; k < count; k++) {
+        if (memcmp(added + (k - 1) * KEY_BYTES, added + k * KEY_BYTES, KEY_BYTES) >= 0) return false;
+    }
+
+    ED25519Signature signature;
+    memcpy(signature.signature, delta + length - crypto_sign_BYTES, crypto_sign_BYTES);
+    if (!authority.verify(delta, length - crypto_sign_BYTES, &signature)) return false;
+
+    // the active list stays valid until the new one is complete
+    const size_t target = active == 0 ? bankSize() : 0;
+    if (!storage.erase(target, bankSize()) || !write(target, next, added, count)) return false;
+    active = target;
+
+    for (size_t k = 0; k < count; k++) insert(added + k * KEY_BYTES);
+    return true;
+}
+
+void RevocationList::resetCounters() {
+    lookupCount = 0;
+    falsePositiveCount = 0;
+}
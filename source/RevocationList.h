@@ -0,0 +1,180 @@
+/*!
+ * @file
+ * @brief A revocation list of device keys with a Bloom filter in front.
+ *
+ * A gateway has to refuse the signatures of revoked devices, but a fleet
+ * revokes more keys than fit into RAM as a plain list. The revoked keys are
+ * kept sorted in flash and a Bloom filter in RAM answers the common case,
+ * a key that is not revoked, with a few bit tests. Only if all filter bits of
+ * a key are set the list is binary searched, so a false positive of the
+ * filter costs a lookup, never a wrong answer.
+ *
+ * The list grows with signed deltas of newly revoked keys. A delta is merged
+ * into the other half of the storage and becomes active when its header is
+ * written, an interrupted update leaves the previous list in place.
+ *
+ * Delta (big endian): ['UBRV' | sequence (4) | count (2) | count sorted keys | signature]
+ * The signature of the revocation authority covers everything before it and
+ * the sequence must be one more than the sequence of the list.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-31
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_REVOCATIONLIST_H
+#define UBIRCH_MBED_CRYPTO_REVOCATIONLIST_H
+
+#include <stdint.h>
+#include "FlashStorage.h"
+#include "KeyPair.h"
+
+/** The filter bits per revoked key, 10 bits and 7 probes give about 1% false positives. */
+#ifndef REVOCATION_FILTER_BITS_PER_KEY
+#define REVOCATION_FILTER_BITS_PER_KEY 10
+#endif
+
+/** The number of filter bits tested per key. */
+#ifndef REVOCATION_FILTER_PROBES
+#define REVOCATION_FILTER_PROBES 7
+#endif
+
+/** The filter size for an expected number of revoked keys, more keys raise the false positive rate. */
+#define REVOCATION_FILTER_BYTES(keys) (((keys) * REVOCATION_FILTER_BITS_PER_KEY + 7) / 8 + 1)
+
+#define REVOCATION_DELTA_HEADER_BYTES 10
+#define REVOCATION_DELTA_MAX_KEYS 0xFFFFu
+#define REVOCATION_DELTA_BYTES(keys) \
+    (REVOCATION_DELTA_HEADER_BYTES + (keys) * crypto_sign_PUBLICKEYBYTES + crypto_sign_BYTES)
+
+/**
+ * The on-flash header in front of the sorted keys, as large as a key.
+ */
+typedef struct RevocationHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t count;
+    uint32_t crc;
+    unsigned char reserved[16];
+} RevocationHeader;
+
+/**
+ * Revoked public keys in flash, checked through a Bloom filter in RAM.
+ *
+ * @code
+ * static unsigned char filter[REVOCATION_FILTER_BYTES(2000)];
+ * FlashIAPStorage storage(0x80000, 0x20000);
+ * RevocationList revocations(storage, filter, sizeof(filter));
+ * if (!revocations.mount()) revocations.format();
+ *
+ * revocations.apply(delta, deltaLength, authority);
+ * if (revocations.isRevoked(publicKey)) return;
+ * @endcode
+ */
+class RevocationList {
+public:
+    /**
+     * Create a revocation list on top of the storage area. The storage is split
+     * into two halves of whole sectors, each holds the complete list.
+     * @param storage the storage area to use
+     * @param filter the Bloom filter memory, see REVOCATION_FILTER_BYTES()
+     * @param filterSize the size of the filter memory
+     */
+    RevocationList(FlashStorage &storage, unsigned char *filter, size_t filterSize);
+
+    /**
+     * Load the newest complete list from the storage and fill the filter.
+     * @return false if the storage geometry is not supported or holds no list
+     */
+    bool mount();
+
+    /**
+     * Erase the storage area and start with an empty list, sequence 0.
+     * @return true if the storage was erased
+     */
+    bool format();
+
+    /**
+     * Add the keys of a signed delta to the list.
+     * @param delta the delta
+     * @param length the length of the delta
+     * @param authority the key pair with the public key of the revocation authority
+     * @return false if the delta is malformed, not signed by the authority, out of sequence or does not fit
+     */
+    bool apply(const unsigned char *delta, size_t length, ED25519KeyPair &authority);
+
+    /**
+     * Check whether a public key is revoked.
+     * @param publicKey the public key, crypto_sign_PUBLICKEYBYTES long
+     * @return true if the key is on the list
+     */
+    bool isRevoked(const unsigned char *publicKey);
+
+    /** @return the number of revoked keys */
+    uint32_t count() const { return mounted ? header()->count : 0; }
+
+    /** @return the sequence of the last applied delta */
+    uint32_t sequence() const { return mounted ? header()->sequence : 0; }
+
+    /** @return the number of keys that fit into one half of the storage */
+    size_t capacity() const;
+
+    /** @return the number of lookups */
+    uint32_t lookups() const { return lookupCount; }
+
+    /** @return the number of lookups the filter passed to the list, but the key was not revoked */
+    uint32_t falsePositives() const { return falsePositiveCount; }
+
+    /**
+     * Clear the counters.
+     */
+    void resetCounters();
+
+private:
+    FlashStorage &storage;
+    unsigned char *filter;
+    const uint32_t filterBits;
+    bool mounted;
+    size_t active;
+    uint32_t lookupCount;
+    uint32_t falsePositiveCount;
+
+    const RevocationHeader *header(size_t offset) const;
+
+    const RevocationHeader *header() const { return header(active); }
+
+    const unsigned char *keys() const;
+
+    size_t bankSize() const;
+
+    bool isValid(size_t offset) const;
+
+    void insert(const unsigned char *publicKey);
+
+    bool mayContain(const unsigned char *publicKey) const;
+
+    bool write(size_t offset, uint32_t sequence, const unsigned char *added, size_t count);
+
+    // not copyable, the filter memory belongs to the caller
+    RevocationList(const RevocationList &);
+
+    RevocationList &operator=(const RevocationList &);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_REVOCATIONLIST_H
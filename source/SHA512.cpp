@@ -0,0 +1,99 @@
+/*!
+ * @file
+ * @brief Incremental SHA-512.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-10
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include <nacl/armnacl.h>
+#include "SHA512.h"
+
+// the block function takes 16 bit lengths, feed it the largest multiple of the block size below that
+#define MAX_BLOCKS_LENGTH (0xFFFF & ~(SHA512_BLOCKBYTES - 1))
+
+static const unsigned char iv[SHA512_BYTES] = {
+        0x6a, 0x09, 0xe6, 0x67, 0xf3, 0xbc, 0xc9, 0x08, 0xbb, 0x67, 0xae, 0x85, 0x84, 0xca, 0xa7, 0x3b,
+        0x3c, 0x6e, 0xf3, 0x72, 0xfe, 0x94, 0xf8, 0x2b, 0xa5, 0x4f, 0xf5, 0x3a, 0x5f, 0x1d, 0x36, 0xf1,
+        0x51, 0x0e, 0x52, 0x7f, 0xad, 0xe6, 0x82, 0xd1, 0x9b, 0x05, 0x68, 0x8c, 0x2b, 0x3e, 0x6c, 0x1f,
+        0x1f, 0x83, 0xd9, 0xab, 0xfb, 0x41, 0xbd, 0x6b, 0x5b, 0xe0, 0xcd, 0x19, 0x13, 0x7e, 0x21, 0x79
+};
+
+SHA512::SHA512() {
+    reset();
+}
+
+SHA512::~SHA512() {
+    memset(buffer, 0, sizeof(buffer));
+}
+
+void SHA512::reset() {
+    memcpy(state, iv, sizeof(state));
+    buffered = 0;
+    total = 0;
+}
+
+void SHA512::update(const unsigned char *data, size_t length) {
+    if (length == 0) return;
+    total += length;
+
+    // complete a partially filled block first
+    if (buffered) {
+        size_t fill = SHA512_BLOCKBYTES - buffered;
+        if (fill > length) fill = length;
+        memcpy(buffer + buffered, data, fill);
+        buffered += fill;
+        data += fill;
+        length -= fill;
+        if (buffered < SHA512_BLOCKBYTES) return;
+        crypto_hashblocks_sha512(state, buffer, SHA512_BLOCKBYTES);
+        buffered = 0;
+    }
+
+    // hash complete blocks in place
+    while (length >= SHA512_BLOCKBYTES) {
+        size_t blocks = length & ~(size_t) (SHA512_BLOCKBYTES - 1);
+        if (blocks > MAX_BLOCKS_LENGTH) blocks = MAX_BLOCKS_LENGTH;
+        crypto_hashblocks_sha512(state, data, static_cast<crypto_uint16>(blocks));
+        data += blocks;
+        length -= blocks;
+    }
+
+    memcpy(buffer, data, length);
+    buffered = length;
+}
+
+void SHA512::finish(unsigned char *digest) {
+    const uint64_t bits = total << 3;
+
+    buffer[buffered++] = 0x80;
+    if (buffered > SHA512_BLOCKBYTES - 16) {
+        memset(buffer + buffered, 0, SHA512_BLOCKBYTES - buffered);
+        crypto_hashblocks_sha512(state, buffer, SHA512_BLOCKBYTES);
+        buffered = 0;
+    }
+    memset(buffer + buffered, 0, SHA512_BLOCKBYTES - buffered);
+    for (int i = 0; i < 8; i++) buffer[SHA512_BLOCKBYTES - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    crypto_hashblocks_sha512(state, buffer, SHA512_BLOCKBYTES);
+
+    memcpy(digest, state, SHA512_BYTES);
+    memset(buffer, 0, sizeof(buffer));
+}
@@ -0,0 +1,83 @@
+/*!
+ * @file
+ * @brief Incremental SHA-512.
+ *
+ * NaCl only provides a one-shot hash over a contiguous buffer. This class
+ * feeds the NaCl block function incrementally, so data can be hashed in
+ * pieces without concatenating it first.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-10
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SHA512_H
+#define UBIRCH_MBED_CRYPTO_SHA512_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#define SHA512_BYTES 64
+#define SHA512_BLOCKBYTES 128
+
+/**
+ * SHA-512 over data that arrives in pieces.
+ *
+ * @code
+ * SHA512 hash;
+ * hash.update(header, sizeof(header));
+ * hash.update(payload, payloadLength);
+ * hash.finish(digest);
+ * @endcode
+ */
+class SHA512 {
+public:
+    /**
+     * Create a new hash, ready to receive data.
+     */
+    SHA512();
+
+    ~SHA512();
+
+    /**
+     * Reset the hash to the initial state, discarding all data.
+     */
+    void reset();
+
+    /**
+     * Add data to the hash.
+     * @param data the data to hash
+     * @param length the length of the data
+     */
+    void update(const unsigned char *data, size_t length);
+
+    /**
+     * Finish the hash and write the digest. The hash must be reset before it is used again.
+     * @param digest the output buffer for the SHA512_BYTES long digest
+     */
+    void finish(unsigned char *digest);
+
+private:
+    unsigned char state[SHA512_BYTES];
+    unsigned char buffer[SHA512_BLOCKBYTES];
+    size_t buffered;
+    uint64_t total;
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SHA512_H
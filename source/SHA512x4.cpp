@@ -0,0 +1,242 @@
+/*!
+ * @file
+ * @brief Multi-buffer SHA-512.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-16
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "SHA512x4.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+static const uint64_t K[80] = {
+        0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+        0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+        0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+        0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+        0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+        0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+        0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+        0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+        0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+        0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+        0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+        0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+        0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+        0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+        0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+        0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+        0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+        0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+        0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+        0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static const uint64_t IV[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+// the state and message words of all lanes, word major: x[word][lane]
+typedef uint64_t Words[16][SHA512_LANES];
+typedef uint64_t State[8][SHA512_LANES];
+
+#if defined(__AVX2__)
+
+#define ROTR(x, n) _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - (n)))
+#define XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256(a, b), c)
+
+static void compress(State state, const Words words) {
+    __m256i w[16], s[8];
+    for (int i = 0; i < 16; i++) w[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words[i]));
+    for (int i = 0; i < 8; i++) s[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state[i]));
+
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            const __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            const __m256i s0 = XOR3(ROTR(w15, 1), ROTR(w15, 8), _mm256_srli_epi64(w15, 7));
+            const __m256i s1 = XOR3(ROTR(w2, 19), ROTR(w2, 61), _mm256_srli_epi64(w2, 6));
+            w[t & 15] = _mm256_add_epi64(_mm256_add_epi64(w[t & 15], s0), _mm256_add_epi64(w[(t - 7) & 15], s1));
+        }
+        const __m256i S1 = XOR3(ROTR(e, 14), ROTR(e, 18), ROTR(e, 41));
+        const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        const __m256i t1 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(h, S1), ch),
+                                            _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(K[t])),
+                                                             w[t & 15]));
+        const __m256i S0 = XOR3(ROTR(a, 28), ROTR(a, 34), ROTR(a, 39));
+        const __m256i maj = XOR3(_mm256_and_si256(a, b), _mm256_and_si256(a, c), _mm256_and_si256(b, c));
+        const __m256i t2 = _mm256_add_epi64(S0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi64(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi64(t1, t2);
+    }
+
+    s[0] = _mm256_add_epi64(s[0], a);
+    s[1] = _mm256_add_epi64(s[1], b);
+    s[2] = _mm256_add_epi64(s[2], c);
+    s[3] = _mm256_add_epi64(s[3], d);
+    s[4] = _mm256_add_epi64(s[4], e);
+    s[5] = _mm256_add_epi64(s[5], f);
+    s[6] = _mm256_add_epi64(s[6], g);
+    s[7] = _mm256_add_epi64(s[7], h);
+    for (int i = 0; i < 8; i++) _mm256_storeu_si256(reinterpret_cast<__m256i *>(state[i]), s[i]);
+}
+
+#else
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static void compress(State state, const Words words) {
+    uint64_t w[16][SHA512_LANES], v[8][SHA512_LANES];
+    memcpy(w, words, sizeof(w));
+    memcpy(v, state, sizeof(v));
+
+    // every step is done for all lanes, the inner loops vectorize where the target allows it
+    for (int t = 0; t < 80; t++) {
+        uint64_t *wt = w[t & 15];
+        if (t >= 16) {
+            const uint64_t *w15 = w[(t - 15) & 15], *w7 = w[(t - 7) & 15], *w2 = w[(t - 2) & 15];
+            for (int l = 0; l < SHA512_LANES; l++) {
+                wt[l] += (ROTR(w15[l], 1) ^ ROTR(w15[l], 8) ^ (w15[l] >> 7)) + w7[l] +
+                         (ROTR(w2[l], 19) ^ ROTR(w2[l], 61) ^ (w2[l] >> 6));
+            }
+        }
+        for (int l = 0; l < SHA512_LANES; l++) {
+            const uint64_t a = v[0][l], b = v[1][l], c = v[2][l], e = v[4][l], f = v[5][l], g = v[6][l];
+            const uint64_t t1 = v[7][l] + (ROTR(e, 14) ^ ROTR(e, 18) ^ ROTR(e, 41)) + ((e & f) ^ (~e & g)) +
+                                K[t] + wt[l];
+            const uint64_t t2 = (ROTR(a, 28) ^ ROTR(a, 34) ^ ROTR(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            v[7][l] = g;
+            v[6][l] = f;
+            v[5][l] = e;
+            v[4][l] = v[3][l] + t1;
+            v[3][l] = c;
+            v[2][l] = b;
+            v[1][l] = a;
+            v[0][l] = t1 + t2;
+        }
+    }
+
+    for (int i = 0; i < 8; i++) for (int l = 0; l < SHA512_LANES; l++) state[i][l] += v[i][l];
+}
+
+#endif
+
+// position of a lane in its segmented message
+typedef struct LaneCursor {
+    size_t segment;
+    size_t offset;
+    uint64_t length;
+    size_t blocks;
+} LaneCursor;
+
+// copy the next 128 byte block of a lane, with padding and length in the last block
+static void nextBlock(unsigned char *block, const SHA512Lane *lane, LaneCursor *cursor, size_t index) {
+    const uint64_t start = static_cast<uint64_t>(index) * SHA512_BLOCKBYTES;
+    size_t filled = 0;
+
+    while (filled < SHA512_BLOCKBYTES && cursor->segment < lane->count) {
+        const ED25519Segment *segment = lane->segments + cursor->segment;
+        size_t n = segment->length - cursor->offset;
+        if (n > SHA512_BLOCKBYTES - filled) n = SHA512_BLOCKBYTES - filled;
+        memcpy(block + filled, segment->data + cursor->offset, n);
+        filled += n;
+        cursor->offset += n;
+        if (cursor->offset == segment->length) {
+            cursor->segment++;
+            cursor->offset = 0;
+        }
+    }
+
+    memset(block + filled, 0, SHA512_BLOCKBYTES - filled);
+    if (start + filled == cursor->length && cursor->length < start + SHA512_BLOCKBYTES) block[filled] = 0x80;
+    if (index == cursor->blocks - 1) {
+        const uint64_t bits = cursor->length << 3;
+        for (int i = 0; i < 8; i++) block[SHA512_BLOCKBYTES - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+}
+
+void sha512x4(const SHA512Lane *lanes, size_t count) {
+    if (count > SHA512_LANES) count = SHA512_LANES;
+
+    LaneCursor cursors[SHA512_LANES];
+    size_t maxBlocks = 0;
+    for (size_t l = 0; l < count; l++) {
+        cursors[l].segment = 0;
+        cursors[l].offset = 0;
+        cursors[l].length = 0;
+        for (size_t s = 0; s < lanes[l].count; s++) cursors[l].length += lanes[l].segments[s].length;
+        // the data, at least one padding byte and the 16 byte length field
+        cursors[l].blocks = static_cast<size_t>((cursors[l].length + 17 + SHA512_BLOCKBYTES - 1) / SHA512_BLOCKBYTES);
+        if (cursors[l].blocks > maxBlocks) maxBlocks = cursors[l].blocks;
+    }
+
+    State state, next;
+    Words words;
+    unsigned char block[SHA512_BLOCKBYTES];
+    for (int i = 0; i < 8; i++) for (int l = 0; l < SHA512_LANES; l++) state[i][l] = IV[i];
+    memset(words, 0, sizeof(words));
+
+    for (size_t index = 0; index < maxBlocks; index++) {
+        // lanes that are done or unused compress garbage, their state is not updated
+        for (size_t l = 0; l < count; l++) {
+            if (index >= cursors[l].blocks) continue;
+            nextBlock(block, lanes + l, cursors + l, index);
+            for (int i = 0; i < 16; i++) {
+                uint64_t word = 0;
+                for (int j = 0; j < 8; j++) word = (word << 8) | block[i * 8 + j];
+                words[i][l] = word;
+            }
+        }
+
+        memcpy(next, state, sizeof(next));
+        compress(next, words);
+        for (size_t l = 0; l < count; l++) {
+            if (index >= cursors[l].blocks) continue;
+            for (int i = 0; i < 8; i++) state[i][l] = next[i][l];
+        }
+    }
+
+    for (size_t l = 0; l < count; l++) {
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 8; j++) {
+                lanes[l].digest[i * 8 + j] = static_cast<unsigned char>(state[i][l] >> (56 - 8 * j));
+            }
+        }
+    }
+}
+
+bool sha512x4Vectorized() {
+#if defined(__AVX2__)
+    return true;
+#else
+    return false;
+#endif
+}
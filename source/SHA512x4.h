@@ -0,0 +1,61 @@
+/*!
+ * @file
+ * @brief Multi-buffer SHA-512.
+ *
+ * Hashes up to four independent messages at once, one message per 64 bit
+ * lane. On hosts compiled with AVX2 (-mavx2) the four lanes run in one
+ * vector register, otherwise a portable version processes the lanes in
+ * plain loops. This is meant for the backend, which verifies many short
+ * messages; on the devices the single buffer SHA512 class is the better fit.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-16
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SHA512X4_H
+#define UBIRCH_MBED_CRYPTO_SHA512X4_H
+
+#include "ED25519Core.h"
+#include "SHA512.h"
+
+#define SHA512_LANES 4
+
+/**
+ * A message to hash in one lane, given as segments.
+ */
+typedef struct SHA512Lane {
+    const ED25519Segment *segments;
+    size_t count;
+    unsigned char *digest;
+} SHA512Lane;
+
+/**
+ * Hash up to SHA512_LANES messages at once. The messages may have different lengths.
+ * @param lanes the messages and their output buffers
+ * @param count the number of messages, at most SHA512_LANES
+ */
+void sha512x4(const SHA512Lane *lanes, size_t count);
+
+/**
+ * @return true if the AVX2 implementation is compiled in
+ */
+bool sha512x4Vectorized();
+
+#endif //UBIRCH_MBED_CRYPTO_SHA512X4_H
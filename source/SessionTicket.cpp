@@ -0,0 +1,161 @@
+/*!
+ * @file
+ * @brief Session resumption after a completed key exchange.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-26
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "SessionTicket.h"
+#include "CRC32.h"
+#include "SHA512.h"
+
+#define SESSION_RECORD_VERSION 1
+#define SESSION_REQUEST 'R'
+#define SESSION_RESPONSE 'A'
+// type, id and counter are signed
+#define SESSION_SIGNED_BYTES (SESSION_RESUME_BYTES - crypto_sign_BYTES)
+
+static void put32(unsigned char *p, uint32_t value) {
+    p[0] = static_cast<unsigned char>(value >> 24);
+    p[1] = static_cast<unsigned char>(value >> 16);
+    p[2] = static_cast<unsigned char>(value >> 8);
+    p[3] = static_cast<unsigned char>(value);
+}
+
+static uint32_t get32(const unsigned char *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+SessionTicket::SessionTicket() : counter(0), role(SESSION_DEVICE), issued(false) {}
+
+bool SessionTicket::issue(const unsigned char *deviceMessage, const unsigned char *serverMessage, SessionRole role) {
+    clear();
+    if (deviceMessage == NULL || serverMessage == NULL) return false;
+
+    unsigned char digest[SHA512_BYTES];
+    SHA512 hash;
+    hash.update(deviceMessage, SESSION_MESSAGE_BYTES);
+    hash.update(serverMessage, SESSION_MESSAGE_BYTES);
+    hash.finish(digest);
+    memcpy(id, digest, SESSION_TICKET_ID_BYTES);
+
+    const unsigned char *peerMessage = role == SESSION_DEVICE ? serverMessage : deviceMessage;
+    memcpy(peerKey.key, peerMessage, crypto_sign_PUBLICKEYBYTES);
+    this->role = role;
+    issued = true;
+
+    return true;
+}
+
+void SessionTicket::message(unsigned char *header, char type, uint32_t counter) const {
+    header[0] = static_cast<unsigned char>(type);
+    memcpy(header + 1, id, SESSION_TICKET_ID_BYTES);
+    put32(header + 1 + SESSION_TICKET_ID_BYTES, counter);
+}
+
+bool SessionTicket::sign(ED25519KeyPair &keyPair, unsigned char *out, char type, uint32_t counter) const {
+    message(out, type, counter);
+    ED25519Signature *signature = keyPair.sign(out, SESSION_SIGNED_BYTES);
+    if (signature == NULL) return false;
+    memcpy(out + SESSION_SIGNED_BYTES, signature->signature, crypto_sign_BYTES);
+    delete signature;
+    return true;
+}
+
+bool SessionTicket::verify(const unsigned char *in, size_t length, char type, uint32_t *counter) const {
+    if (!issued || in == NULL || length != SESSION_RESUME_BYTES) return false;
+
+    // the cheap checks first, a signature is only verified for this ticket
+    unsigned char expected[SESSION_SIGNED_BYTES];
+    *counter = get32(in + 1 + SESSION_TICKET_ID_BYTES);
+    message(expected, type, *counter);
+    if (memcmp(expected, in, SESSION_SIGNED_BYTES) != 0) return false;
+
+    const ED25519Segment segment = {in, SESSION_SIGNED_BYTES};
+    return ed25519VerifySegments(in + SESSION_SIGNED_BYTES, peerKey.key, &segment, 1);
+}
+
+bool SessionTicket::request(ED25519KeyPair &keyPair, unsigned char *request) {
+    if (!issued || role != SESSION_DEVICE || request == NULL || counter == 0xFFFFFFFF) return false;
+    if (!sign(keyPair, request, SESSION_REQUEST, counter + 1)) return false;
+    counter++;
+    return true;
+}
+
+bool SessionTicket::accept(ED25519KeyPair &keyPair, const unsigned char *request, size_t length,
+                           unsigned char *response) {
+    uint32_t requested;
+    if (role != SESSION_SERVER || response == NULL) return false;
+    if (!verify(request, length, SESSION_REQUEST, &requested) || requested <= counter) return false;
+    if (!sign(keyPair, response, SESSION_RESPONSE, requested)) return false;
+    counter = requested;
+    return true;
+}
+
+bool SessionTicket::confirm(const unsigned char *response, size_t length) {
+    uint32_t confirmed;
+    if (role != SESSION_DEVICE) return false;
+    return verify(response, length, SESSION_RESPONSE, &confirmed) && confirmed == counter;
+}
+
+bool SessionTicket::save(unsigned char *record, size_t length) const {
+    if (!issued || record == NULL || length < SESSION_RECORD_BYTES) return false;
+
+    unsigned char *p = record;
+    *p++ = SESSION_RECORD_VERSION;
+    *p++ = static_cast<unsigned char>(role);
+    *p++ = 0;
+    *p++ = 0;
+    put32(p, counter);
+    p += 4;
+    memcpy(p, id, SESSION_TICKET_ID_BYTES);
+    p += SESSION_TICKET_ID_BYTES;
+    memcpy(p, peerKey.key, crypto_sign_PUBLICKEYBYTES);
+    p += crypto_sign_PUBLICKEYBYTES;
+    put32(p, crc32(0, record, static_cast<size_t>(p - record)));
+
+    return true;
+}
+
+bool SessionTicket::load(const unsigned char *record, size_t length) {
+    clear();
+    if (record == NULL || length < SESSION_RECORD_BYTES) return false;
+    if (record[0] != SESSION_RECORD_VERSION || (record[1] != SESSION_DEVICE && record[1] != SESSION_SERVER))
+        return false;
+    if (crc32(0, record, SESSION_RECORD_BYTES - 4) != get32(record + SESSION_RECORD_BYTES - 4)) return false;
+
+    role = static_cast<SessionRole>(record[1]);
+    counter = get32(record + 4);
+    memcpy(id, record + 8, SESSION_TICKET_ID_BYTES);
+    memcpy(peerKey.key, record + 8 + SESSION_TICKET_ID_BYTES, crypto_sign_PUBLICKEYBYTES);
+    issued = true;
+
+    return true;
+}
+
+void SessionTicket::clear() {
+    memset(&peerKey, 0, sizeof(peerKey));
+    memset(id, 0, sizeof(id));
+    counter = 0;
+    issued = false;
+}
@@ -0,0 +1,162 @@
+/*!
+ * @file
+ * @brief Session resumption after a completed key exchange.
+ *
+ * The four step key exchange D[D], S[S], S[D], D[S] costs the device two
+ * signatures, two verifications and several round trips. Once both sides
+ * verified each other, they keep a ticket: the verified public key of the
+ * peer, a 16 byte ticket id and a counter. The id is the start of
+ * SHA-512(device message || server message) of the exchange, so both sides
+ * derive it without sending it.
+ *
+ * A reconnect is a single signed request and a signed answer, all numbers
+ * big endian:
+ *
+ * ```
+ * request:  ['R' | id (16) | counter (4) | device signature (64)]
+ * response: ['A' | id (16) | counter (4) | server signature (64)]
+ * ```
+ *
+ * The device increments the counter for every request, the server only
+ * accepts counters above the last accepted one, so a recorded request can
+ * not be replayed. Save the ticket after each request() and accept(), or
+ * the peer will reject the reused counter and a full exchange is needed.
+ * The server side of the host tests is TESTS/host_tests/session.py.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-26
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SESSIONTICKET_H
+#define UBIRCH_MBED_CRYPTO_SESSIONTICKET_H
+
+#include <stdint.h>
+#include "KeyPair.h"
+
+/** The length of the key exchange messages [publicKey | nonce]. */
+#define SESSION_MESSAGE_BYTES (crypto_sign_PUBLICKEYBYTES + 4)
+#define SESSION_TICKET_ID_BYTES 16
+/** The length of resumption requests and responses. */
+#define SESSION_RESUME_BYTES (1 + SESSION_TICKET_ID_BYTES + 4 + crypto_sign_BYTES)
+/** The length of a saved ticket: version, role, counter, id, peer key and CRC-32. */
+#define SESSION_RECORD_BYTES (4 + 4 + SESSION_TICKET_ID_BYTES + crypto_sign_PUBLICKEYBYTES + 4)
+
+enum SessionRole {
+    SESSION_DEVICE = 'D',
+    SESSION_SERVER = 'S'
+};
+
+/**
+ * The ticket of a peer that was verified in a full key exchange.
+ *
+ * @code
+ * // after the key exchange succeeded
+ * ticket.issue(deviceMessage, serverMessage, SESSION_DEVICE);
+ * ticket.save(record, sizeof(record));
+ *
+ * // on reconnect
+ * ticket.load(record, sizeof(record));
+ * ticket.request(deviceKey, request);
+ * ticket.save(record, sizeof(record));
+ * send(request, SESSION_RESUME_BYTES);
+ * if (!ticket.confirm(response, responseLength)) fullKeyExchange();
+ * @endcode
+ */
+class SessionTicket {
+public:
+    SessionTicket();
+
+    /**
+     * Issue a ticket after a successful key exchange.
+     * @param deviceMessage the device message [publicKey | nonce] of the exchange
+     * @param serverMessage the server message [publicKey | nonce] of the exchange
+     * @param role the side of the exchange this ticket is kept on, the other side is the peer
+     * @return false if a message is missing
+     */
+    bool issue(const unsigned char *deviceMessage, const unsigned char *serverMessage, SessionRole role);
+
+    /**
+     * Create a signed resumption request, advancing the counter (device side).
+     * @param keyPair the key pair of the device, as used in the key exchange
+     * @param request the output buffer, SESSION_RESUME_BYTES long
+     * @return false if there is no device ticket or the key pair can not sign
+     */
+    bool request(ED25519KeyPair &keyPair, unsigned char *request);
+
+    /**
+     * Check a resumption request and create the signed response (server side).
+     * @param keyPair the key pair of the server, as used in the key exchange
+     * @param request the request of the device
+     * @param length the length of the request
+     * @param response the output buffer, SESSION_RESUME_BYTES long
+     * @return false if the request is not for this ticket, a replay or not signed by the peer
+     */
+    bool accept(ED25519KeyPair &keyPair, const unsigned char *request, size_t length, unsigned char *response);
+
+    /**
+     * Check the response to the last request (device side).
+     * @param response the response of the server
+     * @param length the length of the response
+     * @return true if the server confirmed the session
+     */
+    bool confirm(const unsigned char *response, size_t length);
+
+    /**
+     * Write the ticket to a record, to keep it in flash.
+     * @param record the output buffer
+     * @param length the size of the buffer, at least SESSION_RECORD_BYTES
+     * @return false if there is no ticket or the buffer is too small
+     */
+    bool save(unsigned char *record, size_t length) const;
+
+    /**
+     * Read a ticket from a saved record.
+     * @param record the record written by save()
+     * @param length the length of the record
+     * @return false if the record is damaged, the ticket is cleared then
+     */
+    bool load(const unsigned char *record, size_t length);
+
+    /**
+     * Drop the ticket, the next connection needs a full key exchange.
+     */
+    void clear();
+
+    bool valid() const { return issued; }
+
+    const ED25519PublicKey *getPeerKey() const { return issued ? &peerKey : NULL; }
+
+    uint32_t getCounter() const { return counter; }
+
+private:
+    ED25519PublicKey peerKey;
+    unsigned char id[SESSION_TICKET_ID_BYTES];
+    uint32_t counter;
+    SessionRole role;
+    bool issued;
+
+    void message(unsigned char *header, char type, uint32_t counter) const;
+
+    bool sign(ED25519KeyPair &keyPair, unsigned char *out, char type, uint32_t counter) const;
+
+    bool verify(const unsigned char *in, size_t length, char type, uint32_t *counter) const;
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SESSIONTICKET_H
@@ -0,0 +1,224 @@
+/*!
+ * @file
+ * @brief Double buffered signing and transmission of a continuous packet stream.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-30
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "SignPipeline.h"
+#include "Base64.h"
+
+#ifndef __MBED__
+#include <ctime>
+#endif
+
+SignPipeline::SignPipeline(const ED25519SigningContext &context, PacketSink &sink, bool base64)
+        : context(context), sink(sink), base64(base64), fillIndex(0), sendIndex(0), acquired(false),
+          running(false), stopping(false), sentCount(0), failedCount(0), stallCount(0)
+#ifdef __MBED__
+        , freeSlots(SIGN_PIPELINE_BUFFERS), queuedSlots(0), thread(osPriorityNormal, SIGN_PIPELINE_STACK)
+#else
+        , freeCount(SIGN_PIPELINE_BUFFERS), queuedCount(0)
+#endif
+{
+#ifndef __MBED__
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&changed, NULL);
+#endif
+}
+
+SignPipeline::~SignPipeline() {
+    stop();
+#ifndef __MBED__
+    pthread_cond_destroy(&changed);
+    pthread_mutex_destroy(&lock);
+#endif
+}
+
+#ifdef __MBED__
+
+bool SignPipeline::start() {
+    if (running) return false;
+    running = thread.start(callback(this, &SignPipeline::transmitLoop)) == osOK;
+    return running;
+}
+
+bool SignPipeline::waitFree(uint32_t timeout) {
+    return freeSlots.wait(timeout == SIGN_PIPELINE_FOREVER ? osWaitForever : timeout) > 0;
+}
+
+void SignPipeline::releaseFree() {
+    freeSlots.release();
+}
+
+void SignPipeline::waitQueued() {
+    queuedSlots.wait(osWaitForever);
+}
+
+void SignPipeline::releaseQueued() {
+    queuedSlots.release();
+}
+
+#else
+
+void *SignPipeline::run(void *pipeline) {
+    static_cast<SignPipeline *>(pipeline)->transmitLoop();
+    return NULL;
+}
+
+bool SignPipeline::start() {
+    if (running) return false;
+    running = pthread_create(&thread, NULL, run, this) == 0;
+    return running;
+}
+
+bool SignPipeline::waitFree(uint32_t timeout) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&lock);
+    while (freeCount == 0) {
+        if (timeout == SIGN_PIPELINE_FOREVER) pthread_cond_wait(&changed, &lock);
+        else if (pthread_cond_timedwait(&changed, &lock, &deadline) != 0) break;
+    }
+    const bool available = freeCount > 0;
+    if (available) freeCount--;
+    pthread_mutex_unlock(&lock);
+    return available;
+}
+
+void SignPipeline::releaseFree() {
+    pthread_mutex_lock(&lock);
+    freeCount++;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+}
+
+void SignPipeline::waitQueued() {
+    pthread_mutex_lock(&lock);
+    while (queuedCount == 0) pthread_cond_wait(&changed, &lock);
+    queuedCount--;
+    pthread_mutex_unlock(&lock);
+}
+
+void SignPipeline::releaseQueued() {
+    pthread_mutex_lock(&lock);
+    queuedCount++;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+}
+
+#endif
+
+void SignPipeline::stop() {
+    if (!running) return;
+    if (acquired) {
+        acquired = false;
+        releaseFree();
+    }
+    flush(SIGN_PIPELINE_FOREVER);
+
+    // wake the transmit thread without a packet, it ends then
+    stopping = true;
+    releaseQueued();
+#ifdef __MBED__
+    thread.join();
+#else
+    pthread_join(thread, NULL);
+#endif
+    running = false;
+}
+
+unsigned char *SignPipeline::acquire(uint32_t timeout) {
+    if (!running || stopping) return NULL;
+    if (acquired) return slots[fillIndex].packet + crypto_sign_BYTES;
+
+    // the transport is behind if no buffer is free right away
+    if (!waitFree(0)) {
+        stallCount++;
+        if (timeout == 0 || !waitFree(timeout)) return NULL;
+    }
+    acquired = true;
+    return slots[fillIndex].packet + crypto_sign_BYTES;
+}
+
+bool SignPipeline::submit(size_t length) {
+    if (!acquired || length > SIGN_PIPELINE_PAYLOAD) return false;
+
+    // sign in place, the signature goes in front of the payload
+    Slot &slot = slots[fillIndex];
+    ED25519Signature signature;
+    if (!context.sign(slot.packet + crypto_sign_BYTES, length, signature)) return false;
+    memcpy(slot.packet, signature.signature, crypto_sign_BYTES);
+    slot.length = crypto_sign_BYTES + length;
+
+    if (base64) {
+        Base64Encoder encoder;
+        const size_t encoded = encoder.Update(slot.packet, slot.length, slot.encoded);
+        slot.length = encoded + encoder.Finish(slot.encoded + encoded);
+    }
+
+    acquired = false;
+    fillIndex = (fillIndex + 1) % SIGN_PIPELINE_BUFFERS;
+    releaseQueued();
+    return true;
+}
+
+bool SignPipeline::send(const unsigned char *payload, size_t length, uint32_t timeout) {
+    if (payload == NULL || length > SIGN_PIPELINE_PAYLOAD) return false;
+    unsigned char *buffer = acquire(timeout);
+    if (buffer == NULL) return false;
+
+    memcpy(buffer, payload, length);
+    return submit(length);
+}
+
+bool SignPipeline::flush(uint32_t timeout) {
+    if (!running) return true;
+
+    // all buffers are free when the transport is done, take them and give them back
+    size_t taken = 0;
+    const size_t busy = acquired ? SIGN_PIPELINE_BUFFERS - 1 : SIGN_PIPELINE_BUFFERS;
+    while (taken < busy && waitFree(timeout)) taken++;
+    for (size_t i = 0; i < taken; i++) releaseFree();
+    return taken == busy;
+}
+
+void SignPipeline::transmitLoop() {
+    for (;;) {
+        waitQueued();
+        if (stopping) break;
+
+        const Slot &slot = slots[sendIndex];
+        const unsigned char *packet = base64 ? reinterpret_cast<const unsigned char *>(slot.encoded) : slot.packet;
+        if (sink.transmit(packet, slot.length)) sentCount++;
+        else failedCount++;
+
+        sendIndex = (sendIndex + 1) % SIGN_PIPELINE_BUFFERS;
+        releaseFree();
+    }
+}
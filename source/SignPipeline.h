@@ -0,0 +1,220 @@
+/*!
+ * @file
+ * @brief Double buffered signing and transmission of a continuous packet stream.
+ *
+ * A sensor loop that fills, signs, encodes and sends each packet in turn
+ * keeps either the CPU or the radio idle. The pipeline has a few fixed
+ * packet buffers: the caller fills and signs packet N+1 while a transmit
+ * thread hands packet N to the transport. When all buffers wait for the
+ * transport, acquire() blocks, so a slow transport slows down the producer
+ * instead of losing packets.
+ *
+ * A packet is the signature followed by the payload, the layout of
+ * crypto_sign(), Base64 encoded unless the pipeline is binary.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-30
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SIGNPIPELINE_H
+#define UBIRCH_MBED_CRYPTO_SIGNPIPELINE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "SigningContext.h"
+
+#ifdef __MBED__
+#include "mbed.h"
+#include "rtos.h"
+#else
+#include <pthread.h>
+#endif
+
+/** The number of packet buffers, two to overlap signing and sending, three to absorb jitter. */
+#ifndef SIGN_PIPELINE_BUFFERS
+#define SIGN_PIPELINE_BUFFERS 2
+#endif
+
+/** The largest payload of a packet. */
+#ifndef SIGN_PIPELINE_PAYLOAD
+#define SIGN_PIPELINE_PAYLOAD 256
+#endif
+
+/** The stack size of the transmit thread, it only runs the transport. */
+#ifndef SIGN_PIPELINE_STACK
+#define SIGN_PIPELINE_STACK 2048
+#endif
+
+/** Wait for a free buffer as long as it takes. */
+#define SIGN_PIPELINE_FOREVER 0xFFFFFFFFu
+
+#define SIGN_PIPELINE_PACKET_BYTES (crypto_sign_BYTES + SIGN_PIPELINE_PAYLOAD)
+#define SIGN_PIPELINE_ENCODED_BYTES (4 * ((SIGN_PIPELINE_PACKET_BYTES + 2) / 3))
+
+/**
+ * The transport of the signed packets, e.g. a radio or a FrameTransport.
+ * It is called from the transmit thread of the pipeline.
+ */
+class PacketSink {
+public:
+    virtual ~PacketSink() {};
+
+    /**
+     * Send one packet, blocking until it is sent.
+     * @param packet the packet, valid until the call returns
+     * @param length the packet length
+     * @return false if the packet could not be sent, it is not repeated
+     */
+    virtual bool transmit(const unsigned char *packet, size_t length) = 0;
+};
+
+/**
+ * Signs packets on the calling thread and sends them on a transmit thread.
+ *
+ * @code
+ * SignPipeline pipeline(context, radio);
+ * pipeline.start();
+ * while (running) {
+ *     unsigned char *payload = pipeline.acquire(SIGN_PIPELINE_FOREVER);
+ *     size_t length = readSensors(payload, SIGN_PIPELINE_PAYLOAD);
+ *     pipeline.submit(length);
+ * }
+ * pipeline.stop();
+ * @endcode
+ */
+class SignPipeline {
+public:
+    /**
+     * Create a pipeline, start() it before use.
+     * @param context the signing context, it must outlive the pipeline
+     * @param sink the transport, it must outlive the pipeline
+     * @param base64 false to send the binary packets
+     */
+    SignPipeline(const ED25519SigningContext &context, PacketSink &sink, bool base64 = true);
+
+    /**
+     * Send what is queued and stop the transmit thread.
+     */
+    ~SignPipeline();
+
+    /**
+     * Start the transmit thread, once.
+     * @return false if the thread could not be started
+     */
+    bool start();
+
+    /**
+     * Send what is queued and stop the transmit thread. Packets that are
+     * acquired but not submitted are dropped.
+     */
+    void stop();
+
+    /**
+     * Get the next free payload buffer, SIGN_PIPELINE_PAYLOAD bytes large.
+     * @param timeout the time to wait for the transport, in milliseconds
+     * @return the buffer, NULL if all buffers are still waiting for the transport
+     */
+    unsigned char *acquire(uint32_t timeout);
+
+    /**
+     * Sign and encode the acquired buffer and queue it for the transport.
+     * @param length the length of the payload
+     * @return false if no buffer is acquired, the payload is too long or the context has no key
+     */
+    bool submit(size_t length);
+
+    /**
+     * Copy a payload into the next free buffer and submit it.
+     * @param payload the payload
+     * @param length the length of the payload, at most SIGN_PIPELINE_PAYLOAD
+     * @param timeout the time to wait for a free buffer, in milliseconds
+     * @return false if no buffer became free in time or the payload was not submitted
+     */
+    bool send(const unsigned char *payload, size_t length, uint32_t timeout);
+
+    /**
+     * Wait until all queued packets are sent.
+     * @param timeout the time to wait for each queued packet, in milliseconds
+     * @return false if the transport did not finish in time
+     */
+    bool flush(uint32_t timeout);
+
+    /** @return the number of packets the transport sent */
+    uint32_t sent() const { return sentCount; }
+
+    /** @return the number of packets the transport failed to send */
+    uint32_t failed() const { return failedCount; }
+
+    /** @return how often acquire() found all buffers busy and had to wait for the transport */
+    uint32_t stalls() const { return stallCount; }
+
+private:
+    typedef struct Slot {
+        unsigned char packet[SIGN_PIPELINE_PACKET_BYTES];
+        char encoded[SIGN_PIPELINE_ENCODED_BYTES];
+        size_t length;
+    } Slot;
+
+    const ED25519SigningContext &context;
+    PacketSink &sink;
+    const bool base64;
+
+    Slot slots[SIGN_PIPELINE_BUFFERS];
+    size_t fillIndex;
+    size_t sendIndex;
+    bool acquired;
+    bool running;
+    volatile bool stopping;
+
+    volatile uint32_t sentCount;
+    volatile uint32_t failedCount;
+    uint32_t stallCount;
+
+#ifdef __MBED__
+    rtos::Semaphore freeSlots;
+    rtos::Semaphore queuedSlots;
+    rtos::Thread thread;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    size_t freeCount;
+    size_t queuedCount;
+    pthread_t thread;
+
+    static void *run(void *pipeline);
+#endif
+
+    bool waitFree(uint32_t timeout);
+
+    void releaseFree();
+
+    void waitQueued();
+
+    void releaseQueued();
+
+    void transmitLoop();
+
+    // not copyable, the transmit thread points to this instance
+    SignPipeline(const SignPipeline &);
+
+    SignPipeline &operator=(const SignPipeline &);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SIGNPIPELINE_H
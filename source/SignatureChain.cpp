@@ -0,0 +1,130 @@
+/*!
+ * @file
+ * @brief Hash chained signed message stream.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-15
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "SignatureChain.h"
+
+ChainedSigner::ChainedSigner(ED25519KeyPair &keyPair, const ED25519Signature *last) : keyPair(keyPair) {
+    if (last != NULL) head = *last;
+    else memset(head.signature, 0, crypto_sign_BYTES);
+}
+
+bool ChainedSigner::sign(const unsigned char *payload, size_t length, ED25519Signature *signature) {
+    const ED25519KeyCache *keys = keyPair.expand();
+    if (keys == NULL || signature == NULL) return false;
+
+    const ED25519Segment segments[2] = {
+            {head.signature, crypto_sign_BYTES},
+            {payload,        length}
+    };
+    ed25519SignSegments(signature->signature, &keys->expanded, keys->publicKey.key, segments, 2);
+    head = *signature;
+
+    return true;
+}
+
+ChainedVerifier::ChainedVerifier(ED25519KeyPair &keyPair, const ED25519Signature *last)
+        : keyPair(keyPair), linkedCount(0), arrivals(0), droppedCount(0) {
+    if (last != NULL) head = *last;
+    else memset(head.signature, 0, crypto_sign_BYTES);
+    link(head);
+    // an arrival stamp of 0 marks a free slot
+    memset(window, 0, sizeof(window));
+}
+
+ChainStatus ChainedVerifier::verify(const ED25519Signature *previous, const unsigned char *payload, size_t length,
+                                    const ED25519Signature *signature) {
+    const ED25519PublicKey *publicKey = keyPair.getPublicKey();
+    if (publicKey == NULL || previous == NULL || signature == NULL) return CHAIN_INVALID;
+    if (payload == NULL && length > 0) return CHAIN_INVALID;
+
+    // duplicates are recognized without verifying again, a message following an older link is stale
+    if (!memcmp(signature->signature, head.signature, crypto_sign_BYTES) || wasLinked(*signature))
+        return CHAIN_DUPLICATE;
+    if (memcmp(previous->signature, head.signature, crypto_sign_BYTES) && wasLinked(*previous))
+        return CHAIN_DUPLICATE;
+    for (int i = 0; i < CHAIN_REORDER_WINDOW; i++) {
+        if (window[i].arrival && !memcmp(signature->signature, window[i].signature.signature, crypto_sign_BYTES))
+            return CHAIN_DUPLICATE;
+    }
+
+    const ED25519Segment segments[2] = {
+            {previous->signature, crypto_sign_BYTES},
+            {payload,             length}
+    };
+    if (!ed25519VerifySegments(signature->signature, publicKey->key, segments, 2)) return CHAIN_INVALID;
+
+    if (!memcmp(previous->signature, head.signature, crypto_sign_BYTES)) {
+        link(*signature);
+        advance();
+        return CHAIN_LINKED;
+    }
+
+    // keep the link until the predecessor arrives, replacing the oldest one if needed
+    PendingLink *slot = window;
+    for (int i = 0; i < CHAIN_REORDER_WINDOW; i++) {
+        if (window[i].arrival < slot->arrival) slot = window + i;
+    }
+    if (slot->arrival) droppedCount++;
+    slot->previous = *previous;
+    slot->signature = *signature;
+    slot->arrival = ++arrivals;
+
+    return CHAIN_PENDING;
+}
+
+size_t ChainedVerifier::pending() const {
+    size_t count = 0;
+    for (int i = 0; i < CHAIN_REORDER_WINDOW; i++) if (window[i].arrival) count++;
+    return count;
+}
+
+bool ChainedVerifier::wasLinked(const ED25519Signature &signature) const {
+    const size_t count = linkedCount < CHAIN_LINKED_HISTORY ? linkedCount : CHAIN_LINKED_HISTORY;
+    for (size_t i = 0; i < count; i++) {
+        if (!memcmp(signature.signature, linked[i].signature, crypto_sign_BYTES)) return true;
+    }
+    return false;
+}
+
+void ChainedVerifier::link(const ED25519Signature &signature) {
+    head = signature;
+    linked[linkedCount++ % CHAIN_LINKED_HISTORY] = signature;
+}
+
+void ChainedVerifier::advance() {
+    // move the head along waiting messages as long as they follow it
+    bool linked = true;
+    while (linked) {
+        linked = false;
+        for (int i = 0; i < CHAIN_REORDER_WINDOW; i++) {
+            if (window[i].arrival && !memcmp(window[i].previous.signature, head.signature, crypto_sign_BYTES)) {
+                link(window[i].signature);
+                window[i].arrival = 0;
+                linked = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,173 @@
+/*!
+ * @file
+ * @brief Hash chained signed message stream.
+ *
+ * Every message signs the signature of its predecessor together with the
+ * payload: signature[n] = sign(signature[n-1] || payload[n]), the first
+ * message links to 64 zero bytes unless the chain is continued from a
+ * known signature. The previous signature is sent along with the payload,
+ * so the receiver notices gaps and reordering. Both sides only keep the
+ * last signature, payloads are signed and verified in place.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-15
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SIGNATURECHAIN_H
+#define UBIRCH_MBED_CRYPTO_SIGNATURECHAIN_H
+
+#include "KeyPair.h"
+
+/** The number of valid messages that can wait for a missing predecessor. */
+#ifndef CHAIN_REORDER_WINDOW
+#define CHAIN_REORDER_WINDOW 4
+#endif
+
+/** The number of recently linked signatures kept to recognize retransmitted messages. */
+#ifndef CHAIN_LINKED_HISTORY
+#define CHAIN_LINKED_HISTORY 4
+#endif
+
+/**
+ * Signs payloads as a chain.
+ *
+ * @code
+ * ChainedSigner signer(keyPair);
+ * ED25519Signature previous = signer.last();
+ * ED25519Signature signature;
+ * signer.sign(payload, length, &signature);
+ * send(previous, payload, signature);
+ * @endcode
+ */
+class ChainedSigner {
+public:
+    /**
+     * Start or continue a chain.
+     * @param keyPair the key pair to sign with
+     * @param last the last signature of the chain to continue, NULL to start a new chain
+     */
+    ChainedSigner(ED25519KeyPair &keyPair, const ED25519Signature *last = NULL);
+
+    /**
+     * Sign the next payload, linked to the last signature.
+     * @param payload the payload
+     * @param length the length of the payload
+     * @param signature the output buffer for the signature, it becomes the new chain head
+     * @return false if the key pair has no private key
+     */
+    bool sign(const unsigned char *payload, size_t length, ED25519Signature *signature);
+
+    /**
+     * @return the last signature, the one the next payload will be linked to
+     */
+    const ED25519Signature &last() const { return head; }
+
+private:
+    ED25519KeyPair &keyPair;
+    ED25519Signature head;
+};
+
+/** The result of verifying a chained message. */
+typedef enum ChainStatus {
+    /** the signature is not valid */
+    CHAIN_INVALID = 0,
+    /** the message follows the chain head and is the new head */
+    CHAIN_LINKED,
+    /** the message is valid, but its predecessor is still missing */
+    CHAIN_PENDING,
+    /** the message was already seen or its predecessor is no longer the head, it is not verified */
+    CHAIN_DUPLICATE
+} ChainStatus;
+
+/**
+ * Verifies a chain of messages, accepting messages that arrive out of order.
+ *
+ * Valid messages that do not follow the chain head wait in a small window
+ * until their predecessor arrives, then the chain moves past them. If the
+ * window is full, the oldest waiting message is dropped and counted.
+ * The last CHAIN_LINKED_HISTORY linked signatures are kept, so a retransmitted
+ * message that was already linked is recognized before it is verified and does
+ * not take a slot in the window.
+ *
+ * @code
+ * ChainedVerifier verifier(peerKey);
+ * switch (verifier.verify(&previous, payload, length, &signature)) {
+ *     case CHAIN_LINKED: ...
+ * }
+ * @endcode
+ */
+class ChainedVerifier {
+public:
+    /**
+     * Start or continue verifying a chain.
+     * @param keyPair the key pair holding the public key of the sender
+     * @param last the last known signature of the chain, NULL for a new chain
+     */
+    ChainedVerifier(ED25519KeyPair &keyPair, const ED25519Signature *last = NULL);
+
+    /**
+     * Verify a message and link it into the chain.
+     * @param previous the signature of the preceding message, as sent with the message
+     * @param payload the payload
+     * @param length the length of the payload
+     * @param signature the signature of the message
+     * @return the status of the message
+     */
+    ChainStatus verify(const ED25519Signature *previous, const unsigned char *payload, size_t length,
+                       const ED25519Signature *signature);
+
+    /**
+     * @return the signature of the last message linked to the chain
+     */
+    const ED25519Signature &last() const { return head; }
+
+    /**
+     * @return the number of valid messages waiting for their predecessor
+     */
+    size_t pending() const;
+
+    /**
+     * @return the number of waiting messages dropped because the window was full
+     */
+    uint32_t dropped() const { return droppedCount; }
+
+private:
+    typedef struct PendingLink {
+        ED25519Signature previous;
+        ED25519Signature signature;
+        uint32_t arrival;
+    } PendingLink;
+
+    ED25519KeyPair &keyPair;
+    ED25519Signature head;
+    PendingLink window[CHAIN_REORDER_WINDOW];
+    ED25519Signature linked[CHAIN_LINKED_HISTORY];
+    size_t linkedCount;
+    uint32_t arrivals;
+    uint32_t droppedCount;
+
+    bool wasLinked(const ED25519Signature &signature) const;
+
+    void link(const ED25519Signature &signature);
+
+    void advance();
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SIGNATURECHAIN_H
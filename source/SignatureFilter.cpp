@@ -0,0 +1,163 @@
+/*!
+ * @file
+ * @brief Cheap pre-checks that reject malformed signatures before verifying.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-25
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include <nacl/armnacl.h>
+#include "SignatureFilter.h"
+#include "CryptoStats.h"
+#include "RevocationList.h"
+
+extern "C" {
+#include "ge25519.h"
+}
+
+// the group order L = 2^252 + 27742317777372353535851937790883648493, little endian
+static const unsigned char order[32] = {
+        0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+// the y coordinates of the points of order 1, 2, 4 and 8, the sign of x does not matter
+static const unsigned char smallOrder[][32] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+         0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f},
+        {0x26, 0xe8, 0x95, 0x8f, 0xc2, 0xb2, 0x27, 0xb0, 0x45, 0xc3, 0xf4, 0x89, 0xf2, 0xef, 0x98, 0xf0,
+         0xd5, 0xdf, 0xac, 0x05, 0xd3, 0xc6, 0x33, 0x39, 0xb1, 0x38, 0x02, 0x88, 0x6d, 0x53, 0xfc, 0x05},
+        {0xc7, 0x17, 0x6a, 0x70, 0x3d, 0x4d, 0xd8, 0x4f, 0xba, 0x3c, 0x0b, 0x76, 0x0d, 0x10, 0x67, 0x0f,
+         0x2a, 0x20, 0x53, 0xfa, 0x2c, 0x39, 0xcc, 0xc6, 0x4e, 0xc7, 0xfd, 0x77, 0x92, 0xac, 0x03, 0x7a}
+};
+
+// S < L, comparing the little endian numbers from the top
+static bool canonicalScalar(const unsigned char *s) {
+    for (int i = 31; i >= 0; i--) {
+        if (s[i] != order[i]) return s[i] < order[i];
+    }
+    return false;
+}
+
+// y < p = 2^255 - 19 and y is not the y of a small order point
+static bool acceptablePoint(const unsigned char *point) {
+    unsigned char y[32];
+    memcpy(y, point, sizeof(y));
+    y[31] &= 0x7f;
+
+    bool high = y[31] == 0x7f;
+    for (int i = 1; high && i < 31; i++) high = y[i] == 0xff;
+    if (high && y[0] >= 0xed) return false;
+
+    for (size_t i = 0; i < sizeof(smallOrder) / sizeof(smallOrder[0]); i++) {
+        if (!memcmp(y, smallOrder[i], sizeof(y))) return false;
+    }
+    return true;
+}
+
+static bool decodablePoint(const unsigned char *point) {
+    ge25519 P;
+    return ge25519_unpackneg_vartime(&P, point) == 0;
+}
+
+ED25519SignatureFilter::ED25519SignatureFilter() : blocked(0), revocations(NULL), lastKeyValid(false) {
+    resetCounters();
+}
+
+bool ED25519SignatureFilter::block(const ED25519PublicKey *publicKey) {
+    if (publicKey == NULL || blocked == SIGNATURE_FILTER_BLACKLIST) return false;
+    blacklist[blocked++] = *publicKey;
+    if (lastKeyValid && !memcmp(lastKey.key, publicKey->key, crypto_sign_PUBLICKEYBYTES)) lastKeyValid = false;
+    return true;
+}
+
+FilterResult ED25519SignatureFilter::precheck(const unsigned char *signature, size_t signatureLength,
+                                              const unsigned char *publicKey, size_t publicKeyLength) {
+    if (signature == NULL || signatureLength != crypto_sign_BYTES ||
+        publicKey == NULL || publicKeyLength != crypto_sign_PUBLICKEYBYTES)
+        return FILTER_LENGTH;
+
+    if (!canonicalScalar(signature + 32)) return FILTER_SCALAR;
+
+    for (size_t i = 0; i < blocked; i++) {
+        if (!memcmp(blacklist[i].key, publicKey, crypto_sign_PUBLICKEYBYTES)) return FILTER_BLACKLISTED;
+    }
+    if (revocations != NULL && revocations->isRevoked(publicKey)) return FILTER_BLACKLISTED;
+
+    if (!acceptablePoint(signature)) return FILTER_COMMITMENT;
+    const bool knownKey = lastKeyValid && !memcmp(lastKey.key, publicKey, crypto_sign_PUBLICKEYBYTES);
+    if (!knownKey && !acceptablePoint(publicKey)) return FILTER_PUBLIC_KEY;
+
+    // the field exponentiations come last
+    if (!knownKey) {
+        if (!decodablePoint(publicKey)) return FILTER_PUBLIC_KEY;
+        memcpy(lastKey.key, publicKey, crypto_sign_PUBLICKEYBYTES);
+        lastKeyValid = true;
+    }
+    if (!decodablePoint(signature)) return FILTER_COMMITMENT;
+
+    return FILTER_PASSED;
+}
+
+FilterResult ED25519SignatureFilter::check(const unsigned char *signature, size_t signatureLength,
+                                           const unsigned char *publicKey, size_t publicKeyLength) {
+    CRYPTO_STATS(CRYPTO_STATS_REJECT);
+    const FilterResult result = precheck(signature, signatureLength, publicKey, publicKeyLength);
+
+    checkedCount++;
+    rejectedCount[result]++;
+    // only rejected signatures are counted in the statistics
+    if (result == FILTER_PASSED) CRYPTO_STATS_DISCARD();
+
+    return result;
+}
+
+bool ED25519SignatureFilter::verify(const unsigned char *message, size_t length,
+                                    const unsigned char *signature, size_t signatureLength,
+                                    const unsigned char *publicKey, size_t publicKeyLength) {
+    if (message == NULL && length > 0) return false;
+    if (check(signature, signatureLength, publicKey, publicKeyLength) != FILTER_PASSED) return false;
+
+    CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+    const ED25519Segment segment = {message, length};
+    if (!ed25519VerifySegments(signature, publicKey, &segment, 1)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+    return true;
+}
+
+uint32_t ED25519SignatureFilter::rejected() const {
+    return checkedCount - rejectedCount[FILTER_PASSED];
+}
+
+uint32_t ED25519SignatureFilter::rejected(FilterResult reason) const {
+    return reason > FILTER_PASSED && reason < FILTER_RESULTS ? rejectedCount[reason] : 0;
+}
+
+void ED25519SignatureFilter::resetCounters() {
+    checkedCount = 0;
+    memset(rejectedCount, 0, sizeof(rejectedCount));
+}
@@ -0,0 +1,158 @@
+/*!
+ * @file
+ * @brief Cheap pre-checks that reject malformed signatures before verifying.
+ *
+ * A gateway receives broken and hostile packets as well. Verifying them costs
+ * the full double scalar multiplication, so the filter first runs the checks
+ * that need no group operation at all, cheapest first:
+ *
+ * - the lengths of signature and public key,
+ * - S must be below the group order L (RFC 8032 5.1.7),
+ * - keys on the blacklist or a linked RevocationList,
+ * - R and A must be canonical encodings of points that do not have small order,
+ * - R and A must decode to points on the curve (one field exponentiation each,
+ *   skipped for A if it is the same key as in the last check).
+ *
+ * Only then the signature is verified. Rejected packets cost microseconds
+ * instead of a full verification. The filter counts the checked and rejected
+ * signatures by reason. With UBIRCH_CRYPTO_STATS_ENABLED the time spent on
+ * rejected signatures goes to CRYPTO_STATS_REJECT, so cycles / calls of that
+ * operation are the cycles per rejected packet.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-25
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SIGNATUREFILTER_H
+#define UBIRCH_MBED_CRYPTO_SIGNATUREFILTER_H
+
+#include <stdint.h>
+#include "KeyPair.h"
+
+class RevocationList;
+
+#ifndef SIGNATURE_FILTER_BLACKLIST
+/** The number of public keys that can be blocked. */
+#define SIGNATURE_FILTER_BLACKLIST 8
+#endif
+
+enum FilterResult {
+    FILTER_PASSED = 0,
+    /** signature or public key have the wrong length or are missing */
+    FILTER_LENGTH,
+    /** S is not below the group order */
+    FILTER_SCALAR,
+    /** the public key is blacklisted or revoked */
+    FILTER_BLACKLISTED,
+    /** R is not canonical, has small order or is not on the curve */
+    FILTER_COMMITMENT,
+    /** A is not canonical, has small order or is not on the curve */
+    FILTER_PUBLIC_KEY,
+    FILTER_RESULTS
+};
+
+/**
+ * Rejects malformed signatures before they are verified.
+ *
+ * @code
+ * ED25519SignatureFilter filter;
+ * filter.block(&revokedKey);
+ * if (!filter.verify(payload, payloadLength, signature, 64, publicKey, 32)) return;
+ * printf("%u of %u rejected\r\n", filter.rejected(), filter.checked());
+ * @endcode
+ */
+class ED25519SignatureFilter {
+public:
+    ED25519SignatureFilter();
+
+    /**
+     * Block signatures of a public key.
+     * @param publicKey the public key to block
+     * @return false if the blacklist is full
+     */
+    bool block(const ED25519PublicKey *publicKey);
+
+    /**
+     * Reject the signatures of the keys on a revocation list as FILTER_BLACKLISTED.
+     * The list is not copied, it must outlive the filter.
+     * @param revocations the revocation list, NULL to unlink it
+     */
+    void link(RevocationList *revocations) { this->revocations = revocations; }
+
+    /**
+     * Run the pre-checks on a signature, without verifying it.
+     * @param signature the signature
+     * @param signatureLength the length of the signature, must be crypto_sign_BYTES
+     * @param publicKey the public key of the signer
+     * @param publicKeyLength the length of the public key, must be crypto_sign_PUBLICKEYBYTES
+     * @return FILTER_PASSED or the reason of the rejection
+     */
+    FilterResult check(const unsigned char *signature, size_t signatureLength,
+                       const unsigned char *publicKey, size_t publicKeyLength);
+
+    /**
+     * Run the pre-checks and verify the signature if they pass. The message is not copied.
+     * @param message the signed message
+     * @param length the length of the message
+     * @param signature the signature
+     * @param signatureLength the length of the signature, must be crypto_sign_BYTES
+     * @param publicKey the public key of the signer
+     * @param publicKeyLength the length of the public key, must be crypto_sign_PUBLICKEYBYTES
+     * @return true if the signature is valid
+     */
+    bool verify(const unsigned char *message, size_t length, const unsigned char *signature, size_t signatureLength,
+                const unsigned char *publicKey, size_t publicKeyLength);
+
+    /**
+     * @return the number of signatures checked
+     */
+    uint32_t checked() const { return checkedCount; }
+
+    /**
+     * @return the number of signatures rejected by the pre-checks
+     */
+    uint32_t rejected() const;
+
+    /**
+     * @param reason the reason of the rejection
+     * @return the number of signatures rejected for the reason
+     */
+    uint32_t rejected(FilterResult reason) const;
+
+    /**
+     * Clear the counters, the blacklist is kept.
+     */
+    void resetCounters();
+
+private:
+    ED25519PublicKey blacklist[SIGNATURE_FILTER_BLACKLIST];
+    size_t blocked;
+    RevocationList *revocations;
+    // the last public key that decoded fine does not need to be decoded again
+    ED25519PublicKey lastKey;
+    bool lastKeyValid;
+    uint32_t checkedCount;
+    uint32_t rejectedCount[FILTER_RESULTS];
+
+    FilterResult precheck(const unsigned char *signature, size_t signatureLength,
+                          const unsigned char *publicKey, size_t publicKeyLength);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SIGNATUREFILTER_H
@@ -0,0 +1,48 @@
+/*!
+ * @file
+ * @brief A non-owning view of a signed key exchange message.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-02-01
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "SignedMessage.h"
+#include "ED25519Backend.h"
+#include "CryptoStats.h"
+
+bool SignedMessageView::verify() const {
+    return valid() && verify(publicKey());
+}
+
+bool SignedMessageView::verify(const ED25519PublicKey &signer) const {
+    CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+    if (!valid()) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+
+    // the signature is checked where it was received
+    const ED25519Segment segment = {payload(), SIGNED_MESSAGE_PAYLOAD_BYTES};
+    if (!ED25519DefaultBackend::verify(signature().signature, signer.key, &segment, 1)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+    return true;
+}
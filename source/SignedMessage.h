@@ -0,0 +1,105 @@
+/*!
+ * @file
+ * @brief A non-owning view of a signed key exchange message.
+ *
+ * The messages of the key exchange have a fixed layout:
+ *
+ * ```
+ * [publicKey (32) | nonce (4) | signature (64)]
+ * ```
+ *
+ * The view checks the length once and hands out the fields as references
+ * into the received buffer. Together with the Base64::Decode() variant that
+ * decodes into a buffer of the caller, a message is verified where it was
+ * received, nothing is allocated or copied.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-02-01
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SIGNEDMESSAGE_H
+#define UBIRCH_MBED_CRYPTO_SIGNEDMESSAGE_H
+
+#include <cstddef>
+#include "KeyPair.h"
+
+#define SIGNED_MESSAGE_NONCE_BYTES 4
+/** The signed part of a message, [publicKey | nonce]. */
+#define SIGNED_MESSAGE_PAYLOAD_BYTES (crypto_sign_PUBLICKEYBYTES + SIGNED_MESSAGE_NONCE_BYTES)
+#define SIGNED_MESSAGE_BYTES (SIGNED_MESSAGE_PAYLOAD_BYTES + crypto_sign_BYTES)
+
+/**
+ * Typed access to a signed message in a buffer, the buffer must outlive the view.
+ * The fields of a view that is not valid() must not be used.
+ *
+ * @code
+ * unsigned char *received = reinterpret_cast<unsigned char *>(value);
+ * size_t length;
+ * if (!base64.Decode(value, strlen(value), received, strlen(value), &length)) return false;
+ * SignedMessageView message(received, length);
+ * if (!message.valid() || !message.verify()) return false;
+ * serverKey.link(&message.publicKey());
+ * @endcode
+ */
+class SignedMessageView {
+public:
+    /**
+     * View a received message.
+     * @param data the message
+     * @param length the length of the message, must be SIGNED_MESSAGE_BYTES
+     */
+    SignedMessageView(const unsigned char *data, size_t length)
+            : data(data != NULL && length == SIGNED_MESSAGE_BYTES ? data : NULL) {}
+
+    /** @return true if the message has the expected length */
+    bool valid() const { return data != NULL; }
+
+    /** @return the public key in the message */
+    const ED25519PublicKey &publicKey() const { return *reinterpret_cast<const ED25519PublicKey *>(data); }
+
+    /** @return the SIGNED_MESSAGE_NONCE_BYTES nonce */
+    const unsigned char *nonce() const { return data + crypto_sign_PUBLICKEYBYTES; }
+
+    /** @return the signed part [publicKey | nonce], SIGNED_MESSAGE_PAYLOAD_BYTES long */
+    const unsigned char *payload() const { return data; }
+
+    /** @return the signature of the payload */
+    const ED25519Signature &signature() const {
+        return *reinterpret_cast<const ED25519Signature *>(data + SIGNED_MESSAGE_PAYLOAD_BYTES);
+    }
+
+    /**
+     * Verify a message that is signed by the key it contains.
+     * @return true if the message is valid and the signature is correct
+     */
+    bool verify() const;
+
+    /**
+     * Verify a message that is signed by another key.
+     * @param signer the public key of the signer
+     * @return true if the message is valid and the signature is correct
+     */
+    bool verify(const ED25519PublicKey &signer) const;
+
+private:
+    const unsigned char *data;
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SIGNEDMESSAGE_H
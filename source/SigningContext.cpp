@@ -0,0 +1,92 @@
+/*!
+ * @file
+ * @brief Precomputed signing context for a key that signs many messages.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-28
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include "SigningContext.h"
+#include "CryptoStats.h"
+
+ED25519SigningContext::ED25519SigningContext() : loaded(false) {
+    clear();
+}
+
+ED25519SigningContext::ED25519SigningContext(ED25519KeyPair &keyPair) : loaded(false) {
+    load(keyPair);
+}
+
+ED25519SigningContext::~ED25519SigningContext() {
+    clear();
+}
+
+bool ED25519SigningContext::load(ED25519KeyPair &keyPair) {
+    clear();
+    const ED25519KeyCache *keys = keyPair.expand();
+    if (keys == NULL) return false;
+
+    memcpy(&expanded, &keys->expanded, sizeof(expanded));
+    memcpy(&publicKey, &keys->publicKey, sizeof(publicKey));
+    prefixed.update(expanded.prefix, sizeof(expanded.prefix));
+    loaded = true;
+
+    return true;
+}
+
+void ED25519SigningContext::clear() {
+    ed25519Wipe(&expanded, sizeof(expanded));
+    ed25519Wipe(&publicKey, sizeof(publicKey));
+    // the hash buffer holds the prefix
+    ed25519Wipe(&prefixed, sizeof(prefixed));
+    prefixed.reset();
+    loaded = false;
+}
+
+bool ED25519SigningContext::sign(const unsigned char *message, size_t length, ED25519Signature &signature) const {
+    const ED25519Segment segment = {message, length};
+    return sign(&segment, 1, signature);
+}
+
+bool ED25519SigningContext::sign(const ED25519Segment *segments, size_t count, ED25519Signature &signature) const {
+    CRYPTO_STATS(CRYPTO_STATS_SIGN);
+    if (!loaded || !ed25519ValidSegments(segments, count)) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+
+    ed25519SignPrefixed(signature.signature, prefixed, &expanded, publicKey.key, segments, count);
+    return true;
+}
+
+ED25519Signature *ED25519SigningContext::sign(const unsigned char *message, size_t length) const {
+    CRYPTO_STATS(CRYPTO_STATS_SIGN);
+    const ED25519Segment segment = {message, length};
+    if (!loaded || !ed25519ValidSegments(&segment, 1)) {
+        CRYPTO_STATS_FAILED();
+        return NULL;
+    }
+
+    ED25519Signature *signature = new ED25519Signature;
+    CRYPTO_STATS_ALLOCATED(sizeof(ED25519Signature));
+    ed25519SignPrefixed(signature->signature, prefixed, &expanded, publicKey.key, &segment, 1);
+
+    return signature;
+}
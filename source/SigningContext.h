@@ -0,0 +1,124 @@
+/*!
+ * @file
+ * @brief Precomputed signing context for a key that signs many messages.
+ *
+ * crypto_sign() hashes the secret key on every signature to get the scalar
+ * and the nonce prefix. The signing context does that once: it keeps its
+ * own copy of the expanded secret, the public key and a SHA-512 state that
+ * already absorbed the prefix. A signature then only hashes the message
+ * twice, for the nonce and for H(R || A || M).
+ *
+ * The context does not use the heap and is independent of the key pair it
+ * was created from. It holds secret key material and wipes it when it is
+ * destroyed, keep it only as long as the key is in use.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-28
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_SIGNINGCONTEXT_H
+#define UBIRCH_MBED_CRYPTO_SIGNINGCONTEXT_H
+
+#include "KeyPair.h"
+#include "SHA512.h"
+
+/**
+ * The expanded secret of a key pair, ready to sign.
+ *
+ * @code
+ * ED25519SigningContext context(keyPair);
+ * ED25519Signature signature;
+ * context.sign(message, length, signature);
+ * @endcode
+ */
+class ED25519SigningContext {
+public:
+    /**
+     * Create an empty context, load() a key pair before signing.
+     */
+    ED25519SigningContext();
+
+    /**
+     * Create the context from a key pair. Check valid(), the key pair may have no private key.
+     * @param keyPair the key pair, it is not used after the context is created
+     */
+    ED25519SigningContext(ED25519KeyPair &keyPair);
+
+    /**
+     * Wipe the secret key material.
+     */
+    ~ED25519SigningContext();
+
+    /**
+     * Replace the key of the context.
+     * @param keyPair the key pair, it is not used after this call
+     * @return false if the key pair has no private key or seed, the context is cleared then
+     */
+    bool load(ED25519KeyPair &keyPair);
+
+    /**
+     * Wipe the secret key material, the context can not sign until a key is loaded again.
+     */
+    void clear();
+
+    bool valid() const { return loaded; }
+
+    const ED25519PublicKey *getPublicKey() const { return loaded ? &publicKey : NULL; }
+
+    /**
+     * Sign a message. The signature is the same as the one of ED25519KeyPair::sign().
+     * @param message the message to sign
+     * @param length the length of the message
+     * @param signature the output buffer for the signature
+     * @return false if there is no key or message
+     */
+    bool sign(const unsigned char *message, size_t length, ED25519Signature &signature) const;
+
+    /**
+     * Sign a message that is spread over several buffers, without concatenating them.
+     * @param segments the message segments, in order
+     * @param count the number of segments
+     * @param signature the output buffer for the signature
+     * @return false if there is no key or a segment is missing
+     */
+    bool sign(const ED25519Segment *segments, size_t count, ED25519Signature &signature) const;
+
+    /**
+     * Sign a message, like ED25519KeyPair::sign().
+     * @param message the message to sign
+     * @param length the length of the message
+     * @returns the signature, it has to be deleted after use
+     * @returns NULL if there is no key or message
+     */
+    ED25519Signature *sign(const unsigned char *message, size_t length) const;
+
+private:
+    ED25519ExpandedKey expanded;
+    ED25519PublicKey publicKey;
+    SHA512 prefixed;
+    bool loaded;
+
+    // not copyable, the secret should exist only once
+    ED25519SigningContext(const ED25519SigningContext &);
+
+    ED25519SigningContext &operator=(const ED25519SigningContext &);
+};
+
+#endif //UBIRCH_MBED_CRYPTO_SIGNINGCONTEXT_H
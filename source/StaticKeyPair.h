@@ -0,0 +1,171 @@
+/*!
+ * @file
+ * @brief Key pairs with the algorithm chosen at compile time.
+ *
+ * The keys are stored inside the object, their sizes come from the
+ * algorithm policy (see Algorithms.h). There are no virtual functions and
+ * no heap allocations, every call goes straight to the algorithm and can
+ * be inlined. ED25519KeyPair is still the choice for keys linked to flash
+ * or seeds; this is the lean alternative for a device with one fixed
+ * algorithm.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-22
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_STATICKEYPAIR_H
+#define UBIRCH_MBED_CRYPTO_STATICKEYPAIR_H
+
+#include <cstring>
+#include "Algorithms.h"
+#include "CryptoStats.h"
+
+/**
+ * A key pair of the algorithm ALGORITHM.
+ *
+ * @code
+ * StaticKeyPair<ED25519Algorithm> keyPair;
+ * keyPair.generate();
+ * unsigned char signature[StaticKeyPair<ED25519Algorithm>::SIGNATURE_BYTES];
+ * keyPair.sign(message, length, signature);
+ * @endcode
+ *
+ * @tparam ALGORITHM the algorithm policy, e.g. ED25519Algorithm
+ */
+template<class ALGORITHM>
+class StaticKeyPair {
+public:
+    typedef ALGORITHM Algorithm;
+
+    enum {
+        PUBLIC_KEY_BYTES = ALGORITHM::PUBLIC_KEY_BYTES,
+        SECRET_KEY_BYTES = ALGORITHM::SECRET_KEY_BYTES
+    };
+
+    /**
+     * Create an empty key pair.
+     */
+    StaticKeyPair() : hasPublicKey(false), hasSecretKey(false) {}
+
+    ~StaticKeyPair() {
+        ed25519Wipe(secretKey, sizeof(secretKey));
+    }
+
+    /**
+     * Generate a new key pair.
+     * @return false if the random number generator failed
+     */
+    bool generate() {
+        CRYPTO_STATS(CRYPTO_STATS_GENERATE);
+        hasPublicKey = hasSecretKey = ALGORITHM::generate(publicKey, secretKey);
+        if (!hasSecretKey) CRYPTO_STATS_FAILED();
+        return hasSecretKey;
+    }
+
+    /**
+     * Import a key pair. The keys are copied.
+     * @return false if a key has the wrong length
+     */
+    bool import(const unsigned char *publicKey, size_t publicKeyLength,
+                const unsigned char *secretKey, size_t secretKeyLength) {
+        if (secretKey == NULL || secretKeyLength != SECRET_KEY_BYTES) return false;
+        if (!importPublicKey(publicKey, publicKeyLength)) return false;
+
+        memcpy(this->secretKey, secretKey, SECRET_KEY_BYTES);
+        hasSecretKey = true;
+        return true;
+    }
+
+    /**
+     * Import only the public key, e.g. to verify signatures of a peer.
+     * @return false if the key has the wrong length
+     */
+    bool importPublicKey(const unsigned char *publicKey, size_t length) {
+        if (publicKey == NULL || length != PUBLIC_KEY_BYTES) return false;
+
+        memcpy(this->publicKey, publicKey, PUBLIC_KEY_BYTES);
+        hasPublicKey = true;
+        return true;
+    }
+
+    /**
+     * @return the public key or NULL if there is none
+     */
+    const unsigned char *getPublicKey() const {
+        return hasPublicKey ? publicKey : NULL;
+    }
+
+    /**
+     * Sign a message. Only available for signature algorithms.
+     * @param message the message
+     * @param length the message length
+     * @param signature the output buffer for ALGORITHM::SIGNATURE_BYTES
+     * @return false if there is no secret key
+     */
+    bool sign(const unsigned char *message, size_t length, unsigned char *signature) const {
+        CRYPTO_STATS(CRYPTO_STATS_SIGN);
+        if (!hasSecretKey || signature == NULL || (message == NULL && length > 0)) {
+            CRYPTO_STATS_FAILED();
+            return false;
+        }
+        ALGORITHM::sign(signature, secretKey, message, length);
+        return true;
+    }
+
+    /**
+     * Verify a signed message. Only available for signature algorithms.
+     * @param message the message
+     * @param length the message length, empty messages are allowed
+     * @param signature the signature
+     * @return true if the signature is valid
+     */
+    bool verify(const unsigned char *message, size_t length, const unsigned char *signature) const {
+        CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+        if (!hasPublicKey || signature == NULL || (message == NULL && length > 0) ||
+            !ALGORITHM::verify(signature, publicKey, message, length)) {
+            CRYPTO_STATS_FAILED();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Agree on a shared secret with a peer. Only available for key agreement algorithms.
+     * @param sharedSecret the output buffer for ALGORITHM::SHARED_SECRET_BYTES
+     * @param peerPublicKey the public key of the peer
+     * @return false if there is no secret key or the peer key is invalid
+     */
+    bool agree(unsigned char *sharedSecret, const unsigned char *peerPublicKey) const {
+        if (!hasSecretKey || sharedSecret == NULL || peerPublicKey == NULL) return false;
+        return ALGORITHM::agree(sharedSecret, secretKey, peerPublicKey);
+    }
+
+private:
+    unsigned char publicKey[PUBLIC_KEY_BYTES];
+    unsigned char secretKey[SECRET_KEY_BYTES];
+    bool hasPublicKey;
+    bool hasSecretKey;
+};
+
+typedef StaticKeyPair<ED25519Algorithm> ED25519StaticKeyPair;
+typedef StaticKeyPair<ED25519phAlgorithm> ED25519phStaticKeyPair;
+typedef StaticKeyPair<X25519Algorithm> X25519StaticKeyPair;
+
+#endif //UBIRCH_MBED_CRYPTO_STATICKEYPAIR_H
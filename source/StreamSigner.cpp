@@ -0,0 +1,129 @@
+/*!
+ * @file
+ * @brief Single pass signing and verification of streamed payloads.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-17
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <nacl/armnacl.h>
+#include "StreamSigner.h"
+#include "CryptoStats.h"
+
+ED25519StreamSigner::ED25519StreamSigner(ED25519KeyPair &keyPair) : keyPair(keyPair), started(false) {}
+
+ED25519StreamSigner::~ED25519StreamSigner() {
+    ed25519Wipe(nonce, sizeof(nonce));
+}
+
+bool ED25519StreamSigner::begin() {
+    started = false;
+    const ED25519KeyCache *keys = keyPair.expand();
+    if (keys == NULL) return false;
+
+    unsigned char random[32];
+    randombytes(random, sizeof(random));
+    ed25519RandomNonce(nonce, commitment, &keys->expanded, random);
+    ed25519Wipe(random, sizeof(random));
+
+    // H(R || A || M), the payload follows chunk by chunk
+    hash.reset();
+    hash.update(commitment, sizeof(commitment));
+    hash.update(keys->publicKey.key, crypto_sign_PUBLICKEYBYTES);
+    started = true;
+
+    return true;
+}
+
+void ED25519StreamSigner::update(const unsigned char *chunk, size_t length) {
+    if (started) hash.update(chunk, length);
+}
+
+bool ED25519StreamSigner::finish(ED25519Signature *signature) {
+    const ED25519KeyCache *keys = keyPair.expand();
+    if (!started || keys == NULL || signature == NULL) return false;
+    started = false;
+
+    unsigned char hram[SHA512_BYTES];
+    hash.finish(hram);
+    memcpy(signature->signature, commitment, sizeof(commitment));
+    ed25519SignFinish(signature->signature + 32, nonce, &keys->expanded, hram);
+    ed25519Wipe(nonce, sizeof(nonce));
+
+    return true;
+}
+
+ED25519StreamVerifier::ED25519StreamVerifier() : started(false) {}
+
+bool ED25519StreamVerifier::begin(const ED25519Signature *signature, const ED25519PublicKey *publicKey) {
+    started = false;
+    if (signature == NULL || publicKey == NULL) return false;
+
+    // keep copies, the receive buffer may be reused for the payload
+    memcpy(this->signature.signature, signature->signature, crypto_sign_BYTES);
+    memcpy(this->publicKey.key, publicKey->key, crypto_sign_PUBLICKEYBYTES);
+
+    // H(R || A || M), the payload follows chunk by chunk
+    hash.reset();
+    hash.update(this->signature.signature, 32);
+    hash.update(this->publicKey.key, crypto_sign_PUBLICKEYBYTES);
+    started = true;
+
+    return true;
+}
+
+void ED25519StreamVerifier::update(const unsigned char *chunk, size_t length) {
+    if (started) hash.update(chunk, length);
+}
+
+bool ED25519StreamVerifier::finish() {
+    CRYPTO_STATS(CRYPTO_STATS_VERIFY);
+    if (!started) {
+        CRYPTO_STATS_FAILED();
+        return false;
+    }
+    started = false;
+
+    unsigned char hram[SHA512_BYTES];
+    hash.finish(hram);
+    const bool valid = ed25519Verify(signature.signature, publicKey.key, hram);
+    if (!valid) CRYPTO_STATS_FAILED();
+
+    return valid;
+}
+
+ED25519Base64Signer::ED25519Base64Signer(ED25519KeyPair &keyPair) : signer(keyPair) {}
+
+bool ED25519Base64Signer::begin() {
+    // drop what may be left from an unfinished payload
+    char rest[4];
+    encoder.Finish(rest);
+    return signer.begin();
+}
+
+size_t ED25519Base64Signer::update(const unsigned char *chunk, size_t length, char *output) {
+    signer.update(chunk, length);
+    return encoder.Update(chunk, length, output);
+}
+
+bool ED25519Base64Signer::finish(char *output, size_t *outputLength, ED25519Signature *signature) {
+    *outputLength = encoder.Finish(output);
+    return signer.finish(signature);
+}
@@ -0,0 +1,179 @@
+/*!
+ * @file
+ * @brief Single pass signing and verification of streamed payloads.
+ *
+ * A regular ED25519 signature hashes the message twice: once for the nonce
+ * r = H(prefix || M) and once for H(R || A || M). For payloads streamed from
+ * external flash that means reading everything twice. The stream signer
+ * uses a random nonce r = H(prefix || random) instead, so R is known before
+ * the first byte and the payload is read exactly once.
+ *
+ * The signatures verify with any ED25519 implementation. They are not
+ * deterministic anymore and rely on randombytes(): if it ever repeats a
+ * value, the private key can be calculated from two signatures.
+ *
+ * The stream verifier checks plain ED25519 signatures of any signer. If the
+ * signature is sent ahead of the payload, R and A are hashed before the
+ * first chunk arrives and hashing overlaps the transfer. Only the scalar
+ * multiplications are left once the last chunk is in.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-17
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_STREAMSIGNER_H
+#define UBIRCH_MBED_CRYPTO_STREAMSIGNER_H
+
+#include "KeyPair.h"
+#include "SHA512.h"
+#include "Base64.h"
+
+/**
+ * Signs a payload chunk by chunk in a single pass.
+ *
+ * @code
+ * ED25519StreamSigner signer(keyPair);
+ * signer.begin();
+ * while (read(chunk, &length)) signer.update(chunk, length);
+ * signer.finish(&signature);
+ * @endcode
+ */
+class ED25519StreamSigner {
+public:
+    ED25519StreamSigner(ED25519KeyPair &keyPair);
+
+    ~ED25519StreamSigner();
+
+    /**
+     * Start a new signature, choosing a fresh nonce.
+     * @return false if the key pair has no private key
+     */
+    bool begin();
+
+    /**
+     * Add the next chunk of the payload.
+     * @param chunk the payload chunk
+     * @param length the length of the chunk
+     */
+    void update(const unsigned char *chunk, size_t length);
+
+    /**
+     * Finish the signature of the payload.
+     * @param signature the output buffer for the signature
+     * @return false if begin() was not called successfully
+     */
+    bool finish(ED25519Signature *signature);
+
+private:
+    ED25519KeyPair &keyPair;
+    SHA512 hash;
+    unsigned char nonce[32];
+    unsigned char commitment[32];
+    bool started;
+};
+
+/**
+ * Verifies the signature of a payload chunk by chunk, as it arrives.
+ *
+ * @code
+ * ED25519StreamVerifier verifier;
+ * verifier.begin(&signature, &publicKey);
+ * while (receive(chunk, &length)) verifier.update(chunk, length);
+ * bool valid = verifier.finish();
+ * @endcode
+ */
+class ED25519StreamVerifier {
+public:
+    ED25519StreamVerifier();
+
+    /**
+     * Start the verification of a new payload.
+     * @param signature the signature of the payload
+     * @param publicKey the public key of the signer
+     * @return false if signature or public key is missing
+     */
+    bool begin(const ED25519Signature *signature, const ED25519PublicKey *publicKey);
+
+    /**
+     * Add the next chunk of the payload.
+     * @param chunk the payload chunk
+     * @param length the length of the chunk
+     */
+    void update(const unsigned char *chunk, size_t length);
+
+    /**
+     * Finish the verification of the payload.
+     * @return true if the signature is valid, false if it is not or begin() was not called successfully
+     */
+    bool finish();
+
+private:
+    SHA512 hash;
+    ED25519Signature signature;
+    ED25519PublicKey publicKey;
+    bool started;
+};
+
+/**
+ * Signs and Base64 encodes a payload in one pass over the data.
+ *
+ * @code
+ * ED25519Base64Signer signer(keyPair);
+ * char out[BASE64_ENCODED_BYTES(sizeof(chunk))];
+ * signer.begin();
+ * while (read(chunk, &length)) send(out, signer.update(chunk, length, out));
+ * signer.finish(out, &outLength, &signature);
+ * send(out, outLength);
+ * @endcode
+ */
+class ED25519Base64Signer {
+public:
+    ED25519Base64Signer(ED25519KeyPair &keyPair);
+
+    /**
+     * Start a new signed and encoded payload.
+     * @return false if the key pair has no private key
+     */
+    bool begin();
+
+    /**
+     * Sign and encode the next chunk of the payload.
+     * @param chunk the payload chunk
+     * @param length the length of the chunk
+     * @param output the buffer for the encoded chunk, BASE64_ENCODED_BYTES(length) long
+     * @return the number of characters written to output
+     */
+    size_t update(const unsigned char *chunk, size_t length, char *output);
+
+    /**
+     * Finish the encoding and the signature.
+     * @param output the buffer for the last 4 encoded characters
+     * @param outputLength the number of characters written to output
+     * @param signature the output buffer for the signature
+     * @return false if begin() was not called successfully
+     */
+    bool finish(char *output, size_t *outputLength, ED25519Signature *signature);
+
+private:
+    ED25519StreamSigner signer;
+    Base64Encoder encoder;
+};
+
+#endif //UBIRCH_MBED_CRYPTO_STREAMSIGNER_H
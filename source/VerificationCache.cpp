@@ -0,0 +1,90 @@
+/*!
+ * @file
+ * @brief Cache of successfully verified signatures.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-13
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "VerificationCache.h"
+#include "SHA512.h"
+
+VerificationCache::VerificationCache(size_t sets)
+        : sets(sets), clock(0), hitCount(0), missCount(0), evictionCount(0) {
+    // the set index is taken from the digest bits, round down to a power of two
+    while (this->sets & (this->sets - 1)) this->sets &= this->sets - 1;
+    if (this->sets == 0) this->sets = 1;
+
+    entries = new VerificationCacheEntry[this->sets * VERIFICATION_CACHE_WAYS];
+    clear();
+}
+
+VerificationCache::~VerificationCache() {
+    delete[] entries;
+}
+
+bool VerificationCache::verify(ED25519KeyPair &keyPair, const unsigned char *message, size_t length,
+                               const ED25519Signature *signature) {
+    const ED25519PublicKey *publicKey = keyPair.getPublicKey();
+    if (publicKey == NULL || message == NULL || length == 0 || signature == NULL) return false;
+
+    unsigned char digest[SHA512_BYTES];
+    SHA512 hash;
+    hash.update(publicKey->key, crypto_sign_PUBLICKEYBYTES);
+    hash.update(signature->signature, crypto_sign_BYTES);
+    hash.update(message, length);
+    hash.finish(digest);
+
+    const size_t index = (digest[0] | (digest[1] << 8)) & (sets - 1);
+    VerificationCacheEntry *set = entries + index * VERIFICATION_CACHE_WAYS;
+
+    // a used stamp of 0 marks an empty entry, the oldest entry is the replacement candidate
+    VerificationCacheEntry *victim = set;
+    for (int way = 0; way < VERIFICATION_CACHE_WAYS; way++) {
+        VerificationCacheEntry *entry = set + way;
+        if (entry->used && !memcmp(entry->digest, digest, VERIFICATION_CACHE_DIGEST_BYTES)) {
+            entry->used = ++clock;
+            hitCount++;
+            return true;
+        }
+        if (entry->used < victim->used) victim = entry;
+    }
+
+    missCount++;
+    if (!keyPair.verify(message, length, signature)) return false;
+
+    if (victim->used) evictionCount++;
+    memcpy(victim->digest, digest, VERIFICATION_CACHE_DIGEST_BYTES);
+    victim->used = ++clock;
+
+    return true;
+}
+
+void VerificationCache::clear() {
+    memset(entries, 0, sets * VERIFICATION_CACHE_WAYS * sizeof(VerificationCacheEntry));
+    clock = 0;
+}
+
+void VerificationCache::resetCounters() {
+    hitCount = 0;
+    missCount = 0;
+    evictionCount = 0;
+}
@@ -0,0 +1,111 @@
+/*!
+ * @file
+ * @brief Cache of successfully verified signatures.
+ *
+ * Retransmitted packets carry the same public key, signature and message.
+ * The cache remembers a digest of recently verified packets, so a copy is
+ * accepted after hashing it once instead of running the full signature
+ * verification again. Only successful verifications are stored, so packets
+ * with bad signatures can neither hit nor evict entries.
+ *
+ * The digest is the first 32 bytes of SHA-512(public key || signature || message),
+ * which keeps a forged packet from colliding with a cached one.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-13
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_VERIFICATIONCACHE_H
+#define UBIRCH_MBED_CRYPTO_VERIFICATIONCACHE_H
+
+#include "KeyPair.h"
+
+#ifndef VERIFICATION_CACHE_WAYS
+#define VERIFICATION_CACHE_WAYS 4
+#endif
+
+#define VERIFICATION_CACHE_DIGEST_BYTES 32
+
+/**
+ * A cache entry, the digest of a verified packet and the time it was last used.
+ */
+typedef struct VerificationCacheEntry {
+    unsigned char digest[VERIFICATION_CACHE_DIGEST_BYTES];
+    uint32_t used;
+} VerificationCacheEntry;
+
+/**
+ * A set associative cache of verified signatures, replacing the least recently used entry of a set.
+ *
+ * @code
+ * VerificationCache cache(8);   // 8 sets of 4 entries, 36 bytes each
+ * if (!cache.verify(peerKey, message, length, signature)) return false;
+ * @endcode
+ */
+class VerificationCache {
+public:
+    /**
+     * Create a cache with sets * VERIFICATION_CACHE_WAYS entries.
+     * @param sets the number of sets, a power of two
+     */
+    VerificationCache(size_t sets = 8);
+
+    ~VerificationCache();
+
+    /**
+     * Verify a signature, returning immediately if the same packet was verified before.
+     * @param keyPair the key pair holding the public key of the sender
+     * @param message the signed message
+     * @param length the length of the message
+     * @param signature the signature to check
+     * @return true if the signature is valid
+     */
+    bool verify(ED25519KeyPair &keyPair, const unsigned char *message, size_t length,
+                const ED25519Signature *signature);
+
+    /**
+     * Drop all cached entries, e.g. when a key was revoked. The counters are kept.
+     */
+    void clear();
+
+    /**
+     * Reset the hit, miss and eviction counters.
+     */
+    void resetCounters();
+
+    /** @return the number of packets accepted from the cache */
+    uint32_t hits() const { return hitCount; }
+
+    /** @return the number of packets that had to be verified */
+    uint32_t misses() const { return missCount; }
+
+    /** @return the number of entries replaced by newer ones */
+    uint32_t evictions() const { return evictionCount; }
+
+private:
+    VerificationCacheEntry *entries;
+    size_t sets;
+    uint32_t clock;
+    uint32_t hitCount;
+    uint32_t missCount;
+    uint32_t evictionCount;
+};
+
+#endif //UBIRCH_MBED_CRYPTO_VERIFICATIONCACHE_H
@@ -0,0 +1,109 @@
+/*!
+ * @file
+ * @brief X25519 key agreement (RFC 7748).
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-22
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstring>
+#include "X25519.h"
+#include "ED25519Core.h"
+
+extern "C" {
+#include "fe25519.h"
+}
+
+// (A - 2) / 4 of curve25519, little endian
+static const unsigned char a24[32] = {0x41, 0xdb, 0x01};
+static const unsigned char basePoint[32] = {9};
+
+// swap a and b if swap is 1, without branching on the secret bit
+static void conditionalSwap(fe25519 *a, fe25519 *b, unsigned char swap) {
+    fe25519 t = *a;
+    fe25519_cmov(a, b, swap);
+    fe25519_cmov(b, &t, swap);
+}
+
+bool x25519(unsigned char *out, const unsigned char *scalar, const unsigned char *point) {
+    unsigned char k[32], u[32];
+    fe25519 x1, x2, z2, x3, z3, A, AA, B, BB, E, C, D, DA, CB, a;
+
+    memcpy(k, scalar, sizeof(k));
+    k[0] &= 248;
+    k[31] &= 127;
+    k[31] |= 64;
+    memcpy(u, point, sizeof(u));
+    u[31] &= 127;
+
+    fe25519_unpack(&x1, u);
+    fe25519_unpack(&a, a24);
+    fe25519_setone(&x2);
+    fe25519_setzero(&z2);
+    x3 = x1;
+    fe25519_setone(&z3);
+
+    unsigned char swap = 0;
+    for (int t = 254; t >= 0; t--) {
+        const unsigned char bit = static_cast<unsigned char>((k[t >> 3] >> (t & 7)) & 1);
+        swap ^= bit;
+        conditionalSwap(&x2, &x3, swap);
+        conditionalSwap(&z2, &z3, swap);
+        swap = bit;
+
+        fe25519_add(&A, &x2, &z2);
+        fe25519_square(&AA, &A);
+        fe25519_sub(&B, &x2, &z2);
+        fe25519_square(&BB, &B);
+        fe25519_sub(&E, &AA, &BB);
+        fe25519_add(&C, &x3, &z3);
+        fe25519_sub(&D, &x3, &z3);
+        fe25519_mul(&DA, &D, &A);
+        fe25519_mul(&CB, &C, &B);
+
+        fe25519_add(&x3, &DA, &CB);
+        fe25519_square(&x3, &x3);
+        fe25519_sub(&z3, &DA, &CB);
+        fe25519_square(&z3, &z3);
+        fe25519_mul(&z3, &z3, &x1);
+        fe25519_mul(&x2, &AA, &BB);
+        fe25519_mul(&z2, &a, &E);
+        fe25519_add(&z2, &z2, &AA);
+        fe25519_mul(&z2, &z2, &E);
+    }
+    conditionalSwap(&x2, &x3, swap);
+    conditionalSwap(&z2, &z3, swap);
+
+    fe25519_invert(&z2, &z2);
+    fe25519_mul(&x2, &x2, &z2);
+    fe25519_pack(out, &x2);
+
+    ed25519Wipe(k, sizeof(k));
+    ed25519Wipe(&x2, sizeof(x2));
+    ed25519Wipe(&x3, sizeof(x3));
+
+    unsigned char zero = 0;
+    for (int i = 0; i < X25519_BYTES; i++) zero |= out[i];
+    return zero != 0;
+}
+
+void x25519Base(unsigned char *publicKey, const unsigned char *scalar) {
+    x25519(publicKey, scalar, basePoint);
+}
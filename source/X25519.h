@@ -0,0 +1,50 @@
+/*!
+ * @file
+ * @brief X25519 key agreement (RFC 7748).
+ *
+ * A Montgomery ladder on top of the NaCl field arithmetic that is
+ * already linked for ED25519, so no second curve implementation is needed.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-22
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_X25519_H
+#define UBIRCH_MBED_CRYPTO_X25519_H
+
+#define X25519_BYTES 32
+
+/**
+ * Multiply a point by a scalar. The scalar is clamped as required by X25519.
+ * @param out the output buffer for the resulting u-coordinate
+ * @param scalar the 32 byte secret scalar
+ * @param point the 32 byte u-coordinate of the point, e.g. the peer public key
+ * @return false if the result is all zero (the peer sent a low order point)
+ */
+bool x25519(unsigned char *out, const unsigned char *scalar, const unsigned char *point);
+
+/**
+ * Calculate the public key of a secret scalar, the product with the base point.
+ * @param publicKey the output buffer for the 32 byte public key
+ * @param scalar the 32 byte secret scalar
+ */
+void x25519Base(unsigned char *publicKey, const unsigned char *scalar);
+
+#endif //UBIRCH_MBED_CRYPTO_X25519_H
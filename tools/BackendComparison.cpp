@@ -0,0 +1,252 @@
+/*!
+ * @file
+ * @brief Host comparison of the ED25519 backends.
+ *
+ * Runs the NaCl backend of the device and the ref10 backends of
+ * tools/backend through the same operations:
+ *
+ * - the RFC 8032 test vector
+ * - keys and signatures of random seeds and messages, which must be equal
+ *   across all backends
+ * - valid signatures, flipped bits in signatures and public keys, and a
+ *   public key that is not on the curve, which all backends must judge alike
+ *
+ * and prints the cycles per operation of each. The exit status is 1 if any
+ * backend differs.
+ *
+ * ```
+ * make -C tools backend-comparison
+ * tools/backend-comparison [rounds]
+ * ```
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-29
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <ctime>
+#endif
+
+#include <nacl/armnacl.h>
+#include "ED25519Backend.h"
+#include "Ref10Backend.h"
+
+#define DEFAULT_ROUNDS 256
+#define BENCHMARK_ROUNDS 100
+#define MESSAGE_SIZE 256
+#define MAX_BACKENDS 3
+
+// RFC 8032, 7.1 TEST 1
+static const unsigned char rfcSecretKey[ED25519_SEED_BYTES + crypto_sign_PUBLICKEYBYTES] = {
+        0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+        0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60,
+        0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+        0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a
+};
+static const unsigned char rfcSignature[crypto_sign_BYTES] = {
+        0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+        0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+        0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+        0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b
+};
+
+// the operations of one backend, to run all of them through the same checks
+typedef struct Backend {
+    const char *name;
+    void (*derivePublicKey)(unsigned char *, const ED25519ExpandedKey *);
+    void (*sign)(unsigned char *, const ED25519ExpandedKey *, const unsigned char *, const ED25519Segment *, size_t);
+    bool (*verify)(const unsigned char *, const unsigned char *, const ED25519Segment *, size_t);
+} Backend;
+
+template<class B>
+static Backend backend() {
+    const Backend b = {B::name(), &B::derivePublicKey, &B::sign, &B::verify};
+    return b;
+}
+
+static Backend backends[MAX_BACKENDS];
+static size_t backendCount = 0;
+static unsigned char message[MESSAGE_SIZE];
+static FILE *randomFile;
+static int failures = 0;
+
+static void fail(const char *backend, const char *check, int round) {
+    fprintf(stderr, "%s: %s differs (round %d)\n", backend, check, round);
+    failures++;
+}
+
+static bool readRandom(void *buffer, size_t length) {
+    return fread(buffer, 1, length, randomFile) == length;
+}
+
+static unsigned long long cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+static void checkTestVector() {
+    ED25519ExpandedKey expanded;
+    ed25519Expand(&expanded, rfcSecretKey);
+    const ED25519Segment empty = {NULL, 0};
+
+    for (size_t i = 0; i < backendCount; i++) {
+        unsigned char publicKey[crypto_sign_PUBLICKEYBYTES];
+        unsigned char signature[crypto_sign_BYTES];
+        backends[i].derivePublicKey(publicKey, &expanded);
+        if (memcmp(publicKey, rfcSecretKey + ED25519_SEED_BYTES, sizeof(publicKey))) {
+            fail(backends[i].name, "RFC 8032 public key", 0);
+        }
+        backends[i].sign(signature, &expanded, publicKey, &empty, 1);
+        if (memcmp(signature, rfcSignature, sizeof(signature))) fail(backends[i].name, "RFC 8032 signature", 0);
+        if (!backends[i].verify(signature, publicKey, &empty, 1)) fail(backends[i].name, "RFC 8032 verify", 0);
+    }
+    ed25519Wipe(&expanded, sizeof(expanded));
+}
+
+static bool checkDifferential(int rounds) {
+    unsigned char seed[ED25519_SEED_BYTES];
+    unsigned char publicKey[MAX_BACKENDS][crypto_sign_PUBLICKEYBYTES];
+    unsigned char signature[MAX_BACKENDS][crypto_sign_BYTES];
+    ED25519ExpandedKey expanded;
+
+    for (int round = 0; round < rounds; round++) {
+        if (!readRandom(seed, sizeof(seed))) return false;
+        ed25519Expand(&expanded, seed);
+        const ED25519Segment segment = {message, static_cast<size_t>(round % (MESSAGE_SIZE + 1))};
+
+        for (size_t i = 0; i < backendCount; i++) {
+            backends[i].derivePublicKey(publicKey[i], &expanded);
+            backends[i].sign(signature[i], &expanded, publicKey[i], &segment, 1);
+            if (memcmp(publicKey[0], publicKey[i], crypto_sign_PUBLICKEYBYTES)) {
+                fail(backends[i].name, "public key", round);
+            }
+            if (memcmp(signature[0], signature[i], crypto_sign_BYTES)) fail(backends[i].name, "signature", round);
+        }
+
+        // all backends agree on valid and invalid signatures
+        unsigned char invalidSignature[crypto_sign_BYTES];
+        unsigned char invalidKey[crypto_sign_PUBLICKEYBYTES];
+        memcpy(invalidSignature, signature[0], sizeof(invalidSignature));
+        invalidSignature[round % crypto_sign_BYTES] ^= 1 << (round % 8);
+        memcpy(invalidKey, publicKey[0], sizeof(invalidKey));
+        invalidKey[round % crypto_sign_PUBLICKEYBYTES] ^= 1 << (round % 8);
+        for (size_t i = 0; i < backendCount; i++) {
+            if (!backends[i].verify(signature[0], publicKey[0], &segment, 1)) {
+                fail(backends[i].name, "valid signature", round);
+            }
+            if (backends[i].verify(invalidSignature, publicKey[0], &segment, 1)) {
+                fail(backends[i].name, "invalid signature", round);
+            }
+            if (backends[i].verify(signature[0], invalidKey, &segment, 1)) {
+                fail(backends[i].name, "invalid public key", round);
+            }
+        }
+    }
+    ed25519Wipe(&expanded, sizeof(expanded));
+
+    // y = 2 is not on the curve
+    const unsigned char invalid[crypto_sign_PUBLICKEYBYTES] = {2};
+    const ED25519Segment segment = {message, MESSAGE_SIZE};
+    for (size_t i = 0; i < backendCount; i++) {
+        if (backends[i].verify(signature[0], invalid, &segment, 1)) fail(backends[i].name, "point off the curve", 0);
+    }
+    return true;
+}
+
+static bool benchmark() {
+    unsigned char seed[ED25519_SEED_BYTES];
+    unsigned char publicKey[crypto_sign_PUBLICKEYBYTES];
+    unsigned char signature[crypto_sign_BYTES];
+    ED25519ExpandedKey expanded;
+    const ED25519Segment segment = {message, 64};
+    if (!readRandom(seed, sizeof(seed))) return false;
+    ed25519Expand(&expanded, seed);
+
+    printf("64 byte message, cycles per operation (default %s)\n", ED25519DefaultBackend::name());
+    for (size_t i = 0; i < backendCount; i++) {
+        unsigned long long start = cycles();
+        for (int n = 0; n < BENCHMARK_ROUNDS; n++) backends[i].derivePublicKey(publicKey, &expanded);
+        const unsigned long long generateCycles = cycles() - start;
+
+        start = cycles();
+        for (int n = 0; n < BENCHMARK_ROUNDS; n++) backends[i].sign(signature, &expanded, publicKey, &segment, 1);
+        const unsigned long long signCycles = cycles() - start;
+
+        bool valid = true;
+        start = cycles();
+        for (int n = 0; n < BENCHMARK_ROUNDS; n++) valid &= backends[i].verify(signature, publicKey, &segment, 1);
+        const unsigned long long verifyCycles = cycles() - start;
+        if (!valid) fail(backends[i].name, "benchmark verify", 0);
+
+        printf("%-10s generate %10llu, sign %10llu, verify %10llu\n", backends[i].name,
+               generateCycles / BENCHMARK_ROUNDS, signCycles / BENCHMARK_ROUNDS, verifyCycles / BENCHMARK_ROUNDS);
+    }
+    ed25519Wipe(&expanded, sizeof(expanded));
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    if (argc > 2 || rounds <= 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    randomFile = fopen("/dev/urandom", "rb");
+    if (!randomFile) {
+        perror("/dev/urandom");
+        return 1;
+    }
+
+    backends[backendCount++] = backend<ED25519ArmNaClBackend>();
+    backends[backendCount++] = backend<ED25519Ref10Backend>();
+#ifdef ED25519_BACKEND_REF10_RADIX51_AVAILABLE
+    backends[backendCount++] = backend<ED25519Ref10Radix51Backend>();
+#endif
+
+    bool ok = readRandom(message, sizeof(message));
+    if (ok) {
+        checkTestVector();
+        ok = checkDifferential(rounds) && benchmark();
+    }
+    fclose(randomFile);
+    if (!ok) {
+        perror("/dev/urandom");
+        return 1;
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d checks differ\n", failures);
+        return 1;
+    }
+    printf("%d rounds, all %u backends agree\n", rounds, (unsigned) backendCount);
+    return 0;
+}
@@ -0,0 +1,382 @@
+/*!
+ * @file
+ * @brief Bulk key provisioning for a production batch.
+ *
+ * Generates an ED25519 key pair and a signed registration record for every
+ * device of a batch, on all cores of the host. The registration record is
+ * the `pubKeyInfo` JSON of the key service, signed by the device key, as
+ * the device would create it itself:
+ *
+ * ```
+ * {"hwDeviceId":"...","pubKey":"<base64>","pubKeyId":"","algorithm":"ECC_ED25519",
+ *  "previousPubKeyId":"","created":"...","validNotBefore":"...","validNotAfter":"..."}
+ * ```
+ *
+ * The records of the batch go into one binary image that can be memory mapped
+ * by the registration backend. All numbers are little endian:
+ *
+ * ```
+ * header (32):  ['UBPK' | version (2) | entry size (2) | count (4) | created (4)
+ *                | string offset (4) | string length (4) | reserved (8)]
+ * entry (112):  [publicKey (32) | signature (64) | info offset (4) | id offset (4)
+ *                | info length (2) | id length (2) | reserved (4)]
+ * strings:      [hwDeviceId | pubKeyInfo] of every device, in entry order
+ * ```
+ *
+ * The offsets count from the start of the image. The image holds no secrets.
+ * With -d, the key pair of every device is also written to `<dir>/<hwDeviceId>.bin`,
+ * an erased FlashKeyStore area with the key in slot 0, ready to be programmed
+ * into the key store region of the device. Existing blobs are never overwritten,
+ * unless -F is given. tools/provisioning.py lists, verifies and exports the image.
+ *
+ * Build it on the host together with the NaCl sources (plain C), see
+ * tools/Makefile. The tool provides randombytes() from /dev/urandom:
+ *
+ * ```
+ * make -C tools key-provisioning
+ * tools/key-provisioning -n 10000 -p batch7- -o batch7.img -d batch7
+ * ```
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-27
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <set>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "FlashKeyStore.h"
+
+#define IMAGE_MAGIC "UBPK"
+#define IMAGE_VERSION 1
+#define HEADER_BYTES 32
+#define ENTRY_BYTES 112
+#define ENTRY_SIGNATURE crypto_sign_PUBLICKEYBYTES
+#define ENTRY_OFFSETS (ENTRY_SIGNATURE + crypto_sign_BYTES)
+
+#define ID_MAX 255
+#define INFO_MAX 1024
+#define VALIDITY_YEARS 5
+// devices a worker takes at a time, the seeds of a block are read at once
+#define BLOCK 64
+
+static const char *const infoTemplate = "{"
+        "\"hwDeviceId\":\"%s\","
+        "\"pubKey\":\"%s\","
+        "\"pubKeyId\":\"\","
+        "\"algorithm\":\"ECC_ED25519\","
+        "\"previousPubKeyId\":\"\","
+        "\"created\":\"%s\","
+        "\"validNotBefore\":\"%s\","
+        "\"validNotAfter\":\"%s\""
+        "}";
+
+static std::vector<std::string> ids;
+static unsigned char *image = NULL;
+static char created[80], validNotAfter[80];
+static const char *blobDirectory = NULL;
+static bool replaceBlobs = false;
+static size_t blobSize = 8192, blobSector = 4096, blobProgram = 8;
+static size_t next = 0;
+static unsigned long failed = 0;
+static int randomFd = -1;
+
+extern "C" void randombytes(unsigned char *x, unsigned long long xlen) {
+    while (xlen > 0) {
+        const ssize_t n = read(randomFd, x, static_cast<size_t>(xlen));
+        if (n <= 0) {
+            perror("/dev/urandom");
+            abort();
+        }
+        x += n;
+        xlen -= static_cast<unsigned long long>(n);
+    }
+}
+
+static void put16(unsigned char *p, uint16_t value) {
+    p[0] = static_cast<unsigned char>(value);
+    p[1] = static_cast<unsigned char>(value >> 8);
+}
+
+static void put32(unsigned char *p, uint32_t value) {
+    put16(p, static_cast<uint16_t>(value));
+    put16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+static uint32_t get32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void base64(char *out, const unsigned char *data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < length; i += 3) {
+        const uint32_t group = (data[i] << 16) | (i + 1 < length ? data[i + 1] << 8 : 0) |
+                               (i + 2 < length ? data[i + 2] : 0);
+        *out++ = alphabet[(group >> 18) & 0x3F];
+        *out++ = alphabet[(group >> 12) & 0x3F];
+        *out++ = i + 1 < length ? alphabet[(group >> 6) & 0x3F] : '=';
+        *out++ = i + 2 < length ? alphabet[group & 0x3F] : '=';
+    }
+    *out = '\0';
+}
+
+static void timestamp(char *out, size_t length, time_t time, int addYears) {
+    struct tm t;
+    gmtime_r(&time, &t);
+    snprintf(out, length, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", t.tm_year + 1900 + addYears, t.tm_mon + 1,
+             t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, 0);
+}
+
+static size_t formatInfo(char *out, size_t length, const char *id, const unsigned char *publicKey) {
+    char pubKey[(crypto_sign_PUBLICKEYBYTES + 2) / 3 * 4 + 1];
+    base64(pubKey, publicKey, crypto_sign_PUBLICKEYBYTES);
+    return static_cast<size_t>(snprintf(out, length, infoTemplate, id, pubKey, created, created, validNotAfter));
+}
+
+static bool validId(const std::string &id) {
+    if (id.empty() || id.size() > ID_MAX || id == "." || id == "..") return false;
+    for (size_t i = 0; i < id.size(); i++) {
+        const char c = id[i];
+        if (c < 0x20 || c > 0x7E || c == '"' || c == '\\' || c == '/') return false;
+    }
+    return true;
+}
+
+static std::string blobPath(const std::string &id) {
+    return std::string(blobDirectory) + "/" + id + ".bin";
+}
+
+static bool writeBlob(const std::string &id, const unsigned char *publicKey, const unsigned char *seed) {
+    const std::string path = blobPath(id);
+    // the blob may hold the only copy of a key that is registered already
+    if (!replaceBlobs && access(path.c_str(), F_OK) == 0) {
+        fprintf(stderr, "%s: exists, not overwritten\n", path.c_str());
+        return false;
+    }
+    unlink(path.c_str());
+
+    ED25519PublicKey pk;
+    ED25519PrivateKey sk;
+    memcpy(pk.key, publicKey, sizeof(pk.key));
+    memcpy(sk.key, seed, ED25519_SEED_BYTES);
+    memcpy(sk.key + ED25519_SEED_BYTES, publicKey, crypto_sign_PUBLICKEYBYTES);
+
+    // a new file is an erased storage area
+    FileFlashStorage storage(path.c_str(), blobSize, blobSector, blobProgram);
+    FlashKeyStore store(storage);
+    const bool written = storage.isOpen() && store.mount() && store.store(0, pk, sk);
+    ed25519Wipe(&sk, sizeof(sk));
+    if (!written) fprintf(stderr, "%s: could not write the key store\n", path.c_str());
+
+    return written;
+}
+
+static bool provision(size_t index, const unsigned char *seed) {
+    unsigned char *entry = image + HEADER_BYTES + index * ENTRY_BYTES;
+    unsigned char *publicKey = entry;
+
+    ED25519ExpandedKey expanded;
+    ed25519Expand(&expanded, seed);
+    ed25519DerivePublicKey(publicKey, &expanded);
+
+    // the string table has room for exactly this record, without the terminating zero
+    char info[INFO_MAX];
+    const size_t infoLength = formatInfo(info, sizeof(info), ids[index].c_str(), publicKey);
+    memcpy(image + get32(entry + ENTRY_OFFSETS), info, infoLength);
+    ed25519Sign(entry + ENTRY_SIGNATURE, &expanded, publicKey, reinterpret_cast<unsigned char *>(info), infoLength);
+    ed25519Wipe(&expanded, sizeof(expanded));
+
+    return blobDirectory == NULL || writeBlob(ids[index], publicKey, seed);
+}
+
+static void *worker(void *) {
+    unsigned char seeds[BLOCK * ED25519_SEED_BYTES];
+    unsigned long errors = 0;
+
+    for (;;) {
+        const size_t first = __sync_fetch_and_add(&next, BLOCK);
+        if (first >= ids.size()) break;
+        const size_t n = first + BLOCK > ids.size() ? ids.size() - first : BLOCK;
+
+        randombytes(seeds, n * ED25519_SEED_BYTES);
+        for (size_t i = 0; i < n; i++) errors += !provision(first + i, seeds + i * ED25519_SEED_BYTES);
+    }
+    ed25519Wipe(seeds, sizeof(seeds));
+
+    __sync_fetch_and_add(&failed, errors);
+    return NULL;
+}
+
+static bool readIds(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    // the same id twice would register two keys for one device and overwrite its blob
+    std::set<std::string> seen;
+    bool unique = true;
+    char line[ID_MAX + 3];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        const size_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        if (length == 0) continue;
+        if (!seen.insert(line).second) {
+            fprintf(stderr, "%s: duplicate hwDeviceId '%s'\n", path, line);
+            unique = false;
+        }
+        ids.push_back(line);
+    }
+    fclose(f);
+    return unique;
+}
+
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s -o image (-n count [-p prefix] | -i ids) [-d blobs [-F] [-f size] [-e sector] [-w program]]"
+            " [-t threads]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL, *idFile = NULL, *prefix = "device-";
+    long count = 0;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int option;
+    while ((option = getopt(argc, argv, "o:n:p:i:d:Ff:e:w:t:")) != -1) {
+        if (option == 'o') output = optarg;
+        else if (option == 'n') count = strtol(optarg, NULL, 10);
+        else if (option == 'p') prefix = optarg;
+        else if (option == 'i') idFile = optarg;
+        else if (option == 'd') blobDirectory = optarg;
+        else if (option == 'F') replaceBlobs = true;
+        else if (option == 'f') blobSize = strtoul(optarg, NULL, 0);
+        else if (option == 'e') blobSector = strtoul(optarg, NULL, 0);
+        else if (option == 'w') blobProgram = strtoul(optarg, NULL, 0);
+        else if (option == 't') threads = strtol(optarg, NULL, 10);
+        else usage(argv[0]);
+    }
+    if (output == NULL || threads < 1 || (idFile == NULL) == (count < 1)) usage(argv[0]);
+
+    if (idFile != NULL && !readIds(idFile)) return 1;
+    for (long i = 0; i < count; i++) {
+        char id[ID_MAX + 1];
+        snprintf(id, sizeof(id), "%s%08ld", prefix, i);
+        ids.push_back(id);
+    }
+    if (ids.empty()) usage(argv[0]);
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (!validId(ids[i])) {
+            fprintf(stderr, "invalid hwDeviceId '%s'\n", ids[i].c_str());
+            return 1;
+        }
+    }
+
+    if (blobDirectory != NULL && mkdir(blobDirectory, 0755) != 0 && errno != EEXIST) {
+        perror(blobDirectory);
+        return 1;
+    }
+    // refuse before any key is generated, a half written batch is worse than none
+    for (size_t i = 0; blobDirectory != NULL && !replaceBlobs && i < ids.size(); i++) {
+        const std::string path = blobPath(ids[i]);
+        if (access(path.c_str(), F_OK) == 0) {
+            fprintf(stderr, "%s: exists, use -F to overwrite the blobs of the batch\n", path.c_str());
+            return 1;
+        }
+    }
+    randomFd = open("/dev/urandom", O_RDONLY);
+    if (randomFd < 0) {
+        perror("/dev/urandom");
+        return 1;
+    }
+    const time_t batchTime = time(NULL);
+    timestamp(created, sizeof(created), batchTime, 0);
+    timestamp(validNotAfter, sizeof(validNotAfter), batchTime, VALIDITY_YEARS);
+
+    // the lengths of the records only depend on the ids, so the string table is laid out up front
+    char info[INFO_MAX];
+    const unsigned char noKey[crypto_sign_PUBLICKEYBYTES] = {0};
+    const size_t infoBase = formatInfo(info, sizeof(info), "", noKey);
+    const size_t stringOffset = HEADER_BYTES + ids.size() * ENTRY_BYTES;
+    size_t imageSize = stringOffset;
+    for (size_t i = 0; i < ids.size(); i++) imageSize += 2 * ids[i].size() + infoBase;
+    if (imageSize > 0xFFFFFFFFu) {
+        fprintf(stderr, "batch too large for one image\n");
+        return 1;
+    }
+
+    image = static_cast<unsigned char *>(calloc(imageSize, 1));
+    if (image == NULL) {
+        perror("image");
+        return 1;
+    }
+    memcpy(image, IMAGE_MAGIC, 4);
+    put16(image + 4, IMAGE_VERSION);
+    put16(image + 6, ENTRY_BYTES);
+    put32(image + 8, static_cast<uint32_t>(ids.size()));
+    put32(image + 12, static_cast<uint32_t>(batchTime));
+    put32(image + 16, static_cast<uint32_t>(stringOffset));
+    put32(image + 20, static_cast<uint32_t>(imageSize - stringOffset));
+    size_t offset = stringOffset;
+    for (size_t i = 0; i < ids.size(); i++) {
+        unsigned char *entry = image + HEADER_BYTES + i * ENTRY_BYTES;
+        memcpy(image + offset, ids[i].data(), ids[i].size());
+        put32(entry + ENTRY_OFFSETS + 4, static_cast<uint32_t>(offset));
+        put16(entry + ENTRY_OFFSETS + 10, static_cast<uint16_t>(ids[i].size()));
+        offset += ids[i].size();
+        put32(entry + ENTRY_OFFSETS, static_cast<uint32_t>(offset));
+        put16(entry + ENTRY_OFFSETS + 8, static_cast<uint16_t>(infoBase + ids[i].size()));
+        offset += infoBase + ids[i].size();
+    }
+
+    const double start = now();
+    std::vector<pthread_t> workers(static_cast<size_t>(threads));
+    for (long i = 0; i < threads; i++) pthread_create(&workers[i], NULL, worker, NULL);
+    for (long i = 0; i < threads; i++) pthread_join(workers[i], NULL);
+    const double elapsed = now() - start;
+    close(randomFd);
+
+    FILE *f = fopen(output, "wb");
+    bool saved = f != NULL && fwrite(image, 1, imageSize, f) == imageSize;
+    if (f != NULL && fclose(f) != 0) saved = false;
+    if (!saved) perror(output);
+    free(image);
+
+    fprintf(stderr, "%lu devices in %.2fs on %ld threads: %.0f keys/s, %lu bytes image%s, %lu failed\n",
+            static_cast<unsigned long>(ids.size()), elapsed, threads, ids.size() / elapsed,
+            static_cast<unsigned long>(imageSize), blobDirectory != NULL ? " and flash blobs" : "", failed);
+    return saved && failed == 0 ? 0 : 1;
+}
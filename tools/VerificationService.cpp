@@ -0,0 +1,337 @@
+/*!
+ * @file
+ * @brief Native verification service for signed key exchange messages.
+ *
+ * The server side of the key exchange verifies signed messages
+ * `[publicKey (32) | nonce (4)]`. This service does that on all cores of
+ * the host, using the same ED25519 code as the device library, and streams
+ * the results back as soon as they are ready. The signer is sent along,
+ * as the server message of the exchange is signed by the device.
+ *
+ * Protocol on the Unix stream socket, all numbers big endian:
+ *
+ * ```
+ * request:  [id (4) | signer (32) | publicKey (32) | nonce (4) | signature (64)]
+ * response: [id (4) | status (1)]        status 1 = valid, 0 = invalid
+ * ```
+ *
+ * Requests can be pipelined, the responses arrive in the order the
+ * verifications finish, not in the order of the requests. The client
+ * side is TESTS/host_tests/verification.py.
+ *
+ * Every worker thread has its own queue. The connection readers deal the
+ * requests out round robin, a worker that runs out of work steals half of
+ * the queue of another worker. Workers verify up to SHA512_LANES messages
+ * at once with ed25519VerifyBatch().
+ *
+ * Build it on the host together with the NaCl sources (plain C), see
+ * tools/Makefile:
+ *
+ * ```
+ * make -C tools verification-service
+ * tools/verification-service -s /tmp/ubirch-verify.sock
+ * ```
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-19
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "BatchVerifier.h"
+#include "SHA512x4.h"
+#include "SignedMessage.h"
+
+#define REQUEST_BYTES (4 + crypto_sign_PUBLICKEYBYTES + SIGNED_MESSAGE_BYTES)
+#define RESPONSE_BYTES 5
+
+#define DEFAULT_SOCKET "/tmp/ubirch-verify.sock"
+
+class Connection;
+
+struct Job {
+    Connection *connection;
+    unsigned char request[REQUEST_BYTES];
+};
+
+/**
+ * A client connection. It is deleted when the client closed it and
+ * all its jobs are done.
+ */
+class Connection {
+public:
+    Connection(int fd) : fd(fd), references(1), broken(false) {
+        pthread_mutex_init(&writeLock, NULL);
+    }
+
+    ~Connection() {
+        close(fd);
+        pthread_mutex_destroy(&writeLock);
+    }
+
+    int socket() const { return fd; }
+
+    void acquire() { __sync_fetch_and_add(&references, 1); }
+
+    void release() {
+        if (__sync_sub_and_fetch(&references, 1) == 0) delete this;
+    }
+
+    void respond(const unsigned char *id, bool valid) {
+        unsigned char response[RESPONSE_BYTES] = {id[0], id[1], id[2], id[3], static_cast<unsigned char>(valid)};
+        pthread_mutex_lock(&writeLock);
+        size_t written = 0;
+        while (!broken && written < sizeof(response)) {
+            const ssize_t n = send(fd, response + written, sizeof(response) - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) broken = true;
+            else written += static_cast<size_t>(n);
+        }
+        pthread_mutex_unlock(&writeLock);
+    }
+
+private:
+    int fd;
+    int references;
+    bool broken;
+    pthread_mutex_t writeLock;
+};
+
+/**
+ * The job queue of a worker. The owner takes the oldest jobs from the
+ * front, thieves take the newest ones from the back.
+ */
+class WorkQueue {
+public:
+    WorkQueue() { pthread_mutex_init(&lock, NULL); }
+
+    ~WorkQueue() { pthread_mutex_destroy(&lock); }
+
+    void push(Job *job) {
+        pthread_mutex_lock(&lock);
+        jobs.push_back(job);
+        pthread_mutex_unlock(&lock);
+    }
+
+    size_t take(Job **batch, size_t max) {
+        pthread_mutex_lock(&lock);
+        size_t n = 0;
+        while (n < max && !jobs.empty()) {
+            batch[n++] = jobs.front();
+            jobs.pop_front();
+        }
+        pthread_mutex_unlock(&lock);
+        return n;
+    }
+
+    size_t steal(WorkQueue &victim) {
+        std::vector<Job *> loot;
+        pthread_mutex_lock(&victim.lock);
+        const size_t n = (victim.jobs.size() + 1) / 2;
+        for (size_t i = 0; i < n; i++) {
+            loot.push_back(victim.jobs.back());
+            victim.jobs.pop_back();
+        }
+        pthread_mutex_unlock(&victim.lock);
+
+        pthread_mutex_lock(&lock);
+        for (size_t i = loot.size(); i > 0; i--) jobs.push_back(loot[i - 1]);
+        pthread_mutex_unlock(&lock);
+        return n;
+    }
+
+private:
+    pthread_mutex_t lock;
+    std::deque<Job *> jobs;
+};
+
+static volatile sig_atomic_t running = 1;
+static std::vector<WorkQueue *> queues;
+static pthread_mutex_t idleLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idleCondition = PTHREAD_COND_INITIALIZER;
+static size_t queued = 0;
+static size_t nextQueue = 0;
+static unsigned long verified = 0, rejected = 0, steals = 0;
+
+static void submit(Job *job) {
+    const size_t q = __sync_fetch_and_add(&nextQueue, 1) % queues.size();
+
+    // count the job before a worker can see it, the count must never drop below the jobs taken
+    pthread_mutex_lock(&idleLock);
+    queued++;
+    queues[q]->push(job);
+    pthread_cond_signal(&idleCondition);
+    pthread_mutex_unlock(&idleLock);
+}
+
+static void *worker(void *arg) {
+    const size_t self = reinterpret_cast<size_t>(arg);
+    WorkQueue &queue = *queues[self];
+    Job *batch[SHA512_LANES];
+    ED25519VerifyJob jobs[SHA512_LANES];
+
+    while (running) {
+        size_t n = queue.take(batch, SHA512_LANES);
+        for (size_t i = 1; n == 0 && i < queues.size(); i++) {
+            if (queue.steal(*queues[(self + i) % queues.size()]) == 0) continue;
+            __sync_fetch_and_add(&steals, 1);
+            n = queue.take(batch, SHA512_LANES);
+        }
+
+        pthread_mutex_lock(&idleLock);
+        queued -= n;
+        if (n == 0) {
+            while (queued == 0 && running) pthread_cond_wait(&idleCondition, &idleLock);
+            pthread_mutex_unlock(&idleLock);
+            continue;
+        }
+        pthread_mutex_unlock(&idleLock);
+
+        for (size_t i = 0; i < n; i++) {
+            const unsigned char *signer = batch[i]->request + 4;
+            const SignedMessageView message(signer + crypto_sign_PUBLICKEYBYTES, SIGNED_MESSAGE_BYTES);
+            jobs[i].publicKey = reinterpret_cast<const ED25519PublicKey *>(signer);
+            jobs[i].message = message.payload();
+            jobs[i].length = SIGNED_MESSAGE_PAYLOAD_BYTES;
+            jobs[i].signature = &message.signature();
+        }
+        const size_t valid = ed25519VerifyBatch(jobs, n);
+        __sync_fetch_and_add(&verified, valid);
+        __sync_fetch_and_add(&rejected, n - valid);
+
+        for (size_t i = 0; i < n; i++) {
+            batch[i]->connection->respond(batch[i]->request, jobs[i].valid);
+            batch[i]->connection->release();
+            delete batch[i];
+        }
+    }
+    return NULL;
+}
+
+static void *reader(void *arg) {
+    Connection *connection = static_cast<Connection *>(arg);
+    unsigned char buffer[64 * REQUEST_BYTES];
+    size_t buffered = 0;
+
+    while (running) {
+        const ssize_t n = recv(connection->socket(), buffer + buffered, sizeof(buffer) - buffered, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffered += static_cast<size_t>(n);
+
+        size_t offset = 0;
+        for (; buffered - offset >= REQUEST_BYTES; offset += REQUEST_BYTES) {
+            Job *job = new Job;
+            job->connection = connection;
+            memcpy(job->request, buffer + offset, REQUEST_BYTES);
+            connection->acquire();
+            submit(job);
+        }
+        buffered -= offset;
+        memmove(buffer, buffer + offset, buffered);
+    }
+
+    // the responses of pending jobs may still go out
+    shutdown(connection->socket(), SHUT_RD);
+    connection->release();
+    return NULL;
+}
+
+static void stop(int) {
+    running = 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-s socket] [-t threads]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *path = DEFAULT_SOCKET;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int option;
+    while ((option = getopt(argc, argv, "s:t:")) != -1) {
+        if (option == 's') path = optarg;
+        else if (option == 't') threads = strtol(optarg, NULL, 10);
+        else usage(argv[0]);
+    }
+    if (threads < 1) usage(argv[0]);
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) usage(argv[0]);
+    strcpy(address.sun_path, path);
+
+    const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (server < 0 || bind(server, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(server, 16) < 0) {
+        perror(path);
+        return 1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    std::vector<pthread_t> workers(static_cast<size_t>(threads));
+    for (long i = 0; i < threads; i++) queues.push_back(new WorkQueue());
+    for (long i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, worker, reinterpret_cast<void *>(static_cast<size_t>(i)));
+    fprintf(stderr, "verifying on %s with %ld threads%s\n", path, threads,
+            sha512x4Vectorized() ? ", vectorized hashing" : "");
+
+    while (running) {
+        struct pollfd p = {server, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0) continue;
+        const int fd = accept(server, NULL, NULL);
+        if (fd < 0) continue;
+
+        pthread_t thread;
+        Connection *connection = new Connection(fd);
+        if (pthread_create(&thread, NULL, reader, connection) != 0) {
+            connection->release();
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    pthread_mutex_lock(&idleLock);
+    pthread_cond_broadcast(&idleCondition);
+    pthread_mutex_unlock(&idleLock);
+    for (size_t i = 0; i < workers.size(); i++) pthread_join(workers[i], NULL);
+
+    close(server);
+    unlink(path);
+    fprintf(stderr, "%lu valid, %lu invalid, %lu steals\n", verified, rejected, steals);
+    return 0;
+}
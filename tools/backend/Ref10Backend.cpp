@@ -0,0 +1,155 @@
+/*!
+ * @file
+ * @brief ED25519 backends on the ref10 code of BoringSSL, for host builds.
+ *
+ * Both backends share the hashing and the order of the operations, they only
+ * call into the two builds of Ref10Curve.c.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-29
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#include <stdint.h>
+#include "Ref10Backend.h"
+#include "SHA512.h"
+
+// the two builds of Ref10Curve.c
+extern "C" {
+void ref10_25_scalarmult_base(uint8_t out[32], const uint8_t scalar[32]);
+int ref10_25_commitment(uint8_t out[32], const uint8_t publicKey[32], const uint8_t k[32], const uint8_t s[32]);
+void ref10_25_reduce(uint8_t s[64]);
+void ref10_25_muladd(uint8_t s[32], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]);
+#ifdef ED25519_BACKEND_REF10_RADIX51_AVAILABLE
+void ref10_51_scalarmult_base(uint8_t out[32], const uint8_t scalar[32]);
+int ref10_51_commitment(uint8_t out[32], const uint8_t publicKey[32], const uint8_t k[32], const uint8_t s[32]);
+void ref10_51_reduce(uint8_t s[64]);
+void ref10_51_muladd(uint8_t s[32], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]);
+#endif
+}
+
+struct Radix25 {
+    static void scalarmultBase(uint8_t *out, const uint8_t *scalar) { ref10_25_scalarmult_base(out, scalar); }
+
+    static int commitment(uint8_t *out, const uint8_t *publicKey, const uint8_t *k, const uint8_t *s) {
+        return ref10_25_commitment(out, publicKey, k, s);
+    }
+
+    static void reduce(uint8_t *s) { ref10_25_reduce(s); }
+
+    static void muladd(uint8_t *s, const uint8_t *a, const uint8_t *b, const uint8_t *c) {
+        ref10_25_muladd(s, a, b, c);
+    }
+};
+
+#ifdef ED25519_BACKEND_REF10_RADIX51_AVAILABLE
+
+struct Radix51 {
+    static void scalarmultBase(uint8_t *out, const uint8_t *scalar) { ref10_51_scalarmult_base(out, scalar); }
+
+    static int commitment(uint8_t *out, const uint8_t *publicKey, const uint8_t *k, const uint8_t *s) {
+        return ref10_51_commitment(out, publicKey, k, s);
+    }
+
+    static void reduce(uint8_t *s) { ref10_51_reduce(s); }
+
+    static void muladd(uint8_t *s, const uint8_t *a, const uint8_t *b, const uint8_t *c) {
+        ref10_51_muladd(s, a, b, c);
+    }
+};
+
+#endif
+
+// k = H(R || A || M) mod L, in the first 32 bytes of the digest
+template<class Curve>
+static void hram(unsigned char *digest, const unsigned char *R, const unsigned char *publicKey,
+                 const ED25519Segment *segments, size_t count) {
+    SHA512 hash;
+    hash.update(R, 32);
+    hash.update(publicKey, 32);
+    for (size_t i = 0; i < count; i++) hash.update(segments[i].data, segments[i].length);
+    hash.finish(digest);
+    Curve::reduce(digest);
+}
+
+template<class Curve>
+static void sign(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                 const ED25519Segment *segments, size_t count) {
+    unsigned char r[SHA512_BYTES], k[SHA512_BYTES];
+
+    // r = H(prefix || M), R = rB
+    SHA512 hash;
+    hash.update(expanded->prefix, sizeof(expanded->prefix));
+    for (size_t i = 0; i < count; i++) hash.update(segments[i].data, segments[i].length);
+    hash.finish(r);
+    Curve::reduce(r);
+    Curve::scalarmultBase(signature, r);
+
+    // S = r + ka
+    hram<Curve>(k, signature, publicKey, segments, count);
+    Curve::muladd(signature + 32, k, expanded->scalar, r);
+
+    ed25519Wipe(r, sizeof(r));
+}
+
+template<class Curve>
+static bool verify(const unsigned char *signature, const unsigned char *publicKey,
+                   const ED25519Segment *segments, size_t count) {
+    unsigned char k[SHA512_BYTES], check[32];
+
+    if (signature[63] & 224) return false;
+    hram<Curve>(k, signature, publicKey, segments, count);
+    if (!Curve::commitment(check, publicKey, k, signature + 32)) return false;
+
+    unsigned char difference = 0;
+    for (size_t i = 0; i < sizeof(check); i++) difference |= check[i] ^ signature[i];
+    return difference == 0;
+}
+
+void ED25519Ref10Backend::derivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded) {
+    Radix25::scalarmultBase(publicKey, expanded->scalar);
+}
+
+void ED25519Ref10Backend::sign(unsigned char *signature, const ED25519ExpandedKey *expanded,
+                               const unsigned char *publicKey, const ED25519Segment *segments, size_t count) {
+    ::sign<Radix25>(signature, expanded, publicKey, segments, count);
+}
+
+bool ED25519Ref10Backend::verify(const unsigned char *signature, const unsigned char *publicKey,
+                                 const ED25519Segment *segments, size_t count) {
+    return ::verify<Radix25>(signature, publicKey, segments, count);
+}
+
+#ifdef ED25519_BACKEND_REF10_RADIX51_AVAILABLE
+
+void ED25519Ref10Radix51Backend::derivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded) {
+    Radix51::scalarmultBase(publicKey, expanded->scalar);
+}
+
+void ED25519Ref10Radix51Backend::sign(unsigned char *signature, const ED25519ExpandedKey *expanded,
+                                      const unsigned char *publicKey, const ED25519Segment *segments, size_t count) {
+    ::sign<Radix51>(signature, expanded, publicKey, segments, count);
+}
+
+bool ED25519Ref10Radix51Backend::verify(const unsigned char *signature, const unsigned char *publicKey,
+                                        const ED25519Segment *segments, size_t count) {
+    return ::verify<Radix51>(signature, publicKey, segments, count);
+}
+
+#endif
@@ -0,0 +1,92 @@
+/*!
+ * @file
+ * @brief ED25519 backends on the ref10 code of BoringSSL, for host builds.
+ *
+ * The same interface as the backends in source/ED25519Backend.h, with the
+ * group and scalar arithmetic of ref10 as vendored in boringssl/:
+ *
+ * - ED25519Ref10Backend: field elements as 10 limbs of 25.5 bits, portable C
+ *   that only needs 32x32 bit multiplications
+ * - ED25519Ref10Radix51Backend: field elements as 5 limbs of 51 bits with 128
+ *   bit products, the representation of ed25519-donna on 64 bit hosts (gcc and
+ *   clang on 64 bit targets)
+ *
+ * tools/BackendComparison.cpp compares them with the NaCl backend. To build
+ * the library itself on one of them, configure the host build with
+ * `-DED25519_BACKEND_HEADER='"Ref10Backend.h"' -DED25519_BACKEND=ED25519_BACKEND_REF10_RADIX51
+ * -Itools/backend` and link the objects tools/Makefile builds from Ref10Curve.c.
+ *
+ * As ref10, verification rejects signatures with any of the top three bits
+ * of S set. Signatures that pass that check are judged like the NaCl backend.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-29
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#ifndef UBIRCH_MBED_CRYPTO_REF10BACKEND_H
+#define UBIRCH_MBED_CRYPTO_REF10BACKEND_H
+
+#include "ED25519Core.h"
+
+#define ED25519_BACKEND_REF10 2
+#define ED25519_BACKEND_REF10_RADIX51 3
+
+#ifdef __SIZEOF_INT128__
+#define ED25519_BACKEND_REF10_RADIX51_AVAILABLE 1
+#endif
+
+struct ED25519Ref10Backend {
+    static const char *name() { return "ref10"; }
+
+    static void derivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded);
+
+    static void sign(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                     const ED25519Segment *segments, size_t count);
+
+    static bool verify(const unsigned char *signature, const unsigned char *publicKey,
+                       const ED25519Segment *segments, size_t count);
+};
+
+#ifdef ED25519_BACKEND_REF10_RADIX51_AVAILABLE
+
+struct ED25519Ref10Radix51Backend {
+    static const char *name() { return "ref10-51"; }
+
+    static void derivePublicKey(unsigned char *publicKey, const ED25519ExpandedKey *expanded);
+
+    static void sign(unsigned char *signature, const ED25519ExpandedKey *expanded, const unsigned char *publicKey,
+                     const ED25519Segment *segments, size_t count);
+
+    static bool verify(const unsigned char *signature, const unsigned char *publicKey,
+                       const ED25519Segment *segments, size_t count);
+};
+
+#endif
+
+#if defined(ED25519_BACKEND) && ED25519_BACKEND == ED25519_BACKEND_REF10
+typedef ED25519Ref10Backend ED25519DefaultBackend;
+#elif defined(ED25519_BACKEND) && ED25519_BACKEND == ED25519_BACKEND_REF10_RADIX51
+#ifndef ED25519_BACKEND_REF10_RADIX51_AVAILABLE
+#error "ED25519_BACKEND_REF10_RADIX51 needs 128 bit integers"
+#endif
+typedef ED25519Ref10Radix51Backend ED25519DefaultBackend;
+#endif
+
+#endif //UBIRCH_MBED_CRYPTO_REF10BACKEND_H
@@ -0,0 +1,92 @@
+/*!
+ * @file
+ * @brief Byte level group operations on the ref10 code of BoringSSL.
+ *
+ * Compiled twice, with REF10_RADIX=25 (ref10, 10 limbs of 25.5 bits) and
+ * REF10_RADIX=51 (5 limbs of 51 bits with 128 bit products, the layout of
+ * ed25519-donna on 64 bit hosts). The field arithmetic of both is generated
+ * by fiat-crypto, see boringssl/README.md. The exported functions of
+ * curve25519.c get a prefix per build, so both link into one program.
+ *
+ * @author Matthias L. Jugel
+ * @date   2018-01-29
+ *
+ * @copyright &copy; 2018 ubirch GmbH (https://ubirch.com)
+ *
+ * @section LICENSE
+ * ```
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ```
+ */
+
+#if REF10_RADIX == 51
+#define REF10(name) ref10_51_##name
+#elif REF10_RADIX == 25
+#define REF10(name) ref10_25_##name
+#else
+#error "define REF10_RADIX as 25 or 51"
+#endif
+
+#define k25519Precomp REF10(k25519Precomp)
+#define x25519_fe_invert REF10(fe_invert)
+#define x25519_fe_isnegative REF10(fe_isnegative)
+#define x25519_fe_mul_ttt REF10(fe_mul_ttt)
+#define x25519_fe_neg REF10(fe_neg)
+#define x25519_fe_tobytes REF10(fe_tobytes)
+#define x25519_ge_double_scalarmult_vartime REF10(ge_double_scalarmult_vartime)
+#define x25519_ge_frombytes_vartime REF10(ge_frombytes_vartime)
+#define x25519_ge_scalarmult_base REF10(ge_scalarmult_base)
+#define x25519_public_from_private_generic_masked REF10(public_from_private_generic_masked)
+#define x25519_sc_mask REF10(sc_mask)
+#define x25519_sc_muladd REF10(sc_muladd)
+#define x25519_sc_reduce REF10(sc_reduce)
+#define x25519_scalar_mult_generic_masked REF10(scalar_mult_generic_masked)
+
+#include "boringssl/crypto/curve25519/curve25519.c"
+
+// the encoding of a point: y, with the sign of x in the top bit
+static void encode(uint8_t s[32], const fe *X, const fe *Y, const fe *Z) {
+  fe recip, x, y;
+  x25519_fe_invert(&recip, Z);
+  x25519_fe_mul_ttt(&x, X, &recip);
+  x25519_fe_mul_ttt(&y, Y, &recip);
+  x25519_fe_tobytes(s, &y);
+  s[31] ^= x25519_fe_isnegative(&x) << 7;
+}
+
+void REF10(scalarmult_base)(uint8_t out[32], const uint8_t scalar[32]) {
+  ge_p3 A;
+  x25519_ge_scalarmult_base(&A, scalar, 0);
+  encode(out, &A.X, &A.Y, &A.Z);
+}
+
+int REF10(commitment)(uint8_t out[32], const uint8_t publicKey[32], const uint8_t k[32], const uint8_t s[32]) {
+  ge_p3 A;
+  ge_p2 R;
+
+  // R' = sB - kA, the decoding gives A, not -A as in ref10
+  if (!x25519_ge_frombytes_vartime(&A, publicKey)) return 0;
+  x25519_fe_neg(&A.X);
+  x25519_fe_neg(&A.T);
+  x25519_ge_double_scalarmult_vartime(&R, k, &A, s);
+  encode(out, &R.X, &R.Y, &R.Z);
+  return 1;
+}
+
+void REF10(reduce)(uint8_t s[64]) {
+  x25519_sc_reduce(s);
+}
+
+void REF10(muladd)(uint8_t s[32], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]) {
+  x25519_sc_muladd(s, a, b, c);
+}
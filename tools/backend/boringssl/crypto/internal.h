@@ -0,0 +1,64 @@
+// Stands in for the crypto/internal.h of ring when curve25519.c is built for
+// tools/backend: the constant time helpers curve25519.c uses, as in ring.
+
+#ifndef OPENSSL_HEADER_CRYPTO_INTERNAL_H
+#define OPENSSL_HEADER_CRYPTO_INTERNAL_H
+
+#include <assert.h>
+#include <ring-core/base.h>
+
+#if defined(OPENSSL_64_BIT)
+typedef uint64_t crypto_word_t;
+#else
+typedef uint32_t crypto_word_t;
+#endif
+
+// returns |a|, but keeps the compiler from reasoning about the value
+static inline crypto_word_t value_barrier_w(crypto_word_t a) {
+  __asm__("" : "+r"(a) : /* no inputs */);
+  return a;
+}
+
+static inline uint32_t value_barrier_u32(uint32_t a) {
+  __asm__("" : "+r"(a) : /* no inputs */);
+  return a;
+}
+
+// the given value with the MSB copied to all the other bits
+static inline crypto_word_t constant_time_msb_w(crypto_word_t a) {
+  return 0u - (a >> (sizeof(a) * 8 - 1));
+}
+
+// 0xff..f if a == 0 and 0 otherwise
+static inline crypto_word_t constant_time_is_zero_w(crypto_word_t a) {
+  return constant_time_msb_w(~a & (a - 1));
+}
+
+// 0xff..f if a == b and 0 otherwise
+static inline crypto_word_t constant_time_eq_w(crypto_word_t a, crypto_word_t b) {
+  return constant_time_is_zero_w(a ^ b);
+}
+
+// xors |n| bytes from |src| to |dst| if |mask| is 0xff..ff, nothing if it is 0
+static inline void constant_time_conditional_memxor(void *dst, const void *src, size_t n,
+                                                    const crypto_word_t mask) {
+  uint8_t *out = (uint8_t *)dst;
+  const uint8_t *in = (const uint8_t *)src;
+  for (size_t i = 0; i < n; i++) {
+    out[i] ^= value_barrier_w(mask) & in[i];
+  }
+}
+
+// only used for the constant time validation of BoringSSL
+#define CONSTTIME_DECLASSIFY(ptr, len)
+#define declassify_assert(expr) assert(expr)
+
+static inline void *OPENSSL_memcpy(void *dst, const void *src, size_t n) {
+  return n == 0 ? dst : memcpy(dst, src, n);
+}
+
+static inline void *OPENSSL_memset(void *dst, int c, size_t n) {
+  return n == 0 ? dst : memset(dst, c, n);
+}
+
+#endif  // OPENSSL_HEADER_CRYPTO_INTERNAL_H
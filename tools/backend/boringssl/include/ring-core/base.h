@@ -0,0 +1,28 @@
+// Stands in for the ring-core/base.h of ring when curve25519.c is built for
+// tools/backend. Only the word size is configured here: REF10_RADIX 51 selects
+// the 64 bit field arithmetic (5 limbs of 51 bits, needs 128 bit products),
+// anything else the 32 bit one of ref10 (10 limbs of 25.5 bits).
+
+#ifndef OPENSSL_HEADER_BASE_H
+#define OPENSSL_HEADER_BASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(REF10_RADIX) && REF10_RADIX == 51
+#if !defined(__SIZEOF_INT128__)
+#error "the 51 bit field arithmetic needs 128 bit integers"
+#endif
+#define OPENSSL_64_BIT
+#define BORINGSSL_HAS_UINT128
+#else
+#define OPENSSL_32_BIT
+#endif
+
+// the plain C code only, no assembler and no ADX
+#define OPENSSL_NO_ASM
+
+#define OPENSSL_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+
+#endif  // OPENSSL_HEADER_BASE_H
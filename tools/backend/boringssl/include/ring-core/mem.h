@@ -0,0 +1,20 @@
+// Stands in for the ring-core/mem.h of ring when curve25519.c is built for
+// tools/backend.
+
+#ifndef OPENSSL_HEADER_MEM_H
+#define OPENSSL_HEADER_MEM_H
+
+#include "base.h"
+
+// returns zero iff the |len| bytes at |a| and |b| are equal, in constant time
+static inline int CRYPTO_memcmp(const void *a, const void *b, size_t len) {
+  const uint8_t *x = (const uint8_t *)a;
+  const uint8_t *y = (const uint8_t *)b;
+  uint8_t difference = 0;
+  for (size_t i = 0; i < len; i++) {
+    difference |= x[i] ^ y[i];
+  }
+  return difference;
+}
+
+#endif  // OPENSSL_HEADER_MEM_H
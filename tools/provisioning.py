@@ -0,0 +1,103 @@
+"""
+Reader of the batch images written by tools/KeyProvisioning.cpp.
+
+Usage:
+  python provisioning.py list <image>
+  python provisioning.py verify <image> [blobs]
+  python provisioning.py export <image>
+
+`verify` checks the signature of every registration record and, given the
+directory of flash blobs, that each blob holds the key of its device. It
+needs the ed25519 package. `export` prints the registration messages of the
+key service, one JSON message per line.
+"""
+import base64
+import mmap
+import os
+import struct
+import sys
+
+MAGIC = b"UBPK"
+HEADER = struct.Struct("<4sHHIIII8x")
+ENTRY = struct.Struct("<32s64sIIHH4x")
+FLASH_RECORD = struct.Struct("<IHHII32s64s16x")
+FLASH_MAGIC = 0x534B4255
+FLASH_KEY = 0x00A5
+
+
+class BatchImage(object):
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, self.entry_size, self.count, self.created, _, _ = HEADER.unpack_from(self.data, 0)
+        if magic != MAGIC or version != 1 or self.entry_size < ENTRY.size:
+            raise ValueError("%s is not a batch image" % path)
+
+    def close(self):
+        self.data.close()
+
+    def __len__(self):
+        return self.count
+
+    def __getitem__(self, index):
+        """returns (hwDeviceId, public key, signature, pubKeyInfo)"""
+        if not 0 <= index < self.count:
+            raise IndexError(index)
+        public_key, signature, info_offset, id_offset, info_length, id_length = \
+            ENTRY.unpack_from(self.data, HEADER.size + index * self.entry_size)
+        device_id = self.data[id_offset:id_offset + id_length].decode("ascii")
+        return device_id, public_key, signature, self.data[info_offset:info_offset + info_length]
+
+    def __iter__(self):
+        for index in range(self.count):
+            yield self[index]
+
+
+def blob_key(path):
+    """returns the public and private key of slot 0 of a flash blob"""
+    with open(path, "rb") as f:
+        magic, slot, flags, _, _, public_key, private_key = FLASH_RECORD.unpack(f.read(FLASH_RECORD.size))
+    if magic != FLASH_MAGIC or slot != 0 or flags != FLASH_KEY:
+        raise ValueError("%s has no key in slot 0" % path)
+    return public_key, private_key
+
+
+def verify(image, blobs=None):
+    import ed25519
+    errors = 0
+    for device_id, public_key, signature, info in image:
+        try:
+            ed25519.VerifyingKey(public_key).verify(signature, info)
+            if blobs:
+                # signatures are deterministic, the key of the blob signs the record the same way
+                blob_public, blob_private = blob_key(os.path.join(blobs, device_id + ".bin"))
+                if blob_public != public_key or ed25519.SigningKey(blob_private).sign(bytes(info)) != signature:
+                    raise ValueError("flash blob holds another key")
+        except (ed25519.BadSignatureError, ValueError, IOError) as e:
+            print("%s: %s" % (device_id, str(e) or "bad signature"))
+            errors += 1
+    print("%d devices, %d errors" % (len(image), errors))
+    return errors == 0
+
+
+def export(image):
+    for _, _, signature, info in image:
+        sys.stdout.write('{"pubKeyInfo":%s,"signature":"%s","previousPubKeySignature":""}\n' %
+                         (info.decode("ascii"), base64.b64encode(signature).decode("ascii")))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3 or sys.argv[1] not in ("list", "verify", "export"):
+        print(__doc__)
+        sys.exit(1)
+    batch = BatchImage(sys.argv[2])
+    ok = True
+    if sys.argv[1] == "list":
+        for entry in batch:
+            print("%s %s" % (entry[0], base64.b64encode(entry[1]).decode("ascii")))
+    elif sys.argv[1] == "verify":
+        ok = verify(batch, sys.argv[3] if len(sys.argv) > 3 else None)
+    else:
+        export(batch)
+    batch.close()
+    sys.exit(0 if ok else 1)